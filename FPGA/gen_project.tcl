@@ -33,7 +33,7 @@
 #    "./srcs/sources_1/RAM_DDR3.vhd"
 #    "./srcs/sources_1/ddr3_simple_ui.vhd"
 #    "./srcs/sources_1/fixed_float_pkg/fixed_pkg_c.vhdl"
-#    "./srcs/sources_1/SDP_RAM_64x32b.vhd"
+#    "./srcs/sources_1/SDP_RAM_512x32b.vhd"
 #    "./srcs/sources_1/lut_delay.vhd"
 #    "./srcs/sources_1/rand_gen.vhd"
 #    "./srcs/sources_1/angle_gen.vhd"
@@ -54,6 +54,21 @@
 #    "./srcs/sources_1/ip/mig_ddr3/mig_a.prj"
 #    "./srcs/sources_1/ip/clk_wiz_0/clk_wiz_0.xci"
 #    "./srcs/sources_1/mavg.vhd"
+#    "./srcs/sources_1/minmax_pyramid.vhd"
+#    "./srcs/sources_1/event_search.vhd"
+#    "./srcs/sources_1/trig_interp.vhd"
+#    "./srcs/sources_1/spi_queue.vhd"
+#    "./srcs/sources_1/awg_stream.vhd"
+#    "./srcs/sources_1/awg_sweep.vhd"
+#    "./srcs/sources_1/fra_core.vhd"
+#    "./srcs/sources_1/proto_decoder.vhd"
+#    "./srcs/sources_1/pattern_stream.vhd"
+#    "./srcs/sources_1/ets_tdc.vhd"
+#    "./srcs/sources_1/ilv_correct.vhd"
+#    "./srcs/sources_1/frame_meas.vhd"
+#    "./srcs/sources_1/mask_test.vhd"
+#    "./srcs/sources_1/hist_engine.vhd"
+#    "./srcs/sources_1/la_transition.vhd"
 #    "./srcs/sources_1/ip/fifo_gen_0/fifo_gen_0.xci"
 #    "./srcs/sources_1/ip/mig_ddr3/mig_ddr3.xci"
 #    "./srcs/sources_1/ip/cordic_0/cordic_0.xci"
@@ -82,6 +97,21 @@
 #    "./srcs/sources_1/timer_tb.vhd"
 #    "./srcs/sources_1/mavg_tb.vhd"
 #    "./srcs/sources_1/LA_core_tb.vhdl"
+#    "./srcs/sources_1/minmax_pyramid_tb.vhd"
+#    "./srcs/sources_1/event_search_tb.vhd"
+#    "./srcs/sources_1/trig_interp_tb.vhd"
+#    "./srcs/sources_1/spi_queue_tb.vhd"
+#    "./srcs/sources_1/awg_stream_tb.vhd"
+#    "./srcs/sources_1/awg_sweep_tb.vhd"
+#    "./srcs/sources_1/fra_core_tb.vhd"
+#    "./srcs/sources_1/proto_decoder_tb.vhd"
+#    "./srcs/sources_1/pattern_stream_tb.vhd"
+#    "./srcs/sources_1/ets_tdc_tb.vhd"
+#    "./srcs/sources_1/ilv_correct_tb.vhd"
+#    "./srcs/sources_1/frame_meas_tb.vhd"
+#    "./srcs/sources_1/mask_test_tb.vhd"
+#    "./srcs/sources_1/hist_engine_tb.vhd"
+#    "./srcs/sources_1/la_transition_tb.vhd"
 #
 #*****************************************************************************************
 
@@ -197,7 +227,7 @@ set files [list \
  [file normalize "${origin_dir}/srcs/sources_1/RAM_DDR3.vhd"] \
  [file normalize "${origin_dir}/srcs/sources_1/ddr3_simple_ui.vhd"] \
  [file normalize "${origin_dir}/srcs/sources_1/fixed_float_pkg/fixed_pkg_c.vhdl"] \
- [file normalize "${origin_dir}/srcs/sources_1/SDP_RAM_64x32b.vhd"] \
+ [file normalize "${origin_dir}/srcs/sources_1/SDP_RAM_512x32b.vhd"] \
  [file normalize "${origin_dir}/srcs/sources_1/lut_delay.vhd"] \
  [file normalize "${origin_dir}/srcs/sources_1/rand_gen.vhd"] \
  [file normalize "${origin_dir}/srcs/sources_1/angle_gen.vhd"] \
@@ -218,6 +248,21 @@ set files [list \
  [file normalize "${origin_dir}/srcs/sources_1/ip/mig_ddr3/mig_a.prj"] \
  [file normalize "${origin_dir}/srcs/sources_1/ip/clk_wiz_0/clk_wiz_0.xci"] \
  [file normalize "${origin_dir}/srcs/sources_1/mavg.vhd"] \
+ [file normalize "${origin_dir}/srcs/sources_1/minmax_pyramid.vhd"] \
+ [file normalize "${origin_dir}/srcs/sources_1/event_search.vhd"] \
+ [file normalize "${origin_dir}/srcs/sources_1/trig_interp.vhd"] \
+ [file normalize "${origin_dir}/srcs/sources_1/spi_queue.vhd"] \
+ [file normalize "${origin_dir}/srcs/sources_1/awg_stream.vhd"] \
+ [file normalize "${origin_dir}/srcs/sources_1/awg_sweep.vhd"] \
+ [file normalize "${origin_dir}/srcs/sources_1/fra_core.vhd"] \
+ [file normalize "${origin_dir}/srcs/sources_1/proto_decoder.vhd"] \
+ [file normalize "${origin_dir}/srcs/sources_1/pattern_stream.vhd"] \
+ [file normalize "${origin_dir}/srcs/sources_1/ets_tdc.vhd"] \
+ [file normalize "${origin_dir}/srcs/sources_1/ilv_correct.vhd"] \
+ [file normalize "${origin_dir}/srcs/sources_1/frame_meas.vhd"] \
+ [file normalize "${origin_dir}/srcs/sources_1/mask_test.vhd"] \
+ [file normalize "${origin_dir}/srcs/sources_1/hist_engine.vhd"] \
+ [file normalize "${origin_dir}/srcs/sources_1/la_transition.vhd"] \
 ]
 add_files -norecurse -fileset $obj $files
 
@@ -254,7 +299,7 @@ set file_obj [get_files -of_objects [get_filesets sources_1] [list "*$file"]]
 set_property -name "file_type" -value "VHDL" -objects $file_obj
 set_property -name "library" -value "ieee_proposed" -objects $file_obj
 
-set file "$origin_dir/srcs/sources_1/SDP_RAM_64x32b.vhd"
+set file "$origin_dir/srcs/sources_1/SDP_RAM_512x32b.vhd"
 set file [file normalize $file]
 set file_obj [get_files -of_objects [get_filesets sources_1] [list "*$file"]]
 set_property -name "file_type" -value "VHDL" -objects $file_obj
@@ -364,6 +409,81 @@ set file [file normalize $file]
 set file_obj [get_files -of_objects [get_filesets sources_1] [list "*$file"]]
 set_property -name "file_type" -value "VHDL" -objects $file_obj
 
+set file "$origin_dir/srcs/sources_1/minmax_pyramid.vhd"
+set file [file normalize $file]
+set file_obj [get_files -of_objects [get_filesets sources_1] [list "*$file"]]
+set_property -name "file_type" -value "VHDL" -objects $file_obj
+
+set file "$origin_dir/srcs/sources_1/event_search.vhd"
+set file [file normalize $file]
+set file_obj [get_files -of_objects [get_filesets sources_1] [list "*$file"]]
+set_property -name "file_type" -value "VHDL" -objects $file_obj
+
+set file "$origin_dir/srcs/sources_1/trig_interp.vhd"
+set file [file normalize $file]
+set file_obj [get_files -of_objects [get_filesets sources_1] [list "*$file"]]
+set_property -name "file_type" -value "VHDL" -objects $file_obj
+
+set file "$origin_dir/srcs/sources_1/spi_queue.vhd"
+set file [file normalize $file]
+set file_obj [get_files -of_objects [get_filesets sources_1] [list "*$file"]]
+set_property -name "file_type" -value "VHDL" -objects $file_obj
+
+set file "$origin_dir/srcs/sources_1/awg_stream.vhd"
+set file [file normalize $file]
+set file_obj [get_files -of_objects [get_filesets sources_1] [list "*$file"]]
+set_property -name "file_type" -value "VHDL" -objects $file_obj
+
+set file "$origin_dir/srcs/sources_1/awg_sweep.vhd"
+set file [file normalize $file]
+set file_obj [get_files -of_objects [get_filesets sources_1] [list "*$file"]]
+set_property -name "file_type" -value "VHDL" -objects $file_obj
+
+set file "$origin_dir/srcs/sources_1/fra_core.vhd"
+set file [file normalize $file]
+set file_obj [get_files -of_objects [get_filesets sources_1] [list "*$file"]]
+set_property -name "file_type" -value "VHDL" -objects $file_obj
+
+set file "$origin_dir/srcs/sources_1/proto_decoder.vhd"
+set file [file normalize $file]
+set file_obj [get_files -of_objects [get_filesets sources_1] [list "*$file"]]
+set_property -name "file_type" -value "VHDL" -objects $file_obj
+
+set file "$origin_dir/srcs/sources_1/pattern_stream.vhd"
+set file [file normalize $file]
+set file_obj [get_files -of_objects [get_filesets sources_1] [list "*$file"]]
+set_property -name "file_type" -value "VHDL" -objects $file_obj
+
+set file "$origin_dir/srcs/sources_1/ets_tdc.vhd"
+set file [file normalize $file]
+set file_obj [get_files -of_objects [get_filesets sources_1] [list "*$file"]]
+set_property -name "file_type" -value "VHDL" -objects $file_obj
+
+set file "$origin_dir/srcs/sources_1/ilv_correct.vhd"
+set file [file normalize $file]
+set file_obj [get_files -of_objects [get_filesets sources_1] [list "*$file"]]
+set_property -name "file_type" -value "VHDL" -objects $file_obj
+
+set file "$origin_dir/srcs/sources_1/frame_meas.vhd"
+set file [file normalize $file]
+set file_obj [get_files -of_objects [get_filesets sources_1] [list "*$file"]]
+set_property -name "file_type" -value "VHDL" -objects $file_obj
+
+set file "$origin_dir/srcs/sources_1/mask_test.vhd"
+set file [file normalize $file]
+set file_obj [get_files -of_objects [get_filesets sources_1] [list "*$file"]]
+set_property -name "file_type" -value "VHDL" -objects $file_obj
+
+set file "$origin_dir/srcs/sources_1/hist_engine.vhd"
+set file [file normalize $file]
+set file_obj [get_files -of_objects [get_filesets sources_1] [list "*$file"]]
+set_property -name "file_type" -value "VHDL" -objects $file_obj
+
+set file "$origin_dir/srcs/sources_1/la_transition.vhd"
+set file [file normalize $file]
+set file_obj [get_files -of_objects [get_filesets sources_1] [list "*$file"]]
+set_property -name "file_type" -value "VHDL" -objects $file_obj
+
 
 # Set 'sources_1' fileset file properties for local files
 # None
@@ -779,6 +899,426 @@ set_property -name "top" -value "LA_core_tb" -objects $obj
 set_property -name "top_auto_set" -value "0" -objects $obj
 set_property -name "top_lib" -value "xil_defaultlib" -objects $obj
 
+# Create 'minmax_pyramid_tb' fileset (if not found)
+if {[string equal [get_filesets -quiet minmax_pyramid_tb] ""]} {
+  create_fileset -simset minmax_pyramid_tb
+}
+
+# Set 'minmax_pyramid_tb' fileset object
+set obj [get_filesets minmax_pyramid_tb]
+set files [list \
+ [file normalize "${origin_dir}/srcs/sources_1/minmax_pyramid_tb.vhd"] \
+]
+add_files -norecurse -fileset $obj $files
+
+# Set 'minmax_pyramid_tb' fileset file properties for remote files
+set file "$origin_dir/srcs/sources_1/minmax_pyramid_tb.vhd"
+set file [file normalize $file]
+set file_obj [get_files -of_objects [get_filesets minmax_pyramid_tb] [list "*$file"]]
+set_property -name "file_type" -value "VHDL" -objects $file_obj
+
+
+# Set 'minmax_pyramid_tb' fileset file properties for local files
+# None
+
+# Set 'minmax_pyramid_tb' fileset properties
+set obj [get_filesets minmax_pyramid_tb]
+set_property -name "top" -value "minmax_pyramid_tb" -objects $obj
+set_property -name "top_auto_set" -value "0" -objects $obj
+set_property -name "top_lib" -value "xil_defaultlib" -objects $obj
+
+# Create 'event_search_tb' fileset (if not found)
+if {[string equal [get_filesets -quiet event_search_tb] ""]} {
+  create_fileset -simset event_search_tb
+}
+
+# Set 'event_search_tb' fileset object
+set obj [get_filesets event_search_tb]
+set files [list \
+ [file normalize "${origin_dir}/srcs/sources_1/event_search_tb.vhd"] \
+]
+add_files -norecurse -fileset $obj $files
+
+# Set 'event_search_tb' fileset file properties for remote files
+set file "$origin_dir/srcs/sources_1/event_search_tb.vhd"
+set file [file normalize $file]
+set file_obj [get_files -of_objects [get_filesets event_search_tb] [list "*$file"]]
+set_property -name "file_type" -value "VHDL" -objects $file_obj
+
+
+# Set 'event_search_tb' fileset file properties for local files
+# None
+
+# Set 'event_search_tb' fileset properties
+set obj [get_filesets event_search_tb]
+set_property -name "top" -value "event_search_tb" -objects $obj
+set_property -name "top_auto_set" -value "0" -objects $obj
+set_property -name "top_lib" -value "xil_defaultlib" -objects $obj
+
+# Create 'trig_interp_tb' fileset (if not found)
+if {[string equal [get_filesets -quiet trig_interp_tb] ""]} {
+  create_fileset -simset trig_interp_tb
+}
+
+# Set 'trig_interp_tb' fileset object
+set obj [get_filesets trig_interp_tb]
+set files [list \
+ [file normalize "${origin_dir}/srcs/sources_1/trig_interp_tb.vhd"] \
+]
+add_files -norecurse -fileset $obj $files
+
+# Set 'trig_interp_tb' fileset file properties for remote files
+set file "$origin_dir/srcs/sources_1/trig_interp_tb.vhd"
+set file [file normalize $file]
+set file_obj [get_files -of_objects [get_filesets trig_interp_tb] [list "*$file"]]
+set_property -name "file_type" -value "VHDL" -objects $file_obj
+
+
+# Set 'trig_interp_tb' fileset file properties for local files
+# None
+
+# Set 'trig_interp_tb' fileset properties
+set obj [get_filesets trig_interp_tb]
+set_property -name "top" -value "trig_interp_tb" -objects $obj
+set_property -name "top_auto_set" -value "0" -objects $obj
+set_property -name "top_lib" -value "xil_defaultlib" -objects $obj
+
+# Create 'spi_queue_tb' fileset (if not found)
+if {[string equal [get_filesets -quiet spi_queue_tb] ""]} {
+  create_fileset -simset spi_queue_tb
+}
+
+# Set 'spi_queue_tb' fileset object
+set obj [get_filesets spi_queue_tb]
+set files [list \
+ [file normalize "${origin_dir}/srcs/sources_1/spi_queue_tb.vhd"] \
+]
+add_files -norecurse -fileset $obj $files
+
+# Set 'spi_queue_tb' fileset file properties for remote files
+set file "$origin_dir/srcs/sources_1/spi_queue_tb.vhd"
+set file [file normalize $file]
+set file_obj [get_files -of_objects [get_filesets spi_queue_tb] [list "*$file"]]
+set_property -name "file_type" -value "VHDL" -objects $file_obj
+
+
+# Set 'spi_queue_tb' fileset file properties for local files
+# None
+
+# Set 'spi_queue_tb' fileset properties
+set obj [get_filesets spi_queue_tb]
+set_property -name "top" -value "spi_queue_tb" -objects $obj
+set_property -name "top_auto_set" -value "0" -objects $obj
+set_property -name "top_lib" -value "xil_defaultlib" -objects $obj
+
+# Create 'awg_stream_tb' fileset (if not found)
+if {[string equal [get_filesets -quiet awg_stream_tb] ""]} {
+  create_fileset -simset awg_stream_tb
+}
+
+# Set 'awg_stream_tb' fileset object
+set obj [get_filesets awg_stream_tb]
+set files [list \
+ [file normalize "${origin_dir}/srcs/sources_1/awg_stream_tb.vhd"] \
+]
+add_files -norecurse -fileset $obj $files
+
+# Set 'awg_stream_tb' fileset file properties for remote files
+set file "$origin_dir/srcs/sources_1/awg_stream_tb.vhd"
+set file [file normalize $file]
+set file_obj [get_files -of_objects [get_filesets awg_stream_tb] [list "*$file"]]
+set_property -name "file_type" -value "VHDL" -objects $file_obj
+
+
+# Set 'awg_stream_tb' fileset file properties for local files
+# None
+
+# Set 'awg_stream_tb' fileset properties
+set obj [get_filesets awg_stream_tb]
+set_property -name "top" -value "awg_stream_tb" -objects $obj
+set_property -name "top_auto_set" -value "0" -objects $obj
+set_property -name "top_lib" -value "xil_defaultlib" -objects $obj
+
+# Create 'awg_sweep_tb' fileset (if not found)
+if {[string equal [get_filesets -quiet awg_sweep_tb] ""]} {
+  create_fileset -simset awg_sweep_tb
+}
+
+# Set 'awg_sweep_tb' fileset object
+set obj [get_filesets awg_sweep_tb]
+set files [list \
+ [file normalize "${origin_dir}/srcs/sources_1/awg_sweep_tb.vhd"] \
+]
+add_files -norecurse -fileset $obj $files
+
+# Set 'awg_sweep_tb' fileset file properties for remote files
+set file "$origin_dir/srcs/sources_1/awg_sweep_tb.vhd"
+set file [file normalize $file]
+set file_obj [get_files -of_objects [get_filesets awg_sweep_tb] [list "*$file"]]
+set_property -name "file_type" -value "VHDL" -objects $file_obj
+
+
+# Set 'awg_sweep_tb' fileset file properties for local files
+# None
+
+# Set 'awg_sweep_tb' fileset properties
+set obj [get_filesets awg_sweep_tb]
+set_property -name "top" -value "awg_sweep_tb" -objects $obj
+set_property -name "top_auto_set" -value "0" -objects $obj
+set_property -name "top_lib" -value "xil_defaultlib" -objects $obj
+
+# Create 'fra_core_tb' fileset (if not found)
+if {[string equal [get_filesets -quiet fra_core_tb] ""]} {
+  create_fileset -simset fra_core_tb
+}
+
+# Set 'fra_core_tb' fileset object
+set obj [get_filesets fra_core_tb]
+set files [list \
+ [file normalize "${origin_dir}/srcs/sources_1/fra_core_tb.vhd"] \
+]
+add_files -norecurse -fileset $obj $files
+
+# Set 'fra_core_tb' fileset file properties for remote files
+set file "$origin_dir/srcs/sources_1/fra_core_tb.vhd"
+set file [file normalize $file]
+set file_obj [get_files -of_objects [get_filesets fra_core_tb] [list "*$file"]]
+set_property -name "file_type" -value "VHDL" -objects $file_obj
+
+
+# Set 'fra_core_tb' fileset file properties for local files
+# None
+
+# Set 'fra_core_tb' fileset properties
+set obj [get_filesets fra_core_tb]
+set_property -name "top" -value "fra_core_tb" -objects $obj
+set_property -name "top_auto_set" -value "0" -objects $obj
+set_property -name "top_lib" -value "xil_defaultlib" -objects $obj
+
+# Create 'proto_decoder_tb' fileset (if not found)
+if {[string equal [get_filesets -quiet proto_decoder_tb] ""]} {
+  create_fileset -simset proto_decoder_tb
+}
+
+# Set 'proto_decoder_tb' fileset object
+set obj [get_filesets proto_decoder_tb]
+set files [list \
+ [file normalize "${origin_dir}/srcs/sources_1/proto_decoder_tb.vhd"] \
+]
+add_files -norecurse -fileset $obj $files
+
+# Set 'proto_decoder_tb' fileset file properties for remote files
+set file "$origin_dir/srcs/sources_1/proto_decoder_tb.vhd"
+set file [file normalize $file]
+set file_obj [get_files -of_objects [get_filesets proto_decoder_tb] [list "*$file"]]
+set_property -name "file_type" -value "VHDL" -objects $file_obj
+
+
+# Set 'proto_decoder_tb' fileset file properties for local files
+# None
+
+# Set 'proto_decoder_tb' fileset properties
+set obj [get_filesets proto_decoder_tb]
+set_property -name "top" -value "proto_decoder_tb" -objects $obj
+set_property -name "top_auto_set" -value "0" -objects $obj
+set_property -name "top_lib" -value "xil_defaultlib" -objects $obj
+
+# Create 'pattern_stream_tb' fileset (if not found)
+if {[string equal [get_filesets -quiet pattern_stream_tb] ""]} {
+  create_fileset -simset pattern_stream_tb
+}
+
+# Set 'pattern_stream_tb' fileset object
+set obj [get_filesets pattern_stream_tb]
+set files [list \
+ [file normalize "${origin_dir}/srcs/sources_1/pattern_stream_tb.vhd"] \
+]
+add_files -norecurse -fileset $obj $files
+
+# Set 'pattern_stream_tb' fileset file properties for remote files
+set file "$origin_dir/srcs/sources_1/pattern_stream_tb.vhd"
+set file [file normalize $file]
+set file_obj [get_files -of_objects [get_filesets pattern_stream_tb] [list "*$file"]]
+set_property -name "file_type" -value "VHDL" -objects $file_obj
+
+
+# Set 'pattern_stream_tb' fileset file properties for local files
+# None
+
+# Set 'pattern_stream_tb' fileset properties
+set obj [get_filesets pattern_stream_tb]
+set_property -name "top" -value "pattern_stream_tb" -objects $obj
+set_property -name "top_auto_set" -value "0" -objects $obj
+set_property -name "top_lib" -value "xil_defaultlib" -objects $obj
+
+# Create 'ets_tdc_tb' fileset (if not found)
+if {[string equal [get_filesets -quiet ets_tdc_tb] ""]} {
+  create_fileset -simset ets_tdc_tb
+}
+
+# Set 'ets_tdc_tb' fileset object
+set obj [get_filesets ets_tdc_tb]
+set files [list \
+ [file normalize "${origin_dir}/srcs/sources_1/ets_tdc_tb.vhd"] \
+]
+add_files -norecurse -fileset $obj $files
+
+# Set 'ets_tdc_tb' fileset file properties for remote files
+set file "$origin_dir/srcs/sources_1/ets_tdc_tb.vhd"
+set file [file normalize $file]
+set file_obj [get_files -of_objects [get_filesets ets_tdc_tb] [list "*$file"]]
+set_property -name "file_type" -value "VHDL" -objects $file_obj
+
+
+# Set 'ets_tdc_tb' fileset file properties for local files
+# None
+
+# Set 'ets_tdc_tb' fileset properties
+set obj [get_filesets ets_tdc_tb]
+set_property -name "top" -value "ets_tdc_tb" -objects $obj
+set_property -name "top_auto_set" -value "0" -objects $obj
+set_property -name "top_lib" -value "xil_defaultlib" -objects $obj
+
+# Create 'ilv_correct_tb' fileset (if not found)
+if {[string equal [get_filesets -quiet ilv_correct_tb] ""]} {
+  create_fileset -simset ilv_correct_tb
+}
+
+# Set 'ilv_correct_tb' fileset object
+set obj [get_filesets ilv_correct_tb]
+set files [list \
+ [file normalize "${origin_dir}/srcs/sources_1/ilv_correct_tb.vhd"] \
+]
+add_files -norecurse -fileset $obj $files
+
+# Set 'ilv_correct_tb' fileset file properties for remote files
+set file "$origin_dir/srcs/sources_1/ilv_correct_tb.vhd"
+set file [file normalize $file]
+set file_obj [get_files -of_objects [get_filesets ilv_correct_tb] [list "*$file"]]
+set_property -name "file_type" -value "VHDL" -objects $file_obj
+
+
+# Set 'ilv_correct_tb' fileset file properties for local files
+# None
+
+# Set 'ilv_correct_tb' fileset properties
+set obj [get_filesets ilv_correct_tb]
+set_property -name "top" -value "ilv_correct_tb" -objects $obj
+set_property -name "top_auto_set" -value "0" -objects $obj
+set_property -name "top_lib" -value "xil_defaultlib" -objects $obj
+
+# Create 'frame_meas_tb' fileset (if not found)
+if {[string equal [get_filesets -quiet frame_meas_tb] ""]} {
+  create_fileset -simset frame_meas_tb
+}
+
+# Set 'frame_meas_tb' fileset object
+set obj [get_filesets frame_meas_tb]
+set files [list \
+ [file normalize "${origin_dir}/srcs/sources_1/frame_meas_tb.vhd"] \
+]
+add_files -norecurse -fileset $obj $files
+
+# Set 'frame_meas_tb' fileset file properties for remote files
+set file "$origin_dir/srcs/sources_1/frame_meas_tb.vhd"
+set file [file normalize $file]
+set file_obj [get_files -of_objects [get_filesets frame_meas_tb] [list "*$file"]]
+set_property -name "file_type" -value "VHDL" -objects $file_obj
+
+
+# Set 'frame_meas_tb' fileset file properties for local files
+# None
+
+# Set 'frame_meas_tb' fileset properties
+set obj [get_filesets frame_meas_tb]
+set_property -name "top" -value "frame_meas_tb" -objects $obj
+set_property -name "top_auto_set" -value "0" -objects $obj
+set_property -name "top_lib" -value "xil_defaultlib" -objects $obj
+
+# Create 'mask_test_tb' fileset (if not found)
+if {[string equal [get_filesets -quiet mask_test_tb] ""]} {
+  create_fileset -simset mask_test_tb
+}
+
+# Set 'mask_test_tb' fileset object
+set obj [get_filesets mask_test_tb]
+set files [list \
+ [file normalize "${origin_dir}/srcs/sources_1/mask_test_tb.vhd"] \
+]
+add_files -norecurse -fileset $obj $files
+
+# Set 'mask_test_tb' fileset file properties for remote files
+set file "$origin_dir/srcs/sources_1/mask_test_tb.vhd"
+set file [file normalize $file]
+set file_obj [get_files -of_objects [get_filesets mask_test_tb] [list "*$file"]]
+set_property -name "file_type" -value "VHDL" -objects $file_obj
+
+
+# Set 'mask_test_tb' fileset file properties for local files
+# None
+
+# Set 'mask_test_tb' fileset properties
+set obj [get_filesets mask_test_tb]
+set_property -name "top" -value "mask_test_tb" -objects $obj
+set_property -name "top_auto_set" -value "0" -objects $obj
+set_property -name "top_lib" -value "xil_defaultlib" -objects $obj
+
+# Create 'hist_engine_tb' fileset (if not found)
+if {[string equal [get_filesets -quiet hist_engine_tb] ""]} {
+  create_fileset -simset hist_engine_tb
+}
+
+# Set 'hist_engine_tb' fileset object
+set obj [get_filesets hist_engine_tb]
+set files [list \
+ [file normalize "${origin_dir}/srcs/sources_1/hist_engine_tb.vhd"] \
+]
+add_files -norecurse -fileset $obj $files
+
+# Set 'hist_engine_tb' fileset file properties for remote files
+set file "$origin_dir/srcs/sources_1/hist_engine_tb.vhd"
+set file [file normalize $file]
+set file_obj [get_files -of_objects [get_filesets hist_engine_tb] [list "*$file"]]
+set_property -name "file_type" -value "VHDL" -objects $file_obj
+
+
+# Set 'hist_engine_tb' fileset file properties for local files
+# None
+
+# Set 'hist_engine_tb' fileset properties
+set obj [get_filesets hist_engine_tb]
+set_property -name "top" -value "hist_engine_tb" -objects $obj
+set_property -name "top_auto_set" -value "0" -objects $obj
+set_property -name "top_lib" -value "xil_defaultlib" -objects $obj
+
+# Create 'la_transition_tb' fileset (if not found)
+if {[string equal [get_filesets -quiet la_transition_tb] ""]} {
+  create_fileset -simset la_transition_tb
+}
+
+# Set 'la_transition_tb' fileset object
+set obj [get_filesets la_transition_tb]
+set files [list \
+ [file normalize "${origin_dir}/srcs/sources_1/la_transition_tb.vhd"] \
+]
+add_files -norecurse -fileset $obj $files
+
+# Set 'la_transition_tb' fileset file properties for remote files
+set file "$origin_dir/srcs/sources_1/la_transition_tb.vhd"
+set file [file normalize $file]
+set file_obj [get_files -of_objects [get_filesets la_transition_tb] [list "*$file"]]
+set_property -name "file_type" -value "VHDL" -objects $file_obj
+
+
+# Set 'la_transition_tb' fileset file properties for local files
+# None
+
+# Set 'la_transition_tb' fileset properties
+set obj [get_filesets la_transition_tb]
+set_property -name "top" -value "la_transition_tb" -objects $obj
+set_property -name "top_auto_set" -value "0" -objects $obj
+set_property -name "top_lib" -value "xil_defaultlib" -objects $obj
+
 # Set 'utils_1' fileset object
 set obj [get_filesets utils_1]
 # Empty (no sources present)
@@ -46,6 +46,59 @@ Port (
     DataOutEnable : in std_logic;
     DataOutValid : out STD_LOGIC;
     ReadingFrame : in std_logic;
+    FrameDiscard : in std_logic;                        -- frame is not sent (header only), drop its samples
+    ViewportStart : in std_logic;                       -- start reading a window of the last saved frame
+    ViewportOffset : in std_logic_vector(26 downto 0);  -- first window sample (from frame start)
+    ViewportLength : in std_logic_vector(26 downto 0);  -- number of window samples
+    ViewportStride : in std_logic_vector(26 downto 0);  -- read every n-th sample
+    ViewportLevel : in std_logic_vector(3 downto 0);    -- 0: samples, 2 to 12: min/max pyramid level
+    PyramidEnable : in std_logic;                       -- build min/max pyramid of saved frame
+    PyramidOverflow : out std_logic;                    -- min/max pyramid of last frame is incomplete
+    SearchConfig : in std_logic_vector(31 downto 0);    -- event search condition (viewport returns matching positions)
+    SearchWidth : in std_logic_vector(26 downto 0);     -- event search pulse width
+    SearchMask : in std_logic_vector(11 downto 0);      -- event search digital pattern
+    SearchPatternA : in std_logic_vector(11 downto 0);
+    SearchPatternB : in std_logic_vector(11 downto 0);
+    SearchSpan : in std_logic_vector(26 downto 0);      -- number of searched samples
+    AwgRegion : in std_logic;                           -- reserve upper quarter of RAM for AWG samples
+    AwgUpClk : in std_logic;                            -- AWG sample upload
+    AwgUpWrite : in std_logic;
+    AwgUpAddrWrite : in std_logic;
+    AwgUpData : in std_logic_vector(31 downto 0);
+    AwgUpAlmostFull : out std_logic;
+    AwgPlayEnable : in std_logic;                       -- AWG playback from RAM
+    AwgPlayLoop : in std_logic;
+    AwgPlayStart : in std_logic_vector(22 downto 0);
+    AwgPlayLength : in std_logic_vector(22 downto 0);
+    AwgClk : in std_logic;                              -- AWG sample output
+    AwgClkDivide : in std_logic_vector(15 downto 0);
+    AwgSample : out std_logic_vector(11 downto 0);
+    AwgUnderrun : out std_logic;
+    AwgPlaying : out std_logic;
+    PatPlayEnable : in std_logic;                       -- RLE digital pattern playback from RAM (AWG region)
+    PatPlayLoop : in std_logic;
+    PatPlayStart : in std_logic_vector(22 downto 0);
+    PatPlayLength : in std_logic_vector(22 downto 0);
+    PatClk : in std_logic;                              -- digital pattern output
+    PatStep : in std_logic;
+    PatState : out std_logic_vector(11 downto 0);
+    PatUnderrun : out std_logic;
+    PatLoopError : out std_logic;
+    PatPlaying : out std_logic;
+    HistEnable : in std_logic;                          -- persistence histogram in RAM (end of AWG region)
+    HistClear : in std_logic;
+    HistStepLog2 : in std_logic_vector(3 downto 0);
+    HistClk : in std_logic;                             -- frame samples (ADC clock)
+    HistStart : in std_logic;
+    HistStop : in std_logic;
+    HistSampleEn : in std_logic;
+    HistDataA : in signed(9 downto 0);
+    HistDataB : in signed(9 downto 0);
+    HistResultTgl : out std_logic;
+    HistFrames : out std_logic_vector(31 downto 0);
+    HistSkipped : out std_logic_vector(31 downto 0);
+    HistClearing : out std_logic;
+    HistSaturated : out std_logic;
     ram_rdy : out std_logic;
     init_calib_complete : out STD_LOGIC;
     device_temp : out std_logic_vector(11 downto 0);
@@ -71,6 +124,9 @@ end RAM_DDR3;
 architecture Behavioral of RAM_DDR3 is
 
     CONSTANT DDR3_MAX_SAMPLES : integer := 2**27; -- 2^27 = 128M samples
+    -- read fifo words (4 samples each) to prefetch before frame data is requested
+    -- 64 words = 256 samples = one FX3 DMA buffer (sent while frame header is being sent)
+    CONSTANT RD_PREFETCH_WORDS : integer := 64;
    
     -- RAM state machine signals
     CONSTANT A: STD_LOGIC_VECTOR (2 DownTo 0) := "000";
@@ -140,6 +196,32 @@ architecture Behavioral of RAM_DDR3 is
         ui_rd_ready : in std_logic;        -- read data from RAM
         ui_rd_data_valid : out std_logic;
         ui_rd_data_available : out std_logic; -- asserted if write counter is higher than read counter
+        ui_vp_start : in std_logic;        -- start viewport readout of the last saved frame
+        ui_vp_offset : in std_logic_vector (26 downto 0); -- first viewport sample (pyramid level: first entry)
+        ui_vp_skip : in std_logic_vector (1 downto 0);    -- position of the first frame sample within first RAM word
+        ui_vp_length : in std_logic_vector (26 downto 0); -- number of viewport samples (pyramid level: entries)
+        ui_vp_stride : in std_logic_vector (26 downto 0); -- read every n-th sample
+        ui_vp_level : in std_logic_vector (3 downto 0);   -- 0: samples, 2 to 12: min/max pyramid level, 15: histogram
+        ui_vp_rd_ready : in std_logic;     -- read fifo can accept viewport samples
+        ui_pyr_enable : in std_logic;      -- build min/max pyramid (frame samples are saved in lower half of RAM)
+        ui_pyr_flush : in std_logic;       -- all frame samples were written to RAM
+        ui_pyr_overflow : out std_logic;   -- some pyramid entries were not written to RAM
+        ui_srch_cfg : in std_logic_vector (31 downto 0);   -- event search condition (mode, channel, edge, hysteresis, level)
+        ui_srch_width : in std_logic_vector (26 downto 0); -- event search pulse width
+        ui_srch_mask : in std_logic_vector (11 downto 0);  -- event search digital pattern
+        ui_srch_patternA : in std_logic_vector (11 downto 0);
+        ui_srch_patternB : in std_logic_vector (11 downto 0);
+        ui_srch_span : in std_logic_vector (26 downto 0);  -- number of searched samples (from viewport offset to frame end)
+        ui_awg_region : in std_logic;      -- upper quarter of RAM holds AWG samples (frame samples are saved in lower half of RAM)
+        ui_awg_wr_req : in std_logic;      -- AWG RAM word is waiting to be written
+        ui_awg_wr_addr : in std_logic_vector (22 downto 0); -- RAM word index in AWG region
+        ui_awg_wr_data : in std_logic_vector (127 downto 0);
+        ui_awg_wr_ack : out std_logic;     -- AWG RAM word was written
+        ui_awg_rd_req : in std_logic;      -- AWG playback fifo can accept RAM word
+        ui_awg_rd_addr : in std_logic_vector (22 downto 0);
+        ui_awg_rd_ack : out std_logic;     -- AWG read command was accepted
+        ui_awg_rd_data : out std_logic_vector (127 downto 0);
+        ui_awg_rd_data_valid : out std_logic;
         init_calib_complete : out std_logic;
         device_temp : out std_logic_vector(11 downto 0);
         -- DDR3 PHY
@@ -161,6 +243,88 @@ architecture Behavioral of RAM_DDR3 is
         );
     end component;
     
+    component awg_stream is
+    Port (
+        clk_up : in std_logic;
+        UpWrite : in std_logic;
+        UpAddrWrite : in std_logic;
+        UpData : in std_logic_vector(31 downto 0);
+        UpAlmostFull : out std_logic;
+        clk : in std_logic;
+        WrReq : out std_logic;
+        WrAddr : out std_logic_vector(22 downto 0);
+        WrData : out std_logic_vector(127 downto 0);
+        WrAck : in std_logic;
+        RdReq : out std_logic;
+        RdAddr : out std_logic_vector(22 downto 0);
+        RdAck : in std_logic;
+        RdData : in std_logic_vector(127 downto 0);
+        RdDataValid : in std_logic;
+        PlayEnable : in std_logic;
+        PlayLoop : in std_logic;
+        PlayStart : in std_logic_vector(22 downto 0);
+        PlayLength : in std_logic_vector(22 downto 0);
+        clk_out : in std_logic;
+        ClkDivide : in std_logic_vector(15 downto 0);
+        Sample : out std_logic_vector(11 downto 0);
+        Underrun : out std_logic;
+        Playing : out std_logic
+    );
+    end component;
+    
+    component pattern_stream is
+    Port (
+        clk : in std_logic;
+        RdReq : out std_logic;
+        RdAddr : out std_logic_vector(22 downto 0);
+        RdAck : in std_logic;
+        RdData : in std_logic_vector(127 downto 0);
+        RdDataValid : in std_logic;
+        PlayEnable : in std_logic;
+        PlayLoop : in std_logic;
+        PlayStart : in std_logic_vector(22 downto 0);
+        PlayLength : in std_logic_vector(22 downto 0);
+        clk_out : in std_logic;
+        Step : in std_logic;
+        State : out std_logic_vector(11 downto 0);
+        Underrun : out std_logic;
+        LoopError : out std_logic;
+        Playing : out std_logic
+    );
+    end component;
+    
+    component hist_engine is
+    Generic (
+        TBIN_LOG2 : integer := 10
+    );
+    Port (
+        clk_adc : in std_logic;
+        Enable : in std_logic;
+        StepLog2 : in std_logic_vector(3 downto 0);
+        Start : in std_logic;
+        Stop : in std_logic;
+        SampleEn : in std_logic;
+        DataA : in signed(9 downto 0);
+        DataB : in signed(9 downto 0);
+        clk : in std_logic;
+        RdReq : out std_logic;
+        RdAddr : out std_logic_vector(22 downto 0);
+        RdAck : in std_logic;
+        RdData : in std_logic_vector(127 downto 0);
+        RdDataValid : in std_logic;
+        WrReq : out std_logic;
+        WrAddr : out std_logic_vector(22 downto 0);
+        WrData : out std_logic_vector(127 downto 0);
+        WrAck : in std_logic;
+        Clear : in std_logic;
+        ResultTgl : out std_logic;
+        Frames : out std_logic_vector(31 downto 0);
+        Skipped : out std_logic_vector(31 downto 0);
+        Clearing : out std_logic;
+        Saturated : out std_logic
+    );
+    end component;
+    
 	--Inputs
     signal fwr_rst        : std_logic := '0';
     signal fwr_DataIn    : std_logic_vector(31 downto 0) := (others => '0');
@@ -227,6 +391,9 @@ architecture Behavioral of RAM_DDR3 is
     signal PreTrigSaving_i : std_logic := '0';
     signal ui_frameStart : std_logic := '0';
     signal ram_rdy_i : std_logic := '0';
+    signal FrameDiscard_d : std_logic := '0';
+    signal FrameDiscard_dd : std_logic := '0';
+    signal frd_Discard : std_logic := '0';
     signal DebugRAMState : integer range 0 to 3;
 
     signal PreTrigSavingCnt : integer range 0 to DDR3_MAX_SAMPLES-1 := 0;
@@ -247,6 +414,65 @@ architecture Behavioral of RAM_DDR3 is
     signal PostFrameSave : std_logic := '0';
     signal rst_d : std_logic := '0';
     signal frd_data_cnt : unsigned(26 downto 0);
+    signal frd_PrefetchArmed : std_logic := '0';
+    signal frd_Prefetched : std_logic := '0';
+    signal PreTrigSkip : integer range 0 to 3 := 0;
+    signal ui_vp_start : std_logic := '0';
+    signal ui_vp_offset : std_logic_vector(26 downto 0) := (others => '0');
+    signal ui_vp_skip : std_logic_vector(1 downto 0) := (others => '0');
+    signal ui_vp_rd_ready : std_logic := '0';
+    -- min/max pyramid
+    signal FrameSaved : std_logic := '0';      -- all frame samples were saved to write fifo
+    signal FrameSaved_d : std_logic := '0';
+    signal FrameSaved_dd : std_logic := '0';
+    signal FrameSaved_ddd : std_logic := '0';
+    signal pyr_flush_armed : std_logic := '0';
+    signal pyr_flush_cnt : integer range 0 to 15 := 0;
+    signal ui_pyr_flush : std_logic := '0';
+    
+    -- AWG sample streaming
+    signal awg_wr_req : std_logic;
+    signal awg_wr_addr : std_logic_vector(22 downto 0);
+    signal awg_wr_data : std_logic_vector(127 downto 0);
+    signal awg_wr_ack : std_logic;
+    signal awg_rd_req : std_logic;
+    signal awg_rd_addr : std_logic_vector(22 downto 0);
+    signal awg_rd_ack : std_logic;
+    signal awg_rd_data : std_logic_vector(127 downto 0);
+    signal awg_rd_data_valid : std_logic;
+    -- RLE pattern streaming (shares AWG read port)
+    signal pat_rd_req : std_logic;
+    signal pat_rd_addr : std_logic_vector(22 downto 0);
+    signal pat_rd_ack : std_logic;
+    signal pat_rd_data_valid : std_logic;
+    -- persistence histogram (shares AWG read and write port)
+    signal hist_rd_req : std_logic;
+    signal hist_rd_addr : std_logic_vector(22 downto 0);
+    signal hist_rd_ack : std_logic;
+    signal hist_rd_data_valid : std_logic;
+    signal hist_wr_req : std_logic;
+    signal hist_wr_addr : std_logic_vector(22 downto 0);
+    signal hist_wr_data : std_logic_vector(127 downto 0);
+    signal hist_wr_ack : std_logic;
+    -- AWG region read and write port arbiters
+    type rd_owner_array is array(0 to 63) of std_logic_vector(1 downto 0);
+    signal awg_port_rd_req : std_logic;
+    signal awg_port_rd_addr : std_logic_vector(22 downto 0);
+    signal awg_port_rd_ack : std_logic;
+    signal awg_port_rd_data_valid : std_logic;
+    signal arb_busy : std_logic := '0';
+    signal arb_owner : std_logic_vector(1 downto 0) := "00";    -- 00: AWG, 01: pattern, 10: histogram
+    signal arb_last : std_logic_vector(1 downto 0) := "00";     -- owner of last accepted read command
+    signal rd_owner_head : std_logic_vector(1 downto 0);
+    signal awg_port_wr_req : std_logic;
+    signal awg_port_wr_addr : std_logic_vector(22 downto 0);
+    signal awg_port_wr_data : std_logic_vector(127 downto 0);
+    signal awg_port_wr_ack : std_logic;
+    signal wr_arb_busy : std_logic := '0';
+    signal wr_arb_owner : std_logic := '0';                     -- 0: AWG upload, 1: histogram
+    signal rd_owner : rd_owner_array := (others => "00");
+    signal rd_owner_wr : unsigned(5 downto 0) := (others => '0');
+    signal rd_owner_rd : unsigned(5 downto 0) := (others => '0');
     
 -- attribute strings
 attribute KEEP: boolean;
@@ -280,6 +506,9 @@ attribute KEEP of fwr_Empty_d: signal is true;
 attribute KEEP of FrameSaveEnd_d: signal is true;
 attribute ASYNC_REG of fwr_Empty_d: signal is true;
 attribute ASYNC_REG of FrameSaveEnd_d: signal is true;
+attribute ASYNC_REG of FrameSaved_d: signal is true;
+attribute ASYNC_REG of FrameDiscard_d: signal is true;
+attribute ASYNC_REG of FrameDiscard_dd: signal is true;
 attribute KEEP of rst_d: signal is true;
 attribute ASYNC_REG of rst_d: signal is true;
 attribute KEEP of ram_rdy: signal is true;
@@ -317,6 +546,7 @@ attribute mark_debug of PreTrigSavingCntMod_d : signal is true;
 
 attribute keep of frd_data_cnt : signal is true;
 attribute mark_debug of frd_data_cnt : signal is true;
+attribute mark_debug of frd_Prefetched : signal is true;
 
 begin
 
@@ -368,6 +598,32 @@ RAM: ddr3_simple_ui PORT MAP (
 	ui_rd_ready         => ui_rd_ready,
 	ui_rd_data_valid    => ui_rd_data_valid_i,
 	ui_rd_data_available   => ui_rd_data_available,
+	ui_vp_start         => ui_vp_start,
+	ui_vp_offset        => ui_vp_offset,
+	ui_vp_skip          => ui_vp_skip,
+	ui_vp_length        => ViewportLength,
+	ui_vp_stride        => ViewportStride,
+	ui_vp_level         => ViewportLevel,
+	ui_vp_rd_ready      => ui_vp_rd_ready,
+	ui_pyr_enable       => PyramidEnable,
+	ui_pyr_flush        => ui_pyr_flush,
+	ui_pyr_overflow     => PyramidOverflow,
+	ui_srch_cfg         => SearchConfig,
+	ui_srch_width       => SearchWidth,
+	ui_srch_mask        => SearchMask,
+	ui_srch_patternA    => SearchPatternA,
+	ui_srch_patternB    => SearchPatternB,
+	ui_srch_span        => SearchSpan,
+	ui_awg_region       => AwgRegion,
+	ui_awg_wr_req       => awg_port_wr_req,
+	ui_awg_wr_addr      => awg_port_wr_addr,
+	ui_awg_wr_data      => awg_port_wr_data,
+	ui_awg_wr_ack       => awg_port_wr_ack,
+	ui_awg_rd_req       => awg_port_rd_req,
+	ui_awg_rd_addr      => awg_port_rd_addr,
+	ui_awg_rd_ack       => awg_port_rd_ack,
+	ui_awg_rd_data      => awg_rd_data,
+	ui_awg_rd_data_valid => awg_port_rd_data_valid,
 	init_calib_complete => init_calib_complete_i,
 	device_temp => device_temp,
 	ddr3_dq      => ddr3_dq,        
@@ -385,6 +641,147 @@ RAM: ddr3_simple_ui PORT MAP (
 	ddr3_odt     => ddr3_odt       
 );
 
+AWG_STREAM_inst: awg_stream PORT MAP (
+	clk_up       => AwgUpClk,
+	UpWrite      => AwgUpWrite,
+	UpAddrWrite  => AwgUpAddrWrite,
+	UpData       => AwgUpData,
+	UpAlmostFull => AwgUpAlmostFull,
+	clk          => ui_clk_i,
+	WrReq        => awg_wr_req,
+	WrAddr       => awg_wr_addr,
+	WrData       => awg_wr_data,
+	WrAck        => awg_wr_ack,
+	RdReq        => awg_rd_req,
+	RdAddr       => awg_rd_addr,
+	RdAck        => awg_rd_ack,
+	RdData       => awg_rd_data,
+	RdDataValid  => awg_rd_data_valid,
+	PlayEnable   => AwgPlayEnable,
+	PlayLoop     => AwgPlayLoop,
+	PlayStart    => AwgPlayStart,
+	PlayLength   => AwgPlayLength,
+	clk_out      => AwgClk,
+	ClkDivide    => AwgClkDivide,
+	Sample       => AwgSample,
+	Underrun     => AwgUnderrun,
+	Playing      => AwgPlaying
+	);
+
+PATTERN_STREAM_inst: pattern_stream PORT MAP (
+	clk          => ui_clk_i,
+	RdReq        => pat_rd_req,
+	RdAddr       => pat_rd_addr,
+	RdAck        => pat_rd_ack,
+	RdData       => awg_rd_data,
+	RdDataValid  => pat_rd_data_valid,
+	PlayEnable   => PatPlayEnable,
+	PlayLoop     => PatPlayLoop,
+	PlayStart    => PatPlayStart,
+	PlayLength   => PatPlayLength,
+	clk_out      => PatClk,
+	Step         => PatStep,
+	State        => PatState,
+	Underrun     => PatUnderrun,
+	LoopError    => PatLoopError,
+	Playing      => PatPlaying
+	);
+
+HIST_ENGINE_inst: hist_engine
+	GENERIC MAP (
+	TBIN_LOG2    => 10
+	)
+	PORT MAP (
+	clk_adc      => HistClk,
+	Enable       => HistEnable,
+	StepLog2     => HistStepLog2,
+	Start        => HistStart,
+	Stop         => HistStop,
+	SampleEn     => HistSampleEn,
+	DataA        => HistDataA,
+	DataB        => HistDataB,
+	clk          => ui_clk_i,
+	RdReq        => hist_rd_req,
+	RdAddr       => hist_rd_addr,
+	RdAck        => hist_rd_ack,
+	RdData       => awg_rd_data,
+	RdDataValid  => hist_rd_data_valid,
+	WrReq        => hist_wr_req,
+	WrAddr       => hist_wr_addr,
+	WrData       => hist_wr_data,
+	WrAck        => hist_wr_ack,
+	Clear        => HistClear,
+	ResultTgl    => HistResultTgl,
+	Frames       => HistFrames,
+	Skipped      => HistSkipped,
+	Clearing     => HistClearing,
+	Saturated    => HistSaturated
+	);
+
+-- AWG region read port is shared by AWG and pattern streaming and persistence histogram:
+-- requester is selected when port is free (round robin) and request is held until
+-- it is acknowledged, owner of each accepted read command is queued and read data is passed to it
+-- (a request withdrawn meanwhile reads one spare word, streams have fifo margin for it)
+awg_port_rd_req <= arb_busy;
+awg_port_rd_addr <= pat_rd_addr when arb_owner = "01" else
+                    hist_rd_addr when arb_owner = "10" else
+                    awg_rd_addr;
+awg_rd_ack <= awg_port_rd_ack when arb_owner = "00" else '0';
+pat_rd_ack <= awg_port_rd_ack when arb_owner = "01" else '0';
+hist_rd_ack <= awg_port_rd_ack when arb_owner = "10" else '0';
+rd_owner_head <= rd_owner(to_integer(rd_owner_rd));
+awg_rd_data_valid <= awg_port_rd_data_valid when rd_owner_head = "00" else '0';
+pat_rd_data_valid <= awg_port_rd_data_valid when rd_owner_head = "01" else '0';
+hist_rd_data_valid <= awg_port_rd_data_valid when rd_owner_head = "10" else '0';
+
+-- AWG region write port is shared by AWG upload and persistence histogram (same scheme)
+awg_port_wr_req <= wr_arb_busy;
+awg_port_wr_addr <= hist_wr_addr when wr_arb_owner = '1' else awg_wr_addr;
+awg_port_wr_data <= hist_wr_data when wr_arb_owner = '1' else awg_wr_data;
+awg_wr_ack <= awg_port_wr_ack and not(wr_arb_owner);
+hist_wr_ack <= awg_port_wr_ack and wr_arb_owner;
+
+awg_rd_arb_proc: process (ui_clk_i)
+    variable v_req : std_logic_vector(2 downto 0);
+    variable v_owner : integer range 0 to 2;
+begin
+    if rising_edge (ui_clk_i) then
+        if arb_busy = '0' then
+            -- first waiting requester after owner of last read command
+            v_req := hist_rd_req & pat_rd_req & awg_rd_req;
+            for k in 1 to 3 loop
+                v_owner := (to_integer(unsigned(arb_last)) + k) mod 3;
+                if v_req(v_owner) = '1' then
+                    arb_busy <= '1';
+                    arb_owner <= std_logic_vector(to_unsigned(v_owner,2));
+                    exit;
+                end if;
+            end loop;
+        elsif awg_port_rd_ack = '1' then
+            arb_busy <= '0';
+            arb_last <= arb_owner;
+            rd_owner(to_integer(rd_owner_wr)) <= arb_owner;
+            rd_owner_wr <= rd_owner_wr + 1;
+        end if;
+        if awg_port_rd_data_valid = '1' then
+            rd_owner_rd <= rd_owner_rd + 1;
+        end if;
+        
+        if wr_arb_busy = '0' then
+            -- alternate when both are waiting
+            if awg_wr_req = '1' and (hist_wr_req = '0' or wr_arb_owner = '1') then
+                wr_arb_busy <= '1';
+                wr_arb_owner <= '0';
+            elsif hist_wr_req = '1' then
+                wr_arb_busy <= '1';
+                wr_arb_owner <= '1';
+            end if;
+        elsif awg_port_wr_ack = '1' then
+            wr_arb_busy <= '0';
+        end if;
+    end if;
+end process;
+
 ui_clk <= ui_clk_i;
 init_calib_complete <= init_calib_complete_i;
 
@@ -440,6 +837,9 @@ begin
             FrameSaveEnd_dd <= FrameSaveEnd_d;
             if FrameSaveEnd_dd = '0' and FrameSaveEnd_d = '1' then
                 wr_FifoFill <= '1';
+                FrameSaved <= '1';
+            elsif PreTrigSaving = '1' then
+                FrameSaved <= '0';
             end if;
             -- continue saving to write fifo if number of saved samples are not multiple of 4
             if wr_FifoFill = '1' and PreTrigSavingCntMod /= 0 then
@@ -504,6 +904,7 @@ begin
             if PreTrigSaving_ddd = '1' and PreTrigSaving_dd = '0' then
                 PreTrigSavingCnt_dd <= PreTrigSavingCnt_d;
                 PreTrigSavingCntMod_d <= to_integer(unsigned(PreTrigSavingCnt_d)) mod 4;
+                PreTrigSkip <= to_integer(unsigned(PreTrigSavingCnt_d)) mod 4;
                 PreTrigSavingCntRecvd <= '1';
             else
                 PreTrigSavingCntRecvd <= '0';
@@ -519,6 +920,70 @@ begin
             frd_AlmostFull_d <= frd_AlmostFull;
             
             frd_AlmostEmpty_d <= frd_AlmostEmpty;
+            
+            -- read-ahead: once the first DMA buffer of samples (or the whole frame, if shorter)
+            -- is waiting in read fifo, samples can be read out as soon as the header is sent
+            -- instead of waiting for read fifo to fill up to almost full
+            if frd_PrefetchArmed = '1' then
+                if frd_data_cnt >= RD_PREFETCH_WORDS or frd_data_cnt >= unsigned(FrameSize)/4 then
+                    frd_Prefetched <= '1';
+                    frd_PrefetchArmed <= '0';
+                end if;
+            end if;
+            if ui_frameStart = '1' then
+                frd_PrefetchArmed <= '1';
+                frd_Prefetched <= '0';
+            end if;
+            
+            -- viewport readout: read a window of the last saved frame from RAM again
+            ui_vp_rd_ready <= NOT(frd_AlmostFull_d);
+            if ViewportStart = '1' then
+                ui_vp_start <= '1';
+                -- first sample of the frame is PreTrigSkip samples into the first RAM word
+                ui_vp_offset <= ViewportOffset;
+                ui_vp_skip <= std_logic_vector(to_unsigned(PreTrigSkip,2));
+                -- window samples are aligned to RAM words, nothing to skip
+                PreTrigSavingCntMod_d <= 0;
+                frd_data_cnt <= to_unsigned(0,27);
+                frd_PrefetchArmed <= '1';
+                frd_Prefetched <= '0';
+            else
+                ui_vp_start <= '0';
+            end if;
+            
+            -- header-only frame: samples of the frame are read from RAM and dropped,
+            -- until the next frame is started
+            FrameDiscard_d <= FrameDiscard;
+            FrameDiscard_dd <= FrameDiscard_d;
+            if ui_frameStart = '1' then
+                frd_Discard <= '0';
+            elsif FrameDiscard_dd = '0' and FrameDiscard_d = '1' then
+                frd_Discard <= '1';
+            end if;
+            
+            -- min/max pyramid: send out partially filled entries once all frame samples are written to RAM
+            FrameSaved_d <= FrameSaved;
+            FrameSaved_dd <= FrameSaved_d;
+            FrameSaved_ddd <= FrameSaved_dd;
+            ui_pyr_flush <= '0';
+            if FrameSaved_ddd = '0' and FrameSaved_dd = '1' then
+                pyr_flush_armed <= '1';
+                pyr_flush_cnt <= 0;
+            elsif pyr_flush_armed = '1' then
+                if fwr_Empty_d = '1' and ui_wr_data_waiting_i = '0' then
+                    if pyr_flush_cnt = 15 then
+                        pyr_flush_armed <= '0';
+                        ui_pyr_flush <= '1';
+                    else
+                        pyr_flush_cnt <= pyr_flush_cnt + 1;
+                    end if;
+                else
+                    pyr_flush_cnt <= 0;
+                end if;
+            end if;
+            if ui_frameStart = '1' then
+                pyr_flush_armed <= '0';
+            end if;
                        
             -- if read data is requested assert read fifo ReadEn
             if DataOutEnable = '1' then
@@ -528,10 +993,15 @@ begin
                 -- if read fifo is empty, stop reading data from it
                 elsif frd_AlmostEmpty = '1' then
                     frd_ReadEn <= '0';
+                    -- prefetched data was used up, wait for almost full from now on
+                    frd_Prefetched <= '0';
                 -- if all samples have been read out of RAM
                 elsif frd_data_cnt >= unsigned(FrameSize)/4 then
                     -- keep frd_ReadEn asserted to empty out read fifo
                     frd_ReadEn <= '1';
+                -- if first samples were prefetched, start reading right away
+                elsif frd_Prefetched = '1' then
+                    frd_ReadEn <= '1';
                 end if;
             else
                 -- read is not requested and complete frame was transfered
@@ -542,6 +1012,9 @@ begin
                 if ReadingFrame = '0' and frd_data_cnt >= unsigned(FrameSize)/4 and frd_Empty = '0'then
                     -- assert read enable to read redundant samples from read fifo
                     frd_ReadEn <= '1';
+                elsif frd_Discard = '1' and frd_Empty = '0' then
+                    -- drop samples of a frame which is not sent
+                    frd_ReadEn <= '1';
                 else
                     frd_ReadEn <= '0';
                 end if;
@@ -561,7 +1034,8 @@ begin
 --            end if;
             
             -- if frame reading is finished and read fifo is empty
-            if ReadingFrame = '0' and frd_Empty = '1' then
+            -- (dropped frame must be read out of RAM completely)
+            if ReadingFrame = '0' and frd_Empty = '1' and ( frd_Discard = '0' or frd_data_cnt >= unsigned(FrameSize)/4 ) then
                 -- assert ram_rdy signal to allow start of new frame saving
                 ram_rdy_i <= '1';
             else
@@ -25,6 +25,8 @@ use IEEE.NUMERIC_STD.ALL;
 --library UNISIM;
 --use UNISIM.VComponents.all;
 
+-- Port A writes two consecutive samples at once (first sample in MSBs, addra is sample pair address),
+-- port B reads one sample
 entity SDP_BRAM_custom_signal is
     generic (
       DATA_DEPTH : integer;
@@ -32,8 +34,8 @@ entity SDP_BRAM_custom_signal is
       );
     Port ( clka : in  STD_LOGIC;
            wea : in  STD_LOGIC;
-           addra : in  STD_LOGIC_VECTOR (14 downto 0);
-           dina  : in  STD_LOGIC_VECTOR (11 downto 0);
+           addra : in  STD_LOGIC_VECTOR (13 downto 0);
+           dina  : in  STD_LOGIC_VECTOR (23 downto 0);
            clkb : in  STD_LOGIC;
            addrb : in  STD_LOGIC_VECTOR (14 downto 0);
            doutb : out STD_LOGIC_VECTOR (11 downto 0));
@@ -41,8 +43,10 @@ end SDP_BRAM_custom_signal;
 
 architecture Behavioral of SDP_BRAM_custom_signal is
 
-type ram_type is array (DATA_DEPTH-1 downto 0) of std_logic_vector (DATA_WIDTH-1 downto 0);
+type ram_type is array (DATA_DEPTH/2-1 downto 0) of std_logic_vector (2*DATA_WIDTH-1 downto 0);
 signal ram : ram_type;
+signal doutb_pair : std_logic_vector (2*DATA_WIDTH-1 downto 0);
+signal addrb_lsb : std_logic;
 
 ATTRIBUTE ram_style: string;
 ATTRIBUTE ram_style OF ram: SIGNAL IS "block";
@@ -61,8 +65,11 @@ end process write;
 read: process (clkb)
 begin
 	if (rising_edge(clkb)) then
-		doutb <= ram(to_integer(unsigned(addrb)));
+		doutb_pair <= ram(to_integer(unsigned(addrb(14 downto 1))));
+		addrb_lsb <= addrb(0);
 	end if;
 end process read;
 
+doutb <= doutb_pair(2*DATA_WIDTH-1 downto DATA_WIDTH) when addrb_lsb = '0' else doutb_pair(DATA_WIDTH-1 downto 0);
+
 end Behavioral;
\ No newline at end of file
@@ -16,34 +16,34 @@
 ----------------------------------------------------------------------------------
 
 --
--- Dual-Port RAM, Distributed, Read-First mode
+-- Dual-Port RAM, Block, Read-First mode
 --
 
 library IEEE;
 use IEEE.STD_LOGIC_1164.ALL;
 use IEEE.NUMERIC_STD.ALL;
 
-entity SDP_RAM_64x32b is
+entity SDP_RAM_512x32b is
     port (clk1 : in std_logic;
           clk2 : in std_logic;
           we   : in std_logic;
-          addr1 : in std_logic_vector(5 downto 0);
-          addr2 : in std_logic_vector(5 downto 0);
+          addr1 : in std_logic_vector(8 downto 0);
+          addr2 : in std_logic_vector(8 downto 0);
           di1   : in std_logic_vector(31 downto 0);
           do1  : out std_logic_vector(31 downto 0);
           do2  : out std_logic_vector(31 downto 0));
-end SDP_RAM_64x32b;
+end SDP_RAM_512x32b;
 
-architecture Behavioral of SDP_RAM_64x32b is
+architecture Behavioral of SDP_RAM_512x32b is
 
-constant DATA_DEPTH : integer := 64;
+constant DATA_DEPTH : integer := 512;
 constant DATA_WIDTH : integer := 32;
 
 type ram_type is array (DATA_DEPTH-1 downto 0) of std_logic_vector (DATA_WIDTH-1 downto 0);
 signal RAM : ram_type;
 
 ATTRIBUTE ram_style: string;
-ATTRIBUTE ram_style OF ram: SIGNAL IS "distributed";
+ATTRIBUTE ram_style OF ram: SIGNAL IS "block";
 
 begin
 
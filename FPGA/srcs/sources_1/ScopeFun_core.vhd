@@ -106,7 +106,12 @@ architecture rtl of fpga is
 	--define constants
 	
 	--max number of oscilloscope configuration registers
-    CONSTANT CONFIG_DATA_SIZE : integer := 32;    -- number of 32-bit Words for scope config
+    CONSTANT CONFIG_DATA_SIZE : integer := 40;    -- number of 32-bit Words for scope config
+    CONSTANT CONFIG_REG_SIZE : integer := 128;    -- number of 32-bit config registers (config RAM size)
+    CONSTANT CFG_CMD_MAGIC : std_logic_vector(15 downto 0) := X"C5A5"; -- EP2 register write command header
+    CONSTANT CFG_CMD_MAX_WORDS : integer := 256;  -- max. length of register write command (incl. header)
+    CONSTANT CONFIG_BANKS : integer := 4;         -- number of config register banks
+    CONSTANT CFG_BANK_SEL_ADDR : integer := 16#FFFE#; -- register write command address: switch active bank
     CONSTANT FRAME_HEADER_SIZE : integer := 256;  -- number of 32-bit Words for frame header
     CONSTANT DDR3_MAX_SAMPLES : integer := 2**27; -- 2^27 = 128M samples
     CONSTANT AWG_MAX_SAMPLES : integer := 32768;  -- number of samples for AWG custom signal and dig. pattern generator
@@ -116,6 +121,7 @@ architecture rtl of fpga is
     CONSTANT LA_COUNTER_WIDTH : INTEGER := 16;
     --USB buffers
     CONSTANT FX3_DMA_BUFFER_SIZE : INTEGER := 1024;  -- FX3 DMA BUFER SIZE (number of bytes)
+    CONSTANT AWG_HDR_MAGIC : std_logic_vector(15 downto 0) := X"A3C5"; -- EP4 upload header
     
     CONSTANT bH : INTEGER := 14;  -- sfixed high index
     CONSTANT bL : INTEGER := -17; -- sfixed low index
@@ -138,7 +144,9 @@ architecture rtl of fpga is
         i_data_2_n : in STD_LOGIC_VECTOR (4 downto 0);
         o_clk : out STD_LOGIC;
         o_data_1 : out STD_LOGIC_VECTOR (9 downto 0);
-        o_data_2 : out STD_LOGIC_VECTOR (9 downto 0));
+        o_data_2 : out STD_LOGIC_VECTOR (9 downto 0);
+        o_eye_width : out STD_LOGIC_VECTOR (59 downto 0);
+        o_eye_center : out STD_LOGIC_VECTOR (49 downto 0));
     end component;
      
     component RAM_DDR3 is
@@ -159,6 +167,59 @@ architecture rtl of fpga is
        DataOutEnable : in std_logic;
        DataOutValid : out STD_LOGIC;
        ReadingFrame : in std_logic;
+       FrameDiscard : in std_logic;                        -- frame is not sent (header only), drop its samples
+       ViewportStart : in std_logic;                       -- start reading a window of the last saved frame
+       ViewportOffset : in std_logic_vector(26 downto 0);  -- first window sample (from frame start)
+       ViewportLength : in std_logic_vector(26 downto 0);  -- number of window samples
+       ViewportStride : in std_logic_vector(26 downto 0);  -- read every n-th sample
+       ViewportLevel : in std_logic_vector(3 downto 0);    -- 0: samples, 2 to 12: min/max pyramid level
+       PyramidEnable : in std_logic;                       -- build min/max pyramid of saved frame
+       PyramidOverflow : out std_logic;                    -- min/max pyramid of last frame is incomplete
+       SearchConfig : in std_logic_vector(31 downto 0);    -- event search condition (viewport returns matching positions)
+       SearchWidth : in std_logic_vector(26 downto 0);     -- event search pulse width
+       SearchMask : in std_logic_vector(11 downto 0);      -- event search digital pattern
+       SearchPatternA : in std_logic_vector(11 downto 0);
+       SearchPatternB : in std_logic_vector(11 downto 0);
+       SearchSpan : in std_logic_vector(26 downto 0);      -- number of searched samples
+       AwgRegion : in std_logic;                           -- reserve upper quarter of RAM for AWG samples
+       AwgUpClk : in std_logic;                            -- AWG sample upload
+       AwgUpWrite : in std_logic;
+       AwgUpAddrWrite : in std_logic;
+       AwgUpData : in std_logic_vector(31 downto 0);
+       AwgUpAlmostFull : out std_logic;
+       AwgPlayEnable : in std_logic;                       -- AWG playback from RAM
+       AwgPlayLoop : in std_logic;
+       AwgPlayStart : in std_logic_vector(22 downto 0);
+       AwgPlayLength : in std_logic_vector(22 downto 0);
+       AwgClk : in std_logic;                              -- AWG sample output
+       AwgClkDivide : in std_logic_vector(15 downto 0);
+       AwgSample : out std_logic_vector(11 downto 0);
+       AwgUnderrun : out std_logic;
+       AwgPlaying : out std_logic;
+       PatPlayEnable : in std_logic;                       -- RLE digital pattern playback from RAM
+       PatPlayLoop : in std_logic;
+       PatPlayStart : in std_logic_vector(22 downto 0);
+       PatPlayLength : in std_logic_vector(22 downto 0);
+       PatClk : in std_logic;                              -- digital pattern output
+       PatStep : in std_logic;
+       PatState : out std_logic_vector(11 downto 0);
+       PatUnderrun : out std_logic;
+       PatLoopError : out std_logic;
+       PatPlaying : out std_logic;
+       HistEnable : in std_logic;                          -- persistence histogram in RAM (end of AWG region)
+       HistClear : in std_logic;
+       HistStepLog2 : in std_logic_vector(3 downto 0);
+       HistClk : in std_logic;                             -- frame samples (ADC clock)
+       HistStart : in std_logic;
+       HistStop : in std_logic;
+       HistSampleEn : in std_logic;
+       HistDataA : in signed(9 downto 0);
+       HistDataB : in signed(9 downto 0);
+       HistResultTgl : out std_logic;
+       HistFrames : out std_logic_vector(31 downto 0);
+       HistSkipped : out std_logic_vector(31 downto 0);
+       HistClearing : out std_logic;
+       HistSaturated : out std_logic;
        ram_rdy : out std_logic;
        init_calib_complete : out STD_LOGIC;
        device_temp : out std_logic_vector(11 downto 0);
@@ -181,13 +242,13 @@ architecture rtl of fpga is
        );
     end component;
   
-	component SDP_RAM_64x32b is
+	component SDP_RAM_512x32b is
       port (
 		 clk1 : in std_logic;
          clk2 : in std_logic;
          we   : in std_logic;
-         addr1 : in std_logic_vector(5 downto 0);
-         addr2 : in std_logic_vector(5 downto 0);
+         addr1 : in std_logic_vector(8 downto 0);
+         addr2 : in std_logic_vector(8 downto 0);
          di1   : in std_logic_vector(31 downto 0);
          do1  : out std_logic_vector(31 downto 0);
          do2  : out std_logic_vector(31 downto 0));
@@ -212,8 +273,8 @@ architecture rtl of fpga is
 	   port (
 	      clka: IN std_logic;
 			wea: IN std_logic;
-			addra: IN std_logic_VECTOR(14 downto 0);
-			dina: IN std_logic_VECTOR(11 downto 0);
+			addra: IN std_logic_VECTOR(13 downto 0);
+			dina: IN std_logic_VECTOR(23 downto 0);
 			clkb: IN std_logic;
 			addrb: IN std_logic_VECTOR(14 downto 0);
 			doutb: OUT std_logic_VECTOR(11 downto 0));
@@ -225,6 +286,28 @@ architecture rtl of fpga is
            pwm_out : out  STD_LOGIC);
 	end component;
 
+	component la_transition is
+    Port ( clk : in std_logic;
+           SampleEn : in std_logic;
+           Force : in std_logic;
+           Mask : in std_logic_vector(11 downto 0);
+           DataD : in std_logic_vector(11 downto 0);
+           Rec : out std_logic_vector(31 downto 0);
+           RecValid : out std_logic
+           );
+	end component;
+
+	component trig_interp is
+    Port ( clk : in std_logic;
+           Start : in std_logic;
+           Sample0 : in std_logic_vector(9 downto 0);
+           Sample1 : in std_logic_vector(9 downto 0);
+           Level : in std_logic_vector(10 downto 0);
+           Frac : out std_logic_vector(15 downto 0);
+           FracValid : out std_logic
+           );
+	end component;
+
 	component lut_delay is
     Port ( clk : in  STD_LOGIC;
 		   rst : in STD_LOGIC;
@@ -235,6 +318,153 @@ architecture rtl of fpga is
 			  );
 	end component;
 	
+	component frame_meas is
+    Port (
+        clk : in std_logic;
+        Start : in std_logic;
+        Stop : in std_logic;
+        SampleEn : in std_logic;
+        DataA : in signed(9 downto 0);
+        DataB : in signed(9 downto 0);
+        ResultTgl : out std_logic;
+        TimingValid : out std_logic_vector(1 downto 0);
+        Results : out std_logic_vector(23*32-1 downto 0)
+    );
+	end component;
+	
+	component mask_test is
+    Generic (
+        MASK_LOG2 : integer := 12
+    );
+    Port (
+        clk : in std_logic;
+        Enable : in std_logic;
+        Offset : in std_logic_vector(26 downto 0);
+        StepLog2 : in std_logic_vector(3 downto 0);
+        Length : in std_logic_vector(MASK_LOG2 downto 0);
+        Start : in std_logic;
+        Stop : in std_logic;
+        SampleEn : in std_logic;
+        DataA : in signed(9 downto 0);
+        DataB : in signed(9 downto 0);
+        clk_wr : in std_logic;
+        WrEn : in std_logic;
+        WrSel : in std_logic;
+        WrAddr : in std_logic_vector(MASK_LOG2-1 downto 0);
+        WrData : in std_logic_vector(23 downto 0);
+        ResultTgl : out std_logic;
+        Fail : out std_logic;
+        ViolA : out std_logic_vector(31 downto 0);
+        ViolB : out std_logic_vector(31 downto 0);
+        FirstFail : out std_logic_vector(31 downto 0);
+        FramesTested : out std_logic_vector(31 downto 0);
+        FramesFailed : out std_logic_vector(31 downto 0)
+    );
+	end component;
+	
+	component ilv_correct is
+    Port (
+        clk : in std_logic;
+        DataA : in signed(9 downto 0);
+        DataB : in signed(9 downto 0);
+        OffsetA : in std_logic_vector(15 downto 0);
+        GainA : in std_logic_vector(15 downto 0);
+        OffsetB : in std_logic_vector(15 downto 0);
+        GainB : in std_logic_vector(15 downto 0);
+        Coef0 : in std_logic_vector(15 downto 0);
+        Coef1 : in std_logic_vector(15 downto 0);
+        Coef2 : in std_logic_vector(15 downto 0);
+        Coef3 : in std_logic_vector(15 downto 0);
+        OutA : out signed(9 downto 0);
+        OutB : out signed(9 downto 0);
+        CalStart : in std_logic;
+        CalLog2 : in std_logic_vector(4 downto 0);
+        CalBusy : out std_logic;
+        CalDone : out std_logic;
+        CalSumA : out std_logic_vector(31 downto 0);
+        CalSumB : out std_logic_vector(31 downto 0);
+        CalSumAA : out std_logic_vector(47 downto 0);
+        CalSumBB : out std_logic_vector(47 downto 0);
+        CalSumAB : out std_logic_vector(47 downto 0);
+        CalSumBA : out std_logic_vector(47 downto 0)
+    );
+	end component;
+	
+	component ets_tdc is
+    generic (
+        CAL_LOG2 : integer := 16
+    );
+    Port (
+        clk : in std_logic;
+        TapReg : in std_logic_vector(31 downto 0);
+        Hit : in std_logic;
+        Valid : out std_logic;
+        Code : out std_logic_vector(5 downto 0);
+        Fine : out std_logic_vector(15 downto 0);
+        Calibrated : out std_logic
+    );
+	end component;
+	
+    component awg_sweep is
+    Port (
+        clk : in std_logic;
+        CfgTgl : in std_logic;
+        SweepMode : in std_logic_vector(1 downto 0);
+        SweepRepeat : in std_logic;
+        SweepStart : in std_logic_vector(31 downto 0);
+        SweepStop : in std_logic_vector(31 downto 0);
+        SweepStep : in std_logic_vector(31 downto 0);
+        SweepDwell : in std_logic_vector(31 downto 0);
+        ModMode : in std_logic_vector(1 downto 0);
+        ModSource : in std_logic;
+        ModRate : in std_logic_vector(31 downto 0);
+        ModDepth : in std_logic_vector(19 downto 0);
+        ModSample : in signed(11 downto 0);
+        BaseDelta : in std_logic_vector(31 downto 0);
+        BaseVoltage : in sfixed(0 downto -11);
+        Delta : out std_logic_vector(31 downto 0);
+        Voltage : out sfixed(0 downto -11);
+        Sweeping : out std_logic
+    );
+    end component;
+
+    component proto_decoder is
+    Port (
+        clk : in std_logic;
+        dataD : in std_logic_vector(11 downto 0);
+        Ctrl : in std_logic_vector(31 downto 0);
+        Ctrl2 : in std_logic_vector(31 downto 0);
+        TrigPattern : in std_logic_vector(31 downto 0);
+        TrigMask : in std_logic_vector(31 downto 0);
+        Trig : out std_logic;
+        clk_rd : in std_logic;
+        RdEn : in std_logic;
+        RdData : out std_logic_vector(63 downto 0);
+        RdEmpty : out std_logic
+    );
+    end component;
+
+    component fra_core is
+    Port (
+        clk : in std_logic;
+        Enable : in std_logic;
+        Settle : in std_logic_vector(23 downto 0);
+        Length : in std_logic_vector(22 downto 0);
+        DeltaTgl : in std_logic;
+        Delta : in std_logic_vector(31 downto 0);
+        DataA : in signed(9 downto 0);
+        DataB : in signed(9 downto 0);
+        ResultTgl : out std_logic;
+        ResultDelta : out std_logic_vector(31 downto 0);
+        ResultCount : out std_logic_vector(31 downto 0);
+        ResultIA : out std_logic_vector(47 downto 0);
+        ResultQA : out std_logic_vector(47 downto 0);
+        ResultIB : out std_logic_vector(47 downto 0);
+        ResultQB : out std_logic_vector(47 downto 0);
+        Busy : out std_logic
+    );
+    end component;
+
     component awg_core is
     Port (  clk_in : in  STD_LOGIC;
             --clk enable
@@ -251,6 +481,9 @@ architecture rtl of fpga is
             generatorDuty_1 : in  signed(11 downto 0);
             generatorDelta_1 : in  STD_LOGIC_VECTOR(bH-bL downto 0);
             generatorCustomSample_1 : in  STD_LOGIC_VECTOR (11 downto 0);
+            generatorBankMode_1 : in  STD_LOGIC;
+            generatorBank_1 : in  STD_LOGIC;
+            generatorBankActive_1 : out STD_LOGIC;
 			--AWG2
 			genSignal_2     : out signed (11 downto 0);
 			ram_addrb_awg_2 : out STD_LOGIC_VECTOR (14 downto 0);
@@ -260,6 +493,9 @@ architecture rtl of fpga is
             generatorDuty_2 : in  signed(11 downto 0);
             generatorDelta_2 : in  STD_LOGIC_VECTOR(bH-bL downto 0);
             generatorCustomSample_2 : in  STD_LOGIC_VECTOR (11 downto 0);
+            generatorBankMode_2 : in  STD_LOGIC;
+            generatorBank_2 : in  STD_LOGIC;
+            generatorBankActive_2 : out STD_LOGIC;
 			--DAC programming signals
 			dac_data_1 : out STD_LOGIC_VECTOR (11 downto 0);
 			dac_data_2 : out STD_LOGIC_VECTOR (11 downto 0);
@@ -279,21 +515,24 @@ architecture rtl of fpga is
                 );
      end component;
 	 
-	 component spi is
+	 component spi_queue is
 	  generic (
-            SPI_LENGTH : integer -- NUMBER OF BITS TRANSFERED
+            SPI_LENGTH : integer; -- NUMBER OF BITS TRANSFERED
+            DEPTH : integer;
+            SETTLE_CYCLES : integer
             );
-	  Port ( clk : in  std_logic;				
-		     rst : in std_logic;
+	  Port ( clk : in  std_logic;
 		     clk_divide : in std_logic_vector (4 downto 0);
-			 spi_data : in  std_logic_vector (SPI_LENGTH-1 downto 0);
-			 spi_write_trig : in std_logic;	
 			 sck_idle_value : in std_logic;
-			 spi_busy : out std_logic;
-             cs : out  std_logic;				
-             sck : out  std_logic;			
+			 Wr : in std_logic;
+			 WrData : in  std_logic_vector (SPI_LENGTH-1 downto 0);
+			 Full : out std_logic;
+			 Idle : out std_logic;
+			 DoneCnt : out std_logic_vector (7 downto 0);
+             cs : out  std_logic;
+             sck : out  std_logic;
              si : out  std_logic
-			 );			
+			 );
 	end component;
 	
 	COMPONENT timer
@@ -408,17 +647,37 @@ signal dataB : std_logic_vector(9 downto 0);
 signal ifclk : std_logic;
 signal fdata_d: std_logic_VECTOR(15 downto 0);
 --
-signal cfg_addrA: std_logic_VECTOR(5 downto 0);	     -- memory addr written to / read out on the SPO
-signal cfg_addrA_d: std_logic_VECTOR(5 downto 0);	 -- memory addr written to / read out on the SPO
+signal cfg_addrA: std_logic_VECTOR(6 downto 0);	     -- memory addr written to / read out on the SPO
+signal cfg_addrA_d: std_logic_VECTOR(6 downto 0);	 -- memory addr written to / read out on the SPO
 signal cfg_data_in: std_logic_VECTOR(31 downto 0);	 -- memory location read out on the DPO
 signal cfg_data_in_d: std_logic_VECTOR(31 downto 0); -- memory location read out on the DPO (delayed 1 clk)
-signal cfg_addrB: std_logic_VECTOR(5 downto 0);
-signal cfg_addrB_d: std_logic_VECTOR(5 downto 0);
+signal cfg_addrB: std_logic_VECTOR(6 downto 0);
+signal cfg_addrB_d: std_logic_VECTOR(6 downto 0);
 signal cfg_we: std_logic;
 signal cfg_we_d: std_logic;
 signal cfg_do_A: std_logic_VECTOR(31 downto 0); -- port A data out (clk)
 signal cfg_do_B: std_logic_VECTOR(31 downto 0); -- port B data out (adc_clk)
-signal cfg_data_cnt: integer range 0 to (CONFIG_DATA_SIZE-1) := 0;
+signal cfg_data_cnt: integer range 0 to (CFG_CMD_MAX_WORDS-1) := 0;
+signal cfg_data_len: integer range 0 to CFG_CMD_MAX_WORDS := CONFIG_DATA_SIZE; -- number of words in EP2 transfer
+-- register write command: (address, value) pairs and masked writes (address, mask, value)
+signal cfg_cmd: std_logic := '0';              -- register write command is being received
+signal cfg_cmd_ph: integer range 0 to 2 := 0;  -- next command word: 0 address, 1 mask, 2 value
+signal cfg_cmd_masked: std_logic := '0';
+signal cfg_cmd_skip: std_logic := '0';         -- address is out of register space (padding)
+signal cfg_cmd_mask: std_logic_VECTOR(31 downto 0);
+signal cfg_vp_wr: std_logic := '0';            -- viewport registers were written
+-- config banks: RAM address is bank & register address
+signal cfg_bank: std_logic_VECTOR(1 downto 0) := "00";      -- active bank
+signal cfg_bankA: std_logic_VECTOR(1 downto 0) := "00";     -- bank accessed on port A
+signal cfg_bankA_d: std_logic_VECTOR(1 downto 0) := "00";
+signal cfg_bankB: std_logic_VECTOR(1 downto 0) := "00";     -- active bank (adc_clk)
+signal cfg_bankB_d: std_logic_VECTOR(1 downto 0) := "00";
+signal cfg_bank_req: std_logic_VECTOR(1 downto 0) := "00";  -- requested bank
+signal cfg_bank_pend: std_logic := '0';   -- bank switch is waiting for frame boundary
+signal cfg_bank_sw: std_logic := '0';     -- config of new bank is being decoded
+signal cfg_cmd_bank: std_logic := '0';    -- command address is bank select
+signal cfg_ram_addrA: std_logic_VECTOR(8 downto 0);
+signal cfg_ram_addrB: std_logic_VECTOR(8 downto 0);
 --
 signal y_sin : signed(11 downto 0);
 signal x_cos : signed(11 downto 0);
@@ -441,7 +700,6 @@ signal sloe_i 		 : STD_LOGIC:='1';
 signal LED_i    : STD_LOGIC_VECTOR(3 downto 1):="000";
 signal MasterState : STD_LOGIC_VECTOR(3 downto 0):="0000";	 -- Counter to sequence the fifo signals.
 signal GetSampleState : STD_LOGIC_VECTOR(2 downto 0):="000"; -- Counter to sequence ADC samples save.
-signal DAC_state	 : STD_LOGIC_VECTOR(2 downto 0):="000";	 -- Counter to control DAC output voltages.
 signal LA_state	 : STD_LOGIC_VECTOR(2 downto 0):="000";	 -- Counter to control DAC output voltages.
 signal ReturnToStreamingState : STD_LOGIC := '0';	 -- MasterState return flag
 signal ReturnToFrameRequest : STD_LOGIC := '0';	 -- MasterState return flag
@@ -473,8 +731,9 @@ signal hword_cnt_i : integer range 0 to FRAME_HEADER_SIZE := 0; --header word co
 signal dword_cnt_i : integer range 0 to FX3_DMA_BUFFER_SIZE/4 := 0; --data word counter
 signal sent_word_cnt : integer range 0 to 255 := 0;
 signal faddr_rdy_cnt_i : integer range 0 to 3 := 0; --data word counter
-signal slrd_rdy_cnt : integer range 0 to 7 := 0;
-signal slrd_cnt : integer range 0 to FX3_DMA_BUFFER_SIZE-1 := 0;
+signal slrd_cnt : integer range 0 to FX3_DMA_BUFFER_SIZE/4 := 0; -- EP4 reads in current DMA buffer
+signal slrd_valid : std_logic_vector(1 downto 0) := "00";  -- EP4 read data valid (SLRD to data latency)
+signal awg_wait_cnt : integer range 0 to 7 := 0;
 
 -- flags --
 signal slwr_assert : STD_LOGIC := '1'; -- initally, FX3 buffer is empty			
@@ -510,12 +769,41 @@ signal frame_ready_to_send : std_logic;
 signal frame_ready_to_send_d : std_logic;
 signal sendingFrameSlow : std_logic;
 signal ReadingFrame : std_logic:= '0';
+-- viewport readout (window of the last saved frame)
+signal vp_mode : std_logic := '0';      -- hold last saved frame in RAM and send only requested windows
+signal vp_request : std_logic := '0';   -- window readout was requested by host
+signal vp_start : std_logic := '0';
+signal vp_frame : std_logic := '0';     -- frame being sent is a window of the last saved frame
+signal vp_offset : std_logic_vector(26 downto 0) := (others => '0');
+signal vp_length : std_logic_vector(26 downto 0) := (others => '0');
+signal vp_stride : std_logic_vector(26 downto 0) := (others => '0');
+signal vp_level : std_logic_vector(3 downto 0) := (others => '0');    -- 0: samples, 2 to 12: min/max pyramid level, 15: histogram
+signal pyr_enable : std_logic := '0';     -- build min/max envelope pyramid of each saved frame
+signal pyr_overflow : std_logic;
+signal pyr_overflow_d : std_logic := '0';
+signal pyr_overflow_dd : std_logic := '0';
+-- event search over the last saved frame (viewport readout returns list of matching sample positions)
+signal srch_cfg : std_logic_vector(31 downto 0) := (others => '0');   -- mode, channel, edge, hysteresis, level
+signal srch_width : std_logic_vector(26 downto 0) := (others => '0');
+signal srch_span : std_logic_vector(26 downto 0) := (others => '0');
+signal vp_search : std_logic := '0';     -- frame being sent is event search result list
 signal roll : std_logic;
 signal roll_d : std_logic;
 signal ScopeConfigChanged : std_logic;
 signal cnt_restart_framesave : integer range 0 to 15;
 signal cnt_rst_triggered : integer range 0 to 3;
 signal sampling_CE : std_logic;
+signal capture_CE : std_logic;      -- sample save state machine clock enable
+-- transition-only LA storage (config word 64): frame holds (samples since previous record, dataD) records
+signal la_tr_mode : std_logic := '0';
+signal la_tr_mask : std_logic_vector(11 downto 0) := (others => '0');
+signal la_tr_mode_d : std_logic := '0';
+signal la_tr_mask_d : std_logic_vector(11 downto 0) := (others => '0');
+signal la_tr_force : std_logic;
+signal la_tr_valid : std_logic;
+signal la_tr_rec : std_logic_vector(31 downto 0);
+signal la_tr_rec_d : std_logic_vector(31 downto 0) := (others => '0');
+signal la_tr_rec_dd : std_logic_vector(31 downto 0) := (others => '0');
 
 
 CONSTANT A: STD_LOGIC_VECTOR (3 DownTo 0) := "0000";
@@ -535,18 +823,72 @@ CONSTANT ADC_D: STD_LOGIC_VECTOR (2 DownTo 0) := "011";
 CONSTANT ADC_E: STD_LOGIC_VECTOR (2 DownTo 0) := "100";
 CONSTANT ADC_F: STD_LOGIC_VECTOR (2 DownTo 0) := "101";
 
-CONSTANT DAC_A: STD_LOGIC_VECTOR (2 DownTo 0) := "000";
-CONSTANT DAC_B: STD_LOGIC_VECTOR (2 DownTo 0) := "001";
-CONSTANT DAC_C: STD_LOGIC_VECTOR (2 DownTo 0) := "010";
-CONSTANT DAC_D: STD_LOGIC_VECTOR (2 DownTo 0) := "011";
-CONSTANT DAC_E: STD_LOGIC_VECTOR (2 DownTo 0) := "100";
-
 CONSTANT LA_A: STD_LOGIC_VECTOR (2 DownTo 0) := "000";
 CONSTANT LA_B: STD_LOGIC_VECTOR (2 DownTo 0) := "001";
 CONSTANT LA_C: STD_LOGIC_VECTOR (2 DownTo 0) := "010";
 CONSTANT LA_D: STD_LOGIC_VECTOR (2 DownTo 0) := "011";
 CONSTANT LA_E: STD_LOGIC_VECTOR (2 DownTo 0) := "100";
 CONSTANT LA_F: STD_LOGIC_VECTOR (2 DownTo 0) := "101";
+
+-- config register classes (what happens when register value changes)
+CONSTANT CFG_LIVE: STD_LOGIC_VECTOR (1 DownTo 0) := "00";    -- applied immediately
+CONSTANT CFG_FRAME: STD_LOGIC_VECTOR (1 DownTo 0) := "01";   -- shadowed, applied at next frame start (ADC_A)
+CONSTANT CFG_CAPTURE: STD_LOGIC_VECTOR (1 DownTo 0) := "10"; -- capture in progress is restarted
+
+-- analog trigger: sample s_new crossed level after s_old opposite to slope (00: rising, 01: falling, 10: both)
+function trig_cross(s_new : signed(9 downto 0); s_old : signed(9 downto 0); level : signed(9 downto 0);
+                    slope : std_logic_vector(1 downto 0)) return boolean is
+begin
+    return (slope = "00" AND s_new < level AND s_old >= level)
+        OR (slope = "01" AND s_new >= level AND s_old < level)
+        OR (slope = "10" AND ((s_new < level AND s_old >= level) OR (s_new >= level AND s_old < level)));
+end function;
+
+-- analog trigger: armed trigger fires on sample x (levels include hysteresis)
+function trig_fire(x : signed(9 downto 0); level_r : signed(9 downto 0); level_f : signed(9 downto 0);
+                   slope : std_logic_vector(1 downto 0)) return boolean is
+begin
+    return (slope = "00" AND x >= level_r)
+        OR (slope = "01" AND x < level_f)
+        OR (slope = "10" AND abs(x) >= level_r);
+end function;
+
+-- class of each config register, indexed by word number (address+1)
+type cfg_class_array is array(0 to CONFIG_REG_SIZE-1) of std_logic_vector(1 downto 0);
+
+function cfg_class_init return cfg_class_array is
+    variable r : cfg_class_array;
+begin
+    r := (others => CFG_LIVE);
+    -- ADC config, V-gain, input/trigger settings, timebase
+    for w in 1 to 7 loop
+        r(w) := CFG_CAPTURE;
+    end loop;
+    -- offset (3) is compensated by host
+    r(3) := CFG_LIVE;
+    -- holdoff
+    r(8) := CFG_FRAME;
+    -- frame size
+    r(9) := CFG_CAPTURE;
+    -- digital trigger (stage patterns/masks, delays, capture stage and serial trigger;
+    -- POT wiper code in bits 7..0 of word 24 is applied immediately, see state C)
+    for w in 16 to 24 loop
+        r(w) := CFG_CAPTURE;
+    end loop;
+    -- moving average
+    r(27) := CFG_FRAME;
+    -- pre-trigger (latched at ADC_A)
+    r(28) := CFG_CAPTURE;
+    -- min/max pyramid
+    r(35) := CFG_CAPTURE;
+    -- AWG region in RAM (frame size limit)
+    r(39) := CFG_CAPTURE;
+    -- transition-only LA storage
+    r(64) := CFG_CAPTURE;
+    return r;
+end function;
+
+CONSTANT CFG_CLASS : cfg_class_array := cfg_class_init;
 CONSTANT LA_G: STD_LOGIC_VECTOR (2 DownTo 0) := "110";
 
 -- ADC CLK sample save divider signals
@@ -572,25 +914,22 @@ signal phase_val : STD_LOGIC_VECTOR(bH downto 0);
 
 -- AWG custom buffer
 signal wea_awg : STD_LOGIC;
-signal addra_awg     : STD_LOGIC_VECTOR (14 downto 0);
-signal dina_awg      : STD_LOGIC_VECTOR (11 downto 0);
-signal dina_awg_tmp  : STD_LOGIC_VECTOR (11 downto 0);
+signal addra_awg     : STD_LOGIC_VECTOR (13 downto 0);  -- sample pair address
+signal dina_awg      : STD_LOGIC_VECTOR (23 downto 0);
 signal addrb_awg     : STD_LOGIC_VECTOR (14 downto 0);
 signal doutb_awg     : STD_LOGIC_VECTOR (11 downto 0);
 
 -- AWG2 custom buffer
 signal wea_awg2 : STD_LOGIC;
-signal addra_awg2    : STD_LOGIC_VECTOR (14 downto 0);
-signal dina_awg2     : STD_LOGIC_VECTOR (11 downto 0);
-signal dina_awg2_tmp : STD_LOGIC_VECTOR (11 downto 0);
+signal addra_awg2    : STD_LOGIC_VECTOR (13 downto 0);  -- sample pair address
+signal dina_awg2     : STD_LOGIC_VECTOR (23 downto 0);
 signal addrb_awg2    : STD_LOGIC_VECTOR (14 downto 0);
 signal doutb_awg2    : STD_LOGIC_VECTOR (11 downto 0);
 
 -- Digital custom buffer
 signal wea_dig : STD_LOGIC;
-signal addra_dig     : STD_LOGIC_VECTOR (14 downto 0);
-signal dina_dig      : STD_LOGIC_VECTOR (11 downto 0);
-signal dina_dig_tmp  : STD_LOGIC_VECTOR (11 downto 0);
+signal addra_dig     : STD_LOGIC_VECTOR (13 downto 0);  -- sample pair address
+signal dina_dig      : STD_LOGIC_VECTOR (23 downto 0);
 signal addrb_dig     : STD_LOGIC_VECTOR (14 downto 0);
 signal doutb_dig     : STD_LOGIC_VECTOR (11 downto 0);
 signal doutb_dig_d   : STD_LOGIC_VECTOR (11 downto 0);
@@ -601,7 +940,43 @@ signal digitalClkDivide_L : STD_LOGIC_VECTOR (15 downto 0);
 signal digitalClkDivide_tmp : STD_LOGIC_VECTOR (31 downto 0);
 signal digitalClkDivide_cnt : unsigned(31 downto 0);
 
-signal buffersel : std_logic_vector (1 downto 0);
+-- EP4 upload: header (AWG_HDR_MAGIC & target, offset & length) followed by sample pairs
+signal awg_up_ph : integer range 0 to 4 := 0;     -- 0: header, 1: offset/length, 2: data, 3: padding, 4: RAM upload length
+signal awg_up_legacy : std_logic := '0';          -- no header: fill all buffers in order
+signal awg_up_sel : std_logic_vector(2 downto 0) := "000";
+signal awg_up_addr : unsigned(13 downto 0) := (others => '0');
+signal awg_up_len : unsigned(25 downto 0) := (others => '0');  -- remaining sample pairs
+
+-- long waveform AWG_1 playback from DDR3 (AWG region: upper quarter of RAM)
+signal awg_ddr_region : std_logic := '0';
+signal awg_ddr_play : std_logic := '0';
+signal awg_ddr_loop : std_logic := '0';
+signal awg_ddr_start : std_logic_vector(22 downto 0) := (others => '0');   -- first RAM word (8 samples)
+signal awg_ddr_length : std_logic_vector(22 downto 0) := (others => '0');  -- number of RAM words
+signal awg_ddr_divide : std_logic_vector(15 downto 0) := (others => '0');  -- sample every divide+1 clk_gen
+signal awg_ddr_sample : std_logic_vector(11 downto 0);
+signal awg_ddr_underrun : std_logic;
+signal awg_ddr_playing : std_logic;
+signal awg_ddr_status_d : std_logic_vector(1 downto 0) := "00";
+signal awg_ddr_status_dd : std_logic_vector(1 downto 0) := "00";
+-- run-length encoded digital pattern playback from DDR3 (AWG region)
+signal pat_play : std_logic := '0';
+signal pat_loop : std_logic := '0';
+signal pat_start : std_logic_vector(22 downto 0) := (others => '0');   -- first RAM word (4 commands)
+signal pat_length : std_logic_vector(22 downto 0) := (others => '0');  -- number of RAM words
+signal pat_step : std_logic := '0';
+signal pat_state : std_logic_vector(11 downto 0);
+signal pat_underrun : std_logic;
+signal pat_loop_error : std_logic;
+signal pat_playing : std_logic;
+signal pat_dout : std_logic_vector(11 downto 0);
+signal pat_status_d : std_logic_vector(2 downto 0) := "000";
+signal pat_status_dd : std_logic_vector(2 downto 0) := "000";
+signal awg_up_ddr_wr : std_logic := '0';
+signal awg_up_ddr_addr_wr : std_logic := '0';
+signal awg_up_ddr_data : std_logic_vector(31 downto 0) := (others => '0');
+signal awg_up_ddr_afull : std_logic;
+signal gen1CustomSample : std_logic_vector(11 downto 0);
 
 -- DELAY registers
 signal dataAd	: SIGNED (9 downto 0);
@@ -614,6 +989,19 @@ signal dora_i : std_logic;
 signal dorb_i : std_logic;
 signal trig_signal 	: SIGNED (9 downto 0);
 signal trig_signal_d : SIGNED (9 downto 0);
+signal trig_signal_dd : SIGNED (9 downto 0);
+signal trig_signal_e : SIGNED (9 downto 0) := (others => '0');    -- interleaved: earlier (ADC A) sample of pair, trig_signal is ADC B
+signal trig_signal_e_d : SIGNED (9 downto 0) := (others => '0');
+signal ilv_trig : std_logic;    -- CH1 trigger on interleaved sample pairs
+signal trig_arm_e : std_logic;  -- trigger is armed by earlier sample of interleaved pair
+signal trig_arm_l : std_logic;  -- trigger is armed by trig_signal
+signal trig_arm : std_logic;    -- analog trigger source crossed trigger level opposite to slope (trigger can be armed)
+signal trig_skip_e : std_logic := '0';  -- first clk after arming: samples of pair up to arming sample are not compared
+signal trig_skip_l : std_logic := '0';
+signal trig_fire_e : std_logic; -- trigger fires on earlier sample of interleaved pair (trig_signal_e_d)
+signal trig_fire_l : std_logic; -- trigger fires on trig_signal_d
+signal interp_late : std_logic := '0';  -- interleaved: crossing is between A and B sample of the pair
+signal trig_frac_late : std_logic := '0';
 signal triggered_led : std_logic;
 signal triggered_led_d : std_logic;
 
@@ -671,6 +1059,17 @@ signal mem_tmp_d : std_logic_vector(15 downto 0);
 
 -- digital logic analyzer signals
 signal dt_triggered : std_logic;
+-- UART/SPI/I2C decoders (config words 60 to 63), event records are sent in frame header
+signal dec_ctrl : std_logic_vector(31 downto 0) := (others => '0');
+signal dec_ctrl2 : std_logic_vector(31 downto 0) := (others => '0');
+signal dec_trig_pattern : std_logic_vector(31 downto 0) := (others => '0');
+signal dec_trig_mask : std_logic_vector(31 downto 0) := (others => '0');
+signal dec_triggered : std_logic;
+signal dec_trig_pend : std_logic := '0';
+signal dec_rden : std_logic := '0';
+signal dec_rd_data : std_logic_vector(63 downto 0);
+signal dec_empty : std_logic;
+signal dec_rec_lo : std_logic_vector(31 downto 0) := (others => '0');
 signal dt_delayMaxcnt_0 : std_logic_vector(15 downto 0);
 signal dt_delayMaxcnt_1 : std_logic_vector(15 downto 0);
 signal dt_delayMaxcnt_2 : std_logic_vector(15 downto 0);
@@ -732,11 +1131,12 @@ signal configure_dac : STD_LOGIC;
 signal adc_cs_i : STD_LOGIC := '1';
 signal adc_sclk_i : STD_LOGIC;
 signal adc_sdin_i : STD_LOGIC;
-signal adcA_spi_busy : std_logic;
-signal adcB_spi_busy : std_logic;
+signal adc_spi_idle : std_logic;
+signal adc_spi_done_cnt : std_logic_vector (7 downto 0);
 
 -- DPOT SPI interface
-signal dpot_spi_busy : std_logic;
+signal dpot_spi_idle : std_logic;
+signal dpot_spi_done_cnt : std_logic_vector (7 downto 0);
 signal dpot_spi_write_trig : std_logic;
 signal dpot_spi_WiperCode : std_logic_vector(15 downto 0);
 
@@ -752,10 +1152,11 @@ signal dac_array_count : integer range 1 to 4:=1; -- DAC out selection
 signal dac_cs_i : STD_LOGIC :='1';
 signal dac_sclk_i : STD_LOGIC;
 signal dac_sdin_i : STD_LOGIC;
-signal dac_spi_busy : std_logic;
+signal dac_spi_full : std_logic;
+signal dac_spi_idle : std_logic;   -- all DAC registers were written and outputs are stable
+signal dac_spi_done_cnt : std_logic_vector (7 downto 0);
 signal DAC_pogramming_start : std_logic;
-signal DAC_programming_finished : std_logic;
-signal cnt_dac_out_stable : integer range 0 to 16383;
+signal DAC_enqueue : std_logic := '0';  -- DAC registers are being written to SPI queue
 
 ---- AWG internal signals
 signal generator1Voltage : sfixed(0 downto -11);
@@ -774,6 +1175,64 @@ signal generator2Delta_L : STD_LOGIC_VECTOR(15 downto 0);
 signal generator2Offset : signed (11 downto 0);
 signal generator2Duty : signed(11 downto 0);
 
+-- custom signal RAM banks (ping-pong): uploads go to inactive bank, awg_core switches at waveform wrap
+signal generator1BankMode : std_logic := '0';
+signal generator2BankMode : std_logic := '0';
+signal generator1Bank : std_logic := '0';     -- requested bank
+signal generator2Bank : std_logic := '0';
+signal generator1BankActive : std_logic;      -- bank currently played (clk_gen)
+signal generator2BankActive : std_logic;
+signal generator1BankActive_d : std_logic_vector(1 downto 0) := "00";
+signal generator2BankActive_d : std_logic_vector(1 downto 0) := "00";
+
+-- frequency sweep and modulation (config words 43 to 49: AWG_1, 50 to 56: AWG_2)
+type sweep_reg_array is array(1 to 2) of std_logic_vector(31 downto 0);
+type sweep_mod_array is array(1 to 2) of signed(11 downto 0);
+type sweep_vol_array is array(1 to 2) of sfixed(0 downto -11);
+signal sweep_ctrl : sweep_reg_array := (others => (others => '0'));   -- bits 1..0: sweep mode, 2: repeat, 5..4: modulation, 6: external modulator
+signal sweep_start : sweep_reg_array := (others => (others => '0'));
+signal sweep_stop : sweep_reg_array := (others => (others => '0'));
+signal sweep_step : sweep_reg_array := (others => (others => '0'));
+signal sweep_dwell : sweep_reg_array := (others => (others => '0'));
+signal mod_rate : sweep_reg_array := (others => (others => '0'));
+signal mod_depth : sweep_reg_array := (others => (others => '0'));
+signal mod_sample : sweep_mod_array;
+signal sweep_base_delta : sweep_reg_array;
+signal sweep_base_voltage : sweep_vol_array;
+signal sweep_delta : sweep_reg_array;
+signal sweep_voltage : sweep_vol_array;
+signal sweeping : std_logic_vector(1 to 2);
+signal sweep_cfg_tgl : std_logic := '0';    -- sweep/generator config was copied (ifclk, taken by awg_sweep in clk_gen)
+signal sweeping_d : std_logic_vector(1 to 2) := "00";
+signal sweeping_dd : std_logic_vector(1 to 2) := "00";
+
+-- frequency response analyzer (config words 57 to 59), results are sent in frame header
+type fra_ring_array is array(0 to 255) of std_logic_vector(31 downto 0);
+signal fra_enable : std_logic := '0';
+signal fra_settle : std_logic_vector(23 downto 0) := (others => '0');
+signal fra_length : std_logic_vector(22 downto 0) := (others => '0');
+signal fra_delta : std_logic_vector(31 downto 0) := (others => '0');  -- AWG_1 delta (clk_gen)
+signal fra_delta_tgl : std_logic := '0';
+signal fra_busy : std_logic;
+signal fra_res_tgl : std_logic;
+signal fra_res_tgl_d : std_logic := '0';
+signal fra_res_tgl_dd : std_logic := '0';
+signal fra_res_tgl_ddd : std_logic := '0';
+signal fra_res_delta : std_logic_vector(31 downto 0);
+signal fra_res_count : std_logic_vector(31 downto 0);
+signal fra_res_ia : std_logic_vector(47 downto 0);
+signal fra_res_qa : std_logic_vector(47 downto 0);
+signal fra_res_ib : std_logic_vector(47 downto 0);
+signal fra_res_qb : std_logic_vector(47 downto 0);
+signal fra_res_words : std_logic_vector(255 downto 0);
+signal fra_ring : fra_ring_array;                   -- last 32 points, 8 words each
+signal fra_ring_wr_cnt : integer range 0 to 8 := 8;
+signal fra_wr_pt : unsigned(15 downto 0) := (others => '0');  -- number of finished points
+signal fra_rd_pt : unsigned(15 downto 0) := (others => '0');  -- number of points sent in header
+signal fra_hdr_pt : unsigned(15 downto 0) := (others => '0');
+signal fra_hdr_n : unsigned(4 downto 0) := (others => '0');
+signal fra_lost : std_logic := '0';
+
 signal clk_gen : std_logic;
 signal genSignal_1 : signed (11 downto 0);
 signal genSIgnal_2 : signed (11 downto 0);
@@ -781,8 +1240,6 @@ signal genSignal_1_d : signed (9 downto 0);
 signal genSignal_2_d : signed (9 downto 0);
 signal genSignal_1_dd : signed (9 downto 0);
 signal genSignal_2_dd : signed (9 downto 0);
-signal accumulate_addra_awg : std_logic := '0'; -- start addra counter
-signal accumulate_addra_dig : std_logic := '0'; -- start addra counter
 
 -- analog switching
 signal ch1_dc_i  : STD_LOGIC;
@@ -805,7 +1262,6 @@ signal Timer_cnt : integer range 0 to (2**26)-1 := 0;
 signal startup_timer_cnt : integer range 0 to 250000 := 0;
 signal clk_div_cnt : integer range 0 to 100*(10**6); 
 signal clk_div_cnt_2 : integer range 0 to 250*(10**6);
-signal cnt_rd_last : std_logic := '0';
 signal cnt_dw_stop : integer range 0 to 7 := 0;
 
 --LUT delay line signals
@@ -818,6 +1274,99 @@ signal an_trig_delay_d : std_logic_vector(5 downto 0);
 signal an_trig_delay_dd : unsigned(5 downto 0);
 signal an_trig_delay_max : unsigned(5 downto 0);
 signal an_trig_delay_min : unsigned(5 downto 0) :="000001";
+-- ETS trigger TDC (code-density calibrated delay line)
+signal ets_hit : std_logic;
+signal ets_mark : std_logic := '0';
+signal ets_mark_d : std_logic := '0';
+signal ets_mark_dd : std_logic := '0';
+signal ets_tdc_valid : std_logic;
+signal ets_tdc_code : std_logic_vector(5 downto 0);
+signal ets_tdc_fine : std_logic_vector(15 downto 0);
+signal ets_tdc_calibrated : std_logic;
+signal ets_fine : std_logic_vector(15 downto 0) := (others => '0');
+signal ets_fine_d : std_logic_vector(15 downto 0);
+signal ets_fine_dd : std_logic_vector(15 downto 0);
+signal ets_calibrated_d : std_logic;
+signal ets_calibrated_dd : std_logic;
+
+-- trigger timestamp (ADC clock ticks), frame sequence number and lost triggers (sent in frame header)
+signal ts_cnt_lo : unsigned(31 downto 0) := (others => '0');
+signal ts_cnt_hi : unsigned(31 downto 0) := (others => '0');
+signal GetSampleState_ts : STD_LOGIC_VECTOR(2 downto 0) := "000";
+signal trig_ts : std_logic_vector(63 downto 0) := (others => '0');
+signal frame_seq : unsigned(31 downto 0) := (others => '0');
+signal trig_lost_cnt : unsigned(31 downto 0) := (others => '0');
+signal trig_lost : std_logic_vector(31 downto 0) := (others => '0');
+signal trig_info_tgl : std_logic := '0';
+signal trig_info_tgl_d : std_logic := '0';
+signal trig_info_tgl_dd : std_logic := '0';
+signal trig_info_tgl_ddd : std_logic := '0';
+-- per-frame measurements
+signal meas_start : std_logic := '0';
+signal meas_stop : std_logic := '0';
+signal meas_en : std_logic := '0';
+signal meas_tgl : std_logic;
+signal meas_tgl_d : std_logic := '0';
+signal meas_tgl_dd : std_logic := '0';
+signal meas_tgl_ddd : std_logic := '0';
+signal meas_timing_ok : std_logic_vector(1 downto 0);
+signal meas_results : std_logic_vector(23*32-1 downto 0);
+signal hdr_meas : std_logic_vector(23*32-1 downto 0) := (others => '0');
+signal hdr_meas_ok : std_logic_vector(1 downto 0) := "00";
+-- mask test
+signal mask_enable : std_logic := '0';
+signal mask_fail_only : std_logic := '0';                       -- only failed frames are sent
+signal mask_step : std_logic_vector(3 downto 0) := (others => '0');
+signal mask_length : std_logic_vector(12 downto 0) := (others => '0');
+signal mask_offset : std_logic_vector(26 downto 0) := (others => '0');
+signal wea_mask : std_logic := '0';
+signal addra_mask : std_logic_vector(11 downto 0) := (others => '0');
+signal dina_mask : std_logic_vector(23 downto 0) := (others => '0');
+signal mask_wr_sel : std_logic := '0';
+signal mask_tgl : std_logic;
+signal mask_tgl_d : std_logic := '0';
+signal mask_tgl_dd : std_logic := '0';
+signal mask_tgl_ddd : std_logic := '0';
+signal mask_fail : std_logic;
+signal mask_viol_a : std_logic_vector(31 downto 0);
+signal mask_viol_b : std_logic_vector(31 downto 0);
+signal mask_first : std_logic_vector(31 downto 0);
+signal mask_frames : std_logic_vector(31 downto 0);
+signal mask_frames_failed : std_logic_vector(31 downto 0);
+signal mask_done : std_logic := '0';                            -- mask result of saved frame was received
+signal hdr_mask_fail : std_logic := '0';
+signal hdr_mask : std_logic_vector(5*32-1 downto 0) := (others => '0');
+-- persistence histogram
+signal hist_enable : std_logic := '0';
+signal hist_clear : std_logic := '0';
+signal hist_step : std_logic_vector(3 downto 0) := (others => '0');
+signal hist_tgl : std_logic;
+signal hist_tgl_d : std_logic := '0';
+signal hist_tgl_dd : std_logic := '0';
+signal hist_tgl_ddd : std_logic := '0';
+signal hist_frames : std_logic_vector(31 downto 0);
+signal hist_skipped : std_logic_vector(31 downto 0);
+signal hist_clearing : std_logic;
+signal hist_saturated : std_logic;
+signal hist_status_d : std_logic_vector(1 downto 0) := "00";
+signal hist_status_dd : std_logic_vector(1 downto 0) := "00";
+signal hist_clearing_ddd : std_logic := '0';
+signal hdr_hist : std_logic_vector(2*32-1 downto 0) := (others => '0');
+signal hdr_trig_ts : std_logic_vector(63 downto 0) := (others => '0');
+signal hdr_frame_seq : std_logic_vector(31 downto 0) := (others => '0');
+signal hdr_trig_lost : std_logic_vector(31 downto 0) := (others => '0');
+signal trig_info_dly : std_logic_vector(7 downto 0) := (others => '0');  -- wait for trigger interpolation result
+-- sub-sample trigger interpolation (analog trigger crossing between two samples)
+signal interp_start : std_logic := '0';
+signal interp_armed : std_logic := '0';
+signal interp_s0 : std_logic_vector(9 downto 0);
+signal interp_s1 : std_logic_vector(9 downto 0);
+signal interp_level : std_logic_vector(10 downto 0);
+signal interp_frac : std_logic_vector(15 downto 0);
+signal interp_frac_valid : std_logic;
+signal trig_frac : std_logic_vector(15 downto 0) := (others => '0');
+signal trig_frac_ok : std_logic := '0';
+signal hdr_trig_frac : std_logic_vector(31 downto 0) := (others => '0');
 signal lut_reg_out_tmp0 : std_logic_vector(15 downto 0);
 signal lut_reg_out_tmp1 : std_logic_vector(15 downto 0);
 signal lut_reg_out_tmp0_d : std_logic_vector(15 downto 0);
@@ -832,6 +1381,32 @@ signal ets_test  : std_logic;
 --ADC interleaving
 signal adc_interleaving : std_logic;
 signal adc_interleaving_d : std_logic;
+-- interleaved ADC mismatch correction
+signal ilv_enable : std_logic := '0';
+signal ilv_enable_d : std_logic := '0';
+signal ilv_on : std_logic;
+signal ilv_cal_start : std_logic := '0';
+signal ilv_cal_log2 : std_logic_vector(4 downto 0) := (others => '0');
+signal ilv_gain_a : std_logic_vector(15 downto 0) := X"8000";
+signal ilv_offset_a : std_logic_vector(15 downto 0) := (others => '0');
+signal ilv_gain_b : std_logic_vector(15 downto 0) := X"8000";
+signal ilv_offset_b : std_logic_vector(15 downto 0) := (others => '0');
+signal ilv_coef0 : std_logic_vector(15 downto 0) := (others => '0');
+signal ilv_coef1 : std_logic_vector(15 downto 0) := X"4000";
+signal ilv_coef2 : std_logic_vector(15 downto 0) := (others => '0');
+signal ilv_coef3 : std_logic_vector(15 downto 0) := (others => '0');
+signal ilv_dataA : signed(9 downto 0);
+signal ilv_dataB : signed(9 downto 0);
+signal ilv_cal_busy : std_logic;
+signal ilv_cal_done : std_logic;
+signal ilv_cal_status_d : std_logic_vector(1 downto 0) := "00";
+signal ilv_cal_status_dd : std_logic_vector(1 downto 0) := "00";
+signal ilv_cal_sum_a : std_logic_vector(31 downto 0);
+signal ilv_cal_sum_b : std_logic_vector(31 downto 0);
+signal ilv_cal_sum_aa : std_logic_vector(47 downto 0);
+signal ilv_cal_sum_bb : std_logic_vector(47 downto 0);
+signal ilv_cal_sum_ab : std_logic_vector(47 downto 0);
+signal ilv_cal_sum_ba : std_logic_vector(47 downto 0);
 
 --Debug Signals
 signal DebugMState : integer range 0 to 7;
@@ -854,6 +1429,27 @@ signal init_calib_complete_d : std_logic;
 signal calib_done : std_logic;
 signal read_calib_start : std_logic :='0';
 signal read_calib_source : std_logic := '0';  -- '0' calibrate CH1, '1' calibrate CH2
+-- ADC interface eye scan: results and re-calibration (manual or on temperature change)
+signal adc_eye_width : std_logic_vector(59 downto 0);
+signal adc_eye_center : std_logic_vector(49 downto 0);
+signal adc_eye_lane : integer range 0 to 9 := 0;         -- lane reported in header
+signal adc_recal_auto : std_logic := '0';
+signal adc_recal_man : std_logic := '0';
+signal adc_recal_man_d : std_logic := '0';
+signal adc_recal_dtemp : unsigned(11 downto 0) := (others => '0');
+
+-- header-only frames (measurement mode): samples are sent only on request or with every n-th frame
+signal hdr_only : std_logic := '0';
+signal hdr_only_req : std_logic := '0';                         -- rising edge: send next frame with samples
+signal hdr_only_req_d : std_logic := '0';
+signal hdr_only_nth : unsigned(15 downto 0) := (others => '0'); -- 0: samples only on request
+signal hdr_only_cnt : unsigned(15 downto 0) := (others => '0');
+signal hdr_only_full_pend : std_logic := '0';
+signal frame_no_samples : std_logic := '0';                     -- frame being sent has header only
+signal frame_discard : std_logic := '0';
+signal adc_recal_temp : unsigned(11 downto 0) := (others => '0'); -- temperature at last calibration
+signal adc_recal_cnt : integer range 0 to 20000 := 0;
+signal adc_recal_count : unsigned(7 downto 0) := (others => '0');
 signal device_temp : std_logic_vector(11 downto 0);
 signal device_temp_d : std_logic_vector(11 downto 0);
 signal device_temp_dd : std_logic_vector(11 downto 0);
@@ -916,6 +1512,35 @@ attribute KEEP of an_trig_delay_d: signal is true;
 attribute KEEP of an_trig_delay_dd: signal is true;
 attribute ASYNC_REG of an_trig_delay_d: signal is true;
 attribute ASYNC_REG of an_trig_delay_dd: signal is true;
+attribute ASYNC_REG of ilv_cal_status_d: signal is true;
+attribute ASYNC_REG of ilv_cal_status_dd: signal is true;
+attribute ASYNC_REG of ets_fine_d: signal is true;
+attribute ASYNC_REG of ets_fine_dd: signal is true;
+attribute ASYNC_REG of ets_calibrated_d: signal is true;
+attribute ASYNC_REG of ets_calibrated_dd: signal is true;
+attribute KEEP of trig_info_tgl_d: signal is true;
+attribute ASYNC_REG of trig_info_tgl_d: signal is true;
+attribute ASYNC_REG of trig_info_tgl_dd: signal is true;
+attribute ASYNC_REG of meas_tgl_d: signal is true;
+attribute ASYNC_REG of meas_tgl_dd: signal is true;
+attribute ASYNC_REG of mask_tgl_d: signal is true;
+attribute ASYNC_REG of mask_tgl_dd: signal is true;
+attribute ASYNC_REG of hist_tgl_d: signal is true;
+attribute ASYNC_REG of hist_tgl_dd: signal is true;
+attribute ASYNC_REG of hist_status_d: signal is true;
+attribute ASYNC_REG of hist_status_dd: signal is true;
+attribute ASYNC_REG of pyr_overflow_d: signal is true;
+attribute ASYNC_REG of pyr_overflow_dd: signal is true;
+attribute ASYNC_REG of generator1BankActive_d: signal is true;
+attribute ASYNC_REG of generator2BankActive_d: signal is true;
+attribute ASYNC_REG of awg_ddr_status_d: signal is true;
+attribute ASYNC_REG of awg_ddr_status_dd: signal is true;
+attribute ASYNC_REG of pat_status_d: signal is true;
+attribute ASYNC_REG of pat_status_dd: signal is true;
+attribute ASYNC_REG of sweeping_d: signal is true;
+attribute ASYNC_REG of sweeping_dd: signal is true;
+attribute ASYNC_REG of fra_res_tgl_d: signal is true;
+attribute ASYNC_REG of fra_res_tgl_dd: signal is true;
 attribute KEEP of clearflags: signal is true;
 attribute KEEP of clearflags_d: signal is true;
 attribute ASYNC_REG of clearflags_d: signal is true;
@@ -999,10 +1624,9 @@ attribute mark_debug of dina_awg2  : signal is true;
 attribute mark_debug of addra_awg  : signal is true;
 attribute mark_debug of addra_awg2 : signal is true;
 attribute mark_debug of wea_awg    : signal is true;
-attribute mark_debug of BufferSel  : signal is true;
+attribute mark_debug of awg_up_sel : signal is true;
 attribute mark_debug of faddr_i    : signal is true;
-attribute mark_debug of accumulate_addra_awg : signal is true;
-attribute mark_debug of slrd_rdy_cnt         : signal is true;
+attribute mark_debug of awg_up_ph  : signal is true;
 attribute mark_debug of slrd_cnt   : signal is true;
 
 attribute mark_debug of dpot_spi_WiperCode   : signal is true;
@@ -1032,7 +1656,9 @@ port map (
     i_data_2_n => dataB_n,     
     o_clk => clk_adc_dclk,
     o_data_1 => dataA,
-    o_data_2 => dataB
+    o_data_2 => dataB,
+    o_eye_width => adc_eye_width,
+    o_eye_center => adc_eye_center
     );
     
 RAM_DDR3_inst: RAM_DDR3
@@ -1053,6 +1679,59 @@ port map (
        DataOutEnable => DataOutEnable,
        DataOutValid => DataOutValid,
        ReadingFrame => ReadingFrame,
+       FrameDiscard => frame_discard,
+       ViewportStart => vp_start,
+       ViewportOffset => vp_offset,
+       ViewportLength => vp_length,
+       ViewportStride => vp_stride,
+       ViewportLevel => vp_level,
+       PyramidEnable => pyr_enable,
+       PyramidOverflow => pyr_overflow,
+       SearchConfig => srch_cfg,
+       SearchWidth => srch_width,
+       SearchMask => digital_trig_mask(0),
+       SearchPatternA => digital_trig_patternA(0),
+       SearchPatternB => digital_trig_patternB(0),
+       SearchSpan => srch_span,
+       AwgRegion => awg_ddr_region,
+       AwgUpClk => ifclk,
+       AwgUpWrite => awg_up_ddr_wr,
+       AwgUpAddrWrite => awg_up_ddr_addr_wr,
+       AwgUpData => awg_up_ddr_data,
+       AwgUpAlmostFull => awg_up_ddr_afull,
+       AwgPlayEnable => awg_ddr_play AND awg_ddr_region,
+       AwgPlayLoop => awg_ddr_loop,
+       AwgPlayStart => awg_ddr_start,
+       AwgPlayLength => awg_ddr_length,
+       AwgClk => clk_gen,
+       AwgClkDivide => awg_ddr_divide,
+       AwgSample => awg_ddr_sample,
+       AwgUnderrun => awg_ddr_underrun,
+       AwgPlaying => awg_ddr_playing,
+       PatPlayEnable => pat_play AND awg_ddr_region,
+       PatPlayLoop => pat_loop,
+       PatPlayStart => pat_start,
+       PatPlayLength => pat_length,
+       PatClk => clk_adc_dclk,
+       PatStep => pat_step,
+       PatState => pat_state,
+       PatUnderrun => pat_underrun,
+       PatLoopError => pat_loop_error,
+       PatPlaying => pat_playing,
+       HistEnable => hist_enable AND awg_ddr_region,
+       HistClear => hist_clear,
+       HistStepLog2 => hist_step,
+       HistClk => clk_adc_dclk,
+       HistStart => meas_start,
+       HistStop => meas_stop,
+       HistSampleEn => meas_en,
+       HistDataA => dataAd,
+       HistDataB => dataBd,
+       HistResultTgl => hist_tgl,
+       HistFrames => hist_frames,
+       HistSkipped => hist_skipped,
+       HistClearing => hist_clearing,
+       HistSaturated => hist_saturated,
        ram_rdy => ram_rdy,
        init_calib_complete => init_calib_complete,
        device_temp => device_temp,
@@ -1082,11 +1761,14 @@ port map (
 --         doutb => doutb
 --       );	  
 
-config_RAM: SDP_RAM_64x32b
+cfg_ram_addrA <= cfg_bankA & cfg_addrA;
+cfg_ram_addrB <= cfg_bankB & cfg_addrB;
+
+config_RAM: SDP_RAM_512x32b
 	port map (
-		addr1 => cfg_addrA, -- memory location written to and memory location read out on the SPO
+		addr1 => cfg_ram_addrA, -- memory location written to and memory location read out on the SPO
 		di1 => cfg_data_in,
-		addr2 => cfg_addrB, -- memory location read out on the DPO
+		addr2 => cfg_ram_addrB, -- memory location read out on the DPO
 		clk1 => ifclk,
 		we => cfg_we,
 		clk2 => clk_adc_dclk,
@@ -1127,6 +1809,33 @@ dig_custom_signal: SDP_BRAM_custom_signal
 		addrb => addrb_dig,
 		doutb => doutb_dig);
 
+-- transition-only LA storage: new record (samples since previous record & dataD) when a masked
+-- digital line changes or when sample counter is full (idle marker, state is unchanged);
+-- while frame is not being saved, a record is made every sample (first record of frame is current state)
+la_tr_force <= '1' when GetSampleState = ADC_A or GetSampleState = ADC_F else '0';
+
+la_transition_inst: la_transition
+   port map (
+		clk => clk_adc_dclk,
+		SampleEn => sampling_CE,
+		Force => la_tr_force,
+		Mask => la_tr_mask_d,
+		DataD => dataDd,
+		Rec => la_tr_rec,
+		RecValid => la_tr_valid
+		);
+
+trig_interp_inst: trig_interp
+   port map (
+		clk => clk_adc_dclk,
+		Start => interp_start,
+		Sample0 => interp_s0,
+		Sample1 => interp_s1,
+		Level => interp_level,
+		Frac => interp_frac,
+		FracValid => interp_frac_valid
+		);
+
 lut_delay_inst: lut_delay
    port map (
 		clk => clk_adc_dclk,
@@ -1136,7 +1845,167 @@ lut_delay_inst: lut_delay
 		an_trig_d => an_trig_d,
 		tap_reg_out => lut_reg_out
 		);
+
+-- measurements of post-trigger part of each frame (published in header)
+frame_meas_inst: frame_meas
+   port map (
+		clk => clk_adc_dclk,
+		Start => meas_start,
+		Stop => meas_stop,
+		SampleEn => meas_en,
+		DataA => dataAd,
+		DataB => dataBd,
+		ResultTgl => meas_tgl,
+		TimingValid => meas_timing_ok,
+		Results => meas_results
+		);
+
+-- mask test, limits are uploaded through EP4
+mask_test_inst: mask_test
+   generic map (
+		MASK_LOG2 => 12
+		)
+   port map (
+		clk => clk_adc_dclk,
+		Enable => mask_enable,
+		Offset => mask_offset,
+		StepLog2 => mask_step,
+		Length => mask_length,
+		Start => meas_start,
+		Stop => meas_stop,
+		SampleEn => meas_en,
+		DataA => dataAd,
+		DataB => dataBd,
+		clk_wr => ifclk,
+		WrEn => wea_mask,
+		WrSel => mask_wr_sel,
+		WrAddr => addra_mask,
+		WrData => dina_mask,
+		ResultTgl => mask_tgl,
+		Fail => mask_fail,
+		ViolA => mask_viol_a,
+		ViolB => mask_viol_b,
+		FirstFail => mask_first,
+		FramesTested => mask_frames,
+		FramesFailed => mask_frames_failed
+		);
+
+-- interleaved ADC mode (both ADCs sample channel 1): gain, offset and skew correction
+ilv_on <= ilv_enable_d AND adc_interleaving_d;
+
+ilv_correct_inst: ilv_correct
+   port map (
+		clk => clk_adc_dclk,
+		DataA => signed(dataA),
+		DataB => signed(dataB),
+		OffsetA => ilv_offset_a,
+		GainA => ilv_gain_a,
+		OffsetB => ilv_offset_b,
+		GainB => ilv_gain_b,
+		Coef0 => ilv_coef0,
+		Coef1 => ilv_coef1,
+		Coef2 => ilv_coef2,
+		Coef3 => ilv_coef3,
+		OutA => ilv_dataA,
+		OutB => ilv_dataB,
+		CalStart => ilv_cal_start,
+		CalLog2 => ilv_cal_log2,
+		CalBusy => ilv_cal_busy,
+		CalDone => ilv_cal_done,
+		CalSumA => ilv_cal_sum_a,
+		CalSumB => ilv_cal_sum_b,
+		CalSumAA => ilv_cal_sum_aa,
+		CalSumBB => ilv_cal_sum_bb,
+		CalSumAB => ilv_cal_sum_ab,
+		CalSumBA => ilv_cal_sum_ba
+		);
+
+-- analog trigger edge (delay line taps are valid)
+ets_hit <= an_trig_dd AND NOT(an_trig_ddd);
+
+ets_tdc_inst: ets_tdc
+   port map (
+		clk => clk_adc_dclk,
+		TapReg => lut_reg_out,
+		Hit => ets_hit,
+		Valid => ets_tdc_valid,
+		Code => ets_tdc_code,
+		Fine => ets_tdc_fine,
+		Calibrated => ets_tdc_calibrated
+		);
 		
+-- AWG_1 custom signal is played from RAM while long waveform playback is running
+gen1CustomSample <= awg_ddr_sample when awg_ddr_playing = '1' else doutb_awg;
+-- digital pattern: RLE playback from RAM replaces custom signal BRAM
+pat_dout <= pat_state when pat_playing = '1' else doutb_dig;
+
+-- sweep/modulation engine in front of generator delta and amplitude,
+-- external modulating signal of each generator is output of the other one
+sweep_base_delta(1) <= generator1Delta;
+sweep_base_delta(2) <= generator2Delta;
+sweep_base_voltage(1) <= generator1Voltage;
+sweep_base_voltage(2) <= generator2Voltage;
+mod_sample(1) <= genSignal_2;
+mod_sample(2) <= genSignal_1;
+
+awg_sweep_gen: for i in 1 to 2 generate
+    awg_sweep_inst: awg_sweep
+    port map (
+        clk => clk_gen,
+        CfgTgl => sweep_cfg_tgl,
+        SweepMode => sweep_ctrl(i)(1 downto 0),
+        SweepRepeat => sweep_ctrl(i)(2),
+        SweepStart => sweep_start(i),
+        SweepStop => sweep_stop(i),
+        SweepStep => sweep_step(i),
+        SweepDwell => sweep_dwell(i),
+        ModMode => sweep_ctrl(i)(5 downto 4),
+        ModSource => sweep_ctrl(i)(6),
+        ModRate => mod_rate(i),
+        ModDepth => mod_depth(i)(19 downto 0),
+        ModSample => mod_sample(i),
+        BaseDelta => sweep_base_delta(i),
+        BaseVoltage => sweep_base_voltage(i),
+        Delta => sweep_delta(i),
+        Voltage => sweep_voltage(i),
+        Sweeping => sweeping(i)
+    );
+end generate;
+
+-- frequency response analyzer: new point when AWG_1 frequency is changed
+fra_delta_proc: process(clk_gen)
+begin
+    if rising_edge(clk_gen) then
+        if sweep_delta(1) /= fra_delta then
+            fra_delta <= sweep_delta(1);
+            fra_delta_tgl <= not(fra_delta_tgl);
+        end if;
+    end if;
+end process;
+
+fra_inst: fra_core
+port map (
+    clk => clk_adc_dclk,
+    Enable => fra_enable,
+    Settle => fra_settle,
+    Length => fra_length,
+    DeltaTgl => fra_delta_tgl,
+    Delta => fra_delta,
+    DataA => dataAd,
+    DataB => dataBd,
+    ResultTgl => fra_res_tgl,
+    ResultDelta => fra_res_delta,
+    ResultCount => fra_res_count,
+    ResultIA => fra_res_ia,
+    ResultQA => fra_res_qa,
+    ResultIB => fra_res_ib,
+    ResultQB => fra_res_qb,
+    Busy => fra_busy
+);
+
+-- header record of one point: delta, count, I_A, Q_A, I_B, Q_B (48 bit each, MSB first)
+fra_res_words <= fra_res_delta & fra_res_count & fra_res_ia & fra_res_qa & fra_res_ib & fra_res_qb;
+
 signal_generator_inst: awg_core
 port map (
 	    clk_in => clk_gen,
@@ -1149,20 +2018,26 @@ port map (
 	 	genSignal_1 => genSignal_1,
 	    ram_addrb_awg_1 => addrb_awg,
 	    generatorType_1 => generator1Type,
-	    generatorVoltage_1 => generator1Voltage,
+	    generatorVoltage_1 => sweep_voltage(1),
 	    generatorOffset_1 => generator1Offset,
 	    generatorDuty_1 => generator1Duty,
-	    generatorDelta_1 => generator1Delta,
- 	    generatorCustomSample_1 => doutb_awg,
+	    generatorDelta_1 => sweep_delta(1),
+ 	    generatorCustomSample_1 => gen1CustomSample,
+	    generatorBankMode_1 => generator1BankMode,
+	    generatorBank_1 => generator1Bank,
+	    generatorBankActive_1 => generator1BankActive,
 		--AWG2
 		genSignal_2 => genSignal_2,
 		ram_addrb_awg_2 => addrb_awg2,
 	    generatorType_2 => generator2Type,
-	    generatorVoltage_2 => generator2Voltage,
+	    generatorVoltage_2 => sweep_voltage(2),
 	    generatorOffset_2 => generator2Offset,
 	    generatorDuty_2 => generator2Duty,
-	    generatorDelta_2 => generator2Delta,
+	    generatorDelta_2 => sweep_delta(2),
 	    generatorCustomSample_2 => doutb_awg2,	
+	    generatorBankMode_2 => generator2BankMode,
+	    generatorBank_2 => generator2Bank,
+	    generatorBankActive_2 => generator2BankActive,
    	    --DAC programming signals
 	    dac_data_1 => dac_data_1,
 	    dac_data_2 => dac_data_2,
@@ -1187,48 +2062,52 @@ port map (
         pwm_out => an_trig_level
 		);
 		
-dpot_spi_interface: spi
-generic map (SPI_LENGTH => 16)
+dpot_spi_interface: spi_queue
+generic map (SPI_LENGTH => 16, DEPTH => 4, SETTLE_CYCLES => 0)
 port map (
 		clk => ifclk,
-        rst => '0',
         clk_divide => "11111",					    -- POT:0, POT:1 are midscale after power-up
-        spi_data =>	dpot_spi_WiperCode,
-        spi_write_trig => dpot_spi_write_trig,
 		sck_idle_value => '1',
-		spi_busy => dpot_spi_busy,
+        Wr => dpot_spi_write_trig,
+        WrData => dpot_spi_WiperCode,
+		Full => open,
+		Idle => dpot_spi_idle,
+		DoneCnt => dpot_spi_done_cnt,
         cs => dpot_cs,
         sck => dpot_sck,
         si => dpot_si
 		);
 			
-ADC_CH1_spi_interface: spi
-generic map (SPI_LENGTH => 24)
+ADC_CH1_spi_interface: spi_queue
+generic map (SPI_LENGTH => 24, DEPTH => 4, SETTLE_CYCLES => 0)
 port map (
-		clk => ifclk,			
-        rst => '0',
+		clk => ifclk,
         --clk_divide =>	"01110",
         clk_divide =>	"11101",
-        spi_data =>	adc_spi_data,
-        spi_write_trig =>	ConfigureADC,
 		sck_idle_value => '0',
-		spi_busy => adcA_spi_busy,
+        Wr => ConfigureADC,
+        WrData => adc_spi_data,
+		Full => open,
+		Idle => adc_spi_idle,
+		DoneCnt => adc_spi_done_cnt,
         cs => adc_cs_i,				
         sck => adc_sclk_i,			
         si => adc_sdin_i
 		);
 				
-VDAC_spi_interface: spi
-generic map (SPI_LENGTH => 16)
+-- DAC outputs need 16383 clk to settle after programming
+VDAC_spi_interface: spi_queue
+generic map (SPI_LENGTH => 16, DEPTH => 8, SETTLE_CYCLES => 16383)
 port map (
-		clk => ifclk,			
-        rst => '0',
+		clk => ifclk,
         --clk_divide =>	"10011",
         clk_divide =>	"11101",
-        spi_data =>	dac_cfg_reg,
-        spi_write_trig => configureVdac,
 		sck_idle_value => '1',
-		spi_busy => dac_spi_busy,
+        Wr => configureVdac,
+        WrData => dac_cfg_reg,
+		Full => dac_spi_full,
+		Idle => dac_spi_idle,
+		DoneCnt => dac_spi_done_cnt,
         cs => dac_cs_i,				
         sck => dac_sclk_i,
 		si => dac_sdin_i
@@ -1287,6 +2166,22 @@ port map(
     reset => clearflags_d
     );
 
+-- serial protocol decoders (trigger source "101": decoded content)
+proto_decoder_inst: proto_decoder
+port map (
+    clk => clk_adc_dclk,
+    dataD => dataDd,
+    Ctrl => dec_ctrl,
+    Ctrl2 => dec_ctrl2,
+    TrigPattern => dec_trig_pattern,
+    TrigMask => dec_trig_mask,
+    Trig => dec_triggered,
+    clk_rd => ifclk,
+    RdEn => dec_rden,
+    RdData => dec_rd_data,
+    RdEmpty => dec_empty
+);
+
     -- Create 200 Mhz clk_ref
 --clk_gen_pll_inst: clk_gen_pll
 --Port map ( clk_in => clk_adc_dclk,
@@ -1360,7 +2255,28 @@ ch2_k <= ch2_k_i;
 cc_ab  <= NOT(adc_interleaving_d);
 pktend <= '1';  -- TODO: use pktend for slow capture speeds
 
-DDR3DataIn <= std_logic_vector(dataAd) & std_logic_vector(dataBd) & dataDd(11 downto 0);
+DDR3DataIn <= la_tr_rec_dd when la_tr_mode_d = '1' else
+              std_logic_vector(dataAd) & std_logic_vector(dataBd) & dataDd(11 downto 0);
+-- in transition-only mode, state machine advances (and saves) only when there is a new record
+capture_CE <= la_tr_valid when la_tr_mode_d = '1' else sampling_CE;
+
+-- analog trigger arm condition (Mode: Normal OR Auto OR Single (Not Immediate) AND Source: not Digital),
+-- used to arm the trigger and to count triggers lost while trigger is not armed
+-- interleaved CH1 trigger: samples are compared in time order, each one to its predecessor
+-- (A(n) to B(n-1), then B(n) to A(n))
+ilv_trig <= ilv_on when trigger_source_d = "000" else '0';
+trig_arm_e <= '1' when ets_on_d = '0' AND trigger_source_d(2) = '0' AND trigger_mode_d /= "11" AND ilv_trig = '1'
+                   AND trig_cross(trig_signal_e, trig_signal_d, trig_level_d, trigger_slope_d) else '0';
+trig_arm_l <= '1' when ets_on_d = '0' AND trigger_source_d(2) = '0' AND trigger_mode_d /= "11"
+                   AND (  (ilv_trig = '1' AND trig_cross(trig_signal, trig_signal_e, trig_level_d, trigger_slope_d))
+                       OR (ilv_trig = '0' AND trig_cross(trig_signal, trig_signal_d, trig_level_d, trigger_slope_d)) ) else '0';
+trig_arm <= trig_arm_e OR trig_arm_l;
+
+-- armed analog trigger fires (ADC_D compares pair of the previous clk: trig_signal_e_d, then trig_signal_d)
+trig_fire_e <= '1' when ilv_trig = '1' AND trig_skip_e = '0'
+                    AND trig_fire(trig_signal_e_d, trig_level_r_dd, trig_level_f_dd, trigger_slope_d) else '0';
+trig_fire_l <= '1' when trig_skip_l = '0'
+                    AND trig_fire(trig_signal_d, trig_level_r_dd, trig_level_f_dd, trigger_slope_d) else '0';
 --DDR3DataIn <= std_logic_vector(to_unsigned(saved_sample_cnt_d,32)); --* debug!
 --DDR3DataIn <=   std_logic_vector(DataInTest (9 downto 0))
 --            & std_logic_vector(DataInTest (9 downto 0))
@@ -1387,12 +2303,17 @@ begin
 		dataDd <= dataD;
 		--dataDd <= "00" & std_logic_vector(unsigned(genSignal_1_dd));  --test (debug)!
         -- read ADC data and enable averaging
-        if mavg_enA_d = '1' then
+        -- (interleaved mode: corrected A/B sample pairs, 6 clk later than digital channels)
+        if ilv_on = '1' then
+            dataAd <= ilv_dataA;
+        elsif mavg_enA_d = '1' then
             dataAd <= signed(mavg_dataA);
         else
             dataAd <= signed(dataA);
         end if;
-        if mavg_enB_d = '1' then
+        if ilv_on = '1' then
+            dataBd <= ilv_dataB;
+        elsif mavg_enB_d = '1' then
             dataBd <= signed(mavg_dataB);
         else
             dataBd <= signed(dataB);
@@ -1415,7 +2336,7 @@ begin
 		
 		case digital_direction(1) is
 			when '0' =>
-				dataD(11 downto 6) <= (NOT(digital_OutputWordMask_d(11 downto 6)) AND doutb_dig(11 downto 6))
+				dataD(11 downto 6) <= (NOT(digital_OutputWordMask_d(11 downto 6)) AND pat_dout(11 downto 6))
 									    OR (digital_OutputWordMask_d(11 downto 6) AND digital_OutputWord_d(11 downto 6));
 			when '1' =>
 				dataD(11 downto 6) <= "ZZZZZZ";
@@ -1425,7 +2346,7 @@ begin
 		
 		case digital_direction(0) is
 			when '0' =>
-				dataD(5 downto 0) <= (NOT(digital_OutputWordMask_d(5 downto 0)) AND doutb_dig(5 downto 0))
+				dataD(5 downto 0) <= (NOT(digital_OutputWordMask_d(5 downto 0)) AND pat_dout(5 downto 0))
 									   OR (digital_OutputWordMask_d(5 downto 0) AND digital_OutputWord_d(5 downto 0));
 			when '1' =>
 				dataD(5 downto 0) <= "ZZZZZZ";
@@ -1444,6 +2365,11 @@ begin
 			digitalClkDivide_cnt <= digitalClkDivide_cnt + 1;			
 		end if;
 		if digitalClkDivide_cnt = to_unsigned(0,32) then
+            pat_step <= '1';
+        else
+            pat_step <= '0';
+        end if;
+		if digitalClkDivide_cnt = to_unsigned(0,32) then
             if ( addrb_dig = std_logic_vector(to_unsigned(AWG_MAX_SAMPLES-1,15)) ) then
                 addrb_dig <= "000000000000000";
             else
@@ -1467,13 +2393,16 @@ begin
 			AnalogTrigTresh <= std_logic_vector(signed(trig_level)+to_signed(279,10));
 		end if;			
 		
-		if cfg_addrB = std_logic_vector(to_unsigned(CONFIG_DATA_SIZE-1,6)) then
-			cfg_addrB <= std_logic_vector(to_unsigned(1,6));
+		if cfg_addrB = std_logic_vector(to_unsigned(CONFIG_DATA_SIZE-1,7)) then
+			cfg_addrB <= std_logic_vector(to_unsigned(1,7));
 		else
 			cfg_addrB <= std_logic_vector(unsigned(cfg_addrB) + 1);
 		end if;
 
 		cfg_addrB_d <= cfg_addrB;
+		-- active config bank
+		cfg_bankB_d <= cfg_bank;
+		cfg_bankB <= cfg_bankB_d;
 		--reading config data 
 		case to_integer(unsigned(cfg_addrB_d) + 1) is
 
@@ -1552,7 +2481,6 @@ begin
 		----------------
 		--genSignal_d <= signed(dac_data)-to_signed(2048,12);   --signed(dac_data_rising);
 		clearflags_d <= clearflags;
-		holdOff_d <= holdOff;
 		
 		-- detect requestFrame rising edge (new frame request)
 		-- new frame can start saving
@@ -1574,11 +2502,73 @@ begin
 	    DataWriteEn_d <= DataWriteEn;
         PreTrigWriteEn_d <= PreTrigWriteEn;
         
+        -- free running timestamp counter
+        ts_cnt_lo <= ts_cnt_lo + 1;
+        if ts_cnt_lo = X"FFFFFFFF" then
+            ts_cnt_hi <= ts_cnt_hi + 1;
+        end if;
+        -- at trigger (start of post-trigger capture) latch timestamp, count frame
+        -- and number of triggers lost since previous frame
+        GetSampleState_ts <= GetSampleState;
+        trig_info_dly <= trig_info_dly(6 downto 0) & '0';
+        if GetSampleState = ADC_E and GetSampleState_ts /= ADC_E then
+            trig_ts <= std_logic_vector(ts_cnt_hi & ts_cnt_lo);
+            frame_seq <= frame_seq + 1;
+            trig_lost <= std_logic_vector(trig_lost_cnt);
+            trig_lost_cnt <= to_unsigned(0,32);
+            -- trigger position was interpolated (analog trigger)
+            trig_frac_ok <= interp_armed;
+            trig_frac_late <= interp_late;
+            interp_armed <= '0';
+            trig_info_dly(0) <= '1';
+        elsif GetSampleState = ADC_A then
+            interp_armed <= '0';
+        end if;
+        -- frame measurements: post-trigger samples
+        meas_start <= '0';
+        meas_stop <= '0';
+        meas_en <= '0';
+        if GetSampleState = ADC_E and GetSampleState_ts /= ADC_E then
+            meas_start <= '1';
+        elsif GetSampleState = ADC_F and GetSampleState_ts = ADC_E then
+            meas_stop <= '1';
+        elsif GetSampleState = ADC_E and capture_CE = '1' then
+            meas_en <= '1';
+        end if;
+        if interp_frac_valid = '1' then
+            trig_frac <= interp_frac;
+        end if;
+        -- send trigger info when interpolation result is ready
+        if trig_info_dly(7) = '1' then
+            trig_info_tgl <= NOT(trig_info_tgl);
+        end if;
+        interp_start <= '0';
+        
+        -- decoded content trigger is a pulse, hold it for state machine (which may be clock enabled)
+        if GetSampleState /= ADC_D then
+            dec_trig_pend <= '0';
+        elsif dec_triggered = '1' then
+            dec_trig_pend <= '1';
+        end if;
+        
+        -- transition-only LA storage: align record with write enable
+        la_tr_rec_d <= la_tr_rec;
+        la_tr_rec_dd <= la_tr_rec_d;
+        
+		-- ETS: tap count and calibrated fine time of the analog trigger edge that ended the frame
+		ets_mark <= '0';
+		ets_mark_d <= ets_mark;
+		ets_mark_dd <= ets_mark_d;
+		if ets_tdc_valid = '1' AND ets_mark_dd = '1' then
+		    an_trig_delay <= ets_tdc_code;
+		    ets_fine <= ets_tdc_fine;
+		end if;
+        
 		--=======================================================--
 		--         Save ADC samples to buffer                    --
 		--=======================================================--
 	    		
-		if ( sampling_CE = '0' ) then -- clock enable for sample save state machine
+		if ( capture_CE = '0' ) then -- clock enable for sample save state machine
             
             DataWriteEn <= '0';
             PreTrigWriteEn <= '0';
@@ -1587,10 +2577,18 @@ begin
 
 			-- select signal for trigger source
 			trig_signal_d <= trig_signal; -- monitor current and next value for trigger
+			trig_signal_dd <= trig_signal_d; -- sample before crossing (trigger interpolation)
+			trig_signal_e_d <= trig_signal_e;
 			
 			-- Channel 0
 			if ( trigger_source_d = "000" ) then					
-				trig_signal <= dataAd;		-- if rising
+				if ilv_on = '1' then
+				    -- interleaved: A/B sample pair (A sample is earlier)
+				    trig_signal_e <= dataAd;
+				    trig_signal <= dataBd;
+				else
+				    trig_signal <= dataAd;		-- if rising
+				end if;
 			-- Channel 1
 			elsif ( trigger_source_d = "001" ) then
 				trig_signal <= dataBd;
@@ -1601,6 +2599,13 @@ begin
 				trig_signal <= genSignal_2_dd;
 			end if;
 			
+			-- count analog trigger events while trigger is not armed (frame is being sent, holdoff, pre-trigger)
+			if trig_arm = '1' AND ( GetSampleState = ADC_A OR GetSampleState = ADC_B OR GetSampleState = ADC_F ) then
+			    if trig_lost_cnt /= X"FFFFFFFF" then
+			        trig_lost_cnt <= trig_lost_cnt + 1;
+			    end if;
+			end if;
+			
 			case GetSampleState(2 downto 0) is
 		
 			    when ADC_A =>		-- "IDLE STATE"
@@ -1664,8 +2669,11 @@ begin
 				digital_OutputWordMask_d <= digital_OutputWordMask;
 				digital_direction_d <= digital_Direction;				
 				ets_on_d <= ets_on;
+				la_tr_mode_d <= la_tr_mode;
+				la_tr_mask_d <= la_tr_mask;
 				mavg_enA_d <= mavg_enA;
 				mavg_enB_d <= mavg_enB;
+				holdOff_d <= holdOff;
 				
 				saved_sample_cnt <= 0;
 				saved_sample_cnt_d <= 0;
@@ -1684,6 +2692,7 @@ begin
 					framesize_d <= framesize;     -- save current frame size
 					pre_trigger_d <= pre_trigger; -- size of pre-trigger
 					adc_interleaving_d <= adc_interleaving;
+					ilv_enable_d <= ilv_enable;
 					GetSampleState <= ADC_B;   -- goto "PRE-TRIGGER"				
 					
 				else
@@ -1754,93 +2763,19 @@ begin
 				elsif ets_on_d = '1' AND an_trig_ddd = '0' AND an_trig_dd = '1' then
 					lut_reg_out_tmp1 <= lut_reg_out(31 downto 16);					
 					lut_reg_out_tmp0 <= lut_reg_out(15 downto 0);
-					case lut_reg_out(31 downto 0) is
-                        when "01111111111111111111111111111111" =>
-                            an_trig_delay <= std_logic_vector(to_unsigned(31,6));
-                        when "00111111111111111111111111111111" =>
-                            an_trig_delay <= std_logic_vector(to_unsigned(30,6));
-                        when "00011111111111111111111111111111" =>
-                            an_trig_delay <= std_logic_vector(to_unsigned(29,6));
-                        when "00001111111111111111111111111111" =>
-                            an_trig_delay <= std_logic_vector(to_unsigned(28,6));
-                        when "00000111111111111111111111111111" =>
-                            an_trig_delay <= std_logic_vector(to_unsigned(27,6));
-                        when "00000011111111111111111111111111" =>
-                            an_trig_delay <= std_logic_vector(to_unsigned(26,6));
-                        when "00000001111111111111111111111111" =>
-                            an_trig_delay <= std_logic_vector(to_unsigned(25,6));
-                        when "00000000111111111111111111111111" =>
-                            an_trig_delay <= std_logic_vector(to_unsigned(24,6));
-                        when "00000000011111111111111111111111" =>
-                            an_trig_delay <= std_logic_vector(to_unsigned(23,6));
-                        when "00000000001111111111111111111111" =>
-                            an_trig_delay <= std_logic_vector(to_unsigned(22,6));
-                        when "00000000000111111111111111111111" =>
-                            an_trig_delay <= std_logic_vector(to_unsigned(21,6));
-                        when "00000000000011111111111111111111" =>
-                            an_trig_delay <= std_logic_vector(to_unsigned(20,6));
-                        when "00000000000001111111111111111111" =>
-                            an_trig_delay <= std_logic_vector(to_unsigned(19,6));
-                        when "00000000000000111111111111111111" =>
-                            an_trig_delay <= std_logic_vector(to_unsigned(18,6));
-                        when "00000000000000011111111111111111" =>
-                            an_trig_delay <= std_logic_vector(to_unsigned(17,6));
-                        when "00000000000000001111111111111111" =>
-                            an_trig_delay <= std_logic_vector(to_unsigned(16,6));
-                        when "00000000000000000111111111111111" =>
-                            an_trig_delay <= std_logic_vector(to_unsigned(15,6));
-                        when "00000000000000000011111111111111" =>
-                            an_trig_delay <= std_logic_vector(to_unsigned(14,6));
-                        when "00000000000000000001111111111111" =>
-                            an_trig_delay <= std_logic_vector(to_unsigned(13,6));
-                        when "00000000000000000000111111111111" =>
-                            an_trig_delay <= std_logic_vector(to_unsigned(12,6));
-                        when "00000000000000000000011111111111" =>
-                            an_trig_delay <= std_logic_vector(to_unsigned(11,6));
-                        when "00000000000000000000001111111111" =>
-                            an_trig_delay <= std_logic_vector(to_unsigned(10,6));
-                        when "00000000000000000000000111111111" =>
-                            an_trig_delay <= std_logic_vector(to_unsigned(9,6));
-                        when "00000000000000000000000011111111" =>
-                            an_trig_delay <= std_logic_vector(to_unsigned(8,6));
-                        when "00000000000000000000000001111111" =>
-                            an_trig_delay <= std_logic_vector(to_unsigned(7,6));
-                        when "00000000000000000000000000111111" =>
-                            an_trig_delay <= std_logic_vector(to_unsigned(6,6));
-                        when "00000000000000000000000000011111" =>
-                            an_trig_delay <= std_logic_vector(to_unsigned(5,6));
-                        when "00000000000000000000000000001111" =>
-                            an_trig_delay <= std_logic_vector(to_unsigned(4,6));
-                        when "00000000000000000000000000000111" =>
-                            an_trig_delay <= std_logic_vector(to_unsigned(3,6));
-                        when "00000000000000000000000000000011" =>
-                            an_trig_delay <= std_logic_vector(to_unsigned(2,6));
-                        when "00000000000000000000000000000001" =>
-                            an_trig_delay <= std_logic_vector(to_unsigned(1,6));
-                        when "00000000000000000000000000000000" =>
-                            an_trig_delay <= std_logic_vector(to_unsigned(0,6));
-                        when others => Null;
-					end case;
+					-- fine time of this edge is taken from TDC (3 clk later)
+					ets_mark <= '1';
 					triggered_led <= '1'; -- signal IS TRIGGERED indicator
 					GetSampleState <= ADC_E;
 						
 				-- Mode: Normal OR Auto OR Single (Not Immediate) AND Source: not Digital
-				-- Slope "rising" 
-				elsif ets_on_d = '0' AND trigger_source_d /= "100" AND trigger_mode_d /= "11"
-                    AND (trigger_slope_d = "00" AND trig_signal < trig_level_d AND trig_signal_d >= trig_level_d) then
-                        triggered_led <= '0'; -- signal IS NOT TRIGGERED indicator
-                        GetSampleState <= ADC_D;
-				-- Slope "falling" 
-                elsif ets_on_d = '0' AND trigger_source_d /= "100" AND trigger_mode_d /= "11"
-					AND (trigger_slope_d = "01" AND trig_signal >= trig_level_d AND trig_signal_d < trig_level_d) then
-                        triggered_led <= '0'; -- signal IS NOT TRIGGERED indicator
-                        GetSampleState <= ADC_D;
-				-- Slope "both"	   
-                elsif ets_on_d = '0' AND trigger_source_d /= "100" AND trigger_mode_d /= "11"
-					AND (trigger_slope_d = "10" AND ((trig_signal <  trig_level_d AND trig_signal_d >= trig_level_d)
-					                            OR   (trig_signal >= trig_level_d AND trig_signal_d < trig_level_d ))) then
+				-- Slope "rising", "falling" or "both" (see trig_arm)
+				elsif trig_arm = '1' then
                         triggered_led <= '0'; -- signal IS NOT TRIGGERED indicator
                         GetSampleState <= ADC_D;
+                        -- interleaved: samples up to the arming one must not fire the trigger
+                        trig_skip_e <= ilv_trig;
+                        trig_skip_l <= ilv_trig AND NOT(trig_arm_e);
 				
 				-- IF AUTO:
 				elsif	ets_on_d = '0' AND ( trigger_mode_d = "00" AND (auto_trigger = '1') ) then
@@ -1853,6 +2788,10 @@ begin
                     GetSampleState <= ADC_D;
                     dt_enable <= '1';
                     
+			   -- Protocol decoder trigger
+				elsif (ets_on_d = '0' AND trigger_source_d = "101") then
+                    GetSampleState <= ADC_D;
+                    
 				else
 				
 					GetSampleState <= ADC_C;
@@ -1866,6 +2805,8 @@ begin
 				PreTrigSaving <= '1';
 				PreTrigWriteEn <= '1';
 				triggered <= '0';
+				trig_skip_e <= '0';
+				trig_skip_l <= '0';
 				
 				if auto_trigger_cnt = auto_trigger_maxcnt then
                     auto_trigger_d <= '1';
@@ -1888,23 +2829,41 @@ begin
 					GetSampleState <= ADC_E;
 
 				-- Mode: Normal OR Auto OR Single (Not Immediate) AND Source: not Digital
-				-- Slope "rising"  
-				elsif  trigger_source_d /= "100" AND trigger_mode_d /= "11" AND trigger_slope_d = "00"
-					AND trig_signal_d >= trig_level_r_dd then
-                        triggered_led <= '1';
-                        GetSampleState <= ADC_E;
-                --Slope "falling"
-				elsif  trigger_source_d /= "100" AND trigger_mode_d /= "11" AND trigger_slope_d = "01"
-					AND trig_signal_d < trig_level_f_dd then
-                        triggered_led <= '1';
-                        GetSampleState <= ADC_E;
-                --Slope "both"
-				elsif  trigger_source_d /= "100" AND trigger_mode_d /= "11" AND trigger_slope_d = "10"
---                    AND ( trig_signal_d >= (trig_level_d + trig_hysteresis_d)
---                      OR  trig_signal_d <  (trig_level_d - trig_hysteresis_d) ) then
-					AND ( abs(trig_signal_d) >= trig_level_r_dd ) then
+				-- Slope "rising", "falling" or "both": interpolate crossing between fired sample and its predecessor
+				elsif  trigger_source_d(2) = '0' AND trigger_mode_d /= "11" AND ( trig_fire_e = '1' OR trig_fire_l = '1' ) then
                         triggered_led <= '1';
                         GetSampleState <= ADC_E;
+                        interp_start <= '1';
+                        interp_armed <= '1';
+                        if trig_fire_e = '1' then
+                            -- interleaved: A sample, predecessor is B sample of previous pair
+                            interp_late <= '0';
+                            interp_s0 <= std_logic_vector(trig_signal_dd);
+                            interp_s1 <= std_logic_vector(trig_signal_e_d);
+                            if trigger_slope_d = "01" then
+                                interp_level <= std_logic_vector(resize(trig_level_f_dd,11));
+                            elsif trigger_slope_d = "10" AND trig_signal_e_d < 0 then
+                                interp_level <= std_logic_vector(-resize(trig_level_r_dd,11));
+                            else
+                                interp_level <= std_logic_vector(resize(trig_level_r_dd,11));
+                            end if;
+                        else
+                            -- interleaved: B sample, predecessor is A sample of the same pair
+                            interp_late <= ilv_trig;
+                            if ilv_trig = '1' then
+                                interp_s0 <= std_logic_vector(trig_signal_e_d);
+                            else
+                                interp_s0 <= std_logic_vector(trig_signal_dd);
+                            end if;
+                            interp_s1 <= std_logic_vector(trig_signal_d);
+                            if trigger_slope_d = "01" then
+                                interp_level <= std_logic_vector(resize(trig_level_f_dd,11));
+                            elsif trigger_slope_d = "10" AND trig_signal_d < 0 then
+                                interp_level <= std_logic_vector(-resize(trig_level_r_dd,11));
+                            else
+                                interp_level <= std_logic_vector(resize(trig_level_r_dd,11));
+                            end if;
+                        end if;
 
 			   -- External Digital Inputs trigger
 				elsif (ets_on_d = '0' AND trigger_source_d = "100") then
@@ -1913,6 +2872,15 @@ begin
                     else
                         GetSampleState <= ADC_D;
                     end if;
+
+			   -- Protocol decoder trigger
+				elsif (ets_on_d = '0' AND trigger_source_d = "101") then
+                    if dec_triggered = '1' or dec_trig_pend = '1' then
+                        triggered_led <= '1';
+                        GetSampleState <= ADC_E;
+                    else
+                        GetSampleState <= ADC_D;
+                    end if;
                     
     			else
 
@@ -2009,6 +2977,84 @@ begin
         device_temp_d <= device_temp;
         device_temp_dd <= device_temp_d;
         
+        -- trigger timestamp, frame sequence number and lost triggers of the last saved frame
+        -- (values are stable when toggle is received, next trigger is only possible after frame is sent)
+        trig_info_tgl_d <= trig_info_tgl;
+        trig_info_tgl_dd <= trig_info_tgl_d;
+        trig_info_tgl_ddd <= trig_info_tgl_dd;
+        -- frame measurements
+        meas_tgl_d <= meas_tgl;
+        meas_tgl_dd <= meas_tgl_d;
+        meas_tgl_ddd <= meas_tgl_dd;
+        if meas_tgl_ddd /= meas_tgl_dd then
+            hdr_meas <= meas_results;
+            hdr_meas_ok <= meas_timing_ok;
+        end if;
+        -- mask test
+        mask_tgl_d <= mask_tgl;
+        mask_tgl_dd <= mask_tgl_d;
+        mask_tgl_ddd <= mask_tgl_dd;
+        if mask_tgl_ddd /= mask_tgl_dd then
+            hdr_mask_fail <= mask_fail;
+            hdr_mask <= mask_frames & mask_frames_failed & mask_viol_a & mask_viol_b & mask_first;
+            mask_done <= '1';
+        end if;
+        -- persistence histogram (DDR3 ui clock): counters are copied when frame was binned and after clear
+        hist_tgl_d <= hist_tgl;
+        hist_tgl_dd <= hist_tgl_d;
+        hist_tgl_ddd <= hist_tgl_dd;
+        hist_status_d <= hist_clearing & hist_saturated;
+        hist_status_dd <= hist_status_d;
+        hist_clearing_ddd <= hist_status_dd(1);
+        if hist_tgl_ddd /= hist_tgl_dd or ( hist_clearing_ddd = '1' AND hist_status_dd(1) = '0' ) then
+            hdr_hist <= hist_frames & hist_skipped;
+        end if;
+        if trig_info_tgl_ddd /= trig_info_tgl_dd then
+            hdr_trig_ts <= trig_ts;
+            hdr_frame_seq <= std_logic_vector(frame_seq);
+            hdr_trig_lost <= trig_lost;
+            hdr_trig_frac <= trig_frac_ok & trig_frac_late & "00" & X"000" & trig_frac;
+        end if;
+        
+        -- min/max pyramid overflow (DDR3 ui clock)
+        pyr_overflow_d <= pyr_overflow;
+        pyr_overflow_dd <= pyr_overflow_d;
+        
+        -- active AWG custom signal banks (clk_gen)
+        generator1BankActive_d <= generator1BankActive_d(0) & generator1BankActive;
+        generator2BankActive_d <= generator2BankActive_d(0) & generator2BankActive;
+        -- AWG playback from RAM (clk_gen)
+        awg_ddr_status_d <= awg_ddr_underrun & awg_ddr_playing;
+        awg_ddr_status_dd <= awg_ddr_status_d;
+        -- interleaved ADC calibration (clk_adc_dclk)
+        ilv_cal_status_d <= ilv_cal_busy & ilv_cal_done;
+        ilv_cal_status_dd <= ilv_cal_status_d;
+        -- digital pattern playback from RAM (clk_adc_dclk)
+        pat_status_d <= pat_loop_error & pat_underrun & pat_playing;
+        pat_status_dd <= pat_status_d;
+        sweeping_d <= sweeping;
+        sweeping_dd <= sweeping_d;
+        
+        -- frequency response analyzer: copy results of finished point to header ring
+        -- (results are held until next point is finished)
+        fra_res_tgl_d <= fra_res_tgl;
+        fra_res_tgl_dd <= fra_res_tgl_d;
+        fra_res_tgl_ddd <= fra_res_tgl_dd;
+        if fra_enable = '0' then
+            fra_lost <= '0';
+        end if;
+        
+        dec_rden <= '0';
+        if fra_res_tgl_ddd /= fra_res_tgl_dd then
+            fra_ring_wr_cnt <= 0;
+        elsif fra_ring_wr_cnt /= 8 then
+            fra_ring(to_integer(fra_wr_pt(4 downto 0)) * 8 + fra_ring_wr_cnt) <= fra_res_words(255-32*fra_ring_wr_cnt downto 224-32*fra_ring_wr_cnt);
+            if fra_ring_wr_cnt = 7 then
+                fra_wr_pt <= fra_wr_pt + 1;
+            end if;
+            fra_ring_wr_cnt <= fra_ring_wr_cnt + 1;
+        end if;
+        
         getnewframe_d <= getnewframe;
         getnewframe_dd <= getnewframe_d;
         if getnewframe_dd = '0' and getnewframe_d = '1' then
@@ -2077,6 +3123,10 @@ begin
 		
 		an_trig_delay_d <= an_trig_delay;
 		an_trig_delay_dd <= unsigned(an_trig_delay_d);
+		ets_fine_d <= ets_fine;
+		ets_fine_dd <= ets_fine_d;
+		ets_calibrated_d <= ets_tdc_calibrated;
+		ets_calibrated_dd <= ets_calibrated_d;
 		
 		if an_trig_delay_dd >= an_trig_delay_max then
             an_trig_delay_max <= an_trig_delay_dd;
@@ -2117,6 +3167,38 @@ begin
 		triggered_led_d <= triggered_led; -- indicator that signal is triggered
 		roll_d <= roll;
 		
+		--===========================================================
+		-- Update DAC outputs (analog channel Offset/Gain control)
+		--===========================================================
+		-- DAC registers are written to SPI queue (one each clk), MasterState does not wait for SPI
+		ConfigureVdac <= '0';
+		if DAC_enqueue = '1' then
+			if dac_spi_full = '0' then
+				dac_cfg_reg <= dac_cfg_array(dac_array_count);
+				ConfigureVdac <= '1';
+				if dac_array_count = 4 then
+					dac_array_count <= 1;
+					DAC_enqueue <= '0';
+				else
+					dac_array_count <= dac_array_count + 1;
+				end if;
+			end if;
+		-- scope settings have changed (wait until new config is decoded)
+		elsif DAC_pogramming_start = '1' and MasterState /= C then
+			DAC_pogramming_start <= '0';
+			-- update DAC config registers
+			dac_cfg_array(1) <= "1111" & VgainB;
+			dac_cfg_array(2) <= "1011" & VgainA;
+			-- Convert from Two's Complement to Offset Binary
+			dac_cfg_array(3) <= "0011" & std_logic_vector(NOT(OffsetA(11))& OffsetA(10 downto 0));
+			dac_cfg_array3_d <= "0011" & std_logic_vector(NOT(OffsetA(11))& OffsetA(10 downto 0));
+			dac_cfg_array3_2d <= dac_cfg_array3_d;
+			dac_cfg_array3_3d <= dac_cfg_array3_2d;
+			dac_cfg_array3_4d <= dac_cfg_array3_3d;
+			dac_cfg_array(4) <= "0111" & std_logic_vector(NOT(OffsetB(11))& OffsetB(10 downto 0));
+			DAC_enqueue <= '1';
+		end if;
+		
 		--===========================================================
 		-- Transfer samples from buffer to FX3
 		--===========================================================
@@ -2203,7 +3285,7 @@ begin
 				if flaga_d = '1' then -- if new scope config is waiting
 					faddr_i <= "11"; -- select EP2 fifo buffer
 					-- initialize Config RAM address pointer
-					cfg_addrA <= std_logic_vector(to_unsigned(0,6));
+					cfg_addrA <= std_logic_vector(to_unsigned(0,7));
 					MasterState <= C;  -- goto "GET SCOPE CONFIG"
 				else -- else: awg custom wave data is sent from host	
 					faddr_i <= "10";	-- select EP4
@@ -2217,26 +3299,13 @@ begin
             elsif ReturnToFrameRequest = '1' then
                 ReturnToFrameRequest <= '0'; -- re-set return state flag
                 Masterstate <= F; -- return to frame streaming
-			--if scope settings have changed
-			elsif DAC_pogramming_start = '1' then
-				-- update DAC config registers
-				dac_cfg_array(1) <= "1111" & VgainB;
-				dac_cfg_array(2) <= "1011" & VgainA;
-				-- Convert from Two's Complement to Offset Binary
-				dac_cfg_array(3) <= "0011" & std_logic_vector(NOT(OffsetA(11))& OffsetA(10 downto 0));
-				dac_cfg_array3_d <= "0011" & std_logic_vector(NOT(OffsetA(11))& OffsetA(10 downto 0));
-				dac_cfg_array3_2d <= dac_cfg_array3_d;
-				dac_cfg_array3_3d <= dac_cfg_array3_2d;
-				dac_cfg_array3_4d <= dac_cfg_array3_3d;
-				dac_cfg_array(4) <= "0111" & std_logic_vector(NOT(OffsetB(11))& OffsetB(10 downto 0));
-				Masterstate <= E;
-			--if ADC config has changed
+			--if ADC config has changed (write is queued, SPI runs in background)
 			elsif (adc_cfg_data_d /= adc_cfg_data) then
 				adc_spi_data <= adc_cfg_reg & adc_cfg_data;
 				adc_cfg_reg_d <= adc_cfg_reg;
 				adc_cfg_data_d <= adc_cfg_data;
 --				ConfigureADC <= '1';     debug!
-				Masterstate <= D;
+				Masterstate <= B;
 			else
 				-- if scope config has changed OR single trigger was re-armed
 				if scopeConfigChanged = '1' then
@@ -2251,6 +3320,14 @@ begin
 			end if;
 			DebugMState <= 1;
 		  
+		-- EP2 transfer is either full config block (CONFIG_DATA_SIZE words written to registers 0 to CONFIG_DATA_SIZE-1
+		-- of active bank) or register write command:
+		--   header:  CFG_CMD_MAGIC & X"00" & N (number of command words that follow)
+		--   write:   address word (bit 31 = '0', bits 15..0 register address), value word
+		--   masked:  address word (bit 31 = '1'), mask word, value word (only bits set in mask are written)
+		-- register address is bank*CONFIG_REG_SIZE + word index in config block (decoded below as index+1),
+		-- value written to CFG_BANK_SEL_ADDR selects active bank (switched at next frame boundary in state F),
+		-- other addresses >= CONFIG_BANKS*CONFIG_REG_SIZE are ignored (use as padding, transfer must be at least 4 words)
 		when C =>						-- "GET SCOPE CONFIG"
 			faddr_i <= "11"; -- selected FIFO endpoint is EP2 (config)
 			slwr_i  <= '1';
@@ -2258,16 +3335,22 @@ begin
             -- when writing to RAM, compare new and old config word
             cfg_data_in_d <= cfg_data_in;
             cfg_we_d <= cfg_we;
-			case to_integer(unsigned(cfg_addrA_d)+1) is
-				-- don't look for changes in generator config (word 10 to 15)
-				when 1 to 9 | 16 to 20 =>
-					if cfg_we_d = '1' AND cfg_data_in_d /= cfg_do_A then
-						ScopeConfigChanged <= '1';
+            cfg_bankA_d <= cfg_bankA;
+			if cfg_we_d = '1' AND cfg_data_in_d /= cfg_do_A AND cfg_bankA_d = cfg_bank then
+				-- only capture affecting registers restart the capture
+				-- (next frame registers are latched at frame start, live registers apply immediately)
+				if CFG_CLASS(to_integer(unsigned(cfg_addrA_d)+1)) = CFG_CAPTURE
+				   AND NOT(to_integer(unsigned(cfg_addrA_d)+1) = 24 AND cfg_data_in_d(31 downto 8) = cfg_do_A(31 downto 8)) then
+					ScopeConfigChanged <= '1';
+--					LED_i(1) <= '1';
+				end if;
+				-- reprogram V-DAC only if gain or offset has changed
+				case to_integer(unsigned(cfg_addrA_d)+1) is
+					when 2 | 3 =>
 						DAC_pogramming_start <= '1';
---						LED_i(1) <= '1';
-					end if;
-				when others => null;
-			end case;
+					when others => null;
+				end case;
+			end if;
 
 			if faddr_rdy = '0' then
 			    slrd_i <= '0';
@@ -2278,7 +3361,18 @@ begin
                 if faddr_rdy_cnt_i = 3 then
                     faddr_rdy <= '1';
                     faddr_rdy_cnt_i <= 0;
-                    cfg_we <= '1';
+                    if fdata(31 downto 16) = CFG_CMD_MAGIC then
+                        -- register write command: header is not written to RAM,
+                        -- bits 7..0 hold number of command words that follow
+                        cfg_cmd <= '1';
+                        cfg_cmd_ph <= 0;
+                        cfg_data_len <= to_integer(unsigned(fdata(7 downto 0))) + 1;
+                        cfg_vp_wr <= '0';
+                        cfg_we <= '0';
+                    else
+                        cfg_vp_wr <= '1';
+                        cfg_we <= '1';
+                    end if;
                 else
                     cfg_we <= '0';
                     faddr_rdy <= '0';
@@ -2286,21 +3380,74 @@ begin
                 end if;
                 Masterstate <= C;
 			-- if FX3 is ready for reading and EP2 is not empty 
-			elsif ( flaga_d = '1' and cfg_we = '1') then
+			elsif ( flaga_d = '1' and (cfg_we = '1' or cfg_cmd = '1') ) then
 			    -- slrd has 2 cycle latency
-		        if cfg_data_cnt < CONFIG_DATA_SIZE - 4 then
+		        if cfg_data_cnt < cfg_data_len - 4 then
                     slrd_i  <= '0';
                 else
                     slrd_i  <= '1';
                 end if;
-			    -- read oscilloscope configuration and save to RAM
-                cfg_data_in <= fdata;
-                -- increment RAM address pointer
-				if cfg_data_cnt = CONFIG_DATA_SIZE - 1 then
+				if cfg_data_cnt = cfg_data_len - 1 then
+				    -- last word (or last register write) is written to RAM
 				    cfg_we <= '0';
 				    cfg_data_cnt <= 0;
-				    cfg_addrA <= std_logic_vector(to_unsigned(0,6));
+				    cfg_data_len <= CONFIG_DATA_SIZE;
+				    cfg_cmd <= '0';
+				    cfg_bankA <= cfg_bank;
+				    cfg_addrA <= std_logic_vector(to_unsigned(0,7));
+				elsif cfg_cmd = '1' then
+				    -- register write command: apply writes directly to RAM
+				    cfg_data_cnt <= cfg_data_cnt + 1;
+				    case cfg_cmd_ph is
+				        when 0 =>
+				            -- address word: bit 31 selects masked write, bits 15..0 register address
+				            -- (bits 8..7 select bank, bank select command is written to CFG_BANK_SEL_ADDR)
+				            cfg_we <= '0';
+				            cfg_bankA <= fdata(8 downto 7);
+				            cfg_addrA <= fdata(6 downto 0);
+				            if unsigned(fdata(15 downto 0)) < CONFIG_BANKS*CONFIG_REG_SIZE then
+				                cfg_cmd_skip <= '0';
+				            else
+				                cfg_cmd_skip <= '1';
+				            end if;
+				            if to_integer(unsigned(fdata(15 downto 0))) = CFG_BANK_SEL_ADDR then
+				                cfg_cmd_bank <= '1';
+				            else
+				                cfg_cmd_bank <= '0';
+				            end if;
+				            cfg_cmd_masked <= fdata(31);
+				            if fdata(31) = '1' then
+				                cfg_cmd_ph <= 1;
+				            else
+				                cfg_cmd_ph <= 2;
+				            end if;
+				        when 1 =>
+				            -- mask word (old register value is read out meanwhile)
+				            cfg_we <= '0';
+				            cfg_cmd_mask <= fdata;
+				            cfg_cmd_ph <= 2;
+				        when others =>
+				            -- value word: masked write keeps old value of bits not set in mask
+				            if cfg_cmd_masked = '1' then
+				                cfg_data_in <= (cfg_do_A AND NOT(cfg_cmd_mask)) OR (fdata AND cfg_cmd_mask);
+				            else
+				                cfg_data_in <= fdata;
+				            end if;
+				            cfg_we <= NOT(cfg_cmd_skip);
+				            if cfg_cmd_skip = '0' and cfg_bankA = cfg_bank and unsigned(cfg_addrA) >= 31 and unsigned(cfg_addrA) <= 33 then
+				                cfg_vp_wr <= '1';
+				            end if;
+				            -- bank switch is done at next frame boundary
+				            if cfg_cmd_bank = '1' then
+				                cfg_bank_req <= fdata(1 downto 0);
+				                cfg_bank_pend <= '1';
+				            end if;
+				            cfg_cmd_ph <= 0;
+				    end case;
 				else
+				    -- read oscilloscope configuration and save to RAM
+				    cfg_data_in <= fdata;
+				    -- increment RAM address pointer
 				    cfg_we <= '1';
 				    cfg_data_cnt <= cfg_data_cnt + 1;
 				    cfg_addrA <= std_logic_vector(unsigned(cfg_addrA) + 1);
@@ -2312,14 +3459,17 @@ begin
 			    fdata <= "ZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZ"; -- place data bus in HI-Z state       
 				slrd_i  <= '1';
 				cfg_we <= '0';
-				if to_integer(unsigned(cfg_addrA)) = CONFIG_DATA_SIZE - 1 then
+				if to_integer(unsigned(cfg_addrA)) = CONFIG_REG_SIZE - 1 then
 					-- return to dispatcher state if memory read is finished
-					cfg_addrA_d <= "000000";
-					cfg_addrA <= "000000";
+					cfg_addrA_d <= "0000000";
+					cfg_addrA <= "0000000";
+					cfg_bank_sw <= '0';
 					cfg_data_cnt <= 0;
 					faddr_rdy_cnt_i <= 0;
 					faddr_rdy <= '0';
                     dpot_spi_write_trig <= '1';
+                    -- config is copied: sweep/modulation engines take it
+                    sweep_cfg_tgl <= NOT(sweep_cfg_tgl);
 					Masterstate <= B;
 				else
 				    cfg_addrA_d <= cfg_addrA;
@@ -2337,11 +3487,18 @@ begin
 						adc_cfg_data <= cfg_do_A(7 downto 0);
 						adc_cfg_data_d <= adc_cfg_data;
 					when 2 =>
+						-- after bank switch, reprogram V-DAC only if gain of new bank is different
+						if cfg_bank_sw = '1' and cfg_do_A(27 downto 16) & cfg_do_A(11 downto 0) /= VgainA & VgainB then
+						    DAC_pogramming_start <= '1';
+						end if;
 						VgainA <= cfg_do_A(27 downto 16);
 						--VgainA_d <= VgainA; 
 						VgainB <= cfg_do_A(11 downto 0);
                         --VgainB_d <= VgainB;
 					when 3 =>
+						if cfg_bank_sw = '1' and cfg_do_A(27 downto 16) & cfg_do_A(11 downto 0) /= OffsetA & OffsetB then
+						    DAC_pogramming_start <= '1';
+						end if;
 						OffsetA <= cfg_do_A(27 downto 16);
                         OffsetA_d <= OffsetA;
                         OffsetA_2d <= OffsetA_d;
@@ -2384,106 +3541,205 @@ begin
 					    generator2Delta <= generator2Delta_H & generator2Delta_L;
 					when 24 =>
 					   dpot_spi_WiperCode <= "00000000" & cfg_do_A (7 downto 0); -- write data to POT:0
+					when 32 =>
+					    vp_mode <= cfg_do_A(31);
+					    vp_offset <= cfg_do_A(26 downto 0);
+					when 33 =>
+					    vp_length <= cfg_do_A(26 downto 0);
+					when 34 =>
+					    vp_level <= cfg_do_A(31 downto 28);
+					    vp_stride <= cfg_do_A(26 downto 0);
+					    -- every config write to viewport registers requests a new window
+					    vp_request <= vp_mode AND cfg_vp_wr;
+					when 35 =>
+					    pyr_enable <= cfg_do_A(0);
+					when 36 =>
+					    srch_cfg <= cfg_do_A;
+					when 37 =>
+					    srch_width <= cfg_do_A(26 downto 0);
+					when 38 =>
+					    generator2BankMode <= cfg_do_A(17);
+					    generator1BankMode <= cfg_do_A(16);
+					    generator2Bank <= cfg_do_A(1);
+					    generator1Bank <= cfg_do_A(0);
+					when 39 =>
+					    awg_ddr_region <= cfg_do_A(0);
+					when 40 =>
+					    awg_ddr_play <= cfg_do_A(31);
+					    awg_ddr_loop <= cfg_do_A(30);
+					    awg_ddr_start <= cfg_do_A(22 downto 0);
+					when 41 =>
+					    awg_ddr_length <= cfg_do_A(22 downto 0);
+					when 42 =>
+					    awg_ddr_divide <= cfg_do_A(15 downto 0);
+					when 43 =>
+					    sweep_ctrl(1) <= cfg_do_A;
+					when 44 =>
+					    sweep_start(1) <= cfg_do_A;
+					when 45 =>
+					    sweep_stop(1) <= cfg_do_A;
+					when 46 =>
+					    sweep_step(1) <= cfg_do_A;
+					when 47 =>
+					    sweep_dwell(1) <= cfg_do_A;
+					when 48 =>
+					    mod_rate(1) <= cfg_do_A;
+					when 49 =>
+					    mod_depth(1) <= cfg_do_A;
+					when 50 =>
+					    sweep_ctrl(2) <= cfg_do_A;
+					when 51 =>
+					    sweep_start(2) <= cfg_do_A;
+					when 52 =>
+					    sweep_stop(2) <= cfg_do_A;
+					when 53 =>
+					    sweep_step(2) <= cfg_do_A;
+					when 54 =>
+					    sweep_dwell(2) <= cfg_do_A;
+					when 55 =>
+					    mod_rate(2) <= cfg_do_A;
+					when 56 =>
+					    mod_depth(2) <= cfg_do_A;
+					when 57 =>
+					    fra_enable <= cfg_do_A(0);
+					when 58 =>
+					    fra_settle <= cfg_do_A(23 downto 0);
+					when 59 =>
+					    fra_length <= cfg_do_A(22 downto 0);
+					when 60 =>
+					    dec_ctrl <= cfg_do_A;
+					when 61 =>
+					    dec_ctrl2 <= cfg_do_A;
+					when 62 =>
+					    dec_trig_pattern <= cfg_do_A;
+					when 63 =>
+					    dec_trig_mask <= cfg_do_A;
+					when 64 =>
+					    la_tr_mode <= cfg_do_A(31);
+					    la_tr_mask <= cfg_do_A(11 downto 0);
+					when 65 =>
+					    pat_play <= cfg_do_A(31);
+					    pat_loop <= cfg_do_A(30);
+					    pat_start <= cfg_do_A(22 downto 0);
+					when 66 =>
+					    pat_length <= cfg_do_A(22 downto 0);
+					when 67 =>
+					    ilv_enable <= cfg_do_A(31);
+					    ilv_cal_start <= cfg_do_A(30);
+					    ilv_cal_log2 <= cfg_do_A(4 downto 0);
+					when 68 =>
+					    ilv_gain_a <= cfg_do_A(31 downto 16);
+					    ilv_offset_a <= cfg_do_A(15 downto 0);
+					when 69 =>
+					    ilv_gain_b <= cfg_do_A(31 downto 16);
+					    ilv_offset_b <= cfg_do_A(15 downto 0);
+					when 70 =>
+					    ilv_coef0 <= cfg_do_A(31 downto 16);
+					    ilv_coef1 <= cfg_do_A(15 downto 0);
+					when 71 =>
+					    ilv_coef2 <= cfg_do_A(31 downto 16);
+					    ilv_coef3 <= cfg_do_A(15 downto 0);
+					when 72 =>
+					    adc_recal_auto <= cfg_do_A(31);
+					    adc_recal_man <= cfg_do_A(30);
+					    adc_recal_dtemp <= unsigned(cfg_do_A(11 downto 0));
+					when 73 =>
+					    hdr_only <= cfg_do_A(31);
+					    hdr_only_req <= cfg_do_A(30);
+					    hdr_only_nth <= unsigned(cfg_do_A(15 downto 0));
+					when 74 =>
+					    mask_enable <= cfg_do_A(31);
+					    mask_fail_only <= cfg_do_A(31) AND cfg_do_A(30);
+					    mask_step <= cfg_do_A(19 downto 16);
+					    mask_length <= cfg_do_A(12 downto 0);
+					when 75 =>
+					    mask_offset <= cfg_do_A(26 downto 0);
+					when 76 =>
+					    hist_enable <= cfg_do_A(31);
+					    hist_clear <= cfg_do_A(30);
+					    hist_step <= cfg_do_A(3 downto 0);
 					when others => null;
 				end case;
 			end if;
 			DebugMState <= 2;
       
-		when D =>			          -- "CONFIGURE ADC"
-			-- reset ADC register write command
-			if ConfigureADC = '1' OR adcA_spi_busy = '1' OR adcB_spi_busy = '1' then
-                adc_spi_data <= adc_cfg_reg & adc_cfg_data;
-                ConfigureADC <= '0';
-                Masterstate <= D;
-			else
-            -- return to dispatcher state
-                Masterstate <= B;
-			end if;
-			DebugMState <= 3;
-		
-		when E =>						-- "CONFIGURE ANALOG INPUTS (Gain/Offset)
-
-			--===========================================================
-			-- Update DAC outputs (analog channel Offser/Gain control)
-			--===========================================================	
-
-			if DAC_programming_finished = '1' then
-				if cnt_dac_out_stable = 16383 then
-					DAC_programming_finished <= '0'; --reset programming flag
-					cnt_dac_out_stable <= 0;
-					Masterstate <= B;
-				else
-					DAC_programming_finished <= '1';
-					cnt_dac_out_stable <= cnt_dac_out_stable + 1;
-					Masterstate <= E;
-				end if;										
-			else
-				Masterstate <= E;
-				case DAC_state (2 downto 0) is
-					
-					when DAC_A => -- "IDLE"
-						
-						if DAC_pogramming_start = '1' and dac_spi_busy = '0' then
-							DAC_pogramming_start <= '0';
-							DAC_state <= DAC_B; -- start programming
-						else
-							DAC_state <= DAC_A; -- WAIT
-						end if;
-					
-					when DAC_B => -- "LOAD DAC REGISTER AND START PROGRAMMING"
-					
-						dac_cfg_reg <= dac_cfg_array(dac_array_count);						
-						if dac_spi_busy = '0' then
-						    ConfigureVdac <= '1'; --s DAC programming
-						    DAC_state <= DAC_C;   --goto WAIT
-						else
-						    ConfigureVdac <= '0';
-                            DAC_state <= DAC_B;
-                        end if;
-								
-					when DAC_C => -- "WAIT UNTIL PROGRAMMING FINISHED"
-						ConfigureVdac <= '0';
-						if dac_spi_busy = '1' OR ConfigureVdac = '1' then
-							-- wait if SPI interface is busy
-							DAC_state <= DAC_C;
-						else
-							if ( dac_array_count = 4 ) then
-								DAC_programming_finished <= '1';
-								dac_array_count <= 1;
-								DAC_state <= DAC_A;
-							else
-								DAC_state <= DAC_B;
-								-- select next DAC register and goto LOAD
-								dac_array_count <= dac_array_count + 1;
-							end if;
-						end if;
-
-					when others =>
-						DAC_state <= DAC_A;
-				end case;
-			end if;
-			
-			DebugMState <= 4;
-			
 		when F =>						-- "WAIT FOR NEW FRAME READY"
 			clearflags <= '0';
 			ReadingFrame <= '0';
 --			requestFrame <= '0';
 			-- start sending to FX3 when frame was triggered
-			if ( frame_ready_to_send = '1' ) then
+			-- (when only failed frames are sent, wait for mask test result of the frame)
+			if ( frame_ready_to_send = '1' AND ( mask_fail_only = '0' OR mask_done = '1' ) ) then
 		        newFrameRequestRevcd <= '0';
 		        framesize_dd <= framesize_d;  -- get current frame size
 				frame_ready_to_send <= '0';
---				addrb <= std_logic_vector(unsigned(frame_start_pointer_dd));
-				Masterstate <= G;					-- continue to STREAMING
+				mask_done <= '0';
+				if mask_fail_only = '1' AND hdr_mask_fail = '0' then
+				    -- frame passed mask test: drop its samples and request new frame
+				    frame_discard <= '1';
+				    Masterstate <= F;
+				else
+				    frame_discard <= '0';
+				    -- measurement mode: send only header, except requested or every n-th frame
+				    if hdr_only = '1' AND hdr_only_full_pend = '0' AND ( hdr_only_nth = 0 OR hdr_only_cnt /= hdr_only_nth - 1 ) then
+				        frame_no_samples <= '1';
+				        hdr_only_cnt <= hdr_only_cnt + 1;
+				    else
+				        frame_no_samples <= '0';
+				        hdr_only_cnt <= (others => '0');
+				        hdr_only_full_pend <= '0';
+				    end if;
+--				    addrb <= std_logic_vector(unsigned(frame_start_pointer_dd));
+				    Masterstate <= G;					-- continue to STREAMING
+				end if;
 			-- wait until frame is ready to send
 			elsif ( flaga_d = '1' or flagb_d = '1') then
 				Masterstate <= B;	-- we have to read new config immediately if it was received
+			-- send requested window of the last saved frame (if no frame saving is in progress)
+			elsif ( vp_request = '1' and newFrameRequestRevcd = '0' ) then
+			    vp_request <= '0';
+			    vp_start <= '1';
+			    vp_frame <= '1';
+			    frame_no_samples <= '0';
+			    frame_discard <= '0';
+			    -- event search: samples from window offset to the end of saved frame
+			    if unsigned(vp_offset) < unsigned(framesize_d) then
+			        srch_span <= std_logic_vector(unsigned(framesize_d) - unsigned(vp_offset));
+			    else
+			        srch_span <= (others => '0');
+			    end if;
+			    if srch_cfg(31 downto 30) /= "00" then
+			        vp_search <= '1';
+			    else
+			        vp_search <= '0';
+			    end if;
+			    if unsigned(vp_level) = 0 or srch_cfg(31 downto 30) /= "00" then
+			        framesize_dd <= vp_length;  -- number of window samples (or search results) to send
+			    else
+			        framesize_dd <= vp_length(25 downto 0) & '0';  -- min/max pyramid entry is sent as 2 samples
+			    end if;
+			    Masterstate <= G;
 			else
                 if newFrameRequestRevcd = '0' then
-                    if cnt_restart_framesave = 15 then
+                    if cnt_restart_framesave = 15 and cfg_bank_pend = '1' then
+                        -- no frame is being saved: switch config bank and decode its registers (state C),
+                        -- new frame is requested after return
+                        cfg_bank_pend <= '0';
+                        cfg_bank <= cfg_bank_req;
+                        cfg_bankA <= cfg_bank_req;
+                        cfg_bank_sw <= '1';
+                        cfg_vp_wr <= '0';        -- bank switch is not a viewport request
+                        cfg_addrA <= std_logic_vector(to_unsigned(0,7));
+                        cfg_we <= '0';
+                        faddr_rdy <= '1';   -- skip reading from EP2
+                        ScopeConfigChanged <= '1';
+                        requestFrame <= '0';
+                        Masterstate <= C;
+                    elsif cnt_restart_framesave = 15 then
                         -- if single trigger is requested but armed, then don't request new frame
-                        if s_trigger_mode = "10" AND s_trigger_rearm = '0' then
+                        -- in viewport mode keep last saved frame in RAM
+                        -- wait until DAC outputs are stable after gain/offset change
+                        if ( s_trigger_mode = "10" AND s_trigger_rearm = '0' ) OR vp_mode = '1' OR dac_spi_idle = '0' then
                             cnt_restart_framesave <= 15;
                             requestFrame <= '0';
                         -- request new frame
@@ -2491,12 +3747,15 @@ begin
                             s_trigger_rearm <= '0';
                             cnt_restart_framesave <= 0;
                             requestFrame <= '1';
+                            frame_discard <= '0';
+                            mask_done <= '0';
                     	end if;
+                    	Masterstate <= F;
                     else
                     	cnt_restart_framesave <= cnt_restart_framesave + 1;
                     	requestFrame <= '0';
+                    	Masterstate <= F;
                     end if;
-                    Masterstate <= F;
                 else
                     -- wait in this state until frame is ready to send
                     requestFrame <= '0';
@@ -2511,6 +3770,7 @@ begin
 			slrd_i <= '1';
 			faddr_i <= "00";  -- 00 -- select EP6
 			ReadingFrame <= '1';
+			vp_start <= '0';
 --			frame_ready_to_send <= '0'; 	-- reset frame_ready_to_send flag
 			-- select flagd/flagb IN EP buffer
 			
@@ -2565,6 +3825,11 @@ begin
                         when 0  =>
                             fdata <= X"DDDDDDDD";
                             send_frame_cnt <= send_frame_cnt + 1;
+                            if adc_eye_lane = 9 then
+                                adc_eye_lane <= 0;
+                            else
+                                adc_eye_lane <= adc_eye_lane + 1;
+                            end if;
                         when 1 =>
                             fdata <= X"0000" & X"0" & device_temp_dd;
                             --fdata <= X"00000" & device_temp_dd;
@@ -2574,15 +3839,169 @@ begin
                         when 3 =>
                             fdata <= X"0000" & X"00" & "00" & std_logic_vector(an_trig_delay_min);
                         when 4 =>
-                            fdata <= X"0000" & X"00" & "00" & std_logic_vector(an_trig_delay_max);                          
+                            fdata <= X"0000" & X"00" & "00" & std_logic_vector(an_trig_delay_max);
+                        when 5 =>
+                            -- trigger timestamp (250 MHz ADC clock ticks)
+                            fdata <= hdr_trig_ts(63 downto 32);
+                        when 6 =>
+                            fdata <= hdr_trig_ts(31 downto 0);
+                        when 7 =>
+                            -- frame sequence number
+                            fdata <= hdr_frame_seq;
+                        when 8 =>
+                            -- number of triggers lost since previous frame
+                            fdata <= hdr_trig_lost;
+                        when 9 =>
+                            -- trigger level crossing after the sample before trigger (fraction of sample period, 0.16 fixed point)
+                            -- bit 31: crossing was interpolated (analog trigger)
+                            -- bit 30: interleaved mode, crossing is between A and B sample of the pair
+                            -- (else between B sample of previous pair and A sample)
+                            fdata <= hdr_trig_frac;
+                        when 10 =>
+                            -- protocol decoders: bit 31: enabled, bit 0: more event records are waiting
+                            -- else frame measurements: bit 30: measurements follow, bits 29, 28: timing results of B, A are valid
+                            -- bit 27: mask test is enabled, bit 26: frame failed mask test
+                            if dec_ctrl(2 downto 0) /= "000" then
+                                fdata <= '1' & "000" & X"000000" & "000" & not(dec_empty);
+                            else
+                                fdata <= "01" & hdr_meas_ok & mask_enable & hdr_mask_fail & "00" & X"000000";
+                            end if;
+                        when 11 to 62 =>
+                            -- protocol decoder event records (2 words each, record type 0: no record)
+                            -- or frame measurements (words 11-33, see frame_meas) and mask test results (words 34-38):
+                            -- frames tested, frames failed (since mask test was enabled), samples out of mask A, B,
+                            -- first sample out of mask (from trigger)
+                            -- and persistence histogram (words 39-41): frames accumulated, frames skipped (since clear),
+                            -- bit 31: enabled, bit 1: histogram is being cleared, bit 0: some counter is saturated
+                            if dec_ctrl(2 downto 0) = "000" then
+                                if hword_cnt_i <= 33 then
+                                    fdata <= hdr_meas(32*(hword_cnt_i-11)+31 downto 32*(hword_cnt_i-11));
+                                elsif hword_cnt_i <= 38 then
+                                    fdata <= hdr_mask(32*(38-hword_cnt_i)+31 downto 32*(38-hword_cnt_i));
+                                elsif hword_cnt_i <= 40 then
+                                    fdata <= hdr_hist(32*(40-hword_cnt_i)+31 downto 32*(40-hword_cnt_i));
+                                elsif hword_cnt_i = 41 then
+                                    fdata <= (hist_enable AND awg_ddr_region) & X"0000000" & "0" & hist_status_dd;
+                                else
+                                    fdata <= (others => '0');
+                                end if;
+                            elsif (hword_cnt_i mod 2) = 1 then
+                                if dec_empty = '0' then
+                                    fdata <= dec_rd_data(63 downto 32);
+                                    dec_rec_lo <= dec_rd_data(31 downto 0);
+                                    dec_rden <= '1';
+                                else
+                                    fdata <= (others => '0');
+                                    dec_rec_lo <= (others => '0');
+                                end if;
+                            else
+                                fdata <= dec_rec_lo;
+                            end if;
+                        when 64+CONFIG_DATA_SIZE =>
+                            -- viewport: window position within the last saved frame
+                            cfg_addrA <= std_logic_vector(to_unsigned(0,7));
+                            fdata <= vp_frame & (vp_search and vp_frame) & "000" & vp_offset;
+                        when 64+CONFIG_DATA_SIZE+1 =>
+                            fdata <= "00000" & vp_length;
+                        when 64+CONFIG_DATA_SIZE+2 =>
+                            fdata <= vp_level & "0" & vp_stride;
+                        when 64+CONFIG_DATA_SIZE+3 =>
+                            -- min/max pyramid of the last saved frame
+                            fdata <= pyr_enable & pyr_overflow_dd & "00" & X"0000000";
+                        when 64+CONFIG_DATA_SIZE+8 =>
+                            -- frequency response analyzer: bit 31: enabled, 30: busy, 29: points were lost,
+                            -- 20..16: number of points in this header (8 words each), 15..0: index of first point
+                            if fra_wr_pt - fra_rd_pt > 31 then
+                                -- ring was overwritten, send last 16 points
+                                fra_lost <= '1';
+                                fra_hdr_pt <= fra_wr_pt - 16;
+                                fra_hdr_n <= to_unsigned(16,5);
+                                fra_rd_pt <= fra_wr_pt;
+                                fdata <= fra_enable & fra_busy & '1' & X"00" & "10000" & std_logic_vector(fra_wr_pt - 16);
+                            elsif fra_wr_pt - fra_rd_pt > 16 then
+                                fra_hdr_pt <= fra_rd_pt;
+                                fra_hdr_n <= to_unsigned(16,5);
+                                fra_rd_pt <= fra_rd_pt + 16;
+                                fdata <= fra_enable & fra_busy & fra_lost & X"00" & "10000" & std_logic_vector(fra_rd_pt);
+                            else
+                                fra_hdr_pt <= fra_rd_pt;
+                                fra_hdr_n <= resize(fra_wr_pt - fra_rd_pt,5);
+                                fra_rd_pt <= fra_wr_pt;
+                                fdata <= fra_enable & fra_busy & fra_lost & X"00" & std_logic_vector(resize(fra_wr_pt - fra_rd_pt,5)) & std_logic_vector(fra_rd_pt);
+                            end if;
+                        when 64+CONFIG_DATA_SIZE+137 =>
+                            -- capture mode: bit 31: transition-only LA storage (samples are (20 bit delta, dataD) records),
+                            -- 11..0: digital lines which make new record
+                            fdata <= la_tr_mode & "000" & X"0000" & la_tr_mask;
+                        when 64+CONFIG_DATA_SIZE+138 =>
+                            -- ETS trigger: bit 31: delay line is calibrated, 21..16: taps (as word 2),
+                            -- 15..0: calibrated time from trigger edge to sampling clock edge (ADC clock period / 65536)
+                            fdata <= ets_calibrated_dd & "000000000" & std_logic_vector(an_trig_delay_dd) & ets_fine_dd;
+                        when 64+CONFIG_DATA_SIZE+139 =>
+                            -- interleaved ADC correction: bit 31: enabled, bit 30: interleaving mode,
+                            -- calibration: bit 1: running, bit 0: done (sums below are valid)
+                            fdata <= ilv_enable & adc_interleaving & X"000000" & "0000" & ilv_cal_status_dd;
+                        when 64+CONFIG_DATA_SIZE+140 =>
+                            -- calibration sums (held while calibration start bit is set)
+                            fdata <= ilv_cal_sum_a;
+                        when 64+CONFIG_DATA_SIZE+141 =>
+                            fdata <= ilv_cal_sum_b;
+                        when 64+CONFIG_DATA_SIZE+142 =>
+                            fdata <= X"0000" & ilv_cal_sum_aa(47 downto 32);
+                        when 64+CONFIG_DATA_SIZE+143 =>
+                            fdata <= ilv_cal_sum_aa(31 downto 0);
+                        when 64+CONFIG_DATA_SIZE+144 =>
+                            fdata <= X"0000" & ilv_cal_sum_bb(47 downto 32);
+                        when 64+CONFIG_DATA_SIZE+145 =>
+                            fdata <= ilv_cal_sum_bb(31 downto 0);
+                        when 64+CONFIG_DATA_SIZE+146 =>
+                            fdata <= X"0000" & ilv_cal_sum_ab(47 downto 32);
+                        when 64+CONFIG_DATA_SIZE+147 =>
+                            fdata <= ilv_cal_sum_ab(31 downto 0);
+                        when 64+CONFIG_DATA_SIZE+148 =>
+                            fdata <= X"0000" & ilv_cal_sum_ba(47 downto 32);
+                        when 64+CONFIG_DATA_SIZE+149 =>
+                            fdata <= ilv_cal_sum_ba(31 downto 0);
+                        when 64+CONFIG_DATA_SIZE+150 =>
+                            -- ADC interface eye scan, one lane per frame: bit 31: re-calibration running,
+                            -- bit 30: re-calibration on temperature change enabled, 27..24: lane (0-4 CH1, 5-9 CH2),
+                            -- 21..16: eye width (IDELAY taps), 12..8: selected tap, 7..0: re-calibrations since power-up
+                            fdata <= '0' & adc_recal_auto & "00" & std_logic_vector(to_unsigned(adc_eye_lane,4)) & "00"
+                                     & adc_eye_width(6*adc_eye_lane+5 downto 6*adc_eye_lane) & "000"
+                                     & adc_eye_center(5*adc_eye_lane+4 downto 5*adc_eye_lane) & std_logic_vector(adc_recal_count);
+                            if adc_recal_cnt /= 0 then
+                                fdata(31) <= '1';
+                            end if;
+                        when 64+CONFIG_DATA_SIZE+9 to 64+CONFIG_DATA_SIZE+136 =>
+                            -- frequency response analyzer points
+                            if (hword_cnt_i-(64+CONFIG_DATA_SIZE+9))/8 < to_integer(fra_hdr_n) then
+                                fdata <= fra_ring(to_integer((fra_hdr_pt(4 downto 0) + (hword_cnt_i-(64+CONFIG_DATA_SIZE+9))/8) & to_unsigned((hword_cnt_i-(64+CONFIG_DATA_SIZE+9)) mod 8,3)));
+                            else
+                                fdata <= (others => '0');
+                            end if;
+                        when 64+CONFIG_DATA_SIZE+7 =>
+                            -- AWG playback from RAM: bit 1: sample output underrun (sticky), bit 0: playing
+                            -- bits 6..4: digital pattern playback from RAM: loop error, underrun (sticky), playing
+                            -- bits 17, 16: AWG_2, AWG_1 frequency sweep is running
+                            -- bit 31: header-only frame, no samples follow
+                            fdata <= frame_no_samples & X"00" & "000" & "00" & sweeping_dd(2) & sweeping_dd(1) & X"00" & '0' & pat_status_dd & "00" & awg_ddr_status_dd;
+                        when 64+CONFIG_DATA_SIZE+6 =>
+                            -- AWG custom signal banks: requested and currently played bank
+                            fdata <= X"0000000" & generator2Bank & generator1Bank & generator2BankActive_d(1) & generator1BankActive_d(1);
+                        when 64+CONFIG_DATA_SIZE+5 =>
+                            -- background SPI queues: idle flags (V-DAC incl. settling, ADC, POT) and number of sent words
+                            fdata <= dac_spi_idle & adc_spi_idle & dpot_spi_idle & "00000" & dac_spi_done_cnt & adc_spi_done_cnt & dpot_spi_done_cnt;
+                        when 64+CONFIG_DATA_SIZE+4 =>
+                            -- active config bank, bit 31: bank switch is pending
+                            fdata <= cfg_bank_pend & "000" & X"00000" & "00" & cfg_bank_req & "00" & cfg_bank;
                         when 63 =>
-                            cfg_addrA <= std_logic_vector(to_unsigned(1,6));
+                            cfg_addrA <= std_logic_vector(to_unsigned(1,7));
                             fdata <= X"0000FFFF";
                         when 72 =>
                             fdata(26 downto 0) <= std_logic_vector(unsigned(framesize_dd)+1);
                         when 64 to 71 | 73 to 64+(CONFIG_DATA_SIZE-1) =>
                             if to_integer(unsigned(cfg_addrA)) = CONFIG_DATA_SIZE-1 then
-                                cfg_addrA <= std_logic_vector(to_unsigned(0,6));
+                                cfg_addrA <= std_logic_vector(to_unsigned(0,7));
                             else
                                 cfg_addrA <= std_logic_vector(unsigned(cfg_addrA) + 1);
                             end if;
@@ -2590,9 +4009,19 @@ begin
                         when FRAME_HEADER_SIZE-1 =>
                             fdata  <= x"00000000"; -- CRC
                         when others =>
-                            cfg_addrA <= std_logic_vector(to_unsigned(0,6));
+                            cfg_addrA <= std_logic_vector(to_unsigned(0,7));
                             fdata <= X"0000FFFF";
-                    end case;					
+                    end case;
+                    -- header-only frame ends with the header (which fills a whole DMA buffer),
+                    -- frame samples are dropped from RAM read fifo
+                    if hword_cnt_i = FRAME_HEADER_SIZE-1 AND frame_no_samples = '1' then
+                        hword_cnt_i <= 0;
+                        send_sample_cnt <= 0;
+                        SendingFrameSlow <= '0';
+                        vp_frame <= '0';
+                        frame_discard <= '1';
+                        MasterState <= B;
+                    end if;
 --					case hword_cnt_i is
 --						when 0 =>
 --							fdata(15 downto 0) <= X"DDDD";
@@ -2634,6 +4063,7 @@ begin
                         if dword_cnt_i = (FX3_DMA_BUFFER_SIZE/4)-1 then
                             hword_cnt_i <= 0; -- RESET Header couter
                             send_sample_cnt <= 0;
+                            vp_frame <= '0';
                             MasterState <= B; -- continue to dispatcher
 						else
 						    if DataOutValid = '1' then
@@ -2676,15 +4106,37 @@ begin
 			end if;
 			DebugMState <= 6;
 	
+		-- EP4 transfer is read in whole DMA buffers (FX3_DMA_BUFFER_SIZE), one dword each clk.
+		-- Each dword carries one sample pair (first sample in bits 27..16, second in bits 11..0).
+		-- Targeted upload (starts at DMA buffer boundary):
+		--   word 0:  AWG_HDR_MAGIC & X"000" & "0" & target (000: AWG_1, 001: AWG_2, 010: Digital, 011: RAM,
+		--            100: mask of channel A, 101: mask of channel B)
+		--   word 1:  "00" & offset (sample pairs, bits 29..16) & "0" & length (sample pairs, bits 14..0)
+		--   then length sample pairs, rest of last DMA buffer is padding (offset + length <= AWG_MAX_SAMPLES/2)
+		-- RAM target (long waveform, config words 39 to 42):
+		--   word 1:  offset (RAM words of 8 samples, bits 22..0)
+		--   word 2:  length (dwords, bits 25..0, multiple of 4), upload may span many DMA buffers
+		-- mask target (config words 74, 75): offset and length in mask entries (offset + length <= 4096),
+		--   each dword is one entry: upper limit (bits 27..16) and lower limit (bits 11..0)
+		-- transfer without header is full upload: AWG_1, AWG_2 and Digital buffer (AWG_MAX_SAMPLES each) in order
+		-- AWG in bank mode (config word 38): targeted upload goes to inactive bank (offset + length <= AWG_MAX_SAMPLES/4)
 		when H =>                 -- "Read data for AWG custom signal"
 
 			faddr_i <= "10";	-- select EP4 (awg custom data)
 			slwr_i  <= '1';
+			wea_awg <= '0';
+			wea_awg2 <= '0';
+			wea_dig <= '0';
+			wea_mask <= '0';
+			awg_up_ddr_wr <= '0';
+			awg_up_ddr_addr_wr <= '0';
 			if faddr_rdy = '0' then
                 -- FX3 has 3 cycle latency from FADDR to data
                 -- and 2 cycle latency from SLRD to data
                 slrd_i <= '1';
-                slrd_rdy_cnt <= 0;
+                slrd_cnt <= 0;
+                slrd_valid <= "00";
+                awg_wait_cnt <= 0;
                 if faddr_rdy_cnt_i = 3 then
                     faddr_rdy <= '1';
                     faddr_rdy_cnt_i <= 0;
@@ -2692,177 +4144,124 @@ begin
                     faddr_rdy <= '0';
                     faddr_rdy_cnt_i <= faddr_rdy_cnt_i + 1;
                 end if;
-            elsif ( flagb_dd = '1' ) then
-
-                if slrd_i = '0' then
-                    if slrd_cnt = (FX3_DMA_BUFFER_SIZE/4) then
-                        slrd_cnt <= 0;
-                    else                      
-                        slrd_cnt <= slrd_cnt + 1;
-                    end if;
+                Masterstate <= H;
+            elsif slrd_cnt = 0 and (flagb_dd = '0' or awg_up_ddr_afull = '1') then
+                -- EP4 is empty (or RAM upload fifo can not accept whole DMA buffer)
+                slrd_i <= '1';
+                faddr_rdy <= '0';
+                Masterstate <= B;
+            else
+                -- read whole DMA buffer (SLRD is asserted every clk)
+                if slrd_cnt < FX3_DMA_BUFFER_SIZE/4 then
+                    slrd_i <= '0';
+                    slrd_cnt <= slrd_cnt + 1;
+                else
+                    slrd_i <= '1';
                 end if;
-                -- Select AWG buffer -> 0: AWG_1, 1: AWG_2, 2: Digital
-                case BufferSel is
-                    when "00" =>
-                    
-                        if accumulate_addra_awg = '1' and addra_awg < std_logic_vector(to_unsigned(AWG_MAX_SAMPLES-1,15)) then
-                            addra_awg <= std_logic_vector(unsigned(addra_awg) + 1);
-                        end if;
-                        if slrd_rdy_cnt = 3 then
-                            -- fdata bus is 32-bit wide, so we are reading 2 consecutive 12-bit words in one clock cycle
-                            -- and asserting slrd_i every other clock cycle
-                            dina_awg_tmp <= fdata(11 downto 0);
-                            if slrd_i = '0' then             
-                                slrd_i <= '1'; 
-                                dina_awg <= fdata(27 downto 16);
+                slrd_valid <= slrd_valid(0) & NOT(slrd_i);
+
+                if slrd_valid(1) = '1' then
+                    case awg_up_ph is
+                        when 0 =>   -- header or first sample pair of full upload
+                            if fdata(31 downto 16) = AWG_HDR_MAGIC then
+                                awg_up_legacy <= '0';
+                                awg_up_sel <= fdata(2 downto 0);
+                                awg_up_ph <= 1;
+                            else
+                                awg_up_legacy <= '1';
+                                awg_up_sel <= "000";
                                 wea_awg <= '1';
-                                accumulate_addra_awg <= '1'; -- start address counters                      
+                                addra_awg <= std_logic_vector(to_unsigned(0,14));
+                                dina_awg <= fdata(27 downto 16) & fdata(11 downto 0);
+                                awg_up_addr <= to_unsigned(1,14);
+                                awg_up_len <= to_unsigned(AWG_MAX_SAMPLES/2-1,26);
+                                awg_up_ph <= 2;
+                            end if;
+                        when 1 =>   -- offset & length
+                            awg_up_addr <= unsigned(fdata(29 downto 16));
+                            awg_up_len <= resize(unsigned(fdata(14 downto 0)),26);
+                            if awg_up_sel = "011" then
+                                -- RAM: start address, length follows
+                                awg_up_ddr_addr_wr <= '1';
+                                awg_up_ddr_data <= fdata;
+                                awg_up_ph <= 4;
+                            elsif unsigned(fdata(14 downto 0)) = 0 then
+                                awg_up_ph <= 3;
                             else
-                                if slrd_cnt < (FX3_DMA_BUFFER_SIZE/4) then
-                                    dina_awg <= dina_awg_tmp;
+                                awg_up_ph <= 2;
+                            end if;
+                        when 2 =>   -- write sample pair to selected buffer
+                            case awg_up_sel is
+                                when "000" =>
                                     wea_awg <= '1';
-                                    accumulate_addra_awg <= '1'; -- start address counters
-                                    slrd_i <= '0';
-                                else
-                                    cnt_rd_last <= not(cnt_rd_last);
-                                    if cnt_rd_last = '0' then
-                                        dina_awg <= dina_awg_tmp;
+                                    if generator1BankMode = '1' and awg_up_legacy = '0' then
+                                        -- bank mode: write to bank which is not requested for playing
+                                        addra_awg <= NOT(generator1Bank) & std_logic_vector(awg_up_addr(12 downto 0));
                                     else
-                                        dina_awg <= fdata(27 downto 16);
+                                        addra_awg <= std_logic_vector(awg_up_addr);
                                     end if;
-                                    wea_awg <= flagb_d;
-                                    accumulate_addra_awg <= flagb_d; -- start address counters
-                                    slrd_i <= '1';
-                                end if;
-                            end if;
-                        else
-                            if slrd_i = '1' then
-                                slrd_i <= '0';
-                            else
-                                slrd_i <= '1';
-                            end if;
-                            slrd_rdy_cnt <= slrd_rdy_cnt + 1;
-                            accumulate_addra_awg <= '0';
-                        end if;
-                        -- stay in this state, util EP4 is not empty
-                        Masterstate <= H;
-                        
-                    when "01" =>
-                    
-                        if accumulate_addra_awg = '1' and addra_awg2 < std_logic_vector(to_unsigned(AWG_MAX_SAMPLES-1,15)) then
-                        addra_awg2 <= std_logic_vector(unsigned(addra_awg2) + 1);
-                        end if;
-                        if slrd_rdy_cnt = 3 then
-                            -- fdata bus is 32-bit wide, so we are reading 2 consecutive 12-bit words in one clock cycle
-                            -- and asserting slrd_i every other clock cycle
-                            dina_awg2_tmp <= fdata(11 downto 0);
-                            if slrd_i = '0' then             
-                                slrd_i <= '1'; 
-                                dina_awg2 <= fdata(27 downto 16);
-                                wea_awg2 <= '1';
-                                accumulate_addra_awg <= '1'; -- start address counters                      
-                            else
-                                if slrd_cnt < (FX3_DMA_BUFFER_SIZE/4) then
-                                    dina_awg2 <= dina_awg2_tmp;
+                                    dina_awg <= fdata(27 downto 16) & fdata(11 downto 0);
+                                when "001" =>
                                     wea_awg2 <= '1';
-                                    accumulate_addra_awg <= '1'; -- start address counters
-                                    slrd_i <= '0';
-                                else
-                                    cnt_rd_last <= not(cnt_rd_last);
-                                    if cnt_rd_last = '0' then
-                                        dina_awg2 <= dina_awg2_tmp;
+                                    if generator2BankMode = '1' and awg_up_legacy = '0' then
+                                        addra_awg2 <= NOT(generator2Bank) & std_logic_vector(awg_up_addr(12 downto 0));
                                     else
-                                        dina_awg2 <= fdata(27 downto 16);
+                                        addra_awg2 <= std_logic_vector(awg_up_addr);
                                     end if;
-                                    wea_awg2 <= flagb_d;
-                                    accumulate_addra_awg <= flagb_d; -- start address counters
-                                    slrd_i <= '1';
-                                end if;
-                            end if;
-                        else
-                            if slrd_i = '1' then
-                                slrd_i <= '0';
-                            else
-                                slrd_i <= '1';
-                            end if;
-                            slrd_rdy_cnt <= slrd_rdy_cnt + 1;
-                            accumulate_addra_awg <= '0';
-                        end if;
-                        -- stay in this state, util EP4 is not empty
-                        Masterstate <= H;
-                    
-                    when "10" =>
-                    
-                        if accumulate_addra_awg = '1' and addra_dig < std_logic_vector(to_unsigned(AWG_MAX_SAMPLES-1,15)) then
-                            addra_dig <= std_logic_vector(unsigned(addra_dig) + 1);
-                        end if;
-                        if slrd_rdy_cnt = 3 then
-                            -- fdata bus is 32-bit wide, so we are reading 2 consecutive 12-bit words in one clock cycle
-                            -- and asserting slrd_i every other clock cycle
-                            dina_dig_tmp <= fdata(11 downto 0);
-                            if slrd_i = '0' then             
-                                slrd_i <= '1'; 
-                                dina_dig <= fdata(27 downto 16);
-                                wea_dig <= '1';
-                                accumulate_addra_awg <= '1'; -- start address counters                      
-                            else
-                                if slrd_cnt < (FX3_DMA_BUFFER_SIZE/4) then
-                                    dina_dig <= dina_dig_tmp;
+                                    dina_awg2 <= fdata(27 downto 16) & fdata(11 downto 0);
+                                when "010" =>
                                     wea_dig <= '1';
-                                    accumulate_addra_awg <= '1'; -- start address counters
-                                    slrd_i <= '0';
+                                    addra_dig <= std_logic_vector(awg_up_addr);
+                                    dina_dig <= fdata(27 downto 16) & fdata(11 downto 0);
+                                when "100" | "101" =>
+                                    wea_mask <= '1';
+                                    mask_wr_sel <= awg_up_sel(0);
+                                    addra_mask <= std_logic_vector(awg_up_addr(11 downto 0));
+                                    dina_mask <= fdata(27 downto 16) & fdata(11 downto 0);
+                                when "011" =>
+                                    awg_up_ddr_wr <= '1';
+                                    awg_up_ddr_data <= fdata;
+                                when others => null;
+                            end case;
+                            awg_up_addr <= awg_up_addr + 1;
+                            if awg_up_len = 1 then
+                                if awg_up_legacy = '1' and awg_up_sel /= "010" then
+                                    -- full upload: continue with next buffer (AWG_2, Digital)
+                                    awg_up_sel <= std_logic_vector(unsigned(awg_up_sel) + 1);
+                                    awg_up_len <= to_unsigned(AWG_MAX_SAMPLES/2,26);
                                 else
-                                    cnt_rd_last <= not(cnt_rd_last);
-                                    if cnt_rd_last = '0' then
-                                        dina_dig <= dina_dig_tmp;
-                                    else
-                                        dina_dig <= fdata(27 downto 16);
-                                    end if;
-                                    wea_dig <= flagb_d;
-                                    accumulate_addra_awg <= flagb_d; -- start address counters
-                                    slrd_i <= '1';
+                                    awg_up_ph <= 3;
                                 end if;
+                            else
+                                awg_up_len <= awg_up_len - 1;
                             end if;
-                        else
-                            if slrd_i = '1' then
-                                slrd_i <= '0';
+                        when 4 =>   -- RAM upload length
+                            awg_up_len <= unsigned(fdata(25 downto 0));
+                            if unsigned(fdata(25 downto 0)) = 0 then
+                                awg_up_ph <= 3;
                             else
-                                slrd_i <= '1';
+                                awg_up_ph <= 2;
                             end if;
-                            slrd_rdy_cnt <= slrd_rdy_cnt + 1;
-                            accumulate_addra_awg <= '0';
-                        end if;
-                        -- stay in this state, util EP4 is not empty
+                        when others => null;    -- padding
+                    end case;
+                end if;
+
+                -- whole DMA buffer was read
+                if slrd_cnt = FX3_DMA_BUFFER_SIZE/4 and slrd_i = '1' and slrd_valid = "00" then
+                    if awg_up_ph = 3 then
+                        awg_up_ph <= 0;  -- next DMA buffer starts new upload
+                    end if;
+                    -- wait until FX3 flags are updated, then back to dispatcher
+                    if awg_wait_cnt = 7 then
+                        awg_wait_cnt <= 0;
+                        faddr_rdy <= '0';
+                        Masterstate <= B;
+                    else
+                        awg_wait_cnt <= awg_wait_cnt + 1;
                         Masterstate <= H;
-                
-                    when others => null;
-                end case;
-            else
-                slrd_cnt <= 0;
-                slrd_rdy_cnt <= 0;
-                cnt_rd_last <= '0';
-                slrd_i <= '1';
-                wea_dig <= '0';
-                wea_awg <= '0';
-                wea_awg2 <= '0';
-                accumulate_addra_awg <= '0'; -- re-set counter flag
-                -- if awg buffer is full
-                if addra_awg = std_logic_vector(to_unsigned(AWG_MAX_SAMPLES-1,15)) then
-                    addra_awg <= std_logic_vector(to_unsigned(0,15));
-                    BufferSel <= "01"; -- switch to AWG_2 buffer
-                    Masterstate <= B;
-                elsif addra_awg2 = std_logic_vector(to_unsigned(AWG_MAX_SAMPLES-1,15)) then
-                    addra_awg2 <= std_logic_vector(to_unsigned(0,15));
-                    BufferSel <= "10"; -- switch to dig. pattern buffer
-                    Masterstate <= B;
-                elsif addra_dig = std_logic_vector(to_unsigned(AWG_MAX_SAMPLES-1,15)) then
-                    addra_dig <= std_logic_vector(to_unsigned(0,15));
-                    BufferSel <= "00"; -- reset buffer select
-                    faddr_rdy <= '0';
-                    Masterstate <= B; -- back to dispatcher
+                    end if;
                 else
-                   -- halt on error
-                    MasterState <= B; -- halt in curent state
+                    Masterstate <= H;
                 end if;
             end if;
 			DebugMState <= 7;
@@ -2873,6 +4272,56 @@ begin
 			MasterState <= A;
 			
 		end case;
+		
+		-- measurement mode: next frame is sent with samples when requested by host
+		hdr_only_req_d <= hdr_only_req;
+		if hdr_only_req = '1' AND hdr_only_req_d = '0' then
+		    hdr_only_full_pend <= '1';
+		end if;
+		
+		--===========================================================
+		-- ADC interface re-calibration (eye scan of both channels)
+		--===========================================================
+		-- requested by host or when device temperature moved by adc_recal_dtemp since last calibration;
+		-- ADC sends test pattern meanwhile, so frame saving is held in reset
+		adc_recal_man_d <= adc_recal_man;
+		if MasterState = A then
+		    -- power-up calibration
+		    adc_recal_temp <= unsigned(device_temp_dd);
+		    adc_recal_cnt <= 0;
+		elsif adc_recal_cnt = 0 then
+		    if ( adc_recal_man = '1' AND adc_recal_man_d = '0' )
+		       OR ( adc_recal_auto = '1' AND adc_recal_dtemp /= 0
+		            AND ( unsigned(device_temp_dd) >= adc_recal_temp + adc_recal_dtemp
+		               OR unsigned(device_temp_dd) + adc_recal_dtemp <= adc_recal_temp ) ) then
+		        adc_recal_cnt <= 1;
+		    end if;
+		else
+		    clearflags <= '1';
+		    if adc_recal_cnt = 1 then
+		        adc_spi_data <= X"00C0" & X"44"; -- configure ADC to send TEST pattern (CHECKERBOARD)
+		        ConfigureADC <= '1';
+		    elsif adc_recal_cnt = 2000 or adc_recal_cnt = 2001 then
+		        read_calib_start <= '1';
+		        read_calib_source <= '0';       -- CH1
+		    elsif adc_recal_cnt = 10000 or adc_recal_cnt = 10001 then
+		        read_calib_start <= '1';
+		        read_calib_source <= '1';       -- CH2
+		    elsif adc_recal_cnt = 18000 then
+		        adc_spi_data <= X"00C0" & X"00"; -- configure ADC to DISABLE TEST pattern
+		        ConfigureADC <= '1';
+		    else
+		        ConfigureADC <= '0';
+		        read_calib_start <= '0';
+		    end if;
+		    if adc_recal_cnt = 20000 then
+		        adc_recal_cnt <= 0;
+		        adc_recal_temp <= unsigned(device_temp_dd);
+		        adc_recal_count <= adc_recal_count + 1;
+		    else
+		        adc_recal_cnt <= adc_recal_cnt + 1;
+		    end if;
+		end if;
 	end if;
 
 end process;
@@ -37,7 +37,9 @@ entity adc_if is
         i_data_2_n : in STD_LOGIC_VECTOR (4 downto 0);
         o_clk : out STD_LOGIC;
         o_data_1 : out STD_LOGIC_VECTOR (9 downto 0);
-        o_data_2 : out STD_LOGIC_VECTOR (9 downto 0)
+        o_data_2 : out STD_LOGIC_VECTOR (9 downto 0);
+        o_eye_width : out STD_LOGIC_VECTOR (59 downto 0);   -- passing taps of each lane (6 bits, data1 lanes 0-4, data2 lanes 5-9)
+        o_eye_center : out STD_LOGIC_VECTOR (49 downto 0)   -- selected tap of each lane (5 bits)
         );
 end adc_if;
 
@@ -58,16 +60,23 @@ signal read_calib_start_d: std_logic := '0';
 signal read_calib_source: std_logic := '0';
 signal cal_src: integer range 0 to 1 := 0;
 
-type cnt_tap_value_mem is array(0 to 1) of integer range 0 to 64;
-signal cnt_tap_value : cnt_tap_value_mem := (0,0);
+-- per lane IDELAY tap (lanes 0-4: data1, 5-9: data2) and eye scan results
+type lane_tap_mem is array(0 to 9) of integer range 0 to 31;
+type lane_cnt_mem is array(0 to 4) of integer range 0 to 127;
+type lane_eye_mem is array(0 to 9) of integer range 0 to 32;
+type lane_run_mem is array(0 to 4) of integer range 0 to 32;
+signal lane_tap : lane_tap_mem := (0 to 4 => ADC_DATA1_DELAY, 5 to 9 => ADC_DATA2_DELAY);
+signal eye_width : lane_eye_mem := (others => 0);
 
+signal scan_tap: integer range 0 to 31 := 0;
 signal cnt_read_data: integer range 0 to 127 := 0;
-signal cnt_read_ok: integer range 0 to 127 := 0;
-signal max_tap_value: integer range 0 to 63 := 0;
-signal min_tap_value: integer range 0 to 63 := 0;
-signal selected_tap_value: integer range 0 to 63 := 0;
-signal min_tap_value_set: std_logic := '0';
-signal load_cnt_tap_value : std_logic := '0';
+signal cnt_read_ok: lane_cnt_mem := (others => 0);
+signal run_start: lane_tap_mem := (others => 0);     -- passing taps in a row
+signal run_len: lane_run_mem := (others => 0);
+signal best_start: lane_tap_mem := (others => 0);    -- widest eye
+signal best_len: lane_run_mem := (others => 0);
+signal scan_done: std_logic := '0';
+signal load_cnt_tap_value : std_logic_vector(1 downto 0) := "00";
 
 signal i_clk_buff : std_logic;
 signal i_data_1_buff : std_logic_vector(4 downto 0);
@@ -124,9 +133,7 @@ attribute mark_debug of i_data_1_delayed : signal is true;
 attribute mark_debug of i_data_2_delayed : signal is true;
 attribute mark_debug of clk_iddr : signal is true; 
 attribute mark_debug of cnt_read_data : signal is true; 
-attribute mark_debug of min_tap_value : signal is true; 
-attribute mark_debug of max_tap_value : signal is true; 
-attribute mark_debug of cnt_tap_value : signal is true; 
+attribute mark_debug of scan_tap : signal is true; 
 attribute mark_debug of load_cnt_tap_value : signal is true; 
 attribute mark_debug of cnt_read_ok : signal is true;
 attribute mark_debug of dlyCalibState : signal is true;
@@ -256,11 +263,11 @@ data_delay: for i in 0 to 4 generate
         C => clk_iddr,
         CE => '0',
         CINVCTRL => '0',
-        CNTVALUEIN => std_logic_vector(to_unsigned(cnt_tap_value(0),5)), -- delay value
+        CNTVALUEIN => std_logic_vector(to_unsigned(lane_tap(i),5)), -- delay value
         DATAIN => '0',
         IDATAIN => i_data_1_buff(i),
         INC => '0',
-        LD => load_cnt_tap_value,   -- Loads delay value CNTVALUEIN
+        LD => load_cnt_tap_value(0),   -- Loads delay value CNTVALUEIN
         LDPIPEEN => '0',
         REGRST => '0'
     );
@@ -281,11 +288,11 @@ data_delay: for i in 0 to 4 generate
         C => clk_iddr,
         CE => '0',
         CINVCTRL => '0',
-        CNTVALUEIN => std_logic_vector(to_unsigned(cnt_tap_value(1),5)),
+        CNTVALUEIN => std_logic_vector(to_unsigned(lane_tap(5+i),5)),
         DATAIN => '0',
         IDATAIN => i_data_2_buff(i),
         INC => '0',
-        LD => '0',
+        LD => load_cnt_tap_value(1),
         LDPIPEEN => '0',
         REGRST => '0'
     );
@@ -424,7 +431,17 @@ begin
     end if;
 end process;
 
+-- eye scan results (static after calibration)
+eye_out: for i in 0 to 9 generate
+    o_eye_width(6*i+5 downto 6*i) <= std_logic_vector(to_unsigned(eye_width(i),6));
+    o_eye_center(5*i+4 downto 5*i) <= std_logic_vector(to_unsigned(lane_tap(i),5));
+end generate;
+
+-- eye scan: all 32 IDELAY taps of the selected channel are checked against checkerboard
+-- test pattern, each lane (DDR pair of bits) is set to the center of its widest passing window
 calibrate_idelay: process(clk_iddr)
+    variable v_data_d : std_logic_vector(9 downto 0);
+    variable v_data_dd : std_logic_vector(9 downto 0);
 begin
     
     if rising_edge(clk_iddr) then
@@ -436,91 +453,95 @@ begin
             
             read_calib_source <= i_read_calib_source;
             
-            -- implement dynamic calibration to find the center of a data eye for dataA/DataB inputs
             case dlyCalibState is
     
             when dly_calib_idle =>
             
                 if read_calib_start_d = '1' then
                     cal_src <= to_integer(unsigned'('0' & read_calib_source));
-                    cnt_tap_value(to_integer(unsigned'('0' & read_calib_source))) <= 0;    -- reset IDELAY tap selection
+                    -- start scan at tap 0 for all lanes of selected channel
+                    for l in 0 to 4 loop
+                        lane_tap(5*to_integer(unsigned'('0' & read_calib_source)) + l) <= 0;
+                    end loop;
+                    load_cnt_tap_value(to_integer(unsigned'('0' & read_calib_source))) <= '1';
                     dlyCalibState <= dly_calib_run;
                 else
+                    load_cnt_tap_value <= "00";
                     dlyCalibState <= dly_calib_idle;
                 end if;
             
-                load_cnt_tap_value <= '0'; 
-                cnt_read_data <= 0;        -- ADC samples read
-                cnt_read_ok <= 0;          -- samples that were correctly read
-                min_tap_value_set <= '0';  -- min tap value set flag
+                scan_tap <= 0;
+                scan_done <= '0';
+                cnt_read_data <= 0;               -- ADC samples read
+                cnt_read_ok <= (others => 0);     -- samples that were correctly read (per lane)
+                run_len <= (others => 0);
+                best_len <= (others => 0);
              
             when dly_calib_run =>
             
-                if cnt_read_data = 33 then
-                    -- if all samples were read correctly for the current tap value
-                    if cnt_read_ok = 32 then
-                        -- save min tap value
-                        if min_tap_value_set = '0' then
-                            min_tap_value_set <= '1';
-                            min_tap_value <= cnt_tap_value(cal_src);
-                            max_tap_value <= cnt_tap_value(cal_src);
-                        -- if min tap value was already saved
-                        else
-                            -- update max tap value
-                            max_tap_value <= cnt_tap_value(cal_src);
+                if scan_done = '1' then
+                    -- set each lane to the center of its eye (keep previous tap if no passing tap was found,
+                    -- e.g. when ADC did not send test data)
+                    for l in 0 to 4 loop
+                        eye_width(5*cal_src + l) <= best_len(l);
+                        if best_len(l) /= 0 then
+                            lane_tap(5*cal_src + l) <= best_start(l) + (best_len(l) - 1)/2;
                         end if;
-                        -- if all taps were checked
-                        if cnt_tap_value(cal_src) = 31 then
-                            cnt_tap_value(cal_src) <= (max_tap_value + min_tap_value)/2;
-                            dlyCalibState <= dly_calib_idle;
+                    end loop;
+                    load_cnt_tap_value(cal_src) <= '1';
+                    dlyCalibState <= dly_calib_idle;
+                elsif cnt_read_data = 33 then
+                    -- lane passes current tap if all samples were read correctly
+                    for l in 0 to 4 loop
+                        if cnt_read_ok(l) >= 32 then
+                            if run_len(l) = 0 then
+                                run_start(l) <= scan_tap;
+                            end if;
+                            run_len(l) <= run_len(l) + 1;
+                            if run_len(l) + 1 > best_len(l) then
+                                best_len(l) <= run_len(l) + 1;
+                                if run_len(l) = 0 then
+                                    best_start(l) <= scan_tap;
+                                else
+                                    best_start(l) <= run_start(l);
+                                end if;
+                            end if;
                         else
-                            cnt_tap_value(cal_src) <= cnt_tap_value(cal_src) + 1; -- increase IDELAY tap value
-                            dlyCalibState <= dly_calib_run;
+                            run_len(l) <= 0;
                         end if;
+                    end loop;
+                    -- next tap
+                    if scan_tap = 31 then
+                        scan_done <= '1';
+                        load_cnt_tap_value <= "00";
                     else
-                    -- not all samples were read properly
-                        -- if min tap value was already set
-                        if min_tap_value_set = '1' then
-                            cnt_tap_value(cal_src) <= (max_tap_value + min_tap_value)/2;
-                            -- end calibration, because we have reached the end of eye
-                            dlyCalibState <= dly_calib_idle;
-                        -- countinue searching for min tap value
-                        else
-                            -- all taps were chcked and min tap value was not found
-                            -- we should never get here (but we could if ADC did not send test data)
-                            if cnt_tap_value(cal_src) = 31 then
-                                cnt_tap_value(cal_src) <= 0;
-                                dlyCalibState <= dly_calib_idle;
-                            -- not all taps were checked
-                            -- continue searching for min tap value
-                            else
-                                cnt_tap_value(cal_src) <= cnt_tap_value(cal_src) + 1; -- increase IDELAY tap value
-                                dlyCalibState <= dly_calib_run;
-                            end if;
-                        end if;
+                        scan_tap <= scan_tap + 1;
+                        for l in 0 to 4 loop
+                            lane_tap(5*cal_src + l) <= scan_tap + 1;
+                        end loop;
+                        load_cnt_tap_value(cal_src) <= '1';
                     end if;
                     -- reset counters
-                    load_cnt_tap_value <= '1';
-                    cnt_read_data <= 0;  -- how many samples were read
-                    cnt_read_ok <= 0;    -- how many samples were read correctly
+                    cnt_read_data <= 0;              -- how many samples were read
+                    cnt_read_ok <= (others => 0);    -- how many samples were read correctly
                 else
-                    load_cnt_tap_value <= '0';
-                    -- read two consecutive samples and check if they were properly read
+                    load_cnt_tap_value <= "00";
+                    -- read two consecutive samples and check if each lane (bits 2l+1, 2l) was properly read
                     tmp_data_1_dd <= tmp_data_1_d;
                     tmp_data_2_dd <= tmp_data_2_d;
                     if read_calib_source = '0' then
-                        if tmp_data_1_dd = "1010101010" and tmp_data_1_d = "0101010101" then
-                            cnt_read_ok <= cnt_read_ok + 1;
-                        elsif tmp_data_1_dd = "0101010101" and tmp_data_1_d = "1010101010" then
-                            cnt_read_ok <= cnt_read_ok + 1;
-                        end if;
+                        v_data_d := tmp_data_1_d;
+                        v_data_dd := tmp_data_1_dd;
                     else
-                        if tmp_data_2_dd = "1010101010" and tmp_data_2_d = "0101010101" then
-                            cnt_read_ok <= cnt_read_ok + 1;
-                        elsif tmp_data_2_dd = "0101010101" and tmp_data_2_d = "1010101010" then
-                            cnt_read_ok <= cnt_read_ok + 1;
+                        v_data_d := tmp_data_2_d;
+                        v_data_dd := tmp_data_2_dd;
+                    end if;
+                    for l in 0 to 4 loop
+                        if ( v_data_dd(2*l+1 downto 2*l) = "10" and v_data_d(2*l+1 downto 2*l) = "01" )
+                           or ( v_data_dd(2*l+1 downto 2*l) = "01" and v_data_d(2*l+1 downto 2*l) = "10" ) then
+                            cnt_read_ok(l) <= cnt_read_ok(l) + 1;
                         end if;
-                    end if;            
+                    end loop;
                     cnt_read_data <= cnt_read_data + 1;
                     dlyCalibState <= dly_calib_run;
                     
@@ -45,6 +45,9 @@ entity awg_core is
             generatorDuty_1    : in  signed(11 downto 0);
             generatorDelta_1   : in  STD_LOGIC_VECTOR(bH-bL downto 0);
             generatorCustomSample_1 : in  STD_LOGIC_VECTOR (11 downto 0);
+            generatorBankMode_1 : in  STD_LOGIC;   -- custom signal RAM is split in two banks (ping-pong)
+            generatorBank_1    : in  STD_LOGIC;    -- requested bank, switched at waveform wrap
+            generatorBankActive_1 : out STD_LOGIC;
             --AWG2
             genSignal_2        : out signed (11 downto 0);
             ram_addrb_awg_2    : out STD_LOGIC_VECTOR (14 downto 0);
@@ -54,6 +57,9 @@ entity awg_core is
             generatorDuty_2    : in  signed(11 downto 0);
             generatorDelta_2   : in  STD_LOGIC_VECTOR(bH-bL downto 0);
             generatorCustomSample_2 : in  STD_LOGIC_VECTOR (11 downto 0);
+            generatorBankMode_2 : in  STD_LOGIC;
+            generatorBank_2    : in  STD_LOGIC;
+            generatorBankActive_2 : out STD_LOGIC;
             --DAC programming signals
             dac_data_1 : out STD_LOGIC_VECTOR (11 downto 0);
             dac_data_2 : out STD_LOGIC_VECTOR (11 downto 0);
@@ -208,6 +214,18 @@ signal enable_rand_1 : std_logic;
 signal enable_rand_2 : std_logic;
 
 signal phase_sync_i : std_logic := '0';
+
+-- custom signal RAM banks (ping-pong): bank is the RAM address MSB, waveform is AWG_MAX_SAMPLES/2 long
+signal ram_addr_1_i : std_logic_vector(bH downto 0) := (others => '0');
+signal ram_addr_2_i : std_logic_vector(bH downto 0) := (others => '0');
+signal ram_addr_1_msb_d : std_logic := '0';
+signal ram_addr_2_msb_d : std_logic := '0';
+signal generatorBankMode_1d : std_logic := '0';
+signal generatorBankMode_2d : std_logic := '0';
+signal generatorBank_1d : std_logic := '0';
+signal generatorBank_2d : std_logic := '0';
+signal awg_bank_1 : std_logic := '0';
+signal awg_bank_2 : std_logic := '0';
 signal phase_val_i : std_logic_vector(bH-bL downto 0) := std_logic_vector(to_unsigned(0,bh-bL+1));
 
 -- set keep attributes for registers
@@ -250,6 +268,10 @@ attribute ASYNC_REG of generatorDuty_2d         : signal is true;
 attribute KEEP of generatorCustomSample_2d : signal is true;
 attribute ASYNC_REG of generatorCustomSample_2d : signal is true;
 attribute KEEP of phase_val_i      : signal is true;
+attribute ASYNC_REG of generatorBankMode_1d : signal is true;
+attribute ASYNC_REG of generatorBankMode_2d : signal is true;
+attribute ASYNC_REG of generatorBank_1d : signal is true;
+attribute ASYNC_REG of generatorBank_2d : signal is true;
 attribute ASYNC_REG of phase_val_i : signal is true;
 
 attribute KEEP of genSignal_1_tmp_d : signal is true;
@@ -339,12 +361,15 @@ begin
 -- clock forward
 dac_clk <= clk_in;
 
+generatorBankActive_1 <= awg_bank_1;
+generatorBankActive_2 <= awg_bank_2;
+
 	--========================================--
 	--       Signal generator process         --
 	--========================================--
 
 awg_core_process: process(clk_in)
-
+    variable v_bank_1, v_bank_2 : std_logic;
 begin
 	if (rising_edge(clk_in)) then
 	
@@ -403,13 +428,13 @@ begin
 						---genSignal_tmp <= signed(awg_doutB(11 downto 0));
 						-- increment RAM address according to angle generator output
 						if q_gen_1(0) = '0' then
-							ram_addrb_awg_1 <= std_logic_vector(kot_gen_1(bH downto 0));
+							ram_addr_1_i <= std_logic_vector(kot_gen_1(bH downto 0));
 						elsif q_gen_1 = "01" then
-							ram_addrb_awg_1 <= std_logic_vector(to_signed(2**bH,bH)+signed(kot_gen_1(bH downto 0)));
+							ram_addr_1_i <= std_logic_vector(to_signed(2**bH,bH)+signed(kot_gen_1(bH downto 0)));
 						elsif q_gen_1 = "10" then
-							ram_addrb_awg_1 <= std_logic_vector(kot_gen_1(bH downto 0));
+							ram_addr_1_i <= std_logic_vector(kot_gen_1(bH downto 0));
 						else
-							ram_addrb_awg_1 <= std_logic_vector(to_signed(2**bH,bH)+signed(kot_gen_1(bH downto 0)));
+							ram_addr_1_i <= std_logic_vector(to_signed(2**bH,bH)+signed(kot_gen_1(bH downto 0)));
 						end if;
 						enable_rand_1 <= '0';
 						
@@ -592,13 +617,13 @@ begin
 						---genSignal_tmp <= signed(awg_doutB(11 downto 0));
 						-- increment RAM address according to angle generator output
 						if q_gen_2 = "00" then
-							ram_addrb_awg_2 <= std_logic_vector(kot_gen_2(bH downto 0));
+							ram_addr_2_i <= std_logic_vector(kot_gen_2(bH downto 0));
 						elsif q_gen_2 = "01" then
-							ram_addrb_awg_2 <= std_logic_vector(to_signed(2**bH,bH)+signed(kot_gen_2(bH downto 0)));
+							ram_addr_2_i <= std_logic_vector(to_signed(2**bH,bH)+signed(kot_gen_2(bH downto 0)));
 						elsif q_gen_2 = "10" then
-							ram_addrb_awg_2 <= std_logic_vector(kot_gen_2(bH downto 0));
+							ram_addr_2_i <= std_logic_vector(kot_gen_2(bH downto 0));
 						else
-							ram_addrb_awg_2 <= std_logic_vector(to_signed(2**bH,bH)+signed(kot_gen_2(bH downto 0)));
+							ram_addr_2_i <= std_logic_vector(to_signed(2**bH,bH)+signed(kot_gen_2(bH downto 0)));
 						end if;
 						enable_rand_2 <= '0';
 						
@@ -740,6 +765,41 @@ begin
 --            dac_data_2_test <= std_logic_vector(unsigned(dac_data_1_test) + 1);
 --            dac_data_2 <= not(dac_data_2_test);
 		end if;
+
+		--===========================================
+		-- Custom Signal RAM banks (ping-pong)
+		--===========================================
+		-- requested bank is taken over when RAM address wraps around (end of waveform),
+		-- so new waveform starts phase-coherently; when custom signal is not running, immediately
+		generatorBankMode_1d <= generatorBankMode_1;
+		generatorBank_1d <= generatorBank_1;
+		ram_addr_1_msb_d <= ram_addr_1_i(bH);
+		v_bank_1 := awg_bank_1;
+		if generator1On_d = '0' or unsigned(generatorType_1d) /= 0 or generatorBankMode_1d = '0' or
+		   ( ram_addr_1_msb_d = '1' and ram_addr_1_i(bH) = '0' ) then
+		    v_bank_1 := generatorBank_1d;
+		end if;
+		awg_bank_1 <= v_bank_1;
+		if generatorBankMode_1d = '1' then
+		    ram_addrb_awg_1 <= v_bank_1 & ram_addr_1_i(bH downto 1);
+		else
+		    ram_addrb_awg_1 <= ram_addr_1_i;
+		end if;
+
+		generatorBankMode_2d <= generatorBankMode_2;
+		generatorBank_2d <= generatorBank_2;
+		ram_addr_2_msb_d <= ram_addr_2_i(bH);
+		v_bank_2 := awg_bank_2;
+		if generator2On_d = '0' or unsigned(generatorType_2d) /= 0 or generatorBankMode_2d = '0' or
+		   ( ram_addr_2_msb_d = '1' and ram_addr_2_i(bH) = '0' ) then
+		    v_bank_2 := generatorBank_2d;
+		end if;
+		awg_bank_2 <= v_bank_2;
+		if generatorBankMode_2d = '1' then
+		    ram_addrb_awg_2 <= v_bank_2 & ram_addr_2_i(bH downto 1);
+		else
+		    ram_addrb_awg_2 <= ram_addr_2_i;
+		end if;
 	end if;
 	
 end process;
@@ -49,6 +49,9 @@ architecture Behavioral of awg_core_tb is
         generatorDuty_1 : in  signed(11 downto 0);
         generatorDelta_1 : in  STD_LOGIC_VECTOR(bH-bL downto 0);
         generatorCustomSample_1 : in  STD_LOGIC_VECTOR (11 downto 0);
+        generatorBankMode_1 : in  STD_LOGIC;
+        generatorBank_1 : in  STD_LOGIC;
+        generatorBankActive_1 : out STD_LOGIC;
         --AWG2
         genSignal_2     : out signed (11 downto 0);
         ram_addrb_awg_2 : out STD_LOGIC_VECTOR (14 downto 0);
@@ -58,6 +61,9 @@ architecture Behavioral of awg_core_tb is
         generatorDuty_2 : in  signed(11 downto 0);
         generatorDelta_2 : in  STD_LOGIC_VECTOR(bH-bL downto 0);
         generatorCustomSample_2 : in  STD_LOGIC_VECTOR (11 downto 0);
+        generatorBankMode_2 : in  STD_LOGIC;
+        generatorBank_2 : in  STD_LOGIC;
+        generatorBankActive_2 : out STD_LOGIC;
         --DAC programming signals
         dac_data_1 : out STD_LOGIC_VECTOR (11 downto 0);
         dac_data_2 : out STD_LOGIC_VECTOR (11 downto 0);
@@ -94,6 +100,9 @@ architecture Behavioral of awg_core_tb is
     signal generatorDuty_1          : signed(11 downto 0):="000000000000";
     signal generatorDelta_1         : STD_LOGIC_VECTOR(bH-bL downto 0):=std_logic_vector(to_unsigned(0,bH-bL+1));
     signal generatorCustomSample_1  : STD_LOGIC_VECTOR (11 downto 0):="000000000000";
+    signal generatorBankMode_1      : STD_LOGIC := '0';
+    signal generatorBank_1          : STD_LOGIC := '0';
+    signal generatorBankActive_1    : STD_LOGIC;
     --AWG2
     signal genSignal_2              : signed (11 downto 0);
     signal ram_addrb_awg_2          : STD_LOGIC_VECTOR (14 downto 0);
@@ -103,6 +112,9 @@ architecture Behavioral of awg_core_tb is
     signal generatorDuty_2          : signed(11 downto 0):="000000000000";
     signal generatorDelta_2         : STD_LOGIC_VECTOR(bH-bL downto 0):=std_logic_vector(to_unsigned(0,bH-bL+1));
     signal generatorCustomSample_2  : STD_LOGIC_VECTOR (11 downto 0):="000000000000";
+    signal generatorBankMode_2      : STD_LOGIC := '0';
+    signal generatorBank_2          : STD_LOGIC := '0';
+    signal generatorBankActive_2    : STD_LOGIC;
     --DAC programming signals
     signal dac_data_1               : STD_LOGIC_VECTOR (11 downto 0);
     signal dac_data_2               : STD_LOGIC_VECTOR (11 downto 0);
@@ -138,6 +150,9 @@ begin
         generatorDuty_1         =>  generatorDuty_1,
         generatorDelta_1        =>  generatorDelta_1,
         generatorCustomSample_1 =>  generatorCustomSample_1,
+        generatorBankMode_1     =>  generatorBankMode_1,
+        generatorBank_1         =>  generatorBank_1,
+        generatorBankActive_1   =>  generatorBankActive_1,
         genSignal_2             =>  genSignal_2,
         ram_addrb_awg_2         =>  ram_addrb_awg_2,
         generatorType_2         =>  generatorType_2,
@@ -146,6 +161,9 @@ begin
         generatorDuty_2         =>  generatorDuty_2,
         generatorDelta_2        =>  generatorDelta_2,
         generatorCustomSample_2 =>  generatorCustomSample_2,
+        generatorBankMode_2     =>  generatorBankMode_2,
+        generatorBank_2         =>  generatorBank_2,
+        generatorBankActive_2   =>  generatorBankActive_2,
         dac_data_1              =>  dac_data_1,
         dac_data_2              =>  dac_data_2,
         dac_clk                 =>  dac_clk          
@@ -0,0 +1,404 @@
+----------------------------------------------------------------------------------
+--    Copyright (C) 2019 Dejan Priversek
+--
+--    This program is free software: you can redistribute it and/or modify
+--    it under the terms of the GNU General Public License as published by
+--    the Free Software Foundation, either version 3 of the License, or
+--    (at your option) any later version.
+--
+--    This program is distributed in the hope that it will be useful,
+--    but WITHOUT ANY WARRANTY; without even the implied warranty of
+--    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+--    GNU General Public License for more details.
+--
+--    You should have received a copy of the GNU General Public License
+--    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+----------------------------------------------------------------------------------
+
+--
+-- Scopefun firmware: AWG sample streaming from DDR3
+--
+-- Upload: dwords (2 samples, first in bits 27..16) are written to upload fifo (clk_up),
+-- packed into RAM words (8 samples, first sample in MSBs) and written to AWG region of RAM (clk).
+-- Entry written with UpAddrWrite sets RAM word index of the following data.
+-- Playback: RAM words from PlayStart to PlayStart+PlayLength-1 (optionally looped) are prefetched
+-- into playback fifo and sent out one sample every ClkDivide+1 clocks of clk_out.
+-- RAM requests are served by DDR3 controller arbiter (Req is held until Ack pulse).
+--
+
+library IEEE;
+use IEEE.STD_LOGIC_1164.ALL;
+use IEEE.NUMERIC_STD.ALL;
+
+Library UNISIM;
+use UNISIM.vcomponents.all;
+
+Library UNIMACRO;
+use UNIMACRO.vcomponents.all;
+
+entity awg_stream is
+    Port (
+        -- upload (clk_up)
+        clk_up : in std_logic;
+        UpWrite : in std_logic;                         -- write sample pair
+        UpAddrWrite : in std_logic;                     -- start upload at RAM word UpData(22..0)
+        UpData : in std_logic_vector(31 downto 0);
+        UpAlmostFull : out std_logic;                   -- less than one FX3 DMA buffer of free space
+        -- DDR3 controller (clk)
+        clk : in std_logic;
+        WrReq : out std_logic;
+        WrAddr : out std_logic_vector(22 downto 0);    -- RAM word index in AWG region
+        WrData : out std_logic_vector(127 downto 0);
+        WrAck : in std_logic;
+        RdReq : out std_logic;
+        RdAddr : out std_logic_vector(22 downto 0);
+        RdAck : in std_logic;
+        RdData : in std_logic_vector(127 downto 0);
+        RdDataValid : in std_logic;
+        PlayEnable : in std_logic;
+        PlayLoop : in std_logic;                        -- restart at PlayStart after last word
+        PlayStart : in std_logic_vector(22 downto 0);   -- first RAM word
+        PlayLength : in std_logic_vector(22 downto 0);  -- number of RAM words
+        -- sample output (clk_out)
+        clk_out : in std_logic;
+        ClkDivide : in std_logic_vector(15 downto 0);
+        Sample : out std_logic_vector(11 downto 0);
+        Underrun : out std_logic;                       -- playback fifo was empty when sample was due
+        Playing : out std_logic
+    );
+end awg_stream;
+
+architecture Behavioral of awg_stream is
+
+CONSTANT RD_MAX_PENDING : integer := 32;    -- read commands waiting for data
+
+-- upload fifo
+signal up_di : std_logic_vector(32 downto 0);
+signal up_do : std_logic_vector(32 downto 0);
+signal up_wren : std_logic;
+signal up_rden : std_logic;
+signal up_empty : std_logic;
+signal up_rst : std_logic := '0';
+signal up_rst_cnt : integer range 0 to 31 := 0;
+signal up_ready : std_logic := '0';
+signal up_ready_d : std_logic := '0';
+signal up_ready_dd : std_logic := '0';
+signal up_word : std_logic_vector(127 downto 0);
+signal up_lane : integer range 0 to 3 := 0;
+signal up_idx : unsigned(22 downto 0) := (others => '0');
+signal wr_pending : std_logic := '0';
+
+-- playback fifo (two 64-bit fifos written in parallel)
+signal pl_rst : std_logic := '0';
+signal pl_rst_cnt : integer range 0 to 63 := 0;
+signal pl_ready : std_logic := '0';
+signal pl_ready_d : std_logic := '0';
+signal pl_ready_dd : std_logic := '0';
+signal pl_wren : std_logic;
+signal pl_rden : std_logic;
+signal pl_do_1 : std_logic_vector(63 downto 0);
+signal pl_do_2 : std_logic_vector(63 downto 0);
+signal pl_empty_1 : std_logic;
+signal pl_empty_2 : std_logic;
+signal pl_afull : std_logic;
+signal pl_afull_2 : std_logic;
+
+signal play_en_d : std_logic := '0';
+signal play_en_dd : std_logic := '0';
+signal play_en_ddd : std_logic := '0';
+signal play_active : std_logic := '0';
+signal play_start_req : std_logic := '0';
+signal play_loop_i : std_logic := '0';
+signal play_start_i : unsigned(22 downto 0);
+signal play_length_i : unsigned(22 downto 0);
+signal rd_idx : unsigned(22 downto 0) := (others => '0');
+signal rd_left : unsigned(22 downto 0) := (others => '0');
+signal rd_pending : integer range 0 to RD_MAX_PENDING := 0;
+
+-- sample output
+signal out_en_d : std_logic := '0';
+signal out_en_dd : std_logic := '0';
+signal out_primed : std_logic := '0';
+signal out_lane : integer range 0 to 7 := 0;
+signal out_div_cnt : unsigned(15 downto 0) := (others => '0');
+signal out_word : std_logic_vector(127 downto 0);
+signal underrun_i : std_logic := '0';
+
+attribute ASYNC_REG: boolean;
+attribute ASYNC_REG of up_ready_d: signal is true;
+attribute ASYNC_REG of up_ready_dd: signal is true;
+attribute ASYNC_REG of pl_ready_d: signal is true;
+attribute ASYNC_REG of pl_ready_dd: signal is true;
+attribute ASYNC_REG of play_en_d: signal is true;
+attribute ASYNC_REG of play_en_dd: signal is true;
+attribute ASYNC_REG of out_en_d: signal is true;
+attribute ASYNC_REG of out_en_dd: signal is true;
+
+attribute mark_debug: boolean;
+attribute mark_debug of rd_pending : signal is true;
+attribute mark_debug of underrun_i : signal is true;
+
+begin
+
+   -----------------------------------------------------------------
+   -- DATA_WIDTH | FIFO_SIZE | FIFO Depth | RDCOUNT/WRCOUNT Width --
+   -- ===========|===========|============|=======================--
+   --   37-72    |  "36Kb"   |     512    |         9-bit         -- <-- playback fifo
+   --   19-36    |  "18Kb"   |     512    |         9-bit         -- <-- upload fifo
+   -----------------------------------------------------------------
+
+UP_FIFO: FIFO_DUALCLOCK_MACRO
+   generic map (
+      DEVICE => "7SERIES",
+      ALMOST_FULL_OFFSET => X"0110",  -- one DMA buffer (256 dwords) + margin
+      ALMOST_EMPTY_OFFSET => X"0006",
+      DATA_WIDTH => 33,
+      FIFO_SIZE => "18Kb",
+      FIRST_WORD_FALL_THROUGH => TRUE)
+   port map (
+      ALMOSTEMPTY => open,
+      ALMOSTFULL => UpAlmostFull,
+      DO => up_do,
+      EMPTY => up_empty,
+      FULL => open,
+      RDCOUNT => open,
+      RDERR => open,
+      WRCOUNT => open,
+      WRERR => open,
+      DI => up_di,
+      RDCLK => clk,
+      RDEN => up_rden,
+      RST => up_rst,
+      WRCLK => clk_up,
+      WREN => up_wren
+   );
+
+PLAY_FIFO_1: FIFO_DUALCLOCK_MACRO
+   generic map (
+      DEVICE => "7SERIES",
+      ALMOST_FULL_OFFSET => X"0030",  -- keep space for pending read commands
+      ALMOST_EMPTY_OFFSET => X"0006",
+      DATA_WIDTH => 64,
+      FIFO_SIZE => "36Kb",
+      FIRST_WORD_FALL_THROUGH => TRUE)
+   port map (
+      ALMOSTEMPTY => open,
+      ALMOSTFULL => pl_afull,
+      DO => pl_do_1,
+      EMPTY => pl_empty_1,
+      FULL => open,
+      RDCOUNT => open,
+      RDERR => open,
+      WRCOUNT => open,
+      WRERR => open,
+      DI => RdData(127 downto 64),
+      RDCLK => clk_out,
+      RDEN => pl_rden,
+      RST => pl_rst,
+      WRCLK => clk,
+      WREN => pl_wren
+   );
+
+PLAY_FIFO_2: FIFO_DUALCLOCK_MACRO
+   generic map (
+      DEVICE => "7SERIES",
+      ALMOST_FULL_OFFSET => X"0030",
+      ALMOST_EMPTY_OFFSET => X"0006",
+      DATA_WIDTH => 64,
+      FIFO_SIZE => "36Kb",
+      FIRST_WORD_FALL_THROUGH => TRUE)
+   port map (
+      ALMOSTEMPTY => open,
+      ALMOSTFULL => pl_afull_2,
+      DO => pl_do_2,
+      EMPTY => pl_empty_2,
+      FULL => open,
+      RDCOUNT => open,
+      RDERR => open,
+      WRCOUNT => open,
+      WRERR => open,
+      DI => RdData(63 downto 0),
+      RDCLK => clk_out,
+      RDEN => pl_rden,
+      RST => pl_rst,
+      WRCLK => clk,
+      WREN => pl_wren
+   );
+
+up_di <= UpAddrWrite & UpData;
+up_wren <= (UpWrite or UpAddrWrite) and up_ready;
+-- next entry is taken unless assembled RAM word can not be moved to write request
+up_rden <= '1' when up_empty = '0' and up_ready_dd = '1' and not(up_lane = 3 and wr_pending = '1' and up_do(32) = '0') else '0';
+
+WrReq <= wr_pending;
+
+-- data of read commands issued after playback was stopped is discarded
+pl_wren <= RdDataValid and play_active and pl_ready;
+RdReq <= '1' when play_active = '1' and pl_ready = '1' and pl_afull = '0' and pl_afull_2 = '0'
+              and rd_pending < RD_MAX_PENDING and rd_left /= 0 else '0';
+RdAddr <= std_logic_vector(rd_idx);
+
+out_word <= pl_do_1 & pl_do_2;
+pl_rden <= '1' when out_en_dd = '1' and pl_ready_dd = '1' and out_div_cnt = 0 and out_lane = 7
+                    and pl_empty_1 = '0' and pl_empty_2 = '0' else '0';
+Underrun <= underrun_i;
+Playing <= out_primed;
+
+-- upload fifo reset (after configuration)
+-- RST must be held high for at least five WRCLK/RDCLK clock cycles, WREN/RDEN must be low
+up_rst_proc: process (clk_up)
+begin
+    if rising_edge(clk_up) then
+        if up_ready = '0' then
+            if up_rst_cnt = 31 then
+                up_ready <= '1';
+            else
+                up_rst_cnt <= up_rst_cnt + 1;
+            end if;
+            if up_rst_cnt >= 2 and up_rst_cnt < 18 then
+                up_rst <= '1';
+            else
+                up_rst <= '0';
+            end if;
+        end if;
+    end if;
+end process;
+
+ram_proc: process (clk)
+begin
+    if rising_edge(clk) then
+
+        up_ready_d <= up_ready;
+        up_ready_dd <= up_ready_d;
+
+        --------------
+        --  UPLOAD  --
+        --------------
+        if WrAck = '1' then
+            wr_pending <= '0';
+        end if;
+        if up_rden = '1' then
+            if up_do(32) = '1' then
+                -- new upload: RAM word index
+                up_idx <= unsigned(up_do(22 downto 0));
+                up_lane <= 0;
+            else
+                up_word(127-32*up_lane downto 96-32*up_lane) <= up_do(31 downto 0);
+                if up_lane = 3 then
+                    WrData <= up_word(127 downto 32) & up_do(31 downto 0);
+                    WrAddr <= std_logic_vector(up_idx);
+                    wr_pending <= '1';
+                    up_idx <= up_idx + 1;
+                    up_lane <= 0;
+                else
+                    up_lane <= up_lane + 1;
+                end if;
+            end if;
+        end if;
+
+        ----------------
+        --  PLAYBACK  --
+        ----------------
+        play_en_d <= PlayEnable;
+        play_en_dd <= play_en_d;
+        play_en_ddd <= play_en_dd;
+        if play_en_ddd = '0' and play_en_dd = '1' then
+            play_start_req <= '1';
+            play_active <= '0';
+        elsif play_en_dd = '0' then
+            play_start_req <= '0';
+            play_active <= '0';
+            pl_ready <= '0';
+            pl_rst <= '0';
+            pl_rst_cnt <= 0;
+        end if;
+
+        -- count read commands waiting for data
+        if RdAck = '1' and RdDataValid = '0' then
+            rd_pending <= rd_pending + 1;
+        elsif RdAck = '0' and RdDataValid = '1' and rd_pending /= 0 then
+            rd_pending <= rd_pending - 1;
+        end if;
+
+        -- start: wait until data of previous playback was received, then reset playback fifo
+        if play_start_req = '1' and play_en_dd = '1' and rd_pending = 0 then
+            if pl_rst_cnt = 63 then
+                pl_rst_cnt <= 0;
+                pl_rst <= '0';
+                pl_ready <= '1';
+                play_start_req <= '0';
+                play_active <= '1';
+                play_loop_i <= PlayLoop;
+                play_start_i <= unsigned(PlayStart);
+                play_length_i <= unsigned(PlayLength);
+                rd_idx <= unsigned(PlayStart);
+                rd_left <= unsigned(PlayLength);
+            else
+                pl_rst_cnt <= pl_rst_cnt + 1;
+                pl_ready <= '0';
+                if pl_rst_cnt >= 4 and pl_rst_cnt < 36 then
+                    pl_rst <= '1';
+                else
+                    pl_rst <= '0';
+                end if;
+            end if;
+        end if;
+
+        -- read command accepted: next RAM word
+        if RdAck = '1' and play_active = '1' then
+            if rd_left = 1 and play_loop_i = '1' then
+                rd_idx <= play_start_i;
+                rd_left <= play_length_i;
+            else
+                rd_idx <= rd_idx + 1;
+                rd_left <= rd_left - 1;
+            end if;
+        end if;
+
+    end if;
+end process;
+
+out_proc: process (clk_out)
+begin
+    if rising_edge(clk_out) then
+
+        out_en_d <= play_active;
+        out_en_dd <= out_en_d;
+        pl_ready_d <= pl_ready;
+        pl_ready_dd <= pl_ready_d;
+
+        if out_en_dd = '0' or pl_ready_dd = '0' then
+            out_primed <= '0';
+            out_lane <= 0;
+            out_div_cnt <= (others => '0');
+        elsif out_primed = '0' then
+            -- start when first RAM word was prefetched
+            if pl_empty_1 = '0' and pl_empty_2 = '0' then
+                out_primed <= '1';
+                underrun_i <= '0';
+            end if;
+        else
+            if out_div_cnt = unsigned(ClkDivide) then
+                out_div_cnt <= (others => '0');
+            else
+                out_div_cnt <= out_div_cnt + 1;
+            end if;
+            if out_div_cnt = 0 then
+                if pl_empty_1 = '0' and pl_empty_2 = '0' then
+                    Sample <= out_word(16*(7-out_lane)+11 downto 16*(7-out_lane));
+                    if out_lane = 7 then
+                        out_lane <= 0;
+                    else
+                        out_lane <= out_lane + 1;
+                    end if;
+                else
+                    -- RAM could not keep up: hold last sample
+                    underrun_i <= '1';
+                end if;
+            end if;
+        end if;
+
+    end if;
+end process;
+
+end Behavioral;
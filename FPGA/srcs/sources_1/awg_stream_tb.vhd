@@ -0,0 +1,258 @@
+----------------------------------------------------------------------------------
+--    Copyright (C) 2019 Dejan Priversek
+--
+--    This program is free software: you can redistribute it and/or modify
+--    it under the terms of the GNU General Public License as published by
+--    the Free Software Foundation, either version 3 of the License, or
+--    (at your option) any later version.
+--
+--    This program is distributed in the hope that it will be useful,
+--    but WITHOUT ANY WARRANTY; without even the implied warranty of
+--    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+--    GNU General Public License for more details.
+--
+--    You should have received a copy of the GNU General Public License
+--    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+----------------------------------------------------------------------------------
+
+--
+-- AWG streaming testbench
+-- a ramp is uploaded to RAM model (with read latency) and played in loop,
+-- output samples are compared to the ramp, underrun must not occur
+-- RAM model acknowledges writes after WR_STALL clk, so upload is throttled by
+-- wr_pending; upload is split in two segments and second start address entry
+-- is taken while previous RAM word is still pending, RAM content is compared
+-- to the ramp before playback
+--
+
+LIBRARY IEEE;
+USE IEEE.STD_LOGIC_1164.ALL;
+USE IEEE.NUMERIC_STD.ALL;
+
+library user_lib;
+use user_lib.TextUtil.all;
+
+ENTITY awg_stream_tb IS
+END awg_stream_tb;
+
+ARCHITECTURE behavior OF awg_stream_tb IS
+
+    -- Component Declaration for the Unit Under Test (UUT)
+
+    component awg_stream is
+    Port (
+        clk_up : in std_logic;
+        UpWrite : in std_logic;
+        UpAddrWrite : in std_logic;
+        UpData : in std_logic_vector(31 downto 0);
+        UpAlmostFull : out std_logic;
+        clk : in std_logic;
+        WrReq : out std_logic;
+        WrAddr : out std_logic_vector(22 downto 0);
+        WrData : out std_logic_vector(127 downto 0);
+        WrAck : in std_logic;
+        RdReq : out std_logic;
+        RdAddr : out std_logic_vector(22 downto 0);
+        RdAck : in std_logic;
+        RdData : in std_logic_vector(127 downto 0);
+        RdDataValid : in std_logic;
+        PlayEnable : in std_logic;
+        PlayLoop : in std_logic;
+        PlayStart : in std_logic_vector(22 downto 0);
+        PlayLength : in std_logic_vector(22 downto 0);
+        clk_out : in std_logic;
+        ClkDivide : in std_logic_vector(15 downto 0);
+        Sample : out std_logic_vector(11 downto 0);
+        Underrun : out std_logic;
+        Playing : out std_logic
+    );
+    end component;
+
+    --constants
+    CONSTANT START_WORD : integer := 2;     -- first RAM word of ramp
+    CONSTANT N_WORDS : integer := 4;        -- ramp length (RAM words, 8 samples each)
+    CONSTANT N_CHECK : integer := 200;      -- number of compared output samples
+    CONSTANT RD_LATENCY : integer := 12;    -- RAM model read latency (clk)
+    CONSTANT WR_STALL : integer := 20;      -- RAM model write acknowledge delay (clk)
+
+    --Inputs
+    signal clk : std_logic := '0';
+    signal clk_out : std_logic := '0';
+    signal UpWrite : std_logic := '0';
+    signal UpAddrWrite : std_logic := '0';
+    signal UpData : std_logic_vector(31 downto 0) := (others => '0');
+    signal WrAck : std_logic := '0';
+    signal RdAck : std_logic := '0';
+    signal RdData : std_logic_vector(127 downto 0) := (others => '0');
+    signal RdDataValid : std_logic := '0';
+    signal PlayEnable : std_logic := '0';
+
+    --Outputs
+    signal UpAlmostFull : std_logic;
+    signal WrReq : std_logic;
+    signal WrAddr : std_logic_vector(22 downto 0);
+    signal WrData : std_logic_vector(127 downto 0);
+    signal RdReq : std_logic;
+    signal RdAddr : std_logic_vector(22 downto 0);
+    signal Sample : std_logic_vector(11 downto 0);
+    signal Underrun : std_logic;
+    signal Playing : std_logic;
+
+    -- RAM model
+    type ram_array is array(0 to 15) of std_logic_vector(127 downto 0);
+    signal ram : ram_array := (others => (others => '0'));
+    type rd_pipe_array is array(1 to RD_LATENCY) of std_logic_vector(128 downto 0);
+    signal rd_pipe : rd_pipe_array := (others => (others => '0'));
+    signal wr_wait : integer := 0;
+
+    signal last_sample : std_logic_vector(11 downto 0) := (others => '1');
+    signal checked : integer := 0;
+    signal chk_errors : integer := 0;
+
+    signal sim_done : boolean := false;
+
+    -- Clock period definitions
+    constant clk_period : time := 10 ns;
+    constant clk_out_period : time := 8 ns;
+
+BEGIN
+
+    -- Instantiate the Unit Under Test (UUT)
+    uut: awg_stream
+    PORT MAP (
+        clk_up => clk,
+        UpWrite => UpWrite,
+        UpAddrWrite => UpAddrWrite,
+        UpData => UpData,
+        UpAlmostFull => UpAlmostFull,
+        clk => clk,
+        WrReq => WrReq,
+        WrAddr => WrAddr,
+        WrData => WrData,
+        WrAck => WrAck,
+        RdReq => RdReq,
+        RdAddr => RdAddr,
+        RdAck => RdAck,
+        RdData => RdData,
+        RdDataValid => RdDataValid,
+        PlayEnable => PlayEnable,
+        PlayLoop => '1',
+        PlayStart => std_logic_vector(to_unsigned(START_WORD,23)),
+        PlayLength => std_logic_vector(to_unsigned(N_WORDS,23)),
+        clk_out => clk_out,
+        ClkDivide => X"0001",
+        Sample => Sample,
+        Underrun => Underrun,
+        Playing => Playing
+    );
+
+    -- Clock process definitions
+    clk_process :process
+    begin
+        if sim_done then
+            wait;
+        end if;
+        clk <= '0';
+        wait for clk_period/2;
+        clk <= '1';
+        wait for clk_period/2;
+    end process;
+
+    clk_out_process :process
+    begin
+        if sim_done then
+            wait;
+        end if;
+        clk_out <= '0';
+        wait for clk_out_period/2;
+        clk_out <= '1';
+        wait for clk_out_period/2;
+    end process;
+
+    -- RAM model: one request per clk (write first), Ack pulse when request is accepted,
+    -- write request is accepted WR_STALL clk after it is raised
+    ram_proc: process(clk)
+    begin
+        if rising_edge(clk) then
+            WrAck <= '0';
+            RdAck <= '0';
+            rd_pipe(2 to RD_LATENCY) <= rd_pipe(1 to RD_LATENCY-1);
+            rd_pipe(1) <= (others => '0');
+            if WrReq = '1' and WrAck = '0' and wr_wait < WR_STALL then
+                wr_wait <= wr_wait + 1;
+            end if;
+            if WrReq = '1' and WrAck = '0' and wr_wait = WR_STALL then
+                ram(to_integer(unsigned(WrAddr))) <= WrData;
+                WrAck <= '1';
+                wr_wait <= 0;
+            elsif RdReq = '1' and RdAck = '0' then
+                rd_pipe(1) <= '1' & ram(to_integer(unsigned(RdAddr)));
+                RdAck <= '1';
+            end if;
+            RdDataValid <= rd_pipe(RD_LATENCY)(128);
+            RdData <= rd_pipe(RD_LATENCY)(127 downto 0);
+        end if;
+    end process;
+
+    -- Stimulus process
+    stim_proc: process
+        variable errors : integer := 0;
+        variable word : std_logic_vector(127 downto 0);
+    begin
+        -- wait for upload fifo reset
+        wait for 1 us;
+        wait until rising_edge(clk);
+        -- ramp: two samples per dword, second segment start address follows
+        -- last dword of first segment while that RAM word waits for WrAck
+        for s in 0 to 1 loop
+            UpAddrWrite <= '1';
+            UpData <= std_logic_vector(to_unsigned(START_WORD + s*N_WORDS/2,32));
+            wait until rising_edge(clk);
+            UpAddrWrite <= '0';
+            for i in s*N_WORDS*2 to (s+1)*N_WORDS*2-1 loop
+                UpWrite <= '1';
+                UpData <= "0000" & std_logic_vector(to_unsigned(2*i,12)) & "0000" & std_logic_vector(to_unsigned(2*i+1,12));
+                wait until rising_edge(clk);
+            end loop;
+            UpWrite <= '0';
+        end loop;
+        wait for 2 us;
+        for w in 0 to N_WORDS-1 loop
+            for l in 0 to 3 loop
+                word(127-32*l downto 96-32*l) := "0000" & std_logic_vector(to_unsigned(8*w+2*l,12)) &
+                                                 "0000" & std_logic_vector(to_unsigned(8*w+2*l+1,12));
+            end loop;
+            Check(ram(START_WORD+w) = word, "RAM word " & integer'image(START_WORD+w) & " mismatch", errors);
+        end loop;
+        Check(unsigned(ram(START_WORD+N_WORDS)) = 0, "RAM word written past upload end", errors);
+        PlayEnable <= '1';
+        wait until checked = N_CHECK;
+        Check(Underrun = '0', "sample output underrun", errors);
+        wait until rising_edge(clk);
+        EndTest("AWG streaming", errors + chk_errors, sim_done);
+        wait;
+    end process;
+
+    -- every new sample must be the next ramp value (consecutive samples always differ)
+    check_proc: process(clk_out)
+        variable expected : integer;
+    begin
+        if rising_edge(clk_out) then
+            if Playing = '1' and not(is_X(Sample)) and Sample /= last_sample then
+                last_sample <= Sample;
+                if last_sample = X"FFF" then
+                    expected := 0;
+                else
+                    expected := (to_integer(unsigned(last_sample)) + 1) mod (N_WORDS*8);
+                end if;
+                if to_integer(unsigned(Sample)) /= expected then
+                    Print("sample " & integer'image(checked) & ": " & integer'image(to_integer(unsigned(Sample))) &
+                          ", expected " & integer'image(expected));
+                    chk_errors <= chk_errors + 1;
+                end if;
+                checked <= checked + 1;
+            end if;
+        end if;
+    end process;
+
+END;
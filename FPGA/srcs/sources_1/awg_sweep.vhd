@@ -0,0 +1,271 @@
+----------------------------------------------------------------------------------
+--    Copyright (C) 2019 Dejan Priversek
+--
+--    This program is free software: you can redistribute it and/or modify
+--    it under the terms of the GNU General Public License as published by
+--    the Free Software Foundation, either version 3 of the License, or
+--    (at your option) any later version.
+--
+--    This program is distributed in the hope that it will be useful,
+--    but WITHOUT ANY WARRANTY; without even the implied warranty of
+--    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+--    GNU General Public License for more details.
+--
+--    You should have received a copy of the GNU General Public License
+--    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+----------------------------------------------------------------------------------
+
+--
+-- Scopefun firmware: AWG frequency sweep and modulation
+--
+-- Placed in front of awg_core generator inputs (delta and amplitude), runs on AWG clock.
+-- Sweep: generator delta steps from SweepStart to SweepStop every SweepDwell clocks,
+--   linear (delta + SweepStep) or logarithmic (delta * (1 + SweepStep/2^24)), sweep starts
+--   when SweepMode is changed from "00" and is repeated or held at SweepStop.
+-- Modulation by internal triangle (ModRate phase increment per clk) or by ModSample:
+--   AM: amplitude * (1 + ModDepth/2^16 * m), gain is limited to 0 to 2
+--   FM: delta + ModDepth * 2048 * m
+--   PM: phase + ModDepth/2^20 * pi * m (applied through delta, so phase stays continuous)
+--   where m is modulating signal (-1 to 1)
+-- Only delta changes (phase accumulator is never reloaded), so all updates are phase-continuous.
+-- Config inputs come from other clock domain: they are taken when CfgTgl toggles (inputs are
+-- stable then, CfgTgl is toggled after config is written).
+--
+
+library IEEE;
+use IEEE.STD_LOGIC_1164.ALL;
+use IEEE.NUMERIC_STD.ALL;
+library IEEE_PROPOSED;
+use IEEE_PROPOSED.FIXED_PKG.ALL;
+
+entity awg_sweep is
+    Port (
+        clk : in std_logic;
+        CfgTgl : in std_logic;                          -- config inputs were updated (other clock domain)
+        SweepMode : in std_logic_vector(1 downto 0);    -- 00: off, 01: linear, 10: logarithmic
+        SweepRepeat : in std_logic;                     -- restart at SweepStart after SweepStop (else hold)
+        SweepStart : in std_logic_vector(31 downto 0);  -- generator delta at sweep start
+        SweepStop : in std_logic_vector(31 downto 0);   -- generator delta at sweep end (up or down)
+        SweepStep : in std_logic_vector(31 downto 0);   -- linear: delta increment, log: factor-1 (bits 23..0)
+        SweepDwell : in std_logic_vector(31 downto 0);  -- clk per step (at least 2)
+        ModMode : in std_logic_vector(1 downto 0);      -- 00: off, 01: AM, 10: FM, 11: PM
+        ModSource : in std_logic;                       -- 0: internal triangle, 1: ModSample
+        ModRate : in std_logic_vector(31 downto 0);     -- internal modulator phase increment
+        ModDepth : in std_logic_vector(19 downto 0);
+        ModSample : in signed(11 downto 0);             -- external modulating signal
+        BaseDelta : in std_logic_vector(31 downto 0);   -- generator delta from config
+        BaseVoltage : in sfixed(0 downto -11);          -- generator amplitude from config
+        Delta : out std_logic_vector(31 downto 0);
+        Voltage : out sfixed(0 downto -11);
+        Sweeping : out std_logic                        -- sweep is running (not held at stop)
+    );
+end awg_sweep;
+
+architecture Behavioral of awg_sweep is
+
+signal cfg_tgl_d : std_logic := '0';
+signal cfg_tgl_dd : std_logic := '0';
+signal cfg_tgl_ddd : std_logic := '0';
+signal sweep_mode_d : std_logic_vector(1 downto 0) := "00";
+signal sweep_mode_dd : std_logic_vector(1 downto 0) := "00";
+signal sweep_repeat_d : std_logic := '0';
+signal sweep_start_d : unsigned(31 downto 0) := (others => '0');
+signal sweep_stop_d : unsigned(31 downto 0) := (others => '0');
+signal sweep_step_d : unsigned(31 downto 0) := (others => '0');
+signal sweep_dwell_d : unsigned(31 downto 0) := (others => '0');
+signal mod_mode_d : std_logic_vector(1 downto 0) := "00";
+signal mod_source_d : std_logic := '0';
+signal mod_rate_d : unsigned(31 downto 0) := (others => '0');
+signal mod_depth_d : unsigned(19 downto 0) := (others => '0');
+signal base_delta_d : unsigned(31 downto 0) := (others => '0');
+signal base_voltage_d : signed(11 downto 0) := (others => '0');
+
+-- sweep
+signal sweep_cur : unsigned(31 downto 0) := (others => '0');
+signal sweep_down : std_logic := '0';
+signal sweep_run : std_logic := '0';
+signal dwell_cnt : unsigned(31 downto 0) := (others => '0');
+signal log_prod : unsigned(55 downto 0) := (others => '0');
+signal delta_c : unsigned(31 downto 0) := (others => '0');
+
+-- modulation
+signal lfo_ph : unsigned(31 downto 0) := (others => '0');
+signal mod_s : signed(11 downto 0) := (others => '0');
+signal mod_prod : signed(32 downto 0) := (others => '0');  -- m * depth
+signal am_gain : signed(18 downto 0) := to_signed(2**16,19);
+signal am_prod : signed(30 downto 0) := (others => '0');
+signal pm_ph : signed(35 downto 0) := (others => '0');
+signal pm_ph_d : signed(35 downto 0) := (others => '0');
+signal pm_pend : signed(37 downto 0) := (others => '0');  -- phase not yet applied through delta
+
+attribute ASYNC_REG: boolean;
+attribute ASYNC_REG of cfg_tgl_d: signal is true;
+attribute ASYNC_REG of cfg_tgl_dd: signal is true;
+
+attribute use_dsp : string;
+attribute use_dsp of log_prod : signal is "yes";
+attribute use_dsp of mod_prod : signal is "yes";
+attribute use_dsp of am_prod : signal is "yes";
+
+begin
+
+sweep_proc: process(clk)
+    variable v_inc : unsigned(31 downto 0);
+    variable v_next : signed(33 downto 0);
+    variable v_over : boolean;
+    variable v_want : signed(37 downto 0);
+    variable v_out : signed(37 downto 0);
+    variable v_vol : signed(30 downto 0);
+    variable v_gain : signed(32 downto 0);
+begin
+
+    if rising_edge(clk) then
+
+        -- take config inputs when they were updated
+        cfg_tgl_d <= CfgTgl;
+        cfg_tgl_dd <= cfg_tgl_d;
+        cfg_tgl_ddd <= cfg_tgl_dd;
+        if cfg_tgl_ddd /= cfg_tgl_dd then
+            sweep_mode_d <= SweepMode;
+            sweep_repeat_d <= SweepRepeat;
+            sweep_start_d <= unsigned(SweepStart);
+            sweep_stop_d <= unsigned(SweepStop);
+            sweep_step_d <= unsigned(SweepStep);
+            sweep_dwell_d <= unsigned(SweepDwell);
+            mod_mode_d <= ModMode;
+            mod_source_d <= ModSource;
+            mod_rate_d <= unsigned(ModRate);
+            mod_depth_d <= unsigned(ModDepth);
+            base_delta_d <= unsigned(BaseDelta);
+            base_voltage_d <= signed(to_slv(BaseVoltage));
+        end if;
+        -- previous sweep mode (sweep start edge)
+        sweep_mode_dd <= sweep_mode_d;
+
+        ---------------
+        --   SWEEP   --
+        ---------------
+        log_prod <= sweep_cur * sweep_step_d(23 downto 0);
+        if sweep_mode_dd = "00" or sweep_mode_dd = "11" then
+            sweep_run <= '0';
+        end if;
+        if sweep_mode_dd = "00" and sweep_mode_d /= "00" and sweep_mode_d /= "11" then
+            -- start sweep
+            sweep_cur <= sweep_start_d;
+            if sweep_start_d > sweep_stop_d then
+                sweep_down <= '1';
+            else
+                sweep_down <= '0';
+            end if;
+            dwell_cnt <= sweep_dwell_d - 1;
+            sweep_run <= '1';
+        elsif sweep_run = '1' then
+            if dwell_cnt = 0 then
+                dwell_cnt <= sweep_dwell_d - 1;
+                if sweep_mode_dd = "01" then
+                    v_inc := sweep_step_d;
+                else
+                    v_inc := log_prod(55 downto 24);
+                    if v_inc = 0 then
+                        v_inc := to_unsigned(1,32);
+                    end if;
+                end if;
+                if sweep_down = '1' then
+                    v_next := signed("00" & sweep_cur) - signed("00" & v_inc);
+                    v_over := v_next <= signed("00" & sweep_stop_d);
+                else
+                    v_next := signed("00" & sweep_cur) + signed("00" & v_inc);
+                    v_over := v_next >= signed("00" & sweep_stop_d);
+                end if;
+                if sweep_cur = sweep_stop_d then
+                    -- end of sweep
+                    if sweep_repeat_d = '1' then
+                        sweep_cur <= sweep_start_d;
+                    else
+                        sweep_run <= '0';
+                    end if;
+                elsif v_over then
+                    sweep_cur <= sweep_stop_d;
+                else
+                    sweep_cur <= unsigned(v_next(31 downto 0));
+                end if;
+            else
+                dwell_cnt <= dwell_cnt - 1;
+            end if;
+        end if;
+
+        -- carrier delta: sweep (also when held at stop) or config
+        if sweep_mode_dd = "00" or sweep_mode_dd = "11" then
+            delta_c <= base_delta_d;
+        else
+            delta_c <= sweep_cur;
+        end if;
+
+        ------------------
+        --  MODULATION  --
+        ------------------
+        -- internal modulator: triangle
+        lfo_ph <= lfo_ph + mod_rate_d;
+        if mod_source_d = '1' then
+            mod_s <= ModSample;
+        elsif lfo_ph(31) = '0' then
+            mod_s <= resize(signed('0' & lfo_ph(30 downto 19)) - 2048, 12);
+        else
+            mod_s <= resize(2047 - signed('0' & lfo_ph(30 downto 19)), 12);
+        end if;
+        mod_prod <= mod_s * signed('0' & mod_depth_d);
+
+        -- AM: gain = 1 + depth * m (1.16 fixed point)
+        v_gain := to_signed(2**16,33) + shift_right(mod_prod, 11);
+        if v_gain < 0 then
+            am_gain <= (others => '0');
+        elsif v_gain > 2**17 then
+            am_gain <= to_signed(2**17,19);
+        else
+            am_gain <= v_gain(18 downto 0);
+        end if;
+        am_prod <= base_voltage_d * am_gain(18 downto 0);
+        v_vol := shift_right(am_prod, 16);
+        if mod_mode_d /= "01" then
+            Voltage <= to_sfixed(std_logic_vector(base_voltage_d),0,-11);
+        elsif v_vol > 2047 then
+            Voltage <= to_sfixed(std_logic_vector(to_signed(2047,12)),0,-11);
+        elsif v_vol < -2048 then
+            Voltage <= to_sfixed(std_logic_vector(to_signed(-2048,12)),0,-11);
+        else
+            Voltage <= to_sfixed(std_logic_vector(v_vol(11 downto 0)),0,-11);
+        end if;
+
+        -- PM: phase offset (full waveform period is 2^34 delta units)
+        pm_ph <= shift_left(resize(mod_prod,36),2);
+        pm_ph_d <= pm_ph;
+
+        -- output delta (saturated, PM phase which did not fit is applied in next clk)
+        if mod_mode_d = "10" then
+            v_want := signed("000000" & delta_c) + resize(mod_prod,38);
+        elsif mod_mode_d = "11" then
+            v_want := signed("000000" & delta_c) + pm_pend;
+        else
+            v_want := signed("000000" & delta_c);
+        end if;
+        if v_want < 0 then
+            v_out := (others => '0');
+        elsif v_want(37 downto 32) /= 0 then
+            v_out := "000000" & X"FFFFFFFF";
+        else
+            v_out := v_want;
+        end if;
+        Delta <= std_logic_vector(v_out(31 downto 0));
+        if mod_mode_d = "11" then
+            pm_pend <= v_want - v_out + resize(pm_ph - pm_ph_d,38);
+        else
+            pm_pend <= (others => '0');
+        end if;
+
+        Sweeping <= sweep_run;
+
+    end if;
+
+end process;
+
+end Behavioral;
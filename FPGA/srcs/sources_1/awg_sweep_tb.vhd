@@ -0,0 +1,197 @@
+----------------------------------------------------------------------------------
+--    Copyright (C) 2019 Dejan Priversek
+--
+--    This program is free software: you can redistribute it and/or modify
+--    it under the terms of the GNU General Public License as published by
+--    the Free Software Foundation, either version 3 of the License, or
+--    (at your option) any later version.
+--
+--    This program is distributed in the hope that it will be useful,
+--    but WITHOUT ANY WARRANTY; without even the implied warranty of
+--    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+--    GNU General Public License for more details.
+--
+--    You should have received a copy of the GNU General Public License
+--    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+----------------------------------------------------------------------------------
+
+--
+-- AWG sweep/modulation testbench
+-- config inputs are taken only when CfgTgl toggles,
+-- linear up sweep is checked step by step (dwell and held stop value),
+-- PM: sum of delta deviations over one modulation period must be zero (phase returns)
+--
+
+LIBRARY IEEE;
+USE IEEE.STD_LOGIC_1164.ALL;
+USE IEEE.NUMERIC_STD.ALL;
+library IEEE_PROPOSED;
+use IEEE_PROPOSED.FIXED_PKG.ALL;
+
+library user_lib;
+use user_lib.TextUtil.all;
+
+ENTITY awg_sweep_tb IS
+END awg_sweep_tb;
+
+ARCHITECTURE behavior OF awg_sweep_tb IS
+
+    -- Component Declaration for the Unit Under Test (UUT)
+
+    component awg_sweep is
+    Port (
+        clk : in std_logic;
+        CfgTgl : in std_logic;
+        SweepMode : in std_logic_vector(1 downto 0);
+        SweepRepeat : in std_logic;
+        SweepStart : in std_logic_vector(31 downto 0);
+        SweepStop : in std_logic_vector(31 downto 0);
+        SweepStep : in std_logic_vector(31 downto 0);
+        SweepDwell : in std_logic_vector(31 downto 0);
+        ModMode : in std_logic_vector(1 downto 0);
+        ModSource : in std_logic;
+        ModRate : in std_logic_vector(31 downto 0);
+        ModDepth : in std_logic_vector(19 downto 0);
+        ModSample : in signed(11 downto 0);
+        BaseDelta : in std_logic_vector(31 downto 0);
+        BaseVoltage : in sfixed(0 downto -11);
+        Delta : out std_logic_vector(31 downto 0);
+        Voltage : out sfixed(0 downto -11);
+        Sweeping : out std_logic
+    );
+    end component;
+
+    --constants
+    CONSTANT START_DELTA : integer := 100000;
+    CONSTANT STOP_DELTA : integer := 100095;
+    CONSTANT STEP_DELTA : integer := 10;
+    CONSTANT DWELL : integer := 4;
+    CONSTANT BASE_DELTA : integer := 2**28;
+
+    --Inputs
+    signal clk : std_logic := '0';
+    signal CfgTgl : std_logic := '0';
+    signal SweepMode : std_logic_vector(1 downto 0) := "00";
+    signal ModMode : std_logic_vector(1 downto 0) := "00";
+
+    --Outputs
+    signal Delta : std_logic_vector(31 downto 0);
+    signal Voltage : sfixed(0 downto -11);
+    signal Sweeping : std_logic;
+
+    signal sim_done : boolean := false;
+
+    -- Clock period definitions
+    constant clk_period : time := 8 ns;
+
+BEGIN
+
+    -- Instantiate the Unit Under Test (UUT)
+    uut: awg_sweep
+    PORT MAP (
+        clk => clk,
+        CfgTgl => CfgTgl,
+        SweepMode => SweepMode,
+        SweepRepeat => '0',
+        SweepStart => std_logic_vector(to_unsigned(START_DELTA,32)),
+        SweepStop => std_logic_vector(to_unsigned(STOP_DELTA,32)),
+        SweepStep => std_logic_vector(to_unsigned(STEP_DELTA,32)),
+        SweepDwell => std_logic_vector(to_unsigned(DWELL,32)),
+        ModMode => ModMode,
+        ModSource => '0',
+        ModRate => std_logic_vector(to_unsigned(2**24,32)),  -- 256 clk modulation period
+        ModDepth => X"10000",
+        ModSample => to_signed(0,12),
+        BaseDelta => std_logic_vector(to_unsigned(BASE_DELTA,32)),
+        BaseVoltage => to_sfixed(0.5,0,-11),
+        Delta => Delta,
+        Voltage => Voltage,
+        Sweeping => Sweeping
+    );
+
+    -- Clock process definitions
+    clk_process :process
+    begin
+        if sim_done then
+            wait;
+        end if;
+        clk <= '0';
+        wait for clk_period/2;
+        clk <= '1';
+        wait for clk_period/2;
+    end process;
+
+    -- Stimulus process
+    stim_proc: process
+        variable errors : integer := 0;
+        variable expected : integer;
+        variable run_len : integer;
+        variable last : integer;
+        variable dev_sum : integer;
+    begin
+        wait for 100 ns;
+        wait until rising_edge(clk);
+        CfgTgl <= NOT(CfgTgl);
+        wait for 100 ns;
+        wait until rising_edge(clk);
+        Check(to_integer(unsigned(Delta)) = BASE_DELTA,
+              "delta without sweep: " & integer'image(to_integer(unsigned(Delta))), errors);
+
+        -- sweep mode is not taken before CfgTgl toggles
+        SweepMode <= "01";
+        wait for 100 ns;
+        wait until rising_edge(clk);
+        Check(to_integer(unsigned(Delta)) = BASE_DELTA and Sweeping = '0',
+              "sweep started without CfgTgl", errors);
+
+        -- linear sweep
+        CfgTgl <= NOT(CfgTgl);
+        wait until to_integer(unsigned(Delta)) = START_DELTA;
+        expected := START_DELTA;
+        run_len := 0;
+        while expected /= STOP_DELTA loop
+            wait until rising_edge(clk);
+            last := to_integer(unsigned(Delta));
+            if last = expected then
+                run_len := run_len + 1;
+            else
+                Check(run_len = DWELL,
+                      "delta " & integer'image(expected) & " held for " & integer'image(run_len) & " clk", errors);
+                if expected + STEP_DELTA > STOP_DELTA then
+                    expected := STOP_DELTA;
+                else
+                    expected := expected + STEP_DELTA;
+                end if;
+                if last /= expected then
+                    Print("delta " & integer'image(last) & ", expected " & integer'image(expected));
+                    errors := errors + 1;
+                    exit;
+                end if;
+                run_len := 1;
+            end if;
+        end loop;
+        for i in 0 to 4*DWELL loop
+            wait until rising_edge(clk);
+        end loop;
+        Check(to_integer(unsigned(Delta)) = STOP_DELTA and Sweeping = '0',
+              "sweep is not held at stop value", errors);
+
+        -- phase modulation returns to carrier phase after each modulation period
+        SweepMode <= "00";
+        ModMode <= "11";
+        CfgTgl <= NOT(CfgTgl);
+        for i in 0 to 255 loop
+            wait until rising_edge(clk);
+        end loop;
+        dev_sum := 0;
+        for i in 0 to 255 loop
+            wait until rising_edge(clk);
+            dev_sum := dev_sum + (to_integer(unsigned(Delta(31 downto 4))) - BASE_DELTA/16);
+        end loop;
+        Check(abs(dev_sum) <= 256, "PM phase drift " & integer'image(dev_sum), errors);
+
+        EndTest("AWG sweep", errors, sim_done);
+        wait;
+    end process;
+
+END;
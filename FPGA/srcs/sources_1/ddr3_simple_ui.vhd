@@ -49,6 +49,32 @@ entity ddr3_simple_ui is
             ui_rd_ready : in std_logic;        -- start reading samples
             ui_rd_data_valid : out std_logic;
             ui_rd_data_available : out std_logic; -- asserted if write counter is higher than read counter
+            ui_vp_start : in std_logic;        -- start viewport readout of the last saved frame
+            ui_vp_offset : in std_logic_vector (26 downto 0); -- first viewport sample (pyramid level: first entry)
+            ui_vp_skip : in std_logic_vector (1 downto 0);    -- position of the first frame sample within first RAM word
+            ui_vp_length : in std_logic_vector (26 downto 0); -- number of viewport samples (pyramid level: entries)
+            ui_vp_stride : in std_logic_vector (26 downto 0); -- read every n-th sample
+            ui_vp_level : in std_logic_vector (3 downto 0);   -- 0: samples, 2 to 12: min/max pyramid level, 15: histogram
+            ui_vp_rd_ready : in std_logic;     -- read fifo can accept viewport samples
+            ui_pyr_enable : in std_logic;      -- build min/max pyramid (frame samples are saved in lower half of RAM)
+            ui_pyr_flush : in std_logic;       -- all frame samples were written to RAM
+            ui_pyr_overflow : out std_logic;   -- some pyramid entries were not written to RAM
+            ui_srch_cfg : in std_logic_vector (31 downto 0);   -- event search condition (mode, channel, edge, hysteresis, level)
+            ui_srch_width : in std_logic_vector (26 downto 0); -- event search pulse width
+            ui_srch_mask : in std_logic_vector (11 downto 0);  -- event search digital pattern
+            ui_srch_patternA : in std_logic_vector (11 downto 0);
+            ui_srch_patternB : in std_logic_vector (11 downto 0);
+            ui_srch_span : in std_logic_vector (26 downto 0);  -- number of searched samples (from viewport offset to frame end)
+            ui_awg_region : in std_logic;      -- upper quarter of RAM holds AWG samples (frame samples are saved in lower half of RAM)
+            ui_awg_wr_req : in std_logic;      -- AWG RAM word is waiting to be written
+            ui_awg_wr_addr : in std_logic_vector (22 downto 0); -- RAM word index in AWG region
+            ui_awg_wr_data : in std_logic_vector (127 downto 0);
+            ui_awg_wr_ack : out std_logic;     -- AWG RAM word was written
+            ui_awg_rd_req : in std_logic;      -- AWG playback fifo can accept RAM word
+            ui_awg_rd_addr : in std_logic_vector (22 downto 0);
+            ui_awg_rd_ack : out std_logic;     -- AWG read command was accepted
+            ui_awg_rd_data : out std_logic_vector (127 downto 0);
+            ui_awg_rd_data_valid : out std_logic;
             init_calib_complete : out std_logic;
             device_temp : out std_logic_vector(11 downto 0);
             -- DDR3 PHY
@@ -115,9 +141,118 @@ component mig_ddr3
       sys_rst                    : in   std_logic
   );
 end component mig_ddr3;
+
+component minmax_pyramid is
+    Generic (
+        FIRST_LEVEL : integer := 2;
+        LAST_LEVEL  : integer := 12;
+        INDEX_WIDTH : integer := 24
+    );
+    Port (
+        clk : in std_logic;
+        rst : in std_logic;
+        DataIn : in std_logic_vector(127 downto 0);
+        DataInEn : in std_logic;
+        Flush : in std_logic;
+        Busy : out std_logic;
+        DataOut : out std_logic_vector(127 downto 0);
+        DataOutLevel : out std_logic_vector(3 downto 0);
+        DataOutIndex : out std_logic_vector(INDEX_WIDTH-1 downto 0);
+        DataOutValid : out std_logic
+    );
+end component;
+
+component event_search is
+    Port (
+        clk : in std_logic;
+        Start : in std_logic;
+        Mode : in std_logic_vector(1 downto 0);
+        Channel : in std_logic;
+        Edge : in std_logic_vector(1 downto 0);
+        Level : in std_logic_vector(9 downto 0);
+        Hyst : in std_logic_vector(9 downto 0);
+        Width : in std_logic_vector(26 downto 0);
+        Mask : in std_logic_vector(11 downto 0);
+        PatternA : in std_logic_vector(11 downto 0);
+        PatternB : in std_logic_vector(11 downto 0);
+        FirstLane : in std_logic_vector(1 downto 0);
+        SampleCnt : in std_logic_vector(26 downto 0);
+        IndexBase : in std_logic_vector(26 downto 0);
+        ResultLen : in std_logic_vector(26 downto 0);
+        DataIn : in std_logic_vector(127 downto 0);
+        DataInEn : in std_logic;
+        InputEnd : in std_logic;
+        Found : out std_logic;
+        OutReady : in std_logic;
+        DataOut : out std_logic_vector(127 downto 0);
+        DataOutValid : out std_logic;
+        Done : out std_logic
+    );
+end component;
     
 CONSTANT RAM_SIZE : integer := 2**27; -- available space in RAM (number of 32-bit samples)
 
+-- min/max pyramid (level k entry: min/max over 4^k samples)
+-- frame samples are saved in lower half of RAM, pyramid levels in upper half:
+-- level k region holds (RAM_SIZE/2)/4^k entries (2 samples each, 2 entries per RAM address)
+CONSTANT PYR_FIRST_LEVEL : integer := 2;
+CONSTANT PYR_LAST_LEVEL : integer := 12;
+type pyr_addr_array is array(0 to 15) of unsigned(27 downto 0);
+
+function pyr_base_init return pyr_addr_array is
+    variable a : pyr_addr_array := (others => (others => '0'));
+    variable b : unsigned(27 downto 0) := to_unsigned(RAM_SIZE,28);
+begin
+    for k in PYR_FIRST_LEVEL to PYR_LAST_LEVEL loop
+        a(k) := b;
+        b := b + to_unsigned(2**(28-2*k),28);
+    end loop;
+    return a;
+end function;
+
+-- mask: number of samples in level region - 1
+function pyr_mask_init return pyr_addr_array is
+    variable a : pyr_addr_array := (others => (others => '0'));
+begin
+    for k in PYR_FIRST_LEVEL to PYR_LAST_LEVEL loop
+        a(k) := to_unsigned(2**(27-2*k)-1,28);
+    end loop;
+    return a;
+end function;
+
+CONSTANT PYR_BASE : pyr_addr_array := pyr_base_init;
+CONSTANT PYR_MASK : pyr_addr_array := pyr_mask_init;
+
+-- viewport: number of requested samples in RAM word (4 samples) starting at lane
+-- (with stride 4 or more each sample needs its own read command)
+function vp_word_samples(lane : unsigned(1 downto 0); step : unsigned(27 downto 0)) return integer is
+begin
+    if step >= 4 or step = 0 then
+        return 1;
+    end if;
+    case step(1 downto 0) is
+        when "01" => return 4 - to_integer(lane);
+        when "10" => if lane < 2 then return 2; else return 1; end if;
+        when others => if lane = 0 then return 2; else return 1; end if;
+    end case;
+end function;
+
+-- viewport: index of the first sample of the next read command
+function vp_word_adv(lane : unsigned(1 downto 0); step : unsigned(27 downto 0)) return unsigned is
+begin
+    if step >= 4 or step = 0 then
+        return step;
+    end if;
+    return to_unsigned(vp_word_samples(lane, step) * to_integer(step(1 downto 0)), 28);
+end function;
+
+-- AWG samples (8 per RAM word) are saved in upper quarter of RAM (above min/max pyramid levels)
+CONSTANT AWG_BASE : unsigned(27 downto 0) := to_unsigned(RAM_SIZE + RAM_SIZE/2,28);
+-- persistence histogram (hist_engine) is saved at the end of AWG region (2^18 RAM words),
+-- viewport readout of level HIST_LEVEL reads it in entries of 2 x 32 bits (4 counters)
+CONSTANT HIST_LEVEL : integer := 15;
+CONSTANT HIST_BASE : unsigned(27 downto 0) := AWG_BASE + to_unsigned((2**23 - 2**18) * 8,28);
+
 -- RAM state machine signals
 CONSTANT A: STD_LOGIC_VECTOR (2 DownTo 0) := "000";
 CONSTANT B: STD_LOGIC_VECTOR (2 DownTo 0) := "001";
@@ -125,6 +260,8 @@ CONSTANT C: STD_LOGIC_VECTOR (2 DownTo 0) := "010";
 CONSTANT D: STD_LOGIC_VECTOR (2 DownTo 0) := "011";
 CONSTANT E: STD_LOGIC_VECTOR (2 DownTo 0) := "100";
 CONSTANT F: STD_LOGIC_VECTOR (2 DownTo 0) := "101";
+CONSTANT G: STD_LOGIC_VECTOR (2 DownTo 0) := "110";
+CONSTANT H: STD_LOGIC_VECTOR (2 DownTo 0) := "111";
 signal RAMstate : std_logic_vector (2 downto 0):=A;
 
 -- MIG generated
@@ -137,6 +274,7 @@ signal app_rd_data_end        : std_logic;
 signal app_rd_data_valid      : std_logic;
 signal app_rd_data_valid_i    : std_logic;
 signal app_wdf_data           : std_logic_vector(127 downto 0);
+signal app_wdf_data_i         : std_logic_vector(127 downto 0);
 signal app_wdf_end            : std_logic := '0';
 signal app_wdf_wren           : std_logic := '0';
 signal app_wdf_wren_i         : std_logic := '0';    
@@ -192,9 +330,79 @@ signal wr_pretrigdsc : unsigned(26 downto 0);
 signal wr_framesize : unsigned(26 downto 0);
 signal wr_PreTrigSavingCntRecvd : std_logic := '0';
 
+-- viewport readout (random access to the last saved frame)
+type vp_lane_mem is array(0 to 127) of std_logic_vector(3 downto 0);
+signal vp_lane : vp_lane_mem;   -- first sample position within RAM word (3..2) and number of samples - 1 (1..0) for each pending read command
+signal vp_lane_wr : unsigned(6 downto 0) := to_unsigned(0,7);
+signal vp_lane_rd : unsigned(6 downto 0) := to_unsigned(0,7);
+signal vp_lane_head : std_logic_vector(3 downto 0);
+signal vp_lane_free : std_logic := '0';
+signal rd_frame_addr : unsigned(27 downto 0) := to_unsigned(0,28); -- RAM address of the first saved frame sample
+signal rd_frame_sample : unsigned(27 downto 0);   -- position of the first frame sample in RAM
+signal vp_lvl_entry : unsigned(27 downto 0);      -- pyramid entry of the first frame sample
+signal vp_base : unsigned(27 downto 0);
+signal vp_idx_mask : unsigned(27 downto 0);
+signal vp_addr_mask : unsigned(27 downto 0);
+signal vp_req : std_logic := '0';
+signal vp_active : std_logic := '0';
+signal vp_idx : unsigned(27 downto 0);
+signal vp_idx_nxt : unsigned(27 downto 0);
+signal vp_step : unsigned(27 downto 0);
+signal vp_cmd_left : unsigned(26 downto 0);
+signal vp_data_left : unsigned(26 downto 0);
+signal vp_cmd_n : integer range 0 to 4;             -- samples read by current read command
+type vp_sample_array is array(0 to 7) of std_logic_vector(31 downto 0);
+signal vp_pack : vp_sample_array;                   -- samples waiting for read fifo word (0 to 2 are used)
+signal vp_pack_cnt : integer range 0 to 3 := 0;
+signal vp_flush : std_logic := '0';                 -- last samples are left in vp_pack
+signal ui_vp_rd_ready_d : std_logic := '0';
+signal ring_last_addr : integer range 0 to (RAM_SIZE*2)-8 := (RAM_SIZE*2)-8; -- last RAM address for frame samples
+
+-- min/max pyramid
+signal pyr_rst : std_logic;
+signal pyr_DataInEn : std_logic;
+signal pyr_Flush : std_logic;
+signal pyr_Busy : std_logic;
+signal pyr_DataOut : std_logic_vector(127 downto 0);
+signal pyr_DataOutLevel : std_logic_vector(3 downto 0);
+signal pyr_DataOutIndex : std_logic_vector(23 downto 0);
+signal pyr_DataOutValid : std_logic;
+-- pyramid RAM words waiting to be written (address & data)
+type pyr_queue_mem is array(0 to 63) of std_logic_vector(155 downto 0);
+signal pyr_queue : pyr_queue_mem;
+signal pyr_queue_wr : unsigned(5 downto 0) := to_unsigned(0,6);
+signal pyr_queue_rd : unsigned(5 downto 0) := to_unsigned(0,6);
+signal pyr_queue_head : std_logic_vector(155 downto 0);
+signal pyr_writing : std_logic := '0';
+signal pyr_overflow : std_logic := '0';
+
+-- event search (viewport readout returns list of matching sample positions instead of samples)
+signal srch_active : std_logic := '0';
+signal srch_start : std_logic := '0';
+signal srch_first : unsigned(27 downto 0);
+signal srch_cmd_left : unsigned(26 downto 0) := to_unsigned(0,27); -- number of RAM words to read
+signal srch_pending : unsigned(6 downto 0) := to_unsigned(0,7);    -- read commands waiting for data
+signal srch_issue_end : std_logic := '0';
+signal srch_in_end : std_logic := '0';
+signal srch_DataInEn : std_logic;
+signal srch_found : std_logic;
+signal srch_done : std_logic;
+signal srch_DataOut : std_logic_vector(127 downto 0);
+signal srch_DataOutValid : std_logic;
+
+-- AWG sample streaming
+signal awg_writing : std_logic := '0';
+signal ui_awg_wr_ack_i : std_logic := '0';
+signal ui_awg_rd_ack_i : std_logic := '0';
+-- read data owner for each pending read command (RAM returns read data in command order), '1': AWG
+signal rd_tag : std_logic_vector(0 to 255) := (others => '0');
+signal rd_tag_wr : unsigned(7 downto 0) := to_unsigned(0,8);
+signal rd_tag_rd : unsigned(7 downto 0) := to_unsigned(0,8);
+signal rd_tag_head : std_logic;
+
 
 --debug signals
-signal debugDDRst : integer range 0 to 4;
+signal debugDDRst : integer range 0 to 7;
 signal wrn_data_not_written : std_logic := '0';
 signal wrn_data_not_read : std_logic := '0';
 signal err_app_rdy_stuck_low : std_logic := '0';
@@ -225,6 +433,12 @@ attribute mark_debug of app_addr_i_rd : signal is true;
 attribute keep of rd_cnt_ini : signal is true;
 attribute mark_debug of rd_cnt_ini : signal is true;
 attribute mark_debug of wr_pretrigdsc : signal is true;
+attribute mark_debug of vp_active : signal is true;
+attribute mark_debug of vp_cmd_left : signal is true;
+attribute mark_debug of pyr_writing : signal is true;
+attribute mark_debug of pyr_overflow : signal is true;
+attribute mark_debug of srch_active : signal is true;
+attribute mark_debug of srch_cmd_left : signal is true;
 
 begin
 
@@ -254,7 +468,7 @@ u_mig_ddr3: mig_ddr3
        app_wdf_wren                   => app_wdf_wren,
        app_rd_data                    => app_rd_data,
        app_rd_data_end                => app_rd_data_end,
-       app_rd_data_valid              => app_rd_data_valid_i,
+       app_rd_data_valid              => app_rd_data_valid,
        app_rdy                        => app_rdy,
        app_wdf_rdy                    => app_wdf_rdy,
        app_sr_req                     => '0',
@@ -274,15 +488,85 @@ u_mig_ddr3: mig_ddr3
 
 ui_clk <= ui_clk_i;
 
--- move sample data to app_wdf_data fifo
-app_wdf_data <= ui_wr_data;
+-- move sample data (or min/max pyramid word) to app_wdf_data fifo
+app_wdf_data <= app_wdf_data_i;
+app_wdf_data_i <= pyr_queue_head(127 downto 0) when pyr_writing = '1' else
+                  ui_awg_wr_data when awg_writing = '1' else
+                  ui_wr_data;
 ui_wr_rdy <= ui_wr_rdy_i;
 
 app_wdf_wren <= app_wdf_wren_i;
 app_wdf_end <= app_wdf_end_i;
 
-app_addr_mux: process (ui_clk_i)
+-- AWG read data is not passed to frame/viewport readout
+rd_tag_head <= rd_tag(to_integer(rd_tag_rd));
+app_rd_data_valid_i <= app_rd_data_valid and not(rd_tag_head);
+ui_awg_wr_ack <= ui_awg_wr_ack_i;
+ui_awg_rd_ack <= ui_awg_rd_ack_i;
 
+-- viewport readout: requested samples of RAM word (first sample is saved in MSBs)
+vp_lane_head <= vp_lane(to_integer(vp_lane_rd));
+vp_cmd_n <= to_integer(vp_cmd_left(2 downto 0)) when vp_cmd_left < vp_word_samples(vp_idx(1 downto 0), vp_step) else
+            vp_word_samples(vp_idx(1 downto 0), vp_step);
+
+-- min/max pyramid is built from sample words written to RAM (in the same order as they are saved)
+pyr_rst <= ui_frameStart or ui_reset_d or ui_clk_sync_rst;
+pyr_DataInEn <= ui_wr_rdy_i and ui_pyr_enable;
+pyr_Flush <= ui_pyr_flush and ui_pyr_enable;
+pyr_queue_head <= pyr_queue(to_integer(pyr_queue_rd));
+ui_pyr_overflow <= pyr_overflow;
+
+-- event search: RAM words of saved frame are evaluated as they are read (4 samples per clk)
+srch_DataInEn <= app_rd_data_valid_i and srch_active;
+
+search: event_search
+    port map (
+        clk => ui_clk_i,
+        Start => srch_start,
+        Mode => ui_srch_cfg(31 downto 30),
+        Channel => ui_srch_cfg(29),
+        Edge => ui_srch_cfg(28 downto 27),
+        Level => ui_srch_cfg(9 downto 0),
+        Hyst => ui_srch_cfg(19 downto 10),
+        Width => ui_srch_width,
+        Mask => ui_srch_mask,
+        PatternA => ui_srch_patternA,
+        PatternB => ui_srch_patternB,
+        FirstLane => std_logic_vector(srch_first(1 downto 0)),
+        SampleCnt => ui_srch_span,
+        IndexBase => ui_vp_offset,
+        ResultLen => ui_vp_length,
+        DataIn => app_rd_data,
+        DataInEn => srch_DataInEn,
+        InputEnd => srch_in_end,
+        Found => srch_found,
+        OutReady => ui_vp_rd_ready_d,
+        DataOut => srch_DataOut,
+        DataOutValid => srch_DataOutValid,
+        Done => srch_done
+    );
+
+pyramid: minmax_pyramid
+    generic map (FIRST_LEVEL => PYR_FIRST_LEVEL, LAST_LEVEL => PYR_LAST_LEVEL, INDEX_WIDTH => 24)
+    port map (
+        clk => ui_clk_i,
+        rst => pyr_rst,
+        DataIn => ui_wr_data,
+        DataInEn => pyr_DataInEn,
+        Flush => pyr_Flush,
+        Busy => pyr_Busy,
+        DataOut => pyr_DataOut,
+        DataOutLevel => pyr_DataOutLevel,
+        DataOutIndex => pyr_DataOutIndex,
+        DataOutValid => pyr_DataOutValid
+    );
+
+app_addr_mux: process (ui_clk_i)
+    variable v_vp_first : unsigned(27 downto 0);
+    variable v_vp_buf : vp_sample_array;
+    variable v_vp_lane : integer range 0 to 3;
+    variable v_vp_n : integer range 1 to 4;
+    variable v_vp_total : integer range 0 to 7;
 begin
     
     if rising_edge(ui_clk_i) then
@@ -309,10 +593,152 @@ begin
             
             --check for read request
             ui_rd_ready_d <= ui_rd_ready;
+            ui_vp_rd_ready_d <= ui_vp_rd_ready;
             
-            -- if controller is ready to read data       
-            ui_rd_data_valid <= app_rd_data_valid_i; -- read fifo write enable
-            ui_rd_data <= app_rd_data;               -- read fifo data
+            -- with min/max pyramid or AWG region enabled frame samples are saved in lower half of RAM
+            if ui_pyr_enable = '1' or ui_awg_region = '1' then
+                ring_last_addr <= RAM_SIZE-8;
+            else
+                ring_last_addr <= (RAM_SIZE*2)-8;
+            end if;
+            
+            -- queue min/max pyramid words (RAM words in level region are addressed by entry pair index)
+            if pyr_rst = '1' then
+                pyr_overflow <= '0';
+            elsif pyr_DataOutValid = '1' then
+                if pyr_queue_wr + 1 = pyr_queue_rd then
+                    -- queue is full: RAM is too busy saving samples
+                    pyr_overflow <= '1';
+                else
+                    pyr_queue(to_integer(pyr_queue_wr)) <= std_logic_vector(PYR_BASE(to_integer(unsigned(pyr_DataOutLevel))) +
+                        shift_left(unsigned(pyr_DataOutIndex) and resize(shift_right(PYR_MASK(to_integer(unsigned(pyr_DataOutLevel))),2),24),3))
+                        & pyr_DataOut;
+                    pyr_queue_wr <= pyr_queue_wr + 1;
+                end if;
+            end if;
+            
+            -- viewport: first frame sample and pyramid entry it belongs to
+            rd_frame_sample <= ('0' & rd_frame_addr(27 downto 1)) + unsigned(ui_vp_skip);
+            vp_lvl_entry <= shift_right(rd_frame_sample, 2*to_integer(unsigned(ui_vp_level)));
+            
+            -- viewport sample step (stride 0 reads every sample)
+            if unsigned(ui_vp_level) /= 0 then
+                vp_step <= to_unsigned(1,vp_step'length);
+            elsif unsigned(ui_vp_stride) = 0 then
+                vp_step <= to_unsigned(1,vp_step'length);
+            else
+                vp_step <= resize(unsigned(ui_vp_stride),vp_step'length);
+            end if;
+            -- limit number of pending viewport read commands
+            if vp_lane_wr - vp_lane_rd < 96 then
+                vp_lane_free <= '1';
+            else
+                vp_lane_free <= '0';
+            end if;
+            
+            -- read data owner queue
+            if app_en = '1' and app_rdy = '1' and app_cmd = "001" then
+                if RAMstate = H then
+                    rd_tag(to_integer(rd_tag_wr)) <= '1';
+                else
+                    rd_tag(to_integer(rd_tag_wr)) <= '0';
+                end if;
+                rd_tag_wr <= rd_tag_wr + 1;
+            end if;
+            if app_rd_data_valid = '1' then
+                rd_tag_rd <= rd_tag_rd + 1;
+            end if;
+            ui_awg_rd_data_valid <= app_rd_data_valid and rd_tag_head;
+            ui_awg_rd_data <= app_rd_data;
+            ui_awg_wr_ack_i <= '0';
+            ui_awg_rd_ack_i <= '0';
+            
+            -- event search: count read commands waiting for data
+            srch_start <= '0';
+            if app_en = '1' and app_rdy = '1' and RAMstate = F then
+                if srch_DataInEn = '0' then
+                    srch_pending <= srch_pending + 1;
+                end if;
+            elsif srch_DataInEn = '1' then
+                srch_pending <= srch_pending - 1;
+            end if;
+            if srch_issue_end = '1' and srch_pending = 0 then
+                srch_in_end <= '1';
+            else
+                srch_in_end <= '0';
+            end if;
+            -- search is finished when result list was sent out and all read data was received
+            if srch_active = '1' and srch_start = '0' and srch_done = '1' and srch_pending = 0 and RAMstate /= F then
+                srch_active <= '0';
+            end if;
+            
+            if srch_active = '1' then
+                -- event search: list of matching sample positions
+                ui_rd_data_valid <= srch_DataOutValid;
+                ui_rd_data <= srch_DataOut;
+            elsif vp_active = '0' then
+                -- if controller is ready to read data       
+                ui_rd_data_valid <= app_rd_data_valid_i; -- read fifo write enable
+                ui_rd_data <= app_rd_data;               -- read fifo data
+            else
+                -- viewport readout: pack selected samples (1 to 4 per RAM word) into read fifo words
+                ui_rd_data_valid <= '0';
+                if vp_flush = '1' then
+                    -- samples left after last RAM word: align partially filled word to MSBs
+                    for j in 0 to 3 loop
+                        if j < vp_pack_cnt then
+                            ui_rd_data(127-32*j downto 96-32*j) <= vp_pack(j);
+                        else
+                            ui_rd_data(127-32*j downto 96-32*j) <= (others => '0');
+                        end if;
+                    end loop;
+                    ui_rd_data_valid <= '1';
+                    vp_pack_cnt <= 0;
+                    vp_flush <= '0';
+                    vp_active <= '0';
+                elsif app_rd_data_valid_i = '1' then
+                    v_vp_lane := to_integer(unsigned(vp_lane_head(3 downto 2)));
+                    v_vp_n := to_integer(unsigned(vp_lane_head(1 downto 0))) + 1;
+                    v_vp_total := vp_pack_cnt + v_vp_n;
+                    v_vp_buf := vp_pack;
+                    for j in 0 to 3 loop
+                        if j < v_vp_n then
+                            v_vp_buf(vp_pack_cnt + j) := app_rd_data(127-32*((v_vp_lane + j*to_integer(vp_step(1 downto 0))) mod 4)
+                                                              downto 96-32*((v_vp_lane + j*to_integer(vp_step(1 downto 0))) mod 4));
+                        end if;
+                    end loop;
+                    vp_lane_rd <= vp_lane_rd + 1;
+                    vp_data_left <= vp_data_left - v_vp_n;
+                    if v_vp_total >= 4 then
+                        ui_rd_data <= v_vp_buf(0) & v_vp_buf(1) & v_vp_buf(2) & v_vp_buf(3);
+                        ui_rd_data_valid <= '1';
+                        vp_pack(0 to 2) <= v_vp_buf(4 to 6);
+                        vp_pack_cnt <= v_vp_total - 4;
+                        if vp_data_left = v_vp_n then
+                            if v_vp_total > 4 then
+                                vp_flush <= '1';
+                            else
+                                vp_active <= '0';
+                            end if;
+                        end if;
+                    elsif vp_data_left = v_vp_n then
+                        -- last viewport samples: align partially filled word to MSBs
+                        for j in 0 to 3 loop
+                            if j < v_vp_total then
+                                ui_rd_data(127-32*j downto 96-32*j) <= v_vp_buf(j);
+                            else
+                                ui_rd_data(127-32*j downto 96-32*j) <= (others => '0');
+                            end if;
+                        end loop;
+                        ui_rd_data_valid <= '1';
+                        vp_pack_cnt <= 0;
+                        vp_active <= '0';
+                    else
+                        vp_pack(0 to 2) <= v_vp_buf(0 to 2);
+                        vp_pack_cnt <= v_vp_total;
+                    end if;
+                end if;
+            end if;
                    
             case RAMstate(2 downto 0) is
             
@@ -355,15 +781,110 @@ begin
                             if shift_right(app_addr_i_wr,3) > shift_right(unsigned(ui_wr_preTrigSavingCnt),2) then
                                 rd_cnt_ini <= '1';
                                 -- set RAM read start address
-                                app_addr_i_rd <= wr_pretrigdsc(26 downto 0) & '0'; -- mulitply by 2
+                                app_addr_i_rd <= (wr_pretrigdsc(26) and not(ui_pyr_enable or ui_awg_region)) & wr_pretrigdsc(25 downto 0) & '0'; -- mulitply by 2
+                                -- and keep it for viewport readout
+                                rd_frame_addr <= (wr_pretrigdsc(26) and not(ui_pyr_enable or ui_awg_region)) & wr_pretrigdsc(25 downto 0) & '0';
                                 -- set write counter, relative to the read counter
                                 wr_cnt <= to_integer(shift_right(app_addr_i_wr,3) - shift_right(wr_pretrigdsc,2));
                             end if;
+                        -- read AWG samples for playback (sample output must not run dry)
+                        elsif ui_awg_rd_req = '1' and ui_awg_rd_ack_i = '0' then
+                            app_addr <= '0' & std_logic_vector(AWG_BASE + shift_left(resize(unsigned(ui_awg_rd_addr),28),3));
+                            app_cmd <= "001";
+                            app_en <= '1';
+                            ui_wr_rdy_i <= '0';
+                            RAMstate <= H;
+                        -- write min/max pyramid word
+                        elsif pyr_queue_rd /= pyr_queue_wr then
+                            app_addr <= '0' & pyr_queue_head(155 downto 128);
+                            app_cmd <= "000";
+                            app_en <= '1';
+                            app_wdf_wren_i <= '1';
+                            app_wdf_end_i <= '1';
+                            pyr_writing <= '1';
+                            ui_wr_rdy_i <= '0';
+                            RAMstate <= E;
+                        -- write uploaded AWG samples
+                        elsif ui_awg_wr_req = '1' and ui_awg_wr_ack_i = '0' then
+                            app_addr <= '0' & std_logic_vector(AWG_BASE + shift_left(resize(unsigned(ui_awg_wr_addr),28),3));
+                            app_cmd <= "000";
+                            app_en <= '1';
+                            app_wdf_wren_i <= '1';
+                            app_wdf_end_i <= '1';
+                            awg_writing <= '1';
+                            ui_wr_rdy_i <= '0';
+                            RAMstate <= G;
                         elsif rd_cnt_ini = '1' and ui_rd_ready_d = '1' and (rd_cnt < wr_cnt) then
                             ui_wr_rdy_i <= '0';
                             app_addr <= '0' & std_logic_vector(app_addr_i_rd(27 downto 3) & "000");
                             app_cmd <= "001";
                             RAMstate <= C;
+                        -- start viewport readout of the last saved frame
+                        elsif vp_req = '1' and vp_active = '0' and srch_active = '0' and ui_srch_cfg(31 downto 30) /= "00" then
+                            -- event search: read all RAM words from viewport offset to frame end
+                            vp_req <= '0';
+                            ui_wr_rdy_i <= '0';
+                            srch_active <= '1';
+                            srch_start <= '1';
+                            srch_issue_end <= '0';
+                            srch_first <= resize(unsigned(ui_vp_offset),28) + unsigned(ui_vp_skip);
+                            if unsigned(ui_srch_span) = 0 then
+                                srch_cmd_left <= to_unsigned(0,27);
+                            else
+                                srch_cmd_left <= resize(shift_right(resize(unsigned(ui_vp_offset(1 downto 0)),28) + unsigned(ui_vp_skip) + unsigned(ui_srch_span) + 3,2),27);
+                            end if;
+                            app_addr <= '0' & std_logic_vector((rd_frame_addr + shift_left(shift_right(resize(unsigned(ui_vp_offset),28) + unsigned(ui_vp_skip),2),3))
+                                        and to_unsigned(ring_last_addr+7,28));
+                            app_cmd <= "001";
+                            app_en <= '0';
+                            RAMstate <= F;
+                        elsif vp_req = '1' and vp_active = '0' and srch_active = '0' then
+                            vp_req <= '0';
+                            ui_wr_rdy_i <= '0';
+                            if unsigned(ui_vp_length) /= 0 then
+                                vp_active <= '1';
+                            end if;
+                            vp_pack_cnt <= 0;
+                            vp_flush <= '0';
+                            if unsigned(ui_vp_level) = 0 then
+                                -- frame samples
+                                vp_cmd_left <= unsigned(ui_vp_length);
+                                vp_data_left <= unsigned(ui_vp_length);
+                                v_vp_first := resize(unsigned(ui_vp_offset),28) + unsigned(ui_vp_skip);
+                                vp_idx <= v_vp_first;
+                                vp_idx_nxt <= v_vp_first + vp_word_adv(v_vp_first(1 downto 0), vp_step);
+                                vp_base <= rd_frame_addr;
+                                vp_idx_mask <= (others => '1');
+                                vp_addr_mask <= to_unsigned(ring_last_addr+7,28);
+                            elsif unsigned(ui_vp_level) >= PYR_FIRST_LEVEL and unsigned(ui_vp_level) <= PYR_LAST_LEVEL then
+                                -- min/max pyramid entries (2 samples each), starting at entry of the first frame sample
+                                vp_cmd_left <= unsigned(ui_vp_length(25 downto 0)) & '0';
+                                vp_data_left <= unsigned(ui_vp_length(25 downto 0)) & '0';
+                                v_vp_first := (vp_lvl_entry(26 downto 0) + unsigned(ui_vp_offset)) & '0';
+                                vp_idx <= v_vp_first;
+                                vp_idx_nxt <= v_vp_first + vp_word_adv(v_vp_first(1 downto 0), vp_step);
+                                vp_base <= PYR_BASE(to_integer(unsigned(ui_vp_level)));
+                                vp_idx_mask <= PYR_MASK(to_integer(unsigned(ui_vp_level)));
+                                vp_addr_mask <= (others => '1');
+                            elsif unsigned(ui_vp_level) = HIST_LEVEL then
+                                -- persistence histogram, starting at first entry (no frame sample offset)
+                                vp_cmd_left <= unsigned(ui_vp_length(25 downto 0)) & '0';
+                                vp_data_left <= unsigned(ui_vp_length(25 downto 0)) & '0';
+                                v_vp_first := resize(unsigned(ui_vp_offset(25 downto 0)) & '0',28);
+                                vp_idx <= v_vp_first;
+                                vp_idx_nxt <= v_vp_first + vp_word_adv(v_vp_first(1 downto 0), vp_step);
+                                vp_base <= HIST_BASE;
+                                vp_idx_mask <= to_unsigned(2**20-1,28);
+                                vp_addr_mask <= (others => '1');
+                            else
+                                -- level is not saved in RAM
+                                vp_active <= '0';
+                                vp_cmd_left <= to_unsigned(0,27);
+                                vp_data_left <= to_unsigned(0,27);
+                            end if;
+                            app_cmd <= "001";
+                            app_en <= '0';
+                            RAMstate <= D;
                         -- wait in idle
                         else
                             ui_wr_rdy_i <= '0';
@@ -377,7 +898,15 @@ begin
                         app_addr_i_wr <= to_unsigned(0,app_addr_i_wr'length);
                         --app_addr_i_rd <= 268425448; test memory addr wrap
                         --app_addr_i_wr <= 268425448; test memory addr wrap
-                        RAMstate <= A;
+                        -- AWG playback does not depend on capture reset
+                        if ui_awg_rd_req = '1' and ui_awg_rd_ack_i = '0' then
+                            app_addr <= '0' & std_logic_vector(AWG_BASE + shift_left(resize(unsigned(ui_awg_rd_addr),28),3));
+                            app_cmd <= "001";
+                            app_en <= '1';
+                            RAMstate <= H;
+                        else
+                            RAMstate <= A;
+                        end if;
                     end if;
                     debugDDRst <= 0;
                 
@@ -421,7 +950,7 @@ begin
                             if app_rdy = '1' and app_en = '1' then
                                 wr_cnt <= wr_cnt + 1;
                                 -- set write address ( Burst Length 8 -> next address is + 8 )
-                                if to_integer(unsigned(app_addr)) = (RAM_SIZE*2)-8 then
+                                if to_integer(unsigned(app_addr)) = ring_last_addr then
                                     app_addr <= std_logic_vector(to_unsigned(0,app_addr'LENGTH));
                                     app_addr_i_wr <= to_unsigned(0,app_addr_i_wr'length);
                                 else
@@ -439,7 +968,7 @@ begin
                                 if app_rdy = '1' then
                                     wr_cnt <= wr_cnt + 1;
                                     app_en <= '0'; 
-                                    if to_integer(unsigned(app_addr)) = (RAM_SIZE*2)-8 then
+                                    if to_integer(unsigned(app_addr)) = ring_last_addr then
                                         app_addr <= std_logic_vector(to_unsigned(0,app_addr'LENGTH));
                                         app_addr_i_wr <= to_unsigned(0,app_addr_i_wr'length);
                                     else
@@ -478,7 +1007,7 @@ begin
                             if app_rdy = '1' and app_en = '1' then
                                 rd_cnt <= rd_cnt + 1;
                                 -- set read address (BL8: next address is current + 8 )
-                                if to_integer(unsigned(app_addr)) = (RAM_SIZE*2)-8 then
+                                if to_integer(unsigned(app_addr)) = ring_last_addr then
                                     app_addr <= std_logic_vector(to_unsigned(0,app_addr'LENGTH));
                                 else
                                     app_addr <= std_logic_vector(unsigned(app_addr) + 8);
@@ -491,7 +1020,7 @@ begin
                                 if app_rdy = '1' then
                                     -- increment read pointer +8
                                     rd_cnt <= rd_cnt + 1;
-                                    if to_integer(unsigned(app_addr)) = (RAM_SIZE*2)-8 then
+                                    if to_integer(unsigned(app_addr)) = ring_last_addr then
                                         app_addr_i_rd <= to_unsigned(0,app_addr_i_rd'length);
                                     else
                                         app_addr_i_rd <= unsigned(app_addr(27 downto 0)) + 8;
@@ -520,12 +1049,190 @@ begin
                     end if;
                     debugDDRst <= 2;
                 
+                when D =>          -- viewport reading from RAM
+                
+                    -- select read command
+                    app_cmd <= "001";
+                    
+                    if ui_reset_d = '1' then
+                        -- restart
+                        app_en <= '0';
+                        RAMstate <= A;
+                    else
+                        -- if read command was accepted
+                        -- save sample positions within RAM word and set address of the next RAM word
+                        -- (with stride below 4 one command reads all requested samples of the RAM word)
+                        if app_en = '1' and app_rdy = '1' then
+                            vp_lane(to_integer(vp_lane_wr)) <= std_logic_vector(vp_idx(1 downto 0)) & std_logic_vector(to_unsigned(vp_cmd_n-1,2));
+                            vp_lane_wr <= vp_lane_wr + 1;
+                            vp_idx <= vp_idx_nxt;
+                            vp_idx_nxt <= vp_idx_nxt + vp_word_adv(vp_idx_nxt(1 downto 0), vp_step);
+                            vp_cmd_left <= vp_cmd_left - vp_cmd_n;
+                            -- 4 samples per RAM address (BL8: next address is current + 8)
+                            app_addr <= '0' & std_logic_vector((vp_base + shift_left(resize(shift_right(vp_idx_nxt and vp_idx_mask,2),28),3)) and vp_addr_mask);
+                            if vp_cmd_left = vp_cmd_n then
+                                -- all read commands were sent
+                                app_en <= '0';
+                                RAMstate <= A;
+                            else
+                                -- continue if read fifo is not AlmostFull
+                                app_en <= ui_vp_rd_ready_d and vp_lane_free;
+                                RAMstate <= D;
+                            end if;
+                        elsif app_en = '1' then
+                            -- wait until app_rdy = '1'
+                            app_en <= '1';
+                            RAMstate <= D;
+                        elsif vp_cmd_left /= 0 then
+                            app_addr <= '0' & std_logic_vector((vp_base + shift_left(resize(shift_right(vp_idx and vp_idx_mask,2),28),3)) and vp_addr_mask);
+                            app_en <= ui_vp_rd_ready_d and vp_lane_free;
+                            RAMstate <= D;
+                        else
+                            RAMstate <= A;
+                        end if;
+                    end if;
+                    debugDDRst <= 3;
+                
+                when E =>          -- writing min/max pyramid word to RAM
+                
+                    -- select write command
+                    app_cmd <= "000";
+                    
+                    if ui_reset_d = '1' then
+                        -- restart
+                        app_en <= '0';
+                        app_wdf_wren_i <= '0';
+                        app_wdf_end_i <= '0';
+                        pyr_writing <= '0';
+                        RAMstate <= A;
+                    else
+                        -- write command accepted
+                        if app_rdy = '1' then
+                            app_en <= '0';
+                        end if;
+                        -- write data accepted
+                        if app_wdf_rdy = '1' then
+                            app_wdf_wren_i <= '0';
+                            app_wdf_end_i <= '0';
+                        end if;
+                        if (app_en = '0' or app_rdy = '1') and (app_wdf_wren_i = '0' or app_wdf_rdy = '1') then
+                            pyr_queue_rd <= pyr_queue_rd + 1;
+                            pyr_writing <= '0';
+                            RAMstate <= A;
+                        else
+                            RAMstate <= E;
+                        end if;
+                    end if;
+                    debugDDRst <= 4;
+                
+                when F =>          -- event search reading from RAM
+                
+                    -- select read command
+                    app_cmd <= "001";
+                    
+                    if ui_reset_d = '1' then
+                        -- restart
+                        app_en <= '0';
+                        srch_issue_end <= '1';
+                        RAMstate <= A;
+                    else
+                        -- if read command was accepted, set address of the next RAM word
+                        if app_en = '1' and app_rdy = '1' then
+                            srch_cmd_left <= srch_cmd_left - 1;
+                            app_addr <= '0' & std_logic_vector((unsigned(app_addr(27 downto 0)) + 8) and to_unsigned(ring_last_addr+7,28));
+                            if srch_cmd_left = 1 or srch_found = '1' then
+                                -- all read commands were sent (or result list is full)
+                                app_en <= '0';
+                                srch_issue_end <= '1';
+                                RAMstate <= A;
+                            else
+                                -- continue if read fifo is not AlmostFull
+                                if ui_vp_rd_ready_d = '1' and srch_pending < 47 then
+                                    app_en <= '1';
+                                else
+                                    app_en <= '0';
+                                end if;
+                                RAMstate <= F;
+                            end if;
+                        elsif app_en = '1' then
+                            -- wait until app_rdy = '1'
+                            app_en <= '1';
+                            RAMstate <= F;
+                        elsif srch_cmd_left /= 0 and srch_found = '0' then
+                            if ui_vp_rd_ready_d = '1' and srch_pending < 48 then
+                                app_en <= '1';
+                            else
+                                app_en <= '0';
+                            end if;
+                            RAMstate <= F;
+                        else
+                            srch_issue_end <= '1';
+                            RAMstate <= A;
+                        end if;
+                    end if;
+                    debugDDRst <= 5;
+                
+                when G =>          -- writing AWG samples to RAM
+                
+                    -- select write command
+                    app_cmd <= "000";
+                    
+                    -- write command accepted
+                    if app_rdy = '1' then
+                        app_en <= '0';
+                    end if;
+                    -- write data accepted
+                    if app_wdf_rdy = '1' then
+                        app_wdf_wren_i <= '0';
+                        app_wdf_end_i <= '0';
+                    end if;
+                    if (app_en = '0' or app_rdy = '1') and (app_wdf_wren_i = '0' or app_wdf_rdy = '1') then
+                        ui_awg_wr_ack_i <= '1';
+                        awg_writing <= '0';
+                        RAMstate <= A;
+                    else
+                        RAMstate <= G;
+                    end if;
+                    debugDDRst <= 6;
+                
+                when H =>          -- AWG playback reading from RAM
+                
+                    -- select read command
+                    app_cmd <= "001";
+                    
+                    -- not aborted on capture reset: command accepted by MIG must be acknowledged
+                    -- (read data is tagged for AWG)
+                    if app_rdy = '1' then
+                        -- read command accepted
+                        app_en <= '0';
+                        ui_awg_rd_ack_i <= '1';
+                        RAMstate <= A;
+                    else
+                        RAMstate <= H;
+                    end if;
+                    debugDDRst <= 7;
+                
                 when others =>
                 
                     RAMstate <= A;
                         
             end case; -- RAMstate
             
+            -- viewport readout request
+            if ui_reset_d = '1' then
+                vp_req <= '0';
+                vp_active <= '0';
+                vp_flush <= '0';
+                srch_active <= '0';
+                srch_pending <= to_unsigned(0,srch_pending'length);
+                vp_lane_wr <= to_unsigned(0,vp_lane_wr'length);
+                vp_lane_rd <= to_unsigned(0,vp_lane_rd'length);
+                pyr_queue_wr <= to_unsigned(0,pyr_queue_wr'length);
+                pyr_queue_rd <= to_unsigned(0,pyr_queue_rd'length);
+            elsif ui_vp_start = '1' then
+                vp_req <= '1';
+            end if;
+            
          end if; -- ui_clk_sync_rst = '0'
           
     end if; -- rising_edge(ui_clk_i)               
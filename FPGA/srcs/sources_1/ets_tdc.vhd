@@ -0,0 +1,154 @@
+----------------------------------------------------------------------------------
+--    Copyright (C) 2019 Dejan Priversek
+--
+--    This program is free software: you can redistribute it and/or modify
+--    it under the terms of the GNU General Public License as published by
+--    the Free Software Foundation, either version 3 of the License, or
+--    (at your option) any later version.
+--
+--    This program is distributed in the hope that it will be useful,
+--    but WITHOUT ANY WARRANTY; without even the implied warranty of
+--    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+--    GNU General Public License for more details.
+--
+--    You should have received a copy of the GNU General Public License
+--    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+----------------------------------------------------------------------------------
+
+--
+-- Scopefun firmware: ETS trigger time-to-digital converter with code-density calibration
+--
+-- Thermometer code of the analog trigger delay line (number of taps passed by trigger edge
+-- until sampling clock edge) is encoded by a pipelined ones counter (tolerant to bubbles).
+-- Fine time is read from a per-code delay table: time from trigger edge to clock edge
+-- (clock period / 65536, center of code bin).
+-- Table is calibrated in background: trigger edges of a signal asynchronous to ADC clock
+-- hit every point of the clock period with equal probability, so width of each code is
+-- proportional to the number of its hits. After 2^CAL_LOG2 hits the histogram is integrated
+-- into the table and a new histogram is started. Until first calibration taps are taken
+-- as uniform (32 taps per clock period).
+-- Result of every hit is valid 3 clk after Hit.
+--
+
+library IEEE;
+use IEEE.STD_LOGIC_1164.ALL;
+use IEEE.NUMERIC_STD.ALL;
+
+entity ets_tdc is
+    generic (
+        CAL_LOG2 : integer := 16    -- hits per calibration (2^CAL_LOG2, at least 2^16)
+    );
+    Port (
+        clk : in std_logic;                             -- ADC clock
+        TapReg : in std_logic_vector(31 downto 0);      -- delay line thermometer code
+        Hit : in std_logic;                             -- analog trigger edge, TapReg is valid
+        Valid : out std_logic;
+        Code : out std_logic_vector(5 downto 0);        -- number of taps
+        Fine : out std_logic_vector(15 downto 0);       -- calibrated fine time
+        Calibrated : out std_logic                      -- table was calibrated at least once
+    );
+end ets_tdc;
+
+architecture Behavioral of ets_tdc is
+
+type cnt_array is array(0 to 3) of unsigned(3 downto 0);
+type hist_array is array(0 to 32) of unsigned(CAL_LOG2 downto 0);
+type lut_array is array(0 to 32) of std_logic_vector(15 downto 0);
+
+-- number of ones in a byte
+function ones8(x : std_logic_vector(7 downto 0)) return unsigned is
+    variable n : unsigned(3 downto 0);
+begin
+    n := (others => '0');
+    for i in 0 to 7 loop
+        if x(i) = '1' then
+            n := n + 1;
+        end if;
+    end loop;
+    return n;
+end function;
+
+-- uniform taps: center of each of 32 bins (last code is end of period)
+function lut_init return lut_array is
+    variable r : lut_array;
+begin
+    for i in 0 to 31 loop
+        r(i) := std_logic_vector(to_unsigned(i*2048 + 1024,16));
+    end loop;
+    r(32) := X"FFFF";
+    return r;
+end function;
+
+-- encoder pipeline
+signal cnt_1 : cnt_array := (others => (others => '0'));
+signal hit_1 : std_logic := '0';
+signal code_2 : unsigned(5 downto 0) := (others => '0');
+signal hit_2 : std_logic := '0';
+
+-- calibration
+signal lut : lut_array := lut_init;
+signal hist : hist_array := (others => (others => '0'));
+signal hits : unsigned(CAL_LOG2 downto 0) := (others => '0');
+signal cal_sum : std_logic := '0';
+signal cal_idx : integer range 0 to 32 := 0;
+signal cal_acc : unsigned(CAL_LOG2 downto 0) := (others => '0');
+signal calibrated_i : std_logic := '0';
+
+attribute ram_style: string;
+attribute ram_style of lut: signal is "distributed";
+
+begin
+
+Calibrated <= calibrated_i;
+
+tdc_proc: process (clk)
+    variable v_pos : unsigned(CAL_LOG2 downto 0);
+begin
+    if rising_edge(clk) then
+
+        -- thermometer to binary: ones in each byte, then sum
+        for g in 0 to 3 loop
+            cnt_1(g) <= ones8(TapReg(8*g+7 downto 8*g));
+        end loop;
+        hit_1 <= Hit;
+        code_2 <= resize(cnt_1(0),6) + resize(cnt_1(1),6) + resize(cnt_1(2),6) + resize(cnt_1(3),6);
+        hit_2 <= hit_1;
+        -- fine time
+        Code <= std_logic_vector(code_2);
+        Fine <= lut(to_integer(code_2));
+        Valid <= hit_2;
+
+        if cal_sum = '0' then
+            -- code density histogram
+            if hit_2 = '1' then
+                hist(to_integer(code_2)) <= hist(to_integer(code_2)) + 1;
+                if hits = 2**CAL_LOG2-1 then
+                    cal_sum <= '1';
+                    cal_idx <= 0;
+                    cal_acc <= (others => '0');
+                end if;
+                hits <= hits + 1;
+            end if;
+        else
+            -- integrate histogram: bin center is sum of preceding bins + half of this bin
+            v_pos := cal_acc + shift_right(hist(cal_idx),1);
+            if v_pos(CAL_LOG2) = '1' then
+                lut(cal_idx) <= X"FFFF";
+            else
+                lut(cal_idx) <= std_logic_vector(v_pos(CAL_LOG2-1 downto CAL_LOG2-16));
+            end if;
+            cal_acc <= cal_acc + hist(cal_idx);
+            hist(cal_idx) <= (others => '0');
+            if cal_idx = 32 then
+                cal_sum <= '0';
+                hits <= (others => '0');
+                calibrated_i <= '1';
+            else
+                cal_idx <= cal_idx + 1;
+            end if;
+        end if;
+
+    end if;
+end process;
+
+end Behavioral;
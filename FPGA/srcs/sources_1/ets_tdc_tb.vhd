@@ -0,0 +1,175 @@
+----------------------------------------------------------------------------------
+--    Copyright (C) 2019 Dejan Priversek
+--
+--    This program is free software: you can redistribute it and/or modify
+--    it under the terms of the GNU General Public License as published by
+--    the Free Software Foundation, either version 3 of the License, or
+--    (at your option) any later version.
+--
+--    This program is distributed in the hope that it will be useful,
+--    but WITHOUT ANY WARRANTY; without even the implied warranty of
+--    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+--    GNU General Public License for more details.
+--
+--    You should have received a copy of the GNU General Public License
+--    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+----------------------------------------------------------------------------------
+
+--
+-- ETS TDC testbench
+-- delay line with unequal taps is hit at phases spread evenly over the clock period,
+-- after calibration fine time of every code must be the center of its bin
+--
+
+LIBRARY IEEE;
+USE IEEE.STD_LOGIC_1164.ALL;
+USE IEEE.NUMERIC_STD.ALL;
+
+library user_lib;
+use user_lib.TextUtil.all;
+
+ENTITY ets_tdc_tb IS
+END ets_tdc_tb;
+
+ARCHITECTURE behavior OF ets_tdc_tb IS
+
+    -- Component Declaration for the Unit Under Test (UUT)
+
+    component ets_tdc is
+    generic (
+        CAL_LOG2 : integer := 16
+    );
+    Port (
+        clk : in std_logic;
+        TapReg : in std_logic_vector(31 downto 0);
+        Hit : in std_logic;
+        Valid : out std_logic;
+        Code : out std_logic_vector(5 downto 0);
+        Fine : out std_logic_vector(15 downto 0);
+        Calibrated : out std_logic
+    );
+    end component;
+
+    --constants
+    CONSTANT PERIOD_PS : integer := 4000;   -- ADC clock period
+    CONSTANT PHASE_STEP : integer := 1237;  -- hit phase step (ps, coprime with period)
+    CONSTANT TOLERANCE : integer := 200;    -- fine time error (period / 65536)
+
+    -- tap delays (ps), taps after end of period are never reached
+    type tap_array is array(0 to 31) of integer;
+    function tap_init return tap_array is
+        variable r : tap_array;
+    begin
+        for i in 0 to 31 loop
+            r(i) := 100 + 40 * (i mod 3);
+        end loop;
+        return r;
+    end function;
+    CONSTANT TAP_PS : tap_array := tap_init;
+
+    -- thermometer code of a hit at phase (ps after trigger edge)
+    function therm(ph : integer) return std_logic_vector is
+        variable r : std_logic_vector(31 downto 0);
+        variable t : integer;
+    begin
+        r := (others => '0');
+        t := 0;
+        for i in 0 to 31 loop
+            t := t + TAP_PS(i);
+            if t <= ph then
+                r(i) := '1';
+            end if;
+        end loop;
+        return r;
+    end function;
+
+    --Inputs
+    signal clk : std_logic := '0';
+    signal TapReg : std_logic_vector(31 downto 0) := (others => '0');
+    signal Hit : std_logic := '0';
+
+    --Outputs
+    signal Valid : std_logic;
+    signal Code : std_logic_vector(5 downto 0);
+    signal Fine : std_logic_vector(15 downto 0);
+    signal Calibrated : std_logic;
+
+    signal sim_done : boolean := false;
+
+    -- Clock period definitions
+    constant clk_period : time := 4 ns;
+
+BEGIN
+
+    -- Instantiate the Unit Under Test (UUT)
+    uut: ets_tdc
+    PORT MAP (
+        clk => clk,
+        TapReg => TapReg,
+        Hit => Hit,
+        Valid => Valid,
+        Code => Code,
+        Fine => Fine,
+        Calibrated => Calibrated
+    );
+
+    -- Clock process definitions
+    clk_process :process
+    begin
+        if sim_done then
+            wait;
+        end if;
+        clk <= '0';
+        wait for clk_period/2;
+        clk <= '1';
+        wait for clk_period/2;
+    end process;
+
+    -- Stimulus process
+    stim_proc: process
+        variable errors : integer := 0;
+        variable ph : integer := 0;
+        variable t : integer;
+        variable expected : integer;
+        variable n_codes : integer := 0;
+    begin
+        wait for 100 ns;
+        wait until rising_edge(clk);
+        -- calibration hits, every second clk
+        while Calibrated = '0' loop
+            TapReg <= therm(ph);
+            Hit <= '1';
+            ph := (ph + PHASE_STEP) mod PERIOD_PS;
+            wait until rising_edge(clk);
+            Hit <= '0';
+            wait until rising_edge(clk);
+        end loop;
+
+        -- hit center of every code reached within the period
+        t := 0;
+        for i in 0 to 31 loop
+            exit when t >= PERIOD_PS;
+            if t + TAP_PS(i) > PERIOD_PS then
+                expected := (t + PERIOD_PS) * 32768 / PERIOD_PS;
+            else
+                expected := (2*t + TAP_PS(i)) * 32768 / PERIOD_PS;
+            end if;
+            TapReg <= therm(t);
+            Hit <= '1';
+            wait until rising_edge(clk);
+            Hit <= '0';
+            wait until Valid = '1';
+            Check(to_integer(unsigned(Code)) = i and abs(to_integer(unsigned(Fine)) - expected) <= TOLERANCE,
+                  "code " & integer'image(to_integer(unsigned(Code))) & ": fine " & integer'image(to_integer(unsigned(Fine))) &
+                      ", expected code " & integer'image(i) & ", fine " & integer'image(expected), errors);
+            wait until rising_edge(clk);
+            t := t + TAP_PS(i);
+            n_codes := n_codes + 1;
+        end loop;
+        Print(integer'image(n_codes) & " codes checked");
+
+        EndTest("ETS TDC", errors, sim_done);
+        wait;
+    end process;
+
+END;
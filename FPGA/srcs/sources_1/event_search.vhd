@@ -0,0 +1,291 @@
+----------------------------------------------------------------------------------
+--    Copyright (C) 2019 Dejan Priversek
+--
+--    This program is free software: you can redistribute it and/or modify
+--    it under the terms of the GNU General Public License as published by
+--    the Free Software Foundation, either version 3 of the License, or
+--    (at your option) any later version.
+--
+--    This program is distributed in the hope that it will be useful,
+--    but WITHOUT ANY WARRANTY; without even the implied warranty of
+--    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+--    GNU General Public License for more details.
+--
+--    You should have received a copy of the GNU General Public License
+--    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+----------------------------------------------------------------------------------
+
+--
+-- Scopefun firmware: event search over a saved frame
+--
+-- Evaluates search condition on RAM words (4 samples, first sample in MSBs) read from saved frame
+-- and returns list of matching sample positions (from frame start), 4 per output word:
+--   "00000" & position(26 downto 0), list is padded with X"FFFFFFFF" to ResultLen entries
+--
+-- Search modes:
+--   "01": level crossing of CH A/B (comparator with hysteresis: high at >= Level, low at < Level-Hyst)
+--         Edge "01": rising, "10": falling, "11": both
+--   "10": pulse shorter than Width samples (position of pulse start)
+--         Edge "01": positive pulses, "10": negative pulses, "11": both
+--   "11": digital pattern match (same as logic analyzer trigger stage: previous sample matches
+--         PatternA, current sample matches PatternB, compared bits selected by Mask)
+--
+
+library IEEE;
+use IEEE.STD_LOGIC_1164.ALL;
+use IEEE.NUMERIC_STD.ALL;
+
+entity event_search is
+    Port (
+        clk : in std_logic;
+        Start : in std_logic;                            -- start new search (clears results)
+        -- search condition
+        Mode : in std_logic_vector(1 downto 0);
+        Channel : in std_logic;                          -- '0': CH A, '1': CH B
+        Edge : in std_logic_vector(1 downto 0);
+        Level : in std_logic_vector(9 downto 0);         -- signed
+        Hyst : in std_logic_vector(9 downto 0);          -- unsigned
+        Width : in std_logic_vector(26 downto 0);
+        Mask : in std_logic_vector(11 downto 0);
+        PatternA : in std_logic_vector(11 downto 0);
+        PatternB : in std_logic_vector(11 downto 0);
+        -- searched samples
+        FirstLane : in std_logic_vector(1 downto 0);     -- first searched sample within first RAM word
+        SampleCnt : in std_logic_vector(26 downto 0);    -- number of searched samples
+        IndexBase : in std_logic_vector(26 downto 0);    -- position of first searched sample
+        ResultLen : in std_logic_vector(26 downto 0);    -- number of list entries
+        DataIn : in std_logic_vector(127 downto 0);
+        DataInEn : in std_logic;
+        InputEnd : in std_logic;                         -- all RAM words were sent
+        Found : out std_logic;                           -- ResultLen events found (reading can stop)
+        -- result list
+        OutReady : in std_logic;                         -- output can accept padding words
+        DataOut : out std_logic_vector(127 downto 0);
+        DataOutValid : out std_logic;
+        Done : out std_logic                             -- all list entries were sent out
+    );
+end event_search;
+
+architecture Behavioral of event_search is
+
+CONSTANT NO_EVENT : std_logic_vector(31 downto 0) := X"FFFFFFFF";
+
+type idx_array is array(0 to 3) of unsigned(26 downto 0);
+type dig_array is array(0 to 3) of std_logic_vector(11 downto 0);
+
+-- stage 1: per sample comparator results
+signal s1_en : std_logic := '0';
+signal s1_valid : std_logic_vector(0 to 3) := (others => '0');
+signal s1_hi : std_logic_vector(0 to 3);
+signal s1_lo : std_logic_vector(0 to 3);
+signal s1_dig : dig_array;
+signal s1_idx : idx_array;
+signal word_pos : unsigned(28 downto 0) := (others => '0');  -- position of first sample in RAM word
+
+-- stage 2: search state carried from sample to sample
+signal st_init : std_logic := '0';          -- first sample was seen
+signal st_hi : std_logic := '0';            -- comparator state
+signal pulse_start : unsigned(26 downto 0);
+signal pulse_valid : std_logic := '0';      -- pulse start was seen
+signal dig_prev : std_logic_vector(11 downto 0);
+signal match_prev : std_logic := '0';
+
+-- result list
+signal pack : std_logic_vector(127 downto 0);
+signal pack_cnt : integer range 0 to 3 := 0;
+signal found_cnt : unsigned(26 downto 0) := (others => '0');
+signal total_cnt : unsigned(26 downto 0) := (others => '0');
+signal found_i : std_logic := '0';
+signal done_i : std_logic := '0';
+
+signal lvl_lo : signed(10 downto 0);        -- lower comparator threshold
+
+attribute mark_debug: boolean;
+attribute mark_debug of found_cnt : signal is true;
+attribute mark_debug of done_i : signal is true;
+
+begin
+
+Found <= found_i;
+Done <= done_i;
+
+search_proc: process(clk)
+    variable s : signed(9 downto 0);
+    variable p : unsigned(28 downto 0);
+    variable v_init, v_hi, v_pulse_valid, v_match_prev, v_match, v_hit, v_found : std_logic;
+    variable v_pulse_start : unsigned(26 downto 0);
+    variable v_dig_prev : std_logic_vector(11 downto 0);
+    variable v_pack : std_logic_vector(127 downto 0);
+    variable v_cnt : integer range 0 to 4;
+    variable v_found_cnt, v_total : unsigned(26 downto 0);
+    variable v_entry : std_logic_vector(31 downto 0);
+    variable v_emit : std_logic;
+    variable v_out : std_logic_vector(127 downto 0);
+begin
+
+    if rising_edge(clk) then
+
+        lvl_lo <= resize(signed(Level),11) - signed(resize(unsigned(Hyst),11));
+        DataOutValid <= '0';
+
+        if Start = '1' then
+            s1_en <= '0';
+            word_pos <= (others => '0');
+            st_init <= '0';
+            pulse_valid <= '0';
+            match_prev <= '0';
+            pack_cnt <= 0;
+            found_cnt <= (others => '0');
+            total_cnt <= (others => '0');
+            if unsigned(ResultLen) = 0 then
+                found_i <= '1';
+            else
+                found_i <= '0';
+            end if;
+            done_i <= '0';
+        else
+
+            -- stage 1: compare samples to thresholds and select samples within searched range
+            s1_en <= DataInEn;
+            if DataInEn = '1' then
+                word_pos <= word_pos + 4;
+                for l in 0 to 3 loop
+                    p := word_pos + l;
+                    if Channel = '0' then
+                        s := signed(DataIn(127-32*l downto 118-32*l));
+                    else
+                        s := signed(DataIn(117-32*l downto 108-32*l));
+                    end if;
+                    if s >= signed(Level) then s1_hi(l) <= '1'; else s1_hi(l) <= '0'; end if;
+                    if resize(s,11) < lvl_lo then s1_lo(l) <= '1'; else s1_lo(l) <= '0'; end if;
+                    s1_dig(l) <= DataIn(107-32*l downto 96-32*l);
+                    if p >= unsigned(FirstLane) and p < resize(unsigned(FirstLane),29) + unsigned(SampleCnt) then
+                        s1_valid(l) <= '1';
+                    else
+                        s1_valid(l) <= '0';
+                    end if;
+                    s1_idx(l) <= unsigned(IndexBase) + resize(p - unsigned(FirstLane),27);
+                end loop;
+            end if;
+
+            -- stage 2: evaluate search condition sample by sample and pack events into output words
+            v_init := st_init;
+            v_hi := st_hi;
+            v_pulse_valid := pulse_valid;
+            v_pulse_start := pulse_start;
+            v_dig_prev := dig_prev;
+            v_match_prev := match_prev;
+            v_pack := pack;
+            v_cnt := pack_cnt;
+            v_found_cnt := found_cnt;
+            v_total := total_cnt;
+            v_found := found_i;
+            v_emit := '0';
+            v_out := pack;
+
+            if s1_en = '1' then
+                for l in 0 to 3 loop
+                    if s1_valid(l) = '1' then
+                        v_hit := '0';
+                        v_entry := "00000" & std_logic_vector(s1_idx(l));
+                        case Mode is
+                            when "01" | "10" =>
+                                if v_init = '1' then
+                                    if (v_hi = '0' and s1_hi(l) = '1') or (v_hi = '1' and s1_lo(l) = '1') then
+                                        if Mode = "01" then
+                                            -- level crossing: rising (Edge(0)) or falling (Edge(1))
+                                            if v_hi = '0' then v_hit := Edge(0); else v_hit := Edge(1); end if;
+                                        elsif v_pulse_valid = '1' and s1_idx(l) - v_pulse_start < unsigned(Width) then
+                                            -- end of short pulse: negative pulse ends at rising edge, positive at falling edge
+                                            if v_hi = '0' then v_hit := Edge(1); else v_hit := Edge(0); end if;
+                                            v_entry := "00000" & std_logic_vector(v_pulse_start);
+                                        end if;
+                                        -- each edge starts a new pulse
+                                        v_pulse_start := s1_idx(l);
+                                        v_pulse_valid := '1';
+                                        v_hi := not(v_hi);
+                                    end if;
+                                else
+                                    v_hi := s1_hi(l);
+                                    v_init := '1';
+                                end if;
+                            when "11" =>
+                                if ((v_dig_prev xnor PatternA) and (s1_dig(l) xnor PatternB) and Mask) = Mask then
+                                    v_match := '1';
+                                else
+                                    v_match := '0';
+                                end if;
+                                if v_init = '1' and v_match = '1' and v_match_prev = '0' then
+                                    v_hit := '1';
+                                end if;
+                                v_match_prev := v_match and v_init;
+                                v_dig_prev := s1_dig(l);
+                                v_init := '1';
+                            when others =>
+                                null;
+                        end case;
+                        -- add event to result list
+                        if v_hit = '1' and v_found = '0' then
+                            v_pack := v_pack(95 downto 0) & v_entry;
+                            v_found_cnt := v_found_cnt + 1;
+                            v_total := v_total + 1;
+                            if v_found_cnt = unsigned(ResultLen) then
+                                v_found := '1';
+                            end if;
+                            if v_cnt = 3 then
+                                v_out := v_pack;
+                                v_emit := '1';
+                                v_cnt := 0;
+                            else
+                                v_cnt := v_cnt + 1;
+                            end if;
+                        end if;
+                    end if;
+                end loop;
+            elsif (InputEnd = '1' or v_found = '1') and OutReady = '1' and done_i = '0' and s1_en = '0' and DataInEn = '0' then
+                -- search finished: pad result list to ResultLen entries
+                for l in 0 to 3 loop
+                    if v_total /= unsigned(ResultLen) then
+                        v_pack := v_pack(95 downto 0) & NO_EVENT;
+                        v_total := v_total + 1;
+                        if v_cnt = 3 then
+                            v_out := v_pack;
+                            v_emit := '1';
+                            v_cnt := 0;
+                        else
+                            v_cnt := v_cnt + 1;
+                        end if;
+                    end if;
+                end loop;
+                if v_emit = '0' then
+                    if v_cnt /= 0 then
+                        -- last partially filled word: align to MSBs
+                        v_out := std_logic_vector(shift_left(unsigned(v_pack), 32*(4-v_cnt)));
+                        v_emit := '1';
+                        v_cnt := 0;
+                    end if;
+                    done_i <= '1';
+                end if;
+            end if;
+
+            st_init <= v_init;
+            st_hi <= v_hi;
+            pulse_valid <= v_pulse_valid;
+            pulse_start <= v_pulse_start;
+            dig_prev <= v_dig_prev;
+            match_prev <= v_match_prev;
+            pack <= v_pack;
+            pack_cnt <= v_cnt;
+            found_cnt <= v_found_cnt;
+            total_cnt <= v_total;
+            found_i <= v_found;
+            DataOut <= v_out;
+            DataOutValid <= v_emit;
+
+        end if;
+
+    end if;
+
+end process;
+
+end Behavioral;
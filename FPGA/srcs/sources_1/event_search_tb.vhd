@@ -0,0 +1,214 @@
+----------------------------------------------------------------------------------
+--    Copyright (C) 2019 Dejan Priversek
+--
+--    This program is free software: you can redistribute it and/or modify
+--    it under the terms of the GNU General Public License as published by
+--    the Free Software Foundation, either version 3 of the License, or
+--    (at your option) any later version.
+--
+--    This program is distributed in the hope that it will be useful,
+--    but WITHOUT ANY WARRANTY; without even the implied warranty of
+--    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+--    GNU General Public License for more details.
+--
+--    You should have received a copy of the GNU General Public License
+--    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+----------------------------------------------------------------------------------
+
+--
+-- event search testbench
+-- CH A is a square wave (period 40 samples) with a single sample negative glitch at sample 130
+--
+
+LIBRARY IEEE;
+USE IEEE.STD_LOGIC_1164.ALL;
+USE IEEE.NUMERIC_STD.ALL;
+
+library user_lib;
+use user_lib.TextUtil.all;
+
+ENTITY event_search_tb IS
+END event_search_tb;
+
+ARCHITECTURE behavior OF event_search_tb IS
+
+    -- Component Declaration for the Unit Under Test (UUT)
+
+    component event_search is
+    Port (
+        clk : in std_logic;
+        Start : in std_logic;
+        Mode : in std_logic_vector(1 downto 0);
+        Channel : in std_logic;
+        Edge : in std_logic_vector(1 downto 0);
+        Level : in std_logic_vector(9 downto 0);
+        Hyst : in std_logic_vector(9 downto 0);
+        Width : in std_logic_vector(26 downto 0);
+        Mask : in std_logic_vector(11 downto 0);
+        PatternA : in std_logic_vector(11 downto 0);
+        PatternB : in std_logic_vector(11 downto 0);
+        FirstLane : in std_logic_vector(1 downto 0);
+        SampleCnt : in std_logic_vector(26 downto 0);
+        IndexBase : in std_logic_vector(26 downto 0);
+        ResultLen : in std_logic_vector(26 downto 0);
+        DataIn : in std_logic_vector(127 downto 0);
+        DataInEn : in std_logic;
+        InputEnd : in std_logic;
+        Found : out std_logic;
+        OutReady : in std_logic;
+        DataOut : out std_logic_vector(127 downto 0);
+        DataOutValid : out std_logic;
+        Done : out std_logic
+    );
+    end component;
+
+    --constants
+    CONSTANT N_WORDS : integer := 100;
+    CONSTANT RESULT_LEN : integer := 16;
+    type result_array is array(0 to RESULT_LEN-1) of integer;
+    -- rising edges (level 0, hysteresis 50), -1: no event
+    CONSTANT RISING : result_array := (40, 80, 120, 131, 160, 200, 240, 280, 320, 360, -1, -1, -1, -1, -1, -1);
+    -- negative pulses shorter than 5 samples
+    CONSTANT GLITCH : result_array := (130, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+
+    --Inputs
+    signal clk : std_logic := '0';
+    signal Start : std_logic := '0';
+    signal Mode : std_logic_vector(1 downto 0) := "00";
+    signal Edge : std_logic_vector(1 downto 0) := "00";
+    signal DataIn : std_logic_vector(127 downto 0) := (others => '0');
+    signal DataInEn : std_logic := '0';
+    signal InputEnd : std_logic := '0';
+
+    --Outputs
+    signal Found : std_logic;
+    signal DataOut : std_logic_vector(127 downto 0);
+    signal DataOutValid : std_logic;
+    signal Done : std_logic;
+
+    signal expected : result_array;
+    signal result_cnt : integer := 0;
+    signal errors : integer := 0;
+
+    signal sim_done : boolean := false;
+
+    -- Clock period definitions
+    constant clk_period : time := 10 ns;
+
+    function sample(i : integer) return std_logic_vector is
+    begin
+        if (i mod 40 < 20) and i /= 130 then
+            return std_logic_vector(to_signed(200,10)) & "0000000000" & X"000";
+        else
+            return std_logic_vector(to_signed(-200,10)) & "0000000000" & X"000";
+        end if;
+    end function;
+
+BEGIN
+
+    -- Instantiate the Unit Under Test (UUT)
+    uut: event_search
+    PORT MAP (
+        clk => clk,
+        Start => Start,
+        Mode => Mode,
+        Channel => '0',
+        Edge => Edge,
+        Level => std_logic_vector(to_signed(0,10)),
+        Hyst => std_logic_vector(to_unsigned(50,10)),
+        Width => std_logic_vector(to_unsigned(5,27)),
+        Mask => X"000",
+        PatternA => X"000",
+        PatternB => X"000",
+        FirstLane => "00",
+        SampleCnt => std_logic_vector(to_unsigned(4*N_WORDS,27)),
+        IndexBase => std_logic_vector(to_unsigned(0,27)),
+        ResultLen => std_logic_vector(to_unsigned(RESULT_LEN,27)),
+        DataIn => DataIn,
+        DataInEn => DataInEn,
+        InputEnd => InputEnd,
+        Found => Found,
+        OutReady => '1',
+        DataOut => DataOut,
+        DataOutValid => DataOutValid,
+        Done => Done
+    );
+
+    -- Clock process definitions
+    clk_process :process
+    begin
+        if sim_done then
+            wait;
+        end if;
+        clk <= '0';
+        wait for clk_period/2;
+        clk <= '1';
+        wait for clk_period/2;
+    end process;
+
+    -- Stimulus process
+    stim_proc: process
+    begin
+        for t in 0 to 1 loop
+            if t = 0 then
+                Mode <= "01";
+                Edge <= "01";
+                expected <= RISING;
+            else
+                Mode <= "10";
+                Edge <= "10";
+                expected <= GLITCH;
+            end if;
+            InputEnd <= '0';
+            Start <= '1';
+            wait until rising_edge(clk);
+            Start <= '0';
+            wait until rising_edge(clk);
+            for i in 0 to N_WORDS-1 loop
+                DataIn <= sample(4*i) & sample(4*i+1) & sample(4*i+2) & sample(4*i+3);
+                DataInEn <= '1';
+                wait until rising_edge(clk);
+            end loop;
+            DataInEn <= '0';
+            wait until rising_edge(clk);
+            InputEnd <= '1';
+            wait until Done = '1';
+            wait until rising_edge(clk);
+            wait until rising_edge(clk);
+            if result_cnt /= RESULT_LEN then
+                Print("search " & integer'image(t) & ": " & integer'image(result_cnt) & " results");
+            end if;
+            assert result_cnt = RESULT_LEN report "wrong number of results" severity failure;
+        end loop;
+        EndTest("event search", errors, sim_done);
+        wait;
+    end process;
+
+    -- compare result list to expected positions
+    check_proc: process(clk)
+        variable r : integer;
+    begin
+        if rising_edge(clk) then
+            if Start = '1' then
+                result_cnt <= 0;
+            elsif DataOutValid = '1' then
+                for l in 0 to 3 loop
+                    if DataOut(127-32*l downto 96-32*l) = X"FFFFFFFF" then
+                        r := -1;
+                    else
+                        r := to_integer(unsigned(DataOut(126-32*l downto 96-32*l)));
+                    end if;
+                    if result_cnt+l < RESULT_LEN then
+                        if r /= expected(result_cnt+l) then
+                            Print("result " & integer'image(result_cnt+l) & ": " & integer'image(r) &
+                                  ", expected " & integer'image(expected(result_cnt+l)));
+                            errors <= errors + 1;
+                        end if;
+                    end if;
+                end loop;
+                result_cnt <= result_cnt + 4;
+            end if;
+        end if;
+    end process;
+
+END;
@@ -0,0 +1,324 @@
+----------------------------------------------------------------------------------
+--    Copyright (C) 2019 Dejan Priversek
+--
+--    This program is free software: you can redistribute it and/or modify
+--    it under the terms of the GNU General Public License as published by
+--    the Free Software Foundation, either version 3 of the License, or
+--    (at your option) any later version.
+--
+--    This program is distributed in the hope that it will be useful,
+--    but WITHOUT ANY WARRANTY; without even the implied warranty of
+--    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+--    GNU General Public License for more details.
+--
+--    You should have received a copy of the GNU General Public License
+--    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+----------------------------------------------------------------------------------
+
+--
+-- Scopefun firmware: frequency response analyzer (digital lock-in)
+--
+-- For every generator frequency (DeltaTgl toggles when AWG_1 delta is changed, e.g. by sweep),
+-- Settle samples are skipped and channels A and B are mixed with reference cosine/sine
+-- and accumulated for at least Length samples, until the end of reference period
+-- (whole periods, at most MAX_SAMPLES samples):
+--   I = sum(x * cos), Q = sum(x * sin)
+-- Reference runs on ADC clock with generator frequency (AWG clock is 4/5 of ADC clock),
+-- its phase against generator is unknown, so gain and phase are taken as (I_B + jQ_B)/(I_A + jQ_A).
+-- ResultTgl toggles when results of a new point are ready (held until next point is finished).
+--
+
+library IEEE;
+use IEEE.STD_LOGIC_1164.ALL;
+use IEEE.NUMERIC_STD.ALL;
+use IEEE.MATH_REAL.ALL;
+
+entity fra_core is
+    Port (
+        clk : in std_logic;                             -- ADC clock
+        Enable : in std_logic;
+        Settle : in std_logic_vector(23 downto 0);      -- samples skipped after frequency change
+        Length : in std_logic_vector(22 downto 0);      -- minimal number of integrated samples
+        DeltaTgl : in std_logic;                        -- generator delta was changed (other clock domain)
+        Delta : in std_logic_vector(31 downto 0);       -- generator delta (stable when DeltaTgl toggles)
+        DataA : in signed(9 downto 0);
+        DataB : in signed(9 downto 0);
+        ResultTgl : out std_logic;
+        ResultDelta : out std_logic_vector(31 downto 0);
+        ResultCount : out std_logic_vector(31 downto 0); -- bit 31: whole reference periods, number of samples
+        ResultIA : out std_logic_vector(47 downto 0);
+        ResultQA : out std_logic_vector(47 downto 0);
+        ResultIB : out std_logic_vector(47 downto 0);
+        ResultQB : out std_logic_vector(47 downto 0);
+        Busy : out std_logic
+    );
+end fra_core;
+
+architecture Behavioral of fra_core is
+
+CONSTANT MAX_SAMPLES : integer := 2**23-1;  -- accumulators can not overflow (10b sample * 15b reference)
+CONSTANT PIPE_LEN : integer := 4;           -- reference phase to accumulator
+
+-- quarter wave sine, half sample offset (symmetric quadrants): round(16383 * sin(2*pi*(i+0.5)/4096))
+type sin_rom_t is array(0 to 1023) of unsigned(13 downto 0);
+
+function sin_rom_init return sin_rom_t is
+    variable r : sin_rom_t;
+begin
+    for i in 0 to 1023 loop
+        r(i) := to_unsigned(integer(round(16383.0 * sin(MATH_2_PI * (real(i) + 0.5) / 4096.0))),14);
+    end loop;
+    return r;
+end function;
+
+CONSTANT SIN_ROM : sin_rom_t := sin_rom_init;
+
+CONSTANT ST_IDLE: STD_LOGIC_VECTOR (2 DownTo 0) := "000";
+CONSTANT ST_DIV: STD_LOGIC_VECTOR (2 DownTo 0) := "001";
+CONSTANT ST_SETTLE: STD_LOGIC_VECTOR (2 DownTo 0) := "010";
+CONSTANT ST_MEAS: STD_LOGIC_VECTOR (2 DownTo 0) := "011";
+CONSTANT ST_DONE: STD_LOGIC_VECTOR (2 DownTo 0) := "100";
+signal fra_state : std_logic_vector (2 downto 0) := ST_IDLE;
+
+signal enable_d : std_logic := '0';
+signal enable_dd : std_logic := '0';
+signal enable_ddd : std_logic := '0';
+signal delta_tgl_d : std_logic := '0';
+signal delta_tgl_dd : std_logic := '0';
+signal delta_tgl_ddd : std_logic := '0';
+signal delta_i : std_logic_vector(31 downto 0) := (others => '0');
+signal settle_cnt : unsigned(23 downto 0) := (others => '0');
+
+-- reference NCO: phase increment per ADC clock = 4/5 * generator delta (units of 2^-34 period)
+signal div_n : unsigned(33 downto 0) := (others => '0');
+signal div_q : unsigned(33 downto 0) := (others => '0');
+signal div_r : unsigned(2 downto 0) := (others => '0');
+signal div_cnt : integer range 0 to 34 := 0;
+signal nco_inc : unsigned(33 downto 0) := (others => '0');
+signal nco_inc_r : unsigned(2 downto 0) := (others => '0');
+signal nco_ph : unsigned(33 downto 0) := (others => '0');
+signal nco_rem : unsigned(2 downto 0) := (others => '0');
+
+-- pipeline
+type data_pipe_t is array(1 to PIPE_LEN) of signed(9 downto 0);
+signal a_pipe : data_pipe_t := (others => (others => '0'));
+signal b_pipe : data_pipe_t := (others => (others => '0'));
+signal meas_pipe : std_logic_vector(0 to PIPE_LEN) := (others => '0');
+signal wrap_pipe : std_logic_vector(1 to PIPE_LEN) := (others => '0');
+signal ph_msb_d : std_logic := '0';
+signal addr_s : unsigned(9 downto 0) := (others => '0');
+signal addr_c : unsigned(9 downto 0) := (others => '0');
+signal neg_s_1 : std_logic := '0';
+signal neg_c_1 : std_logic := '0';
+signal neg_s_2 : std_logic := '0';
+signal neg_c_2 : std_logic := '0';
+signal rom_s : unsigned(13 downto 0) := (others => '0');
+signal rom_c : unsigned(13 downto 0) := (others => '0');
+signal ref_s : signed(14 downto 0) := (others => '0');
+signal ref_c : signed(14 downto 0) := (others => '0');
+signal p_ia : signed(24 downto 0) := (others => '0');
+signal p_qa : signed(24 downto 0) := (others => '0');
+signal p_ib : signed(24 downto 0) := (others => '0');
+signal p_qb : signed(24 downto 0) := (others => '0');
+
+-- accumulators
+signal acc_ia : signed(47 downto 0) := (others => '0');
+signal acc_qa : signed(47 downto 0) := (others => '0');
+signal acc_ib : signed(47 downto 0) := (others => '0');
+signal acc_qb : signed(47 downto 0) := (others => '0');
+signal acc_cnt : unsigned(22 downto 0) := (others => '0');
+signal acc_done : std_logic := '0';
+signal acc_whole : std_logic := '0';
+signal result_tgl_i : std_logic := '0';
+
+attribute ASYNC_REG: boolean;
+attribute ASYNC_REG of enable_d: signal is true;
+attribute ASYNC_REG of enable_dd: signal is true;
+attribute ASYNC_REG of delta_tgl_d: signal is true;
+attribute ASYNC_REG of delta_tgl_dd: signal is true;
+
+attribute rom_style : string;
+attribute rom_style of rom_s : signal is "block";
+attribute rom_style of rom_c : signal is "block";
+
+attribute mark_debug: boolean;
+attribute mark_debug of fra_state : signal is true;
+
+begin
+
+ResultTgl <= result_tgl_i;
+Busy <= '0' when fra_state = ST_IDLE else '1';
+
+fra_proc: process(clk)
+    variable v_ph : unsigned(33 downto 0);
+    variable v_rem : unsigned(3 downto 0);
+    variable v_div : unsigned(3 downto 0);
+    variable v_q : unsigned(11 downto 0);
+    variable v_done : boolean;
+begin
+
+    if rising_edge(clk) then
+
+        enable_d <= Enable;
+        enable_dd <= enable_d;
+        enable_ddd <= enable_dd;
+        delta_tgl_d <= DeltaTgl;
+        delta_tgl_dd <= delta_tgl_d;
+        delta_tgl_ddd <= delta_tgl_dd;
+
+        ---------------------
+        --  POINT CONTROL  --
+        ---------------------
+        meas_pipe(0) <= '0';
+        if enable_dd = '0' then
+            fra_state <= ST_IDLE;
+        elsif (enable_ddd = '0' or delta_tgl_ddd /= delta_tgl_dd) then
+            -- new frequency: reference increment = 4 * delta / 5 (awg_core ignores delta LSB)
+            delta_i <= Delta;
+            div_n <= unsigned(Delta(31 downto 1)) & "000";
+            div_q <= (others => '0');
+            div_r <= (others => '0');
+            div_cnt <= 0;
+            fra_state <= ST_DIV;
+        else
+            case fra_state is
+                when ST_DIV =>      -- bit-serial division by 5
+                    v_div := div_r & div_n(33);
+                    div_n <= div_n(32 downto 0) & '0';
+                    if v_div >= 5 then
+                        div_r <= resize(v_div - 5,3);
+                        div_q <= div_q(32 downto 0) & '1';
+                    else
+                        div_r <= v_div(2 downto 0);
+                        div_q <= div_q(32 downto 0) & '0';
+                    end if;
+                    if div_cnt = 33 then
+                        settle_cnt <= unsigned(Settle);
+                        fra_state <= ST_SETTLE;
+                    else
+                        div_cnt <= div_cnt + 1;
+                    end if;
+                when ST_SETTLE =>   -- wait until DUT output is settled
+                    nco_inc <= div_q;
+                    nco_inc_r <= div_r;
+                    if settle_cnt = 0 then
+                        fra_state <= ST_MEAS;
+                    else
+                        settle_cnt <= settle_cnt - 1;
+                    end if;
+                when ST_MEAS =>     -- integrate
+                    meas_pipe(0) <= '1';
+                    if acc_done = '1' then
+                        meas_pipe(0) <= '0';
+                        fra_state <= ST_DONE;
+                    end if;
+                when ST_DONE =>     -- publish results (held until next point)
+                    ResultDelta <= delta_i;
+                    ResultCount <= acc_whole & "00000000" & std_logic_vector(acc_cnt);
+                    ResultIA <= std_logic_vector(acc_ia);
+                    ResultQA <= std_logic_vector(acc_qa);
+                    ResultIB <= std_logic_vector(acc_ib);
+                    ResultQB <= std_logic_vector(acc_qb);
+                    result_tgl_i <= not(result_tgl_i);
+                    fra_state <= ST_IDLE;
+                when others =>
+                    null;
+            end case;
+        end if;
+
+        ---------------------
+        --  REFERENCE NCO  --
+        ---------------------
+        -- phase + inc + rem/5 (exact, so reference stays locked to generator)
+        v_rem := ('0' & nco_rem) + ('0' & nco_inc_r);
+        if fra_state /= ST_SETTLE and fra_state /= ST_MEAS then
+            nco_ph <= (others => '0');
+            nco_rem <= (others => '0');
+        elsif v_rem >= 5 then
+            nco_ph <= nco_ph + nco_inc + 1;
+            nco_rem <= resize(v_rem - 5,3);
+        else
+            nco_ph <= nco_ph + nco_inc;
+            nco_rem <= v_rem(2 downto 0);
+        end if;
+
+        -- stage 1: quarter wave ROM address (cosine is sine a quarter period later)
+        v_ph := nco_ph;
+        ph_msb_d <= v_ph(33);
+        wrap_pipe(1) <= ph_msb_d and not(v_ph(33));
+        v_q := v_ph(33 downto 22);
+        if v_q(10) = '0' then
+            addr_s <= v_q(9 downto 0);
+        else
+            addr_s <= 1023 - v_q(9 downto 0);
+        end if;
+        neg_s_1 <= v_q(11);
+        v_q := v_q + 1024;
+        if v_q(10) = '0' then
+            addr_c <= v_q(9 downto 0);
+        else
+            addr_c <= 1023 - v_q(9 downto 0);
+        end if;
+        neg_c_1 <= v_q(11);
+
+        -- stage 2: ROM
+        rom_s <= SIN_ROM(to_integer(addr_s));
+        rom_c <= SIN_ROM(to_integer(addr_c));
+        neg_s_2 <= neg_s_1;
+        neg_c_2 <= neg_c_1;
+
+        -- stage 3: sign
+        if neg_s_2 = '1' then
+            ref_s <= -signed('0' & rom_s);
+        else
+            ref_s <= signed('0' & rom_s);
+        end if;
+        if neg_c_2 = '1' then
+            ref_c <= -signed('0' & rom_c);
+        else
+            ref_c <= signed('0' & rom_c);
+        end if;
+
+        -- stage 4: mix
+        p_ia <= a_pipe(3) * ref_c;
+        p_qa <= a_pipe(3) * ref_s;
+        p_ib <= b_pipe(3) * ref_c;
+        p_qb <= b_pipe(3) * ref_s;
+
+        a_pipe <= DataA & a_pipe(1 to PIPE_LEN-1);
+        b_pipe <= DataB & b_pipe(1 to PIPE_LEN-1);
+        meas_pipe(1 to PIPE_LEN) <= meas_pipe(0 to PIPE_LEN-1);
+        wrap_pipe(2 to PIPE_LEN) <= wrap_pipe(1 to PIPE_LEN-1);
+
+        -- stage 5: accumulate until minimal length was reached at the end of reference period
+        if fra_state = ST_DIV then
+            acc_ia <= (others => '0');
+            acc_qa <= (others => '0');
+            acc_ib <= (others => '0');
+            acc_qb <= (others => '0');
+            acc_cnt <= (others => '0');
+            acc_done <= '0';
+            acc_whole <= '0';
+        elsif meas_pipe(PIPE_LEN-1) = '1' and acc_done = '0' then
+            acc_ia <= acc_ia + p_ia;
+            acc_qa <= acc_qa + p_qa;
+            acc_ib <= acc_ib + p_ib;
+            acc_qb <= acc_qb + p_qb;
+            acc_cnt <= acc_cnt + 1;
+            v_done := false;
+            if acc_cnt + 1 >= unsigned(Length) and wrap_pipe(PIPE_LEN) = '1' then
+                acc_whole <= '1';
+                v_done := true;
+            elsif acc_cnt = MAX_SAMPLES-1 then
+                v_done := true;
+            end if;
+            if v_done then
+                acc_done <= '1';
+            end if;
+        end if;
+
+    end if;
+
+end process;
+
+end Behavioral;
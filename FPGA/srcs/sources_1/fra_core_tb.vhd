@@ -0,0 +1,183 @@
+----------------------------------------------------------------------------------
+--    Copyright (C) 2019 Dejan Priversek
+--
+--    This program is free software: you can redistribute it and/or modify
+--    it under the terms of the GNU General Public License as published by
+--    the Free Software Foundation, either version 3 of the License, or
+--    (at your option) any later version.
+--
+--    This program is distributed in the hope that it will be useful,
+--    but WITHOUT ANY WARRANTY; without even the implied warranty of
+--    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+--    GNU General Public License for more details.
+--
+--    You should have received a copy of the GNU General Public License
+--    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+----------------------------------------------------------------------------------
+
+--
+-- frequency response analyzer testbench
+-- channel B is channel A at half amplitude, delayed by a quarter period:
+-- gain (B/A) must be 0.5 and phase difference 90 degrees
+--
+
+LIBRARY IEEE;
+USE IEEE.STD_LOGIC_1164.ALL;
+USE IEEE.NUMERIC_STD.ALL;
+USE IEEE.MATH_REAL.ALL;
+
+library user_lib;
+use user_lib.TextUtil.all;
+
+ENTITY fra_core_tb IS
+END fra_core_tb;
+
+ARCHITECTURE behavior OF fra_core_tb IS
+
+    -- Component Declaration for the Unit Under Test (UUT)
+
+    component fra_core is
+    Port (
+        clk : in std_logic;
+        Enable : in std_logic;
+        Settle : in std_logic_vector(23 downto 0);
+        Length : in std_logic_vector(22 downto 0);
+        DeltaTgl : in std_logic;
+        Delta : in std_logic_vector(31 downto 0);
+        DataA : in signed(9 downto 0);
+        DataB : in signed(9 downto 0);
+        ResultTgl : out std_logic;
+        ResultDelta : out std_logic_vector(31 downto 0);
+        ResultCount : out std_logic_vector(31 downto 0);
+        ResultIA : out std_logic_vector(47 downto 0);
+        ResultQA : out std_logic_vector(47 downto 0);
+        ResultIB : out std_logic_vector(47 downto 0);
+        ResultQB : out std_logic_vector(47 downto 0);
+        Busy : out std_logic
+    );
+    end component;
+
+    --constants
+    CONSTANT PERIOD : integer := 64;                -- signal period (ADC samples)
+    CONSTANT GEN_DELTA : integer := 335544320;          -- 2^34 * 5/4 / PERIOD (AWG clock is 4/5 of ADC clock)
+    CONSTANT MEAS_LENGTH : integer := 4000;
+
+    --Inputs
+    signal clk : std_logic := '0';
+    signal Enable : std_logic := '0';
+    signal DeltaTgl : std_logic := '0';
+    signal DataA : signed(9 downto 0) := (others => '0');
+    signal DataB : signed(9 downto 0) := (others => '0');
+
+    --Outputs
+    signal ResultTgl : std_logic;
+    signal ResultDelta : std_logic_vector(31 downto 0);
+    signal ResultCount : std_logic_vector(31 downto 0);
+    signal ResultIA : std_logic_vector(47 downto 0);
+    signal ResultQA : std_logic_vector(47 downto 0);
+    signal ResultIB : std_logic_vector(47 downto 0);
+    signal ResultQB : std_logic_vector(47 downto 0);
+    signal Busy : std_logic;
+
+    signal sim_done : boolean := false;
+
+    -- Clock period definitions
+    constant clk_period : time := 4 ns;
+
+    -- accumulator value (upper 32 bits) as real
+    function acc_real(x : std_logic_vector(47 downto 0)) return real is
+    begin
+        return real(to_integer(signed(x(47 downto 16)))) * 65536.0;
+    end function;
+
+BEGIN
+
+    -- Instantiate the Unit Under Test (UUT)
+    uut: fra_core
+    PORT MAP (
+        clk => clk,
+        Enable => Enable,
+        Settle => std_logic_vector(to_unsigned(100,24)),
+        Length => std_logic_vector(to_unsigned(MEAS_LENGTH,23)),
+        DeltaTgl => DeltaTgl,
+        Delta => std_logic_vector(to_unsigned(GEN_DELTA,32)),
+        DataA => DataA,
+        DataB => DataB,
+        ResultTgl => ResultTgl,
+        ResultDelta => ResultDelta,
+        ResultCount => ResultCount,
+        ResultIA => ResultIA,
+        ResultQA => ResultQA,
+        ResultIB => ResultIB,
+        ResultQB => ResultQB,
+        Busy => Busy
+    );
+
+    -- Clock process definitions
+    clk_process :process
+    begin
+        if sim_done then
+            wait;
+        end if;
+        clk <= '0';
+        wait for clk_period/2;
+        clk <= '1';
+        wait for clk_period/2;
+    end process;
+
+    -- ADC data
+    data_proc: process(clk)
+        variable n : integer := 0;
+        variable ph : real;
+    begin
+        if rising_edge(clk) then
+            ph := MATH_2_PI * real(n) / real(PERIOD) + 0.3;
+            DataA <= to_signed(integer(round(400.0 * cos(ph))),10);
+            DataB <= to_signed(integer(round(200.0 * cos(ph - MATH_PI_OVER_2))),10);
+            n := (n + 1) mod PERIOD;
+        end if;
+    end process;
+
+    -- Stimulus process
+    stim_proc: process
+        variable errors : integer := 0;
+        variable count : integer;
+        variable mag_a, mag_b : real;
+        variable gain, phase : real;
+        variable res_tgl : std_logic;
+    begin
+        wait for 100 ns;
+        wait until rising_edge(clk);
+        Enable <= '1';
+        wait until ResultTgl'event;
+        wait until rising_edge(clk);
+
+        count := to_integer(unsigned(ResultCount(30 downto 0)));
+        Check(ResultCount(31) = '1' and count >= MEAS_LENGTH,
+              "integrated " & integer'image(count) & " samples, whole periods: " & std_logic'image(ResultCount(31)), errors);
+        Check(to_integer(unsigned(ResultDelta)) = GEN_DELTA, "result delta does not match", errors);
+
+        mag_a := sqrt(acc_real(ResultIA)**2 + acc_real(ResultQA)**2);
+        mag_b := sqrt(acc_real(ResultIB)**2 + acc_real(ResultQB)**2);
+        gain := mag_b / mag_a;
+        phase := (arctan(acc_real(ResultQB), acc_real(ResultIB)) - arctan(acc_real(ResultQA), acc_real(ResultIA))) * 180.0 / MATH_PI;
+        if phase > 180.0 then
+            phase := phase - 360.0;
+        elsif phase < -180.0 then
+            phase := phase + 360.0;
+        end if;
+        Print("gain " & real'image(gain) & ", phase " & real'image(phase));
+        Check(abs(gain - 0.5) <= 0.005, "gain error", errors);
+        Check(abs(abs(phase) - 90.0) <= 0.5, "phase error", errors);
+
+        -- new point when generator frequency is changed
+        res_tgl := ResultTgl;
+        DeltaTgl <= '1';
+        wait until ResultTgl'event for 100 us;
+        Check(ResultTgl /= res_tgl, "no result after frequency change", errors);
+
+        EndTest("FRA", errors, sim_done);
+        wait;
+    end process;
+
+END;
@@ -0,0 +1,249 @@
+----------------------------------------------------------------------------------
+--    Copyright (C) 2019 Dejan Priversek
+--
+--    This program is free software: you can redistribute it and/or modify
+--    it under the terms of the GNU General Public License as published by
+--    the Free Software Foundation, either version 3 of the License, or
+--    (at your option) any later version.
+--
+--    This program is distributed in the hope that it will be useful,
+--    but WITHOUT ANY WARRANTY; without even the implied warranty of
+--    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+--    GNU General Public License for more details.
+--
+--    You should have received a copy of the GNU General Public License
+--    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+----------------------------------------------------------------------------------
+
+--
+-- Scopefun firmware: per-frame measurements of channels A and B
+--
+-- Samples of post-trigger part of the frame (SampleEn between Start and Stop) are measured,
+-- results are published when frame is finished (ResultTgl toggles, held until next frame):
+--   word 0: number of samples N
+--   per channel (words 1-11: A, 12-22: B):
+--     0: min (31..16) and max (15..0), signed
+--     1, 2: sum of samples (48 bit, high word first)  -> mean
+--     3, 4: sum of squares (48 bit)                   -> RMS
+--     5: number of rising crossings of mid level
+--     6: samples from first to last rising crossing  -> period = span / (crossings - 1)
+--     7: samples at or above mid level within that span -> duty cycle
+--     8: sum of rise times (samples from low to high level)
+--     9: sum of fall times
+--    10: number of rise (31..16) and fall (15..0) times
+-- Reference levels are taken from min and max of previous frame: mid = 50 %, low = 10 %, high = 90 %
+-- (TimingValid is low when previous frame amplitude was too small, words 5-10 are then zero).
+--
+
+library IEEE;
+use IEEE.STD_LOGIC_1164.ALL;
+use IEEE.NUMERIC_STD.ALL;
+
+entity frame_meas is
+    Port (
+        clk : in std_logic;                             -- ADC clock
+        Start : in std_logic;                           -- start of measured part of frame
+        Stop : in std_logic;                            -- frame is finished
+        SampleEn : in std_logic;
+        DataA : in signed(9 downto 0);
+        DataB : in signed(9 downto 0);
+        ResultTgl : out std_logic;
+        TimingValid : out std_logic_vector(1 downto 0);
+        Results : out std_logic_vector(23*32-1 downto 0)
+    );
+end frame_meas;
+
+architecture Behavioral of frame_meas is
+
+CONSTANT MIN_AMPLITUDE : integer := 16;     -- ADC LSB, for timing measurements
+
+type sample_array is array(0 to 1) of signed(9 downto 0);
+type sum_array is array(0 to 1) of signed(47 downto 0);
+type sq_array is array(0 to 1) of signed(19 downto 0);
+type cnt_array is array(0 to 1) of unsigned(31 downto 0);
+type cnt16_array is array(0 to 1) of unsigned(15 downto 0);
+
+signal x : sample_array := (others => (others => '0'));
+signal en_1 : std_logic := '0';
+signal en_2 : std_logic := '0';
+signal start_1 : std_logic := '0';
+signal stop_1 : std_logic := '0';
+signal stop_2 : std_logic := '0';
+signal stop_3 : std_logic := '0';
+signal sq : sq_array := (others => (others => '0'));
+signal n : unsigned(31 downto 0) := (others => '0');
+
+-- per channel
+signal mn : sample_array := (others => (others => '0'));
+signal mx : sample_array := (others => (others => '0'));
+signal prev_mn : sample_array := (others => (others => '0'));
+signal prev_mx : sample_array := (others => (others => '0'));
+signal lvl_lo : sample_array := (others => (others => '0'));
+signal lvl_mid : sample_array := (others => (others => '0'));
+signal lvl_hi : sample_array := (others => (others => '0'));
+signal lvl_ok : std_logic_vector(1 downto 0) := "00";
+signal sum : sum_array := (others => (others => '0'));
+signal sumsq : sum_array := (others => (others => '0'));
+signal below : std_logic_vector(1 downto 0) := "00";       -- was below low level (rising crossing is armed)
+signal above : std_logic_vector(1 downto 0) := "00";       -- was above high level
+signal rising : std_logic_vector(1 downto 0) := "00";      -- rise time is being measured
+signal falling : std_logic_vector(1 downto 0) := "00";
+signal edge_start : cnt_array := (others => (others => '0'));
+signal edge_start_f : cnt_array := (others => (others => '0'));
+signal crossings : cnt_array := (others => (others => '0'));
+signal t_first : cnt_array := (others => (others => '0'));
+signal t_last : cnt_array := (others => (others => '0'));
+signal high : cnt_array := (others => (others => '0'));
+signal high_first : cnt_array := (others => (others => '0'));
+signal high_last : cnt_array := (others => (others => '0'));
+signal rise_sum : cnt_array := (others => (others => '0'));
+signal fall_sum : cnt_array := (others => (others => '0'));
+signal rise_cnt : cnt16_array := (others => (others => '0'));
+signal fall_cnt : cnt16_array := (others => (others => '0'));
+
+signal result_tgl_i : std_logic := '0';
+
+begin
+
+ResultTgl <= result_tgl_i;
+
+meas_proc: process (clk)
+    variable v_amp : signed(10 downto 0);
+    variable v_d : signed(10 downto 0);
+    variable v_w : integer range 0 to 22;
+begin
+    if rising_edge(clk) then
+
+        -- inputs and squares (accumulated one clk later)
+        x(0) <= DataA;
+        x(1) <= DataB;
+        en_1 <= SampleEn;
+        en_2 <= en_1;
+        start_1 <= Start;
+        stop_1 <= Stop;
+        stop_2 <= stop_1;
+        stop_3 <= stop_2;
+        for c in 0 to 1 loop
+            sq(c) <= x(c) * x(c);
+        end loop;
+
+        if start_1 = '1' then
+            -- new frame: reference levels from previous frame
+            n <= (others => '0');
+            for c in 0 to 1 loop
+                v_amp := resize(prev_mx(c),11) - resize(prev_mn(c),11);
+                v_d := resize(shift_right(v_amp * 13, 7),11);                           -- 10 %
+                lvl_lo(c) <= resize(resize(prev_mn(c),11) + v_d,10);
+                lvl_hi(c) <= resize(resize(prev_mx(c),11) - v_d,10);
+                lvl_mid(c) <= resize(shift_right(resize(prev_mx(c),11) + resize(prev_mn(c),11),1),10);
+                if v_amp >= MIN_AMPLITUDE then
+                    lvl_ok(c) <= '1';
+                else
+                    lvl_ok(c) <= '0';
+                end if;
+                mn(c) <= to_signed(511,10);
+                mx(c) <= to_signed(-512,10);
+                sum(c) <= (others => '0');
+                sumsq(c) <= (others => '0');
+                below(c) <= '0';
+                above(c) <= '0';
+                rising(c) <= '0';
+                falling(c) <= '0';
+                crossings(c) <= (others => '0');
+                high(c) <= (others => '0');
+                rise_sum(c) <= (others => '0');
+                fall_sum(c) <= (others => '0');
+                rise_cnt(c) <= (others => '0');
+                fall_cnt(c) <= (others => '0');
+            end loop;
+        else
+            if en_1 = '1' then
+                n <= n + 1;
+                for c in 0 to 1 loop
+                    if x(c) < mn(c) then
+                        mn(c) <= x(c);
+                    end if;
+                    if x(c) > mx(c) then
+                        mx(c) <= x(c);
+                    end if;
+                    sum(c) <= sum(c) + resize(x(c),48);
+                    if x(c) >= lvl_mid(c) then
+                        high(c) <= high(c) + 1;
+                    end if;
+                    if lvl_ok(c) = '1' then
+                        -- period and duty cycle: rising crossings of mid level (armed below low level)
+                        if x(c) < lvl_lo(c) then
+                            below(c) <= '1';
+                        elsif below(c) = '1' and x(c) >= lvl_mid(c) then
+                            below(c) <= '0';
+                            if crossings(c) = 0 then
+                                t_first(c) <= n;
+                                high_first(c) <= high(c);
+                            end if;
+                            t_last(c) <= n;
+                            high_last(c) <= high(c);
+                            crossings(c) <= crossings(c) + 1;
+                        end if;
+                        -- rise time: from leaving low level to reaching high level
+                        if x(c) < lvl_lo(c) then
+                            rising(c) <= '1';
+                            edge_start(c) <= n;
+                        elsif rising(c) = '1' and x(c) >= lvl_hi(c) then
+                            rising(c) <= '0';
+                            rise_sum(c) <= rise_sum(c) + (n - edge_start(c));
+                            if rise_cnt(c) /= X"FFFF" then
+                                rise_cnt(c) <= rise_cnt(c) + 1;
+                            end if;
+                        end if;
+                        -- fall time: from leaving high level to reaching low level
+                        if x(c) > lvl_hi(c) then
+                            falling(c) <= '1';
+                            edge_start_f(c) <= n;
+                        elsif falling(c) = '1' and x(c) <= lvl_lo(c) then
+                            falling(c) <= '0';
+                            fall_sum(c) <= fall_sum(c) + (n - edge_start_f(c));
+                            if fall_cnt(c) /= X"FFFF" then
+                                fall_cnt(c) <= fall_cnt(c) + 1;
+                            end if;
+                        end if;
+                    end if;
+                end loop;
+            end if;
+            if en_2 = '1' then
+                for c in 0 to 1 loop
+                    sumsq(c) <= sumsq(c) + resize(sq(c),48);
+                end loop;
+            end if;
+        end if;
+
+        -- frame finished: publish results (after last square was accumulated)
+        if stop_3 = '1' then
+            Results(31 downto 0) <= std_logic_vector(n);
+            for c in 0 to 1 loop
+                v_w := 1 + 11*c;
+                Results(32*v_w+31 downto 32*v_w) <= std_logic_vector(resize(mn(c),16)) & std_logic_vector(resize(mx(c),16));
+                Results(32*(v_w+1)+31 downto 32*(v_w+1)) <= X"0000" & std_logic_vector(sum(c)(47 downto 32));
+                Results(32*(v_w+2)+31 downto 32*(v_w+2)) <= std_logic_vector(sum(c)(31 downto 0));
+                Results(32*(v_w+3)+31 downto 32*(v_w+3)) <= X"0000" & std_logic_vector(sumsq(c)(47 downto 32));
+                Results(32*(v_w+4)+31 downto 32*(v_w+4)) <= std_logic_vector(sumsq(c)(31 downto 0));
+                if lvl_ok(c) = '1' then
+                    Results(32*(v_w+5)+31 downto 32*(v_w+5)) <= std_logic_vector(crossings(c));
+                    Results(32*(v_w+6)+31 downto 32*(v_w+6)) <= std_logic_vector(t_last(c) - t_first(c));
+                    Results(32*(v_w+7)+31 downto 32*(v_w+7)) <= std_logic_vector(high_last(c) - high_first(c));
+                    Results(32*(v_w+8)+31 downto 32*(v_w+8)) <= std_logic_vector(rise_sum(c));
+                    Results(32*(v_w+9)+31 downto 32*(v_w+9)) <= std_logic_vector(fall_sum(c));
+                    Results(32*(v_w+10)+31 downto 32*(v_w+10)) <= std_logic_vector(rise_cnt(c)) & std_logic_vector(fall_cnt(c));
+                else
+                    Results(32*(v_w+10)+31 downto 32*(v_w+5)) <= (others => '0');
+                end if;
+                prev_mn(c) <= mn(c);
+                prev_mx(c) <= mx(c);
+            end loop;
+            TimingValid <= lvl_ok(1) & lvl_ok(0);
+            result_tgl_i <= NOT(result_tgl_i);
+        end if;
+
+    end if;
+end process;
+
+end Behavioral;
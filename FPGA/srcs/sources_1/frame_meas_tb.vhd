@@ -0,0 +1,175 @@
+----------------------------------------------------------------------------------
+--    Copyright (C) 2019 Dejan Priversek
+--
+--    This program is free software: you can redistribute it and/or modify
+--    it under the terms of the GNU General Public License as published by
+--    the Free Software Foundation, either version 3 of the License, or
+--    (at your option) any later version.
+--
+--    This program is distributed in the hope that it will be useful,
+--    but WITHOUT ANY WARRANTY; without even the implied warranty of
+--    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+--    GNU General Public License for more details.
+--
+--    You should have received a copy of the GNU General Public License
+--    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+----------------------------------------------------------------------------------
+
+--
+-- frame measurements testbench
+-- channel A is a trapezoid (period 40 samples, 5 sample edges), channel B is constant,
+-- the second frame (reference levels from the first one) is checked
+--
+
+LIBRARY IEEE;
+USE IEEE.STD_LOGIC_1164.ALL;
+USE IEEE.NUMERIC_STD.ALL;
+
+library user_lib;
+use user_lib.TextUtil.all;
+
+ENTITY frame_meas_tb IS
+END frame_meas_tb;
+
+ARCHITECTURE behavior OF frame_meas_tb IS
+
+    -- Component Declaration for the Unit Under Test (UUT)
+
+    component frame_meas is
+    Port (
+        clk : in std_logic;
+        Start : in std_logic;
+        Stop : in std_logic;
+        SampleEn : in std_logic;
+        DataA : in signed(9 downto 0);
+        DataB : in signed(9 downto 0);
+        ResultTgl : out std_logic;
+        TimingValid : out std_logic_vector(1 downto 0);
+        Results : out std_logic_vector(23*32-1 downto 0)
+    );
+    end component;
+
+    --constants
+    CONSTANT N_SAMPLES : integer := 400;
+    CONSTANT PERIOD : integer := 40;
+    CONSTANT B_LEVEL : integer := 100;
+
+    -- trapezoid sample
+    function trapezoid(k : integer) return integer is
+        variable p : integer;
+    begin
+        p := k mod PERIOD;
+        if p < 15 then
+            return -200;
+        elsif p < 20 then
+            return -200 + 80 * (p - 14);
+        elsif p < 35 then
+            return 200;
+        else
+            return 200 - 80 * (p - 34);
+        end if;
+    end function;
+
+    --Inputs
+    signal clk : std_logic := '0';
+    signal Start : std_logic := '0';
+    signal Stop : std_logic := '0';
+    signal SampleEn : std_logic := '0';
+    signal DataA : signed(9 downto 0) := (others => '0');
+    signal DataB : signed(9 downto 0) := (others => '0');
+
+    --Outputs
+    signal ResultTgl : std_logic;
+    signal TimingValid : std_logic_vector(1 downto 0);
+    signal Results : std_logic_vector(23*32-1 downto 0);
+
+    signal sim_done : boolean := false;
+
+    -- Clock period definitions
+    constant clk_period : time := 4 ns;
+
+    function word(r : std_logic_vector; w : integer) return integer is
+    begin
+        return to_integer(signed(r(32*w+31 downto 32*w)));
+    end function;
+
+BEGIN
+
+    -- Instantiate the Unit Under Test (UUT)
+    uut: frame_meas
+    PORT MAP (
+        clk => clk,
+        Start => Start,
+        Stop => Stop,
+        SampleEn => SampleEn,
+        DataA => DataA,
+        DataB => DataB,
+        ResultTgl => ResultTgl,
+        TimingValid => TimingValid,
+        Results => Results
+    );
+
+    -- Clock process definitions
+    clk_process :process
+    begin
+        if sim_done then
+            wait;
+        end if;
+        clk <= '0';
+        wait for clk_period/2;
+        clk <= '1';
+        wait for clk_period/2;
+    end process;
+
+    -- Stimulus process
+    stim_proc: process
+        variable errors : integer := 0;
+        variable res_tgl : std_logic;
+        variable crossings, span, high, rise_fall : integer;
+    begin
+        wait for 100 ns;
+        for f in 0 to 1 loop
+            res_tgl := ResultTgl;
+            wait until rising_edge(clk);
+            Start <= '1';
+            wait until rising_edge(clk);
+            Start <= '0';
+            for k in 0 to N_SAMPLES-1 loop
+                DataA <= to_signed(trapezoid(k + 7),10);
+                DataB <= to_signed(B_LEVEL,10);
+                SampleEn <= '1';
+                wait until rising_edge(clk);
+            end loop;
+            SampleEn <= '0';
+            Stop <= '1';
+            wait until rising_edge(clk);
+            Stop <= '0';
+            wait until ResultTgl /= res_tgl;
+        end loop;
+
+        -- check second frame
+        Check(word(Results,0) = N_SAMPLES, "N: " & integer'image(word(Results,0)), errors);
+        Check(Results(32+31 downto 32) = std_logic_vector(to_signed(-200,16)) & std_logic_vector(to_signed(200,16)),
+              "A min/max: " & integer'image(to_integer(signed(Results(63 downto 48)))) & ", " &
+                  integer'image(to_integer(signed(Results(47 downto 32)))), errors);
+        Check(word(Results,13) = 0 and word(Results,14) = B_LEVEL * N_SAMPLES,
+              "B sum: " & integer'image(word(Results,14)), errors);
+        Check(TimingValid = "01",
+              "timing valid: " & std_logic'image(TimingValid(1)) & std_logic'image(TimingValid(0)), errors);
+        crossings := word(Results,6);
+        span := word(Results,7);
+        high := word(Results,8);
+        rise_fall := word(Results,11);
+        Print("crossings " & integer'image(crossings) & ", span " & integer'image(span) & ", high " & integer'image(high) &
+              ", rise " & integer'image(word(Results,9)) & ", fall " & integer'image(word(Results,10)));
+        Check(crossings = N_SAMPLES/PERIOD and span = PERIOD * (crossings - 1), "period error", errors);
+        -- high from mid level: 3 ramp samples + 15 + 2 ramp samples of each period
+        Check(high = 20 * (crossings - 1), "duty cycle error", errors);
+        Check(word(Results,9) = 5 * (rise_fall / 65536) and word(Results,10) = 5 * (rise_fall mod 65536),
+              "rise/fall time error", errors);
+
+        EndTest("frame measurements", errors, sim_done);
+        wait;
+    end process;
+
+END;
@@ -0,0 +1,329 @@
+----------------------------------------------------------------------------------
+--    Copyright (C) 2019 Dejan Priversek
+--
+--    This program is free software: you can redistribute it and/or modify
+--    it under the terms of the GNU General Public License as published by
+--    the Free Software Foundation, either version 3 of the License, or
+--    (at your option) any later version.
+--
+--    This program is distributed in the hope that it will be useful,
+--    but WITHOUT ANY WARRANTY; without even the implied warranty of
+--    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+--    GNU General Public License for more details.
+--
+--    You should have received a copy of the GNU General Public License
+--    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+----------------------------------------------------------------------------------
+
+--
+-- Scopefun firmware: persistence (2D waveform histogram) accumulation in DDR3
+--
+-- Post-trigger samples of a frame (SampleEn between Start and Stop, one sample each 2^StepLog2 samples,
+-- up to 2^TBIN_LOG2 time bins) are saved to frame buffer (clk_adc). When frame is finished, it is binned
+-- into the histogram in RAM by read-modify-write (clk): one RAM word holds 8 saturating 16-bit counters
+-- of neighbouring amplitudes (amplitude a in bits 16*(a mod 8)+15 .. 16*(a mod 8), offset binary),
+-- histogram of a time bin is 128 RAM words, channel B follows channel A.
+-- Histogram is placed at the end of AWG region (HIST_BASE). Frames that are finished while previous
+-- frame is still being binned (or histogram is being cleared) are skipped.
+-- RAM requests are served by DDR3 controller arbiter (Req is held until Ack pulse).
+--
+
+library IEEE;
+use IEEE.STD_LOGIC_1164.ALL;
+use IEEE.NUMERIC_STD.ALL;
+
+entity hist_engine is
+    Generic (
+        TBIN_LOG2 : integer := 10                       -- number of time bins (log2)
+    );
+    Port (
+        -- frame samples (clk_adc)
+        clk_adc : in std_logic;
+        Enable : in std_logic;
+        StepLog2 : in std_logic_vector(3 downto 0);     -- samples per time bin (log2)
+        Start : in std_logic;                           -- start of post-trigger part of frame
+        Stop : in std_logic;                            -- frame is finished
+        SampleEn : in std_logic;
+        DataA : in signed(9 downto 0);
+        DataB : in signed(9 downto 0);
+        -- DDR3 controller (clk)
+        clk : in std_logic;
+        RdReq : out std_logic;
+        RdAddr : out std_logic_vector(22 downto 0);    -- RAM word index in AWG region
+        RdAck : in std_logic;
+        RdData : in std_logic_vector(127 downto 0);
+        RdDataValid : in std_logic;
+        WrReq : out std_logic;
+        WrAddr : out std_logic_vector(22 downto 0);
+        WrData : out std_logic_vector(127 downto 0);
+        WrAck : in std_logic;
+        Clear : in std_logic;                           -- rising edge: clear histogram
+        -- status (clk)
+        ResultTgl : out std_logic;                      -- toggles when frame was binned
+        Frames : out std_logic_vector(31 downto 0);     -- frames accumulated since clear
+        Skipped : out std_logic_vector(31 downto 0);    -- frames skipped since clear
+        Clearing : out std_logic;
+        Saturated : out std_logic                       -- some counter reached maximum value
+    );
+end hist_engine;
+
+architecture Behavioral of hist_engine is
+
+CONSTANT TBINS : integer := 2**TBIN_LOG2;
+CONSTANT HIST_WORDS : integer := 2**(TBIN_LOG2+8);         -- 2 channels, 128 RAM words per time bin
+CONSTANT HIST_BASE : unsigned(22 downto 0) := to_unsigned(2**23 - HIST_WORDS,23);
+
+-- frame buffer (amplitudes of A and B)
+type buf_type is array (TBINS-1 downto 0) of std_logic_vector (19 downto 0);
+signal buf : buf_type;
+
+ATTRIBUTE ram_style: string;
+ATTRIBUTE ram_style OF buf: SIGNAL IS "block";
+
+type hist_state_type is (IDLE, CLR, FETCH, RD, RD_WAIT, WR);
+signal hist_state : hist_state_type := IDLE;
+
+-- clk_adc
+signal enable_d : std_logic := '0';
+signal enable_dd : std_logic := '0';
+signal clearing_d : std_logic := '0';
+signal clearing_dd : std_logic := '0';
+signal done_tgl_d : std_logic := '0';
+signal done_tgl_dd : std_logic := '0';
+signal done_tgl_ddd : std_logic := '0';
+signal accepted : std_logic := '0';     -- frame is saved to frame buffer
+signal capturing : std_logic := '0';
+signal buf_busy : std_logic := '0';     -- frame buffer is being binned
+signal sub_cnt : unsigned(15 downto 0) := (others => '0');
+signal sub_max : unsigned(15 downto 0) := (others => '0');
+signal cap_n : unsigned(TBIN_LOG2 downto 0) := (others => '0');
+signal frame_len : unsigned(TBIN_LOG2 downto 0) := (others => '0');
+signal frame_tgl : std_logic := '0';
+signal skip_cnt : unsigned(31 downto 0) := (others => '0');
+signal frame_skipped : unsigned(31 downto 0) := (others => '0');
+
+-- clk
+signal frame_tgl_d : std_logic := '0';
+signal frame_tgl_dd : std_logic := '0';
+signal frame_ack : std_logic := '0';     -- frame_tgl of last frame taken for binning
+signal clear_d : std_logic := '0';
+signal clear_dd : std_logic := '0';
+signal clear_ddd : std_logic := '0';
+signal clr_pend : std_logic := '0';
+signal clr_addr : unsigned(TBIN_LOG2+7 downto 0) := (others => '0');
+signal clearing_i : std_logic := '0';
+signal done_tgl : std_logic := '0';
+signal wr_req_i : std_logic := '0';
+signal len : unsigned(TBIN_LOG2 downto 0) := (others => '0');
+signal idx : unsigned(TBIN_LOG2-1 downto 0) := (others => '0');
+signal ch : std_logic := '0';
+signal buf_rd_addr : unsigned(TBIN_LOG2-1 downto 0) := (others => '0');
+signal buf_q : std_logic_vector(19 downto 0) := (others => '0');
+signal amp : unsigned(9 downto 0);
+signal frames_i : unsigned(31 downto 0) := (others => '0');
+signal saturated_i : std_logic := '0';
+
+attribute ASYNC_REG : string;
+attribute ASYNC_REG of enable_d: signal is "true";
+attribute ASYNC_REG of enable_dd: signal is "true";
+attribute ASYNC_REG of clearing_d: signal is "true";
+attribute ASYNC_REG of clearing_dd: signal is "true";
+attribute ASYNC_REG of done_tgl_d: signal is "true";
+attribute ASYNC_REG of done_tgl_dd: signal is "true";
+attribute ASYNC_REG of frame_tgl_d: signal is "true";
+attribute ASYNC_REG of frame_tgl_dd: signal is "true";
+attribute ASYNC_REG of clear_d: signal is "true";
+attribute ASYNC_REG of clear_dd: signal is "true";
+
+begin
+
+WrReq <= wr_req_i;
+ResultTgl <= done_tgl;
+Frames <= std_logic_vector(frames_i);
+Clearing <= clearing_i;
+Saturated <= saturated_i;
+
+clearing_i <= '1' when clr_pend = '1' or hist_state = CLR else '0';
+
+--=================================================
+-- frame buffer (clk_adc)
+--=================================================
+cap_proc: process (clk_adc)
+begin
+    if rising_edge(clk_adc) then
+
+        enable_d <= Enable;
+        enable_dd <= enable_d;
+        clearing_d <= clearing_i;
+        clearing_dd <= clearing_d;
+        done_tgl_d <= done_tgl;
+        done_tgl_dd <= done_tgl_d;
+        done_tgl_ddd <= done_tgl_dd;
+        sub_max <= shift_left(to_unsigned(1,16), to_integer(unsigned(StepLog2))) - 1;
+
+        if done_tgl_ddd /= done_tgl_dd then
+            buf_busy <= '0';
+        end if;
+
+        -- skipped frames are counted from clear
+        if clearing_dd = '1' then
+            skip_cnt <= (others => '0');
+        end if;
+
+        if Start = '1' then
+            sub_cnt <= (others => '0');
+            cap_n <= (others => '0');
+            if enable_dd = '1' and buf_busy = '0' and clearing_dd = '0' then
+                accepted <= '1';
+                capturing <= '1';
+            else
+                accepted <= '0';
+                capturing <= '0';
+                if enable_dd = '1' then
+                    skip_cnt <= skip_cnt + 1;
+                end if;
+            end if;
+        elsif SampleEn = '1' and capturing = '1' then
+            if sub_cnt = 0 then
+                -- amplitudes in offset binary
+                buf(to_integer(cap_n(TBIN_LOG2-1 downto 0))) <= NOT(DataA(9)) & std_logic_vector(DataA(8 downto 0)) &
+                                                                NOT(DataB(9)) & std_logic_vector(DataB(8 downto 0));
+                cap_n <= cap_n + 1;
+                if cap_n = TBINS-1 then
+                    capturing <= '0';
+                end if;
+            end if;
+            if sub_cnt = sub_max then
+                sub_cnt <= (others => '0');
+            else
+                sub_cnt <= sub_cnt + 1;
+            end if;
+        end if;
+
+        -- frame finished: pass it to binning
+        if Stop = '1' and accepted = '1' then
+            accepted <= '0';
+            capturing <= '0';
+            if cap_n /= 0 then
+                buf_busy <= '1';
+                frame_len <= cap_n;
+                frame_skipped <= skip_cnt;
+                frame_tgl <= NOT(frame_tgl);
+            end if;
+        end if;
+
+    end if;
+end process;
+
+--=================================================
+-- histogram read-modify-write (clk)
+--=================================================
+amp <= unsigned(buf_q(19 downto 10)) when ch = '0' else unsigned(buf_q(9 downto 0));
+
+bin_proc: process (clk)
+    variable v_lane : integer range 0 to 7;
+    variable v_cnt : unsigned(15 downto 0);
+begin
+    if rising_edge(clk) then
+
+        frame_tgl_d <= frame_tgl;
+        frame_tgl_dd <= frame_tgl_d;
+        clear_d <= Clear;
+        clear_dd <= clear_d;
+        clear_ddd <= clear_dd;
+        if clear_dd = '1' and clear_ddd = '0' then
+            clr_pend <= '1';
+        end if;
+
+        buf_q <= buf(to_integer(buf_rd_addr));
+
+        case hist_state is
+
+        when IDLE =>
+            RdReq <= '0';
+            wr_req_i <= '0';
+            if clr_pend = '1' then
+                clr_pend <= '0';
+                clr_addr <= (others => '0');
+                hist_state <= CLR;
+            elsif frame_ack /= frame_tgl_dd then
+                -- frame finished during clear is binned after it (frame buffer stays busy until then)
+                frame_ack <= frame_tgl_dd;
+                len <= frame_len;
+                Skipped <= std_logic_vector(frame_skipped);
+                idx <= (others => '0');
+                ch <= '0';
+                buf_rd_addr <= (others => '0');
+                hist_state <= FETCH;
+            end if;
+
+        when CLR =>
+            -- write zeros to whole histogram region
+            if wr_req_i = '0' then
+                WrAddr <= std_logic_vector(HIST_BASE + resize(clr_addr,23));
+                WrData <= (others => '0');
+                wr_req_i <= '1';
+            elsif WrAck = '1' then
+                wr_req_i <= '0';
+                if clr_addr = HIST_WORDS-1 then
+                    frames_i <= (others => '0');
+                    saturated_i <= '0';
+                    Skipped <= (others => '0');
+                    hist_state <= IDLE;
+                else
+                    clr_addr <= clr_addr + 1;
+                end if;
+            end if;
+
+        when FETCH =>
+            -- frame buffer read
+            hist_state <= RD;
+
+        when RD =>
+            RdAddr <= std_logic_vector(HIST_BASE + resize(unsigned'(ch & idx & amp(9 downto 3)),23));
+            RdReq <= '1';
+            if RdAck = '1' then
+                RdReq <= '0';
+                hist_state <= RD_WAIT;
+            end if;
+
+        when RD_WAIT =>
+            if RdDataValid = '1' then
+                v_lane := to_integer(amp(2 downto 0));
+                v_cnt := unsigned(RdData(16*v_lane+15 downto 16*v_lane));
+                WrData <= RdData;
+                if v_cnt = X"FFFF" then
+                    saturated_i <= '1';
+                else
+                    WrData(16*v_lane+15 downto 16*v_lane) <= std_logic_vector(v_cnt + 1);
+                end if;
+                WrAddr <= std_logic_vector(HIST_BASE + resize(unsigned'(ch & idx & amp(9 downto 3)),23));
+                wr_req_i <= '1';
+                hist_state <= WR;
+            end if;
+
+        when WR =>
+            if WrAck = '1' then
+                wr_req_i <= '0';
+                if ch = '0' then
+                    ch <= '1';
+                    hist_state <= RD;
+                elsif idx = len - 1 then
+                    ch <= '0';
+                    frames_i <= frames_i + 1;
+                    done_tgl <= NOT(done_tgl);
+                    hist_state <= IDLE;
+                else
+                    ch <= '0';
+                    idx <= idx + 1;
+                    buf_rd_addr <= idx + 1;
+                    hist_state <= FETCH;
+                end if;
+            end if;
+
+        end case;
+
+    end if;
+end process;
+
+end Behavioral;
@@ -0,0 +1,351 @@
+----------------------------------------------------------------------------------
+--    Copyright (C) 2019 Dejan Priversek
+--
+--    This program is free software: you can redistribute it and/or modify
+--    it under the terms of the GNU General Public License as published by
+--    the Free Software Foundation, either version 3 of the License, or
+--    (at your option) any later version.
+--
+--    This program is distributed in the hope that it will be useful,
+--    but WITHOUT ANY WARRANTY; without even the implied warranty of
+--    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+--    GNU General Public License for more details.
+--
+--    You should have received a copy of the GNU General Public License
+--    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+----------------------------------------------------------------------------------
+
+--
+-- persistence histogram testbench
+-- (16 time bins, simple RAM model acknowledges requests and returns read data after 4 clk)
+-- histogram is cleared, then frames are sent (channel A ramp, channel B constant),
+-- third frame is finished while second one is still being binned: it must be skipped
+-- (number of skipped frames is published with next binned frame),
+-- one counter is then preset to maximum value: it must hold it (Saturated is set) while
+-- the others are incremented by next frame, clear must reset counters, Frames and Saturated,
+-- frame finished while histogram is being cleared must be binned after clear
+--
+
+LIBRARY IEEE;
+USE IEEE.STD_LOGIC_1164.ALL;
+USE IEEE.NUMERIC_STD.ALL;
+
+library user_lib;
+use user_lib.TextUtil.all;
+
+ENTITY hist_engine_tb IS
+END hist_engine_tb;
+
+ARCHITECTURE behavior OF hist_engine_tb IS
+
+    -- Component Declaration for the Unit Under Test (UUT)
+
+    component hist_engine is
+    Generic (
+        TBIN_LOG2 : integer := 10
+    );
+    Port (
+        clk_adc : in std_logic;
+        Enable : in std_logic;
+        StepLog2 : in std_logic_vector(3 downto 0);
+        Start : in std_logic;
+        Stop : in std_logic;
+        SampleEn : in std_logic;
+        DataA : in signed(9 downto 0);
+        DataB : in signed(9 downto 0);
+        clk : in std_logic;
+        RdReq : out std_logic;
+        RdAddr : out std_logic_vector(22 downto 0);
+        RdAck : in std_logic;
+        RdData : in std_logic_vector(127 downto 0);
+        RdDataValid : in std_logic;
+        WrReq : out std_logic;
+        WrAddr : out std_logic_vector(22 downto 0);
+        WrData : out std_logic_vector(127 downto 0);
+        WrAck : in std_logic;
+        Clear : in std_logic;
+        ResultTgl : out std_logic;
+        Frames : out std_logic_vector(31 downto 0);
+        Skipped : out std_logic_vector(31 downto 0);
+        Clearing : out std_logic;
+        Saturated : out std_logic
+    );
+    end component;
+
+    --constants
+    CONSTANT TBIN_LOG2 : integer := 4;
+    CONSTANT TBINS : integer := 2**TBIN_LOG2;
+    CONSTANT HIST_WORDS : integer := 2**(TBIN_LOG2+8);
+    CONSTANT B_LEVEL : integer := 100;
+
+    -- RAM model (histogram region only)
+    type mem_type is array(0 to HIST_WORDS-1) of std_logic_vector(127 downto 0);
+    signal mem : mem_type := (others => (others => '1'));
+    signal poke_en : std_logic := '0';      -- set counter to maximum value
+    signal poke_word : integer := 0;
+    signal poke_lane : integer := 0;
+
+    --Inputs
+    signal clk_adc : std_logic := '0';
+    signal clk : std_logic := '0';
+    signal Start : std_logic := '0';
+    signal Stop : std_logic := '0';
+    signal SampleEn : std_logic := '0';
+    signal DataA : signed(9 downto 0) := (others => '0');
+    signal DataB : signed(9 downto 0) := (others => '0');
+    signal RdAck : std_logic := '0';
+    signal RdData : std_logic_vector(127 downto 0) := (others => '0');
+    signal RdDataValid : std_logic := '0';
+    signal WrAck : std_logic := '0';
+    signal Clear : std_logic := '0';
+
+    --Outputs
+    signal RdReq : std_logic;
+    signal RdAddr : std_logic_vector(22 downto 0);
+    signal WrReq : std_logic;
+    signal WrAddr : std_logic_vector(22 downto 0);
+    signal WrData : std_logic_vector(127 downto 0);
+    signal ResultTgl : std_logic;
+    signal Frames : std_logic_vector(31 downto 0);
+    signal Skipped : std_logic_vector(31 downto 0);
+    signal Clearing : std_logic;
+    signal Saturated : std_logic;
+
+    signal sim_done : boolean := false;
+
+    -- Clock period definitions
+    constant clk_adc_period : time := 4 ns;
+    constant clk_period : time := 10 ns;
+
+    -- counter of amplitude (offset binary) in time bin of channel
+    function counter(m : mem_type; ch : integer; tbin : integer; amp : integer) return integer is
+        variable w : std_logic_vector(127 downto 0);
+    begin
+        w := m(ch * TBINS * 128 + tbin * 128 + amp / 8);
+        return to_integer(unsigned(w(16*(amp mod 8)+15 downto 16*(amp mod 8))));
+    end function;
+
+BEGIN
+
+    -- Instantiate the Unit Under Test (UUT)
+    uut: hist_engine
+    GENERIC MAP (
+        TBIN_LOG2 => TBIN_LOG2
+    )
+    PORT MAP (
+        clk_adc => clk_adc,
+        Enable => '1',
+        StepLog2 => X"0",
+        Start => Start,
+        Stop => Stop,
+        SampleEn => SampleEn,
+        DataA => DataA,
+        DataB => DataB,
+        clk => clk,
+        RdReq => RdReq,
+        RdAddr => RdAddr,
+        RdAck => RdAck,
+        RdData => RdData,
+        RdDataValid => RdDataValid,
+        WrReq => WrReq,
+        WrAddr => WrAddr,
+        WrData => WrData,
+        WrAck => WrAck,
+        Clear => Clear,
+        ResultTgl => ResultTgl,
+        Frames => Frames,
+        Skipped => Skipped,
+        Clearing => Clearing,
+        Saturated => Saturated
+    );
+
+    -- Clock process definitions
+    clk_adc_process :process
+    begin
+        if sim_done then
+            wait;
+        end if;
+        clk_adc <= '0';
+        wait for clk_adc_period/2;
+        clk_adc <= '1';
+        wait for clk_adc_period/2;
+    end process;
+
+    clk_process :process
+    begin
+        if sim_done then
+            wait;
+        end if;
+        clk <= '0';
+        wait for clk_period/2;
+        clk <= '1';
+        wait for clk_period/2;
+    end process;
+
+    -- RAM model
+    ram_proc: process(clk)
+        variable rd_delay : integer := 0;
+        variable rd_word : integer := 0;
+    begin
+        if rising_edge(clk) then
+            RdAck <= '0';
+            WrAck <= '0';
+            RdDataValid <= '0';
+            if rd_delay /= 0 then
+                rd_delay := rd_delay - 1;
+                if rd_delay = 0 then
+                    RdData <= mem(rd_word);
+                    RdDataValid <= '1';
+                end if;
+            elsif RdReq = '1' and RdAck = '0' then
+                RdAck <= '1';
+                rd_word := to_integer(unsigned(RdAddr)) - (2**23 - HIST_WORDS);
+                rd_delay := 4;
+            end if;
+            if WrReq = '1' and WrAck = '0' then
+                mem(to_integer(unsigned(WrAddr)) - (2**23 - HIST_WORDS)) <= WrData;
+                WrAck <= '1';
+            elsif poke_en = '1' then
+                mem(poke_word)(16*poke_lane+15 downto 16*poke_lane) <= X"FFFF";
+            end if;
+        end if;
+    end process;
+
+    -- Stimulus process
+    stim_proc: process
+        variable errors : integer := 0;
+        variable res_tgl : std_logic;
+        variable amp : integer;
+        variable total : integer;
+
+        -- Clear is raised at sample clear_at of the frame (-1: not raised)
+        procedure send_frame(clear_at : integer := -1) is
+        begin
+            wait until rising_edge(clk_adc);
+            Start <= '1';
+            wait until rising_edge(clk_adc);
+            Start <= '0';
+            for k in 0 to TBINS+3 loop
+                if k = clear_at then
+                    Clear <= '1';
+                end if;
+                DataA <= to_signed(8*k - 64,10);
+                DataB <= to_signed(B_LEVEL,10);
+                SampleEn <= '1';
+                wait until rising_edge(clk_adc);
+            end loop;
+            SampleEn <= '0';
+            Stop <= '1';
+            wait until rising_edge(clk_adc);
+            Stop <= '0';
+        end procedure;
+
+    begin
+        wait for 100 ns;
+        Clear <= '1';
+        wait until Clearing = '1';
+        Clear <= '0';
+        wait until Clearing = '0';
+        wait for 100 ns;
+
+        for f in 0 to 3 loop
+            if f /= 2 then
+                res_tgl := ResultTgl;
+            end if;
+            send_frame;
+            -- third frame follows second one immediately
+            if f /= 1 then
+                wait until ResultTgl /= res_tgl;
+            end if;
+        end loop;
+        wait for 1 us;
+
+        for k in 0 to TBINS-1 loop
+            amp := 8*k - 64 + 512;
+            Check(counter(mem,0,k,amp) = 3 and counter(mem,0,k,amp+1) = 0,
+                  "A time bin " & integer'image(k) & ": " & integer'image(counter(mem,0,k,amp)), errors);
+            Check(counter(mem,1,k,B_LEVEL+512) = 3,
+                  "B time bin " & integer'image(k) & ": " & integer'image(counter(mem,1,k,B_LEVEL+512)), errors);
+        end loop;
+        Check(unsigned(Frames) = 3 and unsigned(Skipped) = 1 and Saturated = '0',
+              "frames " & integer'image(to_integer(unsigned(Frames))) &
+              ", skipped " & integer'image(to_integer(unsigned(Skipped))), errors);
+
+        -- counter of A time bin 0 at maximum value
+        amp := -64 + 512;
+        wait until rising_edge(clk);
+        poke_word <= amp / 8;
+        poke_lane <= amp mod 8;
+        poke_en <= '1';
+        wait until rising_edge(clk);
+        poke_en <= '0';
+        res_tgl := ResultTgl;
+        send_frame;
+        wait until ResultTgl /= res_tgl;
+        wait for 1 us;
+        for k in 0 to TBINS-1 loop
+            amp := 8*k - 64 + 512;
+            if k = 0 then
+                Check(counter(mem,0,k,amp) = 16#FFFF#,
+                      "saturated counter: " & integer'image(counter(mem,0,k,amp)), errors);
+            else
+                Check(counter(mem,0,k,amp) = 4,
+                      "A time bin " & integer'image(k) & ": " & integer'image(counter(mem,0,k,amp)), errors);
+            end if;
+            Check(counter(mem,1,k,B_LEVEL+512) = 4,
+                  "B time bin " & integer'image(k) & ": " & integer'image(counter(mem,1,k,B_LEVEL+512)), errors);
+        end loop;
+        Check(unsigned(Frames) = 4 and Saturated = '1',
+              "frames " & integer'image(to_integer(unsigned(Frames))) & ", saturated " & std_logic'image(Saturated), errors);
+
+        Clear <= '1';
+        wait until Clearing = '1';
+        Clear <= '0';
+        wait until Clearing = '0';
+        wait for 100 ns;
+        Check(mem = (mem'range => (127 downto 0 => '0')), "histogram is not cleared", errors);
+        Check(unsigned(Frames) = 0 and unsigned(Skipped) = 0 and Saturated = '0',
+              "after clear: frames " & integer'image(to_integer(unsigned(Frames))) &
+              ", skipped " & integer'image(to_integer(unsigned(Skipped))) & ", saturated " & std_logic'image(Saturated), errors);
+
+        -- frame is finished while histogram is being cleared: it must be binned after clear,
+        -- next frame must be binned too (frame buffer is released)
+        for f in 1 to 2 loop
+            res_tgl := ResultTgl;
+            if f = 1 then
+                send_frame(2);
+                if Clearing = '0' then
+                    wait until Clearing = '1';
+                end if;
+                Clear <= '0';
+                wait until Clearing = '0';
+            else
+                send_frame;
+            end if;
+            if ResultTgl = res_tgl then
+                wait until ResultTgl /= res_tgl for 100 us;
+            end if;
+            Check(ResultTgl /= res_tgl, "frame " & integer'image(f) & " after clear is not binned", errors);
+            wait for 1 us;
+            total := 0;
+            for w in mem'range loop
+                for l in 0 to 7 loop
+                    total := total + to_integer(unsigned(mem(w)(16*l+15 downto 16*l)));
+                end loop;
+            end loop;
+            for k in 0 to TBINS-1 loop
+                amp := 8*k - 64 + 512;
+                Check(counter(mem,0,k,amp) = f and counter(mem,1,k,B_LEVEL+512) = f,
+                      "after clear, frame " & integer'image(f) & ", time bin " & integer'image(k) & ": A " &
+                      integer'image(counter(mem,0,k,amp)) & ", B " & integer'image(counter(mem,1,k,B_LEVEL+512)), errors);
+            end loop;
+            Check(total = 2*TBINS*f and unsigned(Frames) = f and Saturated = '0',
+                  "after clear, frame " & integer'image(f) & ": counts " & integer'image(total) &
+                  ", frames " & integer'image(to_integer(unsigned(Frames))), errors);
+        end loop;
+
+        EndTest("persistence histogram", errors, sim_done);
+        wait;
+    end process;
+
+END;
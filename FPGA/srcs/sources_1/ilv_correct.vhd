@@ -0,0 +1,222 @@
+----------------------------------------------------------------------------------
+--    Copyright (C) 2019 Dejan Priversek
+--
+--    This program is free software: you can redistribute it and/or modify
+--    it under the terms of the GNU General Public License as published by
+--    the Free Software Foundation, either version 3 of the License, or
+--    (at your option) any later version.
+--
+--    This program is distributed in the hope that it will be useful,
+--    but WITHOUT ANY WARRANTY; without even the implied warranty of
+--    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+--    GNU General Public License for more details.
+--
+--    You should have received a copy of the GNU General Public License
+--    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+----------------------------------------------------------------------------------
+
+--
+-- Scopefun firmware: interleaved ADC mismatch correction and calibration statistics
+--
+-- In interleaving mode both ADCs sample channel 1, ADC B half a clock period after ADC A,
+-- so A(n), B(n), A(n+1), ... is the 500 MS/s sample stream. Offset and gain of each ADC
+-- are corrected: x' = (x + Offset) * Gain / 2^15, and timing skew of ADC B is corrected by
+-- a 4-tap fractional delay FIR: B'(n) = sum(C_k * B(n+1-k)) / 2^14 (C_1 = 2^14 is no correction,
+-- A is delayed by one sample to match). Corrected samples are 6 clk after input samples.
+--
+-- Calibration: while a known tone is applied to channel 1, raw samples of 2^CalLog2 clocks
+-- (at most 2^22) are accumulated when CalStart goes high (results are held while it is high):
+--   sum A, sum B (offset), sum A^2, sum B^2 (gain), sum A(n)*B(n), sum B(n-1)*A(n) (skew:
+--   correlations over A->B and B->A sample gaps are equal when B is exactly half a period late).
+-- Host computes correction terms from them.
+--
+
+library IEEE;
+use IEEE.STD_LOGIC_1164.ALL;
+use IEEE.NUMERIC_STD.ALL;
+
+entity ilv_correct is
+    Port (
+        clk : in std_logic;                             -- ADC clock
+        DataA : in signed(9 downto 0);
+        DataB : in signed(9 downto 0);
+        OffsetA : in std_logic_vector(15 downto 0);     -- signed, ADC LSB
+        GainA : in std_logic_vector(15 downto 0);       -- unsigned, 2^15 = 1
+        OffsetB : in std_logic_vector(15 downto 0);
+        GainB : in std_logic_vector(15 downto 0);
+        Coef0 : in std_logic_vector(15 downto 0);       -- signed FIR coefficients, 2^14 = 1
+        Coef1 : in std_logic_vector(15 downto 0);
+        Coef2 : in std_logic_vector(15 downto 0);
+        Coef3 : in std_logic_vector(15 downto 0);
+        OutA : out signed(9 downto 0);
+        OutB : out signed(9 downto 0);
+        -- calibration
+        CalStart : in std_logic;                        -- asynchronous
+        CalLog2 : in std_logic_vector(4 downto 0);
+        CalBusy : out std_logic;
+        CalDone : out std_logic;
+        CalSumA : out std_logic_vector(31 downto 0);
+        CalSumB : out std_logic_vector(31 downto 0);
+        CalSumAA : out std_logic_vector(47 downto 0);
+        CalSumBB : out std_logic_vector(47 downto 0);
+        CalSumAB : out std_logic_vector(47 downto 0);
+        CalSumBA : out std_logic_vector(47 downto 0)
+    );
+end ilv_correct;
+
+architecture Behavioral of ilv_correct is
+
+type tap_array is array(0 to 3) of signed(17 downto 0);
+type prod_array is array(0 to 3) of signed(33 downto 0);
+
+-- saturate to ADC sample range
+function sat10(x : signed) return signed is
+begin
+    if x > 511 then
+        return to_signed(511,10);
+    elsif x < -512 then
+        return to_signed(-512,10);
+    else
+        return resize(x,10);
+    end if;
+end function;
+
+-- correction pipeline
+signal a_1 : signed(16 downto 0) := (others => '0');
+signal b_1 : signed(16 downto 0) := (others => '0');
+signal a_2 : signed(33 downto 0) := (others => '0');
+signal b_2 : signed(33 downto 0) := (others => '0');
+signal a_3 : signed(17 downto 0) := (others => '0');
+signal a_4 : signed(17 downto 0) := (others => '0');
+signal a_5 : signed(17 downto 0) := (others => '0');
+signal b_taps : tap_array := (others => (others => '0'));
+signal b_prod : prod_array := (others => (others => '0'));
+
+-- calibration
+signal cal_start_d : std_logic := '0';
+signal cal_start_dd : std_logic := '0';
+signal cal_start_ddd : std_logic := '0';
+signal cal_run : std_logic := '0';
+signal cal_run_d : std_logic := '0';
+signal cal_done_i : std_logic := '0';
+signal cal_cnt : unsigned(22 downto 0) := (others => '0');
+signal r_a : signed(9 downto 0) := (others => '0');
+signal r_b : signed(9 downto 0) := (others => '0');
+signal r_b_prev : signed(9 downto 0) := (others => '0');
+signal r_a_d : signed(9 downto 0) := (others => '0');
+signal r_b_d : signed(9 downto 0) := (others => '0');
+signal p_aa : signed(19 downto 0) := (others => '0');
+signal p_bb : signed(19 downto 0) := (others => '0');
+signal p_ab : signed(19 downto 0) := (others => '0');
+signal p_ba : signed(19 downto 0) := (others => '0');
+signal s_a : signed(31 downto 0) := (others => '0');
+signal s_b : signed(31 downto 0) := (others => '0');
+signal s_aa : signed(47 downto 0) := (others => '0');
+signal s_bb : signed(47 downto 0) := (others => '0');
+signal s_ab : signed(47 downto 0) := (others => '0');
+signal s_ba : signed(47 downto 0) := (others => '0');
+
+attribute ASYNC_REG: boolean;
+attribute ASYNC_REG of cal_start_d: signal is true;
+attribute ASYNC_REG of cal_start_dd: signal is true;
+
+begin
+
+CalBusy <= cal_run;
+CalDone <= cal_done_i;
+CalSumA <= std_logic_vector(s_a);
+CalSumB <= std_logic_vector(s_b);
+CalSumAA <= std_logic_vector(s_aa);
+CalSumBB <= std_logic_vector(s_bb);
+CalSumAB <= std_logic_vector(s_ab);
+CalSumBA <= std_logic_vector(s_ba);
+
+correct_proc: process (clk)
+    variable v_sum : signed(35 downto 0);
+begin
+    if rising_edge(clk) then
+
+        -- offset
+        a_1 <= resize(DataA,17) + resize(signed(OffsetA),17);
+        b_1 <= resize(DataB,17) + resize(signed(OffsetB),17);
+        -- gain
+        a_2 <= a_1 * signed('0' & GainA);
+        b_2 <= b_1 * signed('0' & GainB);
+        -- B skew: FIR taps (B(n+1) .. B(n-2) relative to delayed A)
+        b_taps(0) <= resize(shift_right(b_2,15),18);
+        b_taps(1 to 3) <= b_taps(0 to 2);
+        a_3 <= resize(shift_right(a_2,15),18);
+        a_4 <= a_3;
+        b_prod(0) <= b_taps(0) * signed(Coef0);
+        b_prod(1) <= b_taps(1) * signed(Coef1);
+        b_prod(2) <= b_taps(2) * signed(Coef2);
+        b_prod(3) <= b_taps(3) * signed(Coef3);
+        a_5 <= a_4;
+        v_sum := resize(b_prod(0),36) + resize(b_prod(1),36) + resize(b_prod(2),36) + resize(b_prod(3),36);
+        OutB <= sat10(shift_right(v_sum,14));
+        OutA <= sat10(a_5);
+
+    end if;
+end process;
+
+cal_proc: process (clk)
+begin
+    if rising_edge(clk) then
+
+        cal_start_d <= CalStart;
+        cal_start_dd <= cal_start_d;
+        cal_start_ddd <= cal_start_dd;
+
+        -- raw samples and products
+        r_a <= DataA;
+        r_b <= DataB;
+        r_b_prev <= r_b;
+        r_a_d <= r_a;
+        r_b_d <= r_b;
+        p_aa <= r_a * r_a;
+        p_bb <= r_b * r_b;
+        p_ab <= r_a * r_b;
+        p_ba <= r_b_prev * r_a;
+        cal_run_d <= cal_run;
+
+        if cal_start_dd = '0' then
+            cal_run <= '0';
+            cal_done_i <= '0';
+        elsif cal_start_ddd = '0' then
+            -- start: clear sums
+            cal_run <= '1';
+            cal_done_i <= '0';
+            if unsigned(CalLog2) > 22 then
+                cal_cnt <= to_unsigned(2**22-1,23);
+            else
+                cal_cnt <= shift_left(to_unsigned(1,23),to_integer(unsigned(CalLog2))) - 1;
+            end if;
+            s_a <= (others => '0');
+            s_b <= (others => '0');
+            s_aa <= (others => '0');
+            s_bb <= (others => '0');
+            s_ab <= (others => '0');
+            s_ba <= (others => '0');
+        elsif cal_run = '1' then
+            if cal_cnt = 0 then
+                cal_run <= '0';
+                cal_done_i <= '1';
+            else
+                cal_cnt <= cal_cnt - 1;
+            end if;
+        end if;
+
+        -- accumulate (products are one clk behind samples)
+        if cal_run_d = '1' then
+            s_a <= s_a + resize(r_a_d,32);
+            s_b <= s_b + resize(r_b_d,32);
+            s_aa <= s_aa + resize(p_aa,48);
+            s_bb <= s_bb + resize(p_bb,48);
+            s_ab <= s_ab + resize(p_ab,48);
+            s_ba <= s_ba + resize(p_ba,48);
+        end if;
+
+    end if;
+end process;
+
+end Behavioral;
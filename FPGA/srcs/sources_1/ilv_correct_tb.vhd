@@ -0,0 +1,187 @@
+----------------------------------------------------------------------------------
+--    Copyright (C) 2019 Dejan Priversek
+--
+--    This program is free software: you can redistribute it and/or modify
+--    it under the terms of the GNU General Public License as published by
+--    the Free Software Foundation, either version 3 of the License, or
+--    (at your option) any later version.
+--
+--    This program is distributed in the hope that it will be useful,
+--    but WITHOUT ANY WARRANTY; without even the implied warranty of
+--    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+--    GNU General Public License for more details.
+--
+--    You should have received a copy of the GNU General Public License
+--    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+----------------------------------------------------------------------------------
+
+--
+-- interleaved ADC correction testbench
+-- ADC B samples the tone half a period after ADC A with gain 0.9 and offset +6:
+-- corrected B must match ideal samples, calibration sums must show the mismatch
+--
+
+LIBRARY IEEE;
+USE IEEE.STD_LOGIC_1164.ALL;
+USE IEEE.NUMERIC_STD.ALL;
+USE IEEE.MATH_REAL.ALL;
+
+library user_lib;
+use user_lib.TextUtil.all;
+
+ENTITY ilv_correct_tb IS
+END ilv_correct_tb;
+
+ARCHITECTURE behavior OF ilv_correct_tb IS
+
+    -- Component Declaration for the Unit Under Test (UUT)
+
+    component ilv_correct is
+    Port (
+        clk : in std_logic;
+        DataA : in signed(9 downto 0);
+        DataB : in signed(9 downto 0);
+        OffsetA : in std_logic_vector(15 downto 0);
+        GainA : in std_logic_vector(15 downto 0);
+        OffsetB : in std_logic_vector(15 downto 0);
+        GainB : in std_logic_vector(15 downto 0);
+        Coef0 : in std_logic_vector(15 downto 0);
+        Coef1 : in std_logic_vector(15 downto 0);
+        Coef2 : in std_logic_vector(15 downto 0);
+        Coef3 : in std_logic_vector(15 downto 0);
+        OutA : out signed(9 downto 0);
+        OutB : out signed(9 downto 0);
+        CalStart : in std_logic;
+        CalLog2 : in std_logic_vector(4 downto 0);
+        CalBusy : out std_logic;
+        CalDone : out std_logic;
+        CalSumA : out std_logic_vector(31 downto 0);
+        CalSumB : out std_logic_vector(31 downto 0);
+        CalSumAA : out std_logic_vector(47 downto 0);
+        CalSumBB : out std_logic_vector(47 downto 0);
+        CalSumAB : out std_logic_vector(47 downto 0);
+        CalSumBA : out std_logic_vector(47 downto 0)
+    );
+    end component;
+
+    --constants
+    CONSTANT PERIOD : integer := 50;        -- tone period (interleaved samples)
+    CONSTANT LATENCY : integer := 6;        -- clk
+    CONSTANT CAL_LOG2 : integer := 12;
+    CONSTANT N_CHECK : integer := 200;
+
+    -- ideal sample k of interleaved stream (A(n) = 2n, B(n) = 2n + 1)
+    function tone(k : integer) return real is
+    begin
+        return 400.0 * sin(MATH_2_PI * real(k) / real(PERIOD));
+    end function;
+
+    --Inputs
+    signal clk : std_logic := '0';
+    signal DataA : signed(9 downto 0) := (others => '0');
+    signal DataB : signed(9 downto 0) := (others => '0');
+    signal CalStart : std_logic := '0';
+
+    --Outputs
+    signal OutA : signed(9 downto 0);
+    signal OutB : signed(9 downto 0);
+    signal CalBusy : std_logic;
+    signal CalDone : std_logic;
+    signal CalSumA : std_logic_vector(31 downto 0);
+    signal CalSumB : std_logic_vector(31 downto 0);
+    signal CalSumAA : std_logic_vector(47 downto 0);
+    signal CalSumBB : std_logic_vector(47 downto 0);
+    signal CalSumAB : std_logic_vector(47 downto 0);
+    signal CalSumBA : std_logic_vector(47 downto 0);
+
+    signal n : integer := 0;                -- clk (A/B pair) counter
+
+    signal sim_done : boolean := false;
+
+    -- Clock period definitions
+    constant clk_period : time := 4 ns;
+
+BEGIN
+
+    -- Instantiate the Unit Under Test (UUT)
+    uut: ilv_correct
+    PORT MAP (
+        clk => clk,
+        DataA => DataA,
+        DataB => DataB,
+        OffsetA => X"0000",
+        GainA => X"8000",
+        OffsetB => std_logic_vector(to_signed(-6,16)),
+        GainB => std_logic_vector(to_unsigned(integer(32768.0/0.9),16)),
+        Coef0 => X"0000",
+        Coef1 => X"4000",
+        Coef2 => X"0000",
+        Coef3 => X"0000",
+        OutA => OutA,
+        OutB => OutB,
+        CalStart => CalStart,
+        CalLog2 => std_logic_vector(to_unsigned(CAL_LOG2,5)),
+        CalBusy => CalBusy,
+        CalDone => CalDone,
+        CalSumA => CalSumA,
+        CalSumB => CalSumB,
+        CalSumAA => CalSumAA,
+        CalSumBB => CalSumBB,
+        CalSumAB => CalSumAB,
+        CalSumBA => CalSumBA
+    );
+
+    -- Clock process definitions
+    clk_process :process
+    begin
+        if sim_done then
+            wait;
+        end if;
+        clk <= '0';
+        wait for clk_period/2;
+        clk <= '1';
+        wait for clk_period/2;
+    end process;
+
+    -- ADC data
+    data_proc: process(clk)
+    begin
+        if rising_edge(clk) then
+            DataA <= to_signed(integer(round(tone(2*n))),10);
+            DataB <= to_signed(integer(round(0.9 * tone(2*n+1) + 6.0)),10);
+            n <= n + 1;
+        end if;
+    end process;
+
+    -- Stimulus process
+    stim_proc: process
+        variable errors : integer := 0;
+        variable k : integer;
+        variable mean_b, rms_a, rms_b : real;
+    begin
+        wait for 100 ns;
+        -- corrected samples (n is index of next input pair, output is LATENCY pairs behind)
+        for i in 1 to N_CHECK loop
+            wait until rising_edge(clk);
+            k := n - 1 - LATENCY;
+            Check(abs(to_integer(OutA) - integer(round(tone(2*k)))) <= 1
+                  and abs(to_integer(OutB) - integer(round(tone(2*k+1)))) <= 2,
+                  "pair " & integer'image(k) & ": " & integer'image(to_integer(OutA)) & ", " & integer'image(to_integer(OutB)) &
+                      ", expected " & integer'image(integer(round(tone(2*k)))) & ", " & integer'image(integer(round(tone(2*k+1)))), errors);
+        end loop;
+
+        -- calibration statistics
+        CalStart <= '1';
+        wait until CalDone = '1';
+        wait until rising_edge(clk);
+        mean_b := real(to_integer(signed(CalSumB))) / 2.0**CAL_LOG2;
+        rms_a := sqrt(real(to_integer(signed(CalSumAA(31 downto 0)))) / 2.0**CAL_LOG2);
+        rms_b := sqrt(real(to_integer(signed(CalSumBB(31 downto 0)))) / 2.0**CAL_LOG2 - mean_b**2);
+        Print("mean B " & real'image(mean_b) & ", rms A " & real'image(rms_a) & ", rms B " & real'image(rms_b));
+        Check(abs(mean_b - 6.0) <= 0.5 and abs(rms_b / rms_a - 0.9) <= 0.01, "calibration sums error", errors);
+
+        EndTest("interleaved ADC correction", errors, sim_done);
+        wait;
+    end process;
+
+END;
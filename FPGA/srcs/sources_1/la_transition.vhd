@@ -0,0 +1,71 @@
+----------------------------------------------------------------------------------
+--    Copyright (C) 2019 Dejan Priversek
+--
+--    This program is free software: you can redistribute it and/or modify
+--    it under the terms of the GNU General Public License as published by
+--    the Free Software Foundation, either version 3 of the License, or
+--    (at your option) any later version.
+--
+--    This program is distributed in the hope that it will be useful,
+--    but WITHOUT ANY WARRANTY; without even the implied warranty of
+--    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+--    GNU General Public License for more details.
+--
+--    You should have received a copy of the GNU General Public License
+--    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+----------------------------------------------------------------------------------
+
+--
+-- Scopefun firmware: transition-only storage of digital channels (records)
+--
+-- Record (32-bit RAM word): bits 31..12: number of samples since previous record (1 to X"FFFFF"),
+-- bits 11..0: dataD at record sample. Record is made on sample (SampleEn) when a digital line
+-- selected by Mask changes, or when sample counter is full (idle marker: delta X"FFFFF", state is
+-- unchanged), or on every sample while Force is high (frame is not being saved).
+-- Host expander: first record of frame is at sample 0 (its delta is ignored), record k is at
+-- sample position of record k-1 plus its delta, state of record holds until next record
+-- (lines not selected by Mask are only valid at record samples).
+-- RecValid is high for one clk, 1 clk after the sample.
+--
+
+library IEEE;
+use IEEE.STD_LOGIC_1164.ALL;
+use IEEE.NUMERIC_STD.ALL;
+
+entity la_transition is
+    Port (
+        clk : in std_logic;
+        SampleEn : in std_logic;
+        Force : in std_logic;                           -- record every sample
+        Mask : in std_logic_vector(11 downto 0);        -- digital lines which make new record
+        DataD : in std_logic_vector(11 downto 0);
+        Rec : out std_logic_vector(31 downto 0);
+        RecValid : out std_logic
+    );
+end la_transition;
+
+architecture Behavioral of la_transition is
+
+signal last : std_logic_vector(11 downto 0) := (others => '0');
+signal delta : unsigned(19 downto 0) := (others => '0');
+
+begin
+
+rec_proc: process (clk)
+begin
+    if rising_edge(clk) then
+        RecValid <= '0';
+        if SampleEn = '1' then
+            if ((DataD XOR last) AND Mask) /= X"000" OR delta = X"FFFFF" OR Force = '1' then
+                Rec <= std_logic_vector(delta) & DataD;
+                RecValid <= '1';
+                last <= DataD;
+                delta <= X"00001";
+            else
+                delta <= delta + 1;
+            end if;
+        end if;
+    end if;
+end process;
+
+end Behavioral;
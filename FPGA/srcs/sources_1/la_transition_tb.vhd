@@ -0,0 +1,201 @@
+----------------------------------------------------------------------------------
+--    Copyright (C) 2019 Dejan Priversek
+--
+--    This program is free software: you can redistribute it and/or modify
+--    it under the terms of the GNU General Public License as published by
+--    the Free Software Foundation, either version 3 of the License, or
+--    (at your option) any later version.
+--
+--    This program is distributed in the hope that it will be useful,
+--    but WITHOUT ANY WARRANTY; without even the implied warranty of
+--    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+--    GNU General Public License for more details.
+--
+--    You should have received a copy of the GNU General Public License
+--    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+----------------------------------------------------------------------------------
+
+--
+-- transition-only LA storage testbench
+-- known pattern (masked lines count changes, unmasked lines toggle all the time) is recorded
+-- with SampleEn gaps (data in gaps is garbage), first samples are forced records, one idle
+-- stretch is longer than delta counter range (idle marker); records are expanded back to
+-- samples as host does (reference expander) and compared to the pattern
+--
+
+LIBRARY IEEE;
+USE IEEE.STD_LOGIC_1164.ALL;
+USE IEEE.NUMERIC_STD.ALL;
+
+library user_lib;
+use user_lib.TextUtil.all;
+
+ENTITY la_transition_tb IS
+END la_transition_tb;
+
+ARCHITECTURE behavior OF la_transition_tb IS
+
+    -- Component Declaration for the Unit Under Test (UUT)
+
+    component la_transition is
+    Port ( clk : in std_logic;
+           SampleEn : in std_logic;
+           Force : in std_logic;
+           Mask : in std_logic_vector(11 downto 0);
+           DataD : in std_logic_vector(11 downto 0);
+           Rec : out std_logic_vector(31 downto 0);
+           RecValid : out std_logic
+           );
+    end component;
+
+    --constants
+    type int_array is array(natural range <>) of integer;
+    CONSTANT MASK : std_logic_vector(11 downto 0) := X"0F5";    -- lines 0, 2, 4..7
+    CONSTANT N_SAMPLES : integer := 2**20 + 400;
+    CONSTANT N_FORCE : integer := 4;                            -- forced records (frame not saved yet)
+    -- samples where masked lines change
+    CONSTANT CHANGE_POS : int_array := (5, 6, 7, 100, 101, 250, 2**20 + 300, N_SAMPLES-1);
+    CONSTANT MAX_REC : integer := 64;
+
+    -- dataD of sample n
+    function pattern(n : integer) return std_logic_vector is
+        variable c : integer := 0;
+        variable v : unsigned(5 downto 0);
+        variable d : std_logic_vector(11 downto 0);
+    begin
+        for i in CHANGE_POS'range loop
+            if CHANGE_POS(i) <= n then
+                c := c + 1;
+            end if;
+        end loop;
+        v := to_unsigned(c mod 64, 6);
+        d(0) := v(0);
+        d(2) := v(1);
+        d(4) := v(2);
+        d(5) := v(3);
+        d(6) := v(4);
+        d(7) := v(5);
+        d(1) := to_unsigned(n mod 2, 1)(0);
+        d(3) := to_unsigned((n/3) mod 2, 1)(0);
+        d(11 downto 8) := std_logic_vector(to_unsigned((n/7) mod 16, 4));
+        return d;
+    end function;
+
+    --Inputs
+    signal clk : std_logic := '0';
+    signal SampleEn : std_logic := '0';
+    signal Force : std_logic := '0';
+    signal DataD : std_logic_vector(11 downto 0) := (others => '0');
+
+    --Outputs
+    signal Rec : std_logic_vector(31 downto 0);
+    signal RecValid : std_logic;
+
+    type rec_array is array(0 to MAX_REC-1) of std_logic_vector(31 downto 0);
+    signal recs : rec_array := (others => (others => '0'));
+    signal rec_n : integer := 0;
+
+    signal sim_done : boolean := false;
+
+    -- Clock period definitions
+    constant clk_period : time := 4 ns;
+
+BEGIN
+
+    -- Instantiate the Unit Under Test (UUT)
+    uut: la_transition
+    PORT MAP (
+        clk => clk,
+        SampleEn => SampleEn,
+        Force => Force,
+        Mask => MASK,
+        DataD => DataD,
+        Rec => Rec,
+        RecValid => RecValid
+    );
+
+    -- Clock process definitions
+    clk_process :process
+    begin
+        if sim_done then
+            wait;
+        end if;
+        clk <= '0';
+        wait for clk_period/2;
+        clk <= '1';
+        wait for clk_period/2;
+    end process;
+
+    -- Stimulus process
+    stim_proc: process
+        variable errors : integer := 0;
+        variable pos : integer;
+        variable next_pos : integer;
+        variable state : std_logic_vector(11 downto 0);
+        variable idle : integer;
+    begin
+        wait for 100 ns;
+        wait until rising_edge(clk);
+        for n in 0 to N_SAMPLES-1 loop
+            DataD <= pattern(n);
+            SampleEn <= '1';
+            if n < N_FORCE then
+                Force <= '1';
+            else
+                Force <= '0';
+            end if;
+            wait until rising_edge(clk);
+            -- clk without sample
+            if n mod 5 = 4 then
+                DataD <= NOT(pattern(n));
+                SampleEn <= '0';
+                wait until rising_edge(clk);
+            end if;
+        end loop;
+        SampleEn <= '0';
+        wait until rising_edge(clk);
+        wait until rising_edge(clk);
+
+        -- reference expander: first record is at sample 0, record k at position of record k-1 + delta,
+        -- masked lines hold record state until next record
+        Check(rec_n = N_FORCE + CHANGE_POS'length + 1, "number of records: " & integer'image(rec_n), errors);
+        pos := 0;
+        idle := 0;
+        for k in 0 to rec_n-1 loop
+            if k > 0 then
+                pos := pos + to_integer(unsigned(recs(k)(31 downto 12)));
+            end if;
+            if recs(k)(31 downto 12) = X"FFFFF" then
+                idle := idle + 1;
+            end if;
+            state := recs(k)(11 downto 0);
+            Check(state = pattern(pos), "record " & integer'image(k) & " at sample " & integer'image(pos) & ": state mismatch", errors);
+            if k < rec_n-1 then
+                next_pos := pos + to_integer(unsigned(recs(k+1)(31 downto 12)));
+                for n in pos to next_pos-1 loop
+                    if ((pattern(n) XOR state) AND MASK) /= X"000" then
+                        Check(false, "sample " & integer'image(n) & ": expanded state mismatch", errors);
+                        exit;
+                    end if;
+                end loop;
+            end if;
+        end loop;
+        Check(pos = N_SAMPLES-1, "last record at sample " & integer'image(pos), errors);
+        Check(idle = 1, "idle markers: " & integer'image(idle), errors);
+
+        EndTest("LA transition records", errors, sim_done);
+        wait;
+    end process;
+
+    -- collect records
+    rec_proc: process(clk)
+    begin
+        if rising_edge(clk) then
+            if RecValid = '1' and rec_n < MAX_REC then
+                recs(rec_n) <= Rec;
+                rec_n <= rec_n + 1;
+            end if;
+        end if;
+    end process;
+
+END;
@@ -0,0 +1,231 @@
+----------------------------------------------------------------------------------
+--    Copyright (C) 2019 Dejan Priversek
+--
+--    This program is free software: you can redistribute it and/or modify
+--    it under the terms of the GNU General Public License as published by
+--    the Free Software Foundation, either version 3 of the License, or
+--    (at your option) any later version.
+--
+--    This program is distributed in the hope that it will be useful,
+--    but WITHOUT ANY WARRANTY; without even the implied warranty of
+--    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+--    GNU General Public License for more details.
+--
+--    You should have received a copy of the GNU General Public License
+--    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+----------------------------------------------------------------------------------
+
+--
+-- Scopefun firmware: mask (pass/fail) test of channels A and B
+--
+-- Every sample of the post-trigger part of the frame (SampleEn between Start and Stop) starting
+-- Offset samples after the trigger is compared with upper and lower limit of its mask entry.
+-- One mask entry covers 2^StepLog2 samples, Length entries are used (up to MASK_SIZE).
+-- Limits are written from host clock domain (upper limit in bits 23..12, lower limit in bits 11..0,
+-- two's complement), sample is out of mask when it is above upper or below lower limit.
+-- Results are published when frame is finished (ResultTgl toggles, held until next frame).
+-- Frame counters count while Enable is high and are cleared when it goes low.
+--
+
+library IEEE;
+use IEEE.STD_LOGIC_1164.ALL;
+use IEEE.NUMERIC_STD.ALL;
+
+entity mask_test is
+    Generic (
+        MASK_LOG2 : integer := 12                       -- number of mask entries per channel (log2)
+    );
+    Port (
+        clk : in std_logic;                             -- ADC clock
+        Enable : in std_logic;
+        Offset : in std_logic_vector(26 downto 0);      -- first tested sample (from trigger)
+        StepLog2 : in std_logic_vector(3 downto 0);     -- samples per mask entry (log2)
+        Length : in std_logic_vector(MASK_LOG2 downto 0); -- number of mask entries
+        Start : in std_logic;                           -- start of post-trigger part of frame
+        Stop : in std_logic;                            -- frame is finished
+        SampleEn : in std_logic;
+        DataA : in signed(9 downto 0);
+        DataB : in signed(9 downto 0);
+        -- mask limits (host clock domain)
+        clk_wr : in std_logic;
+        WrEn : in std_logic;
+        WrSel : in std_logic;                           -- 0: channel A, 1: channel B
+        WrAddr : in std_logic_vector(MASK_LOG2-1 downto 0);
+        WrData : in std_logic_vector(23 downto 0);
+        -- results
+        ResultTgl : out std_logic;
+        Fail : out std_logic;                           -- frame failed (some sample was out of mask)
+        ViolA : out std_logic_vector(31 downto 0);      -- number of samples out of mask
+        ViolB : out std_logic_vector(31 downto 0);
+        FirstFail : out std_logic_vector(31 downto 0);  -- first sample out of mask (from trigger), all ones: none
+        FramesTested : out std_logic_vector(31 downto 0);
+        FramesFailed : out std_logic_vector(31 downto 0)
+    );
+end mask_test;
+
+architecture Behavioral of mask_test is
+
+CONSTANT MASK_SIZE : integer := 2**MASK_LOG2;
+
+type ram_type is array (MASK_SIZE-1 downto 0) of std_logic_vector (23 downto 0);
+signal ram_a : ram_type;
+signal ram_b : ram_type;
+
+ATTRIBUTE ram_style: string;
+ATTRIBUTE ram_style OF ram_a: SIGNAL IS "block";
+ATTRIBUTE ram_style OF ram_b: SIGNAL IS "block";
+
+type sample_array is array(0 to 1) of signed(11 downto 0);
+type lim_array is array(0 to 1) of std_logic_vector(23 downto 0);
+type cnt_array is array(0 to 1) of unsigned(31 downto 0);
+
+signal enable_d : std_logic := '0';
+signal enable_dd : std_logic := '0';
+signal x_1 : sample_array := (others => (others => '0'));
+signal x_2 : sample_array := (others => (others => '0'));
+signal start_1 : std_logic := '0';
+signal stop_1 : std_logic := '0';
+signal stop_2 : std_logic := '0';
+signal stop_3 : std_logic := '0';
+signal pos : unsigned(31 downto 0) := (others => '0');   -- sample number (from trigger)
+signal pos_1 : unsigned(31 downto 0) := (others => '0');
+signal pos_2 : unsigned(31 downto 0) := (others => '0');
+signal skip_cnt : unsigned(26 downto 0) := (others => '0');
+signal sub_cnt : unsigned(15 downto 0) := (others => '0');
+signal sub_max : unsigned(15 downto 0) := (others => '0');
+signal addr : unsigned(MASK_LOG2 downto 0) := (others => '0');
+signal active : std_logic := '0';
+signal check_1 : std_logic := '0';
+signal check_2 : std_logic := '0';
+signal rd_addr : std_logic_vector(MASK_LOG2-1 downto 0) := (others => '0');
+signal lim : lim_array := (others => (others => '0'));
+signal viol : cnt_array := (others => (others => '0'));
+signal failed : std_logic := '0';
+signal first_fail : unsigned(31 downto 0) := (others => '1');
+signal frames_tested : unsigned(31 downto 0) := (others => '0');
+signal frames_failed : unsigned(31 downto 0) := (others => '0');
+
+signal result_tgl_i : std_logic := '0';
+
+attribute ASYNC_REG : string;
+attribute ASYNC_REG of enable_d: signal is "true";
+attribute ASYNC_REG of enable_dd: signal is "true";
+
+begin
+
+ResultTgl <= result_tgl_i;
+
+-- mask limits
+wr_proc: process (clk_wr)
+begin
+    if rising_edge(clk_wr) then
+        if WrEn = '1' then
+            if WrSel = '0' then
+                ram_a(to_integer(unsigned(WrAddr))) <= WrData;
+            else
+                ram_b(to_integer(unsigned(WrAddr))) <= WrData;
+            end if;
+        end if;
+    end if;
+end process;
+
+rd_proc: process (clk)
+begin
+    if rising_edge(clk) then
+        lim(0) <= ram_a(to_integer(unsigned(rd_addr)));
+        lim(1) <= ram_b(to_integer(unsigned(rd_addr)));
+    end if;
+end process;
+
+mask_proc: process (clk)
+begin
+    if rising_edge(clk) then
+
+        enable_d <= Enable;
+        enable_dd <= enable_d;
+        start_1 <= Start;
+        stop_1 <= Stop;
+        stop_2 <= stop_1;
+        stop_3 <= stop_2;
+        sub_max <= shift_left(to_unsigned(1,16), to_integer(unsigned(StepLog2))) - 1;
+
+        -- stage 1: mask entry address
+        x_1(0) <= resize(DataA,12);
+        x_1(1) <= resize(DataB,12);
+        pos_1 <= pos;
+        check_1 <= '0';
+        if Start = '1' then
+            pos <= (others => '0');
+            skip_cnt <= unsigned(Offset);
+            sub_cnt <= (others => '0');
+            addr <= (others => '0');
+            if unsigned(Length) /= 0 and enable_dd = '1' then
+                active <= '1';
+            else
+                active <= '0';
+            end if;
+        elsif SampleEn = '1' then
+            pos <= pos + 1;
+            if skip_cnt /= 0 then
+                skip_cnt <= skip_cnt - 1;
+            elsif active = '1' then
+                check_1 <= '1';
+                rd_addr <= std_logic_vector(addr(MASK_LOG2-1 downto 0));
+                if sub_cnt = sub_max then
+                    sub_cnt <= (others => '0');
+                    if addr = unsigned(Length) - 1 then
+                        active <= '0';
+                    end if;
+                    addr <= addr + 1;
+                else
+                    sub_cnt <= sub_cnt + 1;
+                end if;
+            end if;
+        end if;
+
+        -- stage 2: limits are read from RAM
+        x_2 <= x_1;
+        pos_2 <= pos_1;
+        check_2 <= check_1;
+
+        -- stage 3: compare
+        if start_1 = '1' then
+            viol <= (others => (others => '0'));
+            failed <= '0';
+            first_fail <= (others => '1');
+        elsif check_2 = '1' then
+            for c in 0 to 1 loop
+                if x_2(c) > signed(lim(c)(23 downto 12)) or x_2(c) < signed(lim(c)(11 downto 0)) then
+                    viol(c) <= viol(c) + 1;
+                    failed <= '1';
+                    if failed = '0' then
+                        first_fail <= pos_2;
+                    end if;
+                end if;
+            end loop;
+        end if;
+
+        -- frame finished: publish results
+        if enable_dd = '0' then
+            frames_tested <= (others => '0');
+            frames_failed <= (others => '0');
+        elsif stop_3 = '1' then
+            frames_tested <= frames_tested + 1;
+            if failed = '1' then
+                frames_failed <= frames_failed + 1;
+            end if;
+        end if;
+        if stop_3 = '1' then
+            Fail <= failed;
+            ViolA <= std_logic_vector(viol(0));
+            ViolB <= std_logic_vector(viol(1));
+            FirstFail <= std_logic_vector(first_fail);
+            result_tgl_i <= NOT(result_tgl_i);
+        end if;
+        FramesTested <= std_logic_vector(frames_tested);
+        FramesFailed <= std_logic_vector(frames_failed);
+
+    end if;
+end process;
+
+end Behavioral;
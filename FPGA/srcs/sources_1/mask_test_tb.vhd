@@ -0,0 +1,236 @@
+----------------------------------------------------------------------------------
+--    Copyright (C) 2019 Dejan Priversek
+--
+--    This program is free software: you can redistribute it and/or modify
+--    it under the terms of the GNU General Public License as published by
+--    the Free Software Foundation, either version 3 of the License, or
+--    (at your option) any later version.
+--
+--    This program is distributed in the hope that it will be useful,
+--    but WITHOUT ANY WARRANTY; without even the implied warranty of
+--    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+--    GNU General Public License for more details.
+--
+--    You should have received a copy of the GNU General Public License
+--    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+----------------------------------------------------------------------------------
+
+--
+-- mask test testbench
+-- mask of channel A is +/-100 (two samples per entry, from sample 5 after trigger, 8 entries),
+-- first frame stays within the mask, second frame has samples out of mask
+-- before, inside and after the tested part of the frame: only the one inside must fail,
+-- remaining frames are out of mask everywhere: mask offset runs past frame end (only
+-- last 3 samples are tested), offset is beyond frame end (nothing tested, frame passes)
+-- and offset is back at sample 5 (whole mask fails)
+--
+
+LIBRARY IEEE;
+USE IEEE.STD_LOGIC_1164.ALL;
+USE IEEE.NUMERIC_STD.ALL;
+
+library user_lib;
+use user_lib.TextUtil.all;
+
+ENTITY mask_test_tb IS
+END mask_test_tb;
+
+ARCHITECTURE behavior OF mask_test_tb IS
+
+    -- Component Declaration for the Unit Under Test (UUT)
+
+    component mask_test is
+    Generic (
+        MASK_LOG2 : integer := 12
+    );
+    Port (
+        clk : in std_logic;
+        Enable : in std_logic;
+        Offset : in std_logic_vector(26 downto 0);
+        StepLog2 : in std_logic_vector(3 downto 0);
+        Length : in std_logic_vector(MASK_LOG2 downto 0);
+        Start : in std_logic;
+        Stop : in std_logic;
+        SampleEn : in std_logic;
+        DataA : in signed(9 downto 0);
+        DataB : in signed(9 downto 0);
+        clk_wr : in std_logic;
+        WrEn : in std_logic;
+        WrSel : in std_logic;
+        WrAddr : in std_logic_vector(MASK_LOG2-1 downto 0);
+        WrData : in std_logic_vector(23 downto 0);
+        ResultTgl : out std_logic;
+        Fail : out std_logic;
+        ViolA : out std_logic_vector(31 downto 0);
+        ViolB : out std_logic_vector(31 downto 0);
+        FirstFail : out std_logic_vector(31 downto 0);
+        FramesTested : out std_logic_vector(31 downto 0);
+        FramesFailed : out std_logic_vector(31 downto 0)
+    );
+    end component;
+
+    --constants
+    CONSTANT MASK_LOG2 : integer := 6;
+    CONSTANT N_SAMPLES : integer := 40;
+    CONSTANT N_ENTRIES : integer := 8;
+    CONSTANT FAIL_POS : integer := 10;
+    CONSTANT N_FRAMES : integer := 5;
+    type int_array is array(0 to N_FRAMES-1) of integer;
+    CONSTANT FRAME_OFFSET : int_array := (5, 5, N_SAMPLES-3, N_SAMPLES+10, 5);
+    CONSTANT FRAME_VIOL : int_array := (0, 1, 3, 0, 2*N_ENTRIES);       -- expected samples out of mask A
+    CONSTANT FRAME_FIRST : int_array := (-1, FAIL_POS, N_SAMPLES-3, -1, 5);
+
+    --Inputs
+    signal clk : std_logic := '0';
+    signal clk_wr : std_logic := '0';
+    signal Enable : std_logic := '0';
+    signal Offset : std_logic_vector(26 downto 0) := (others => '0');
+    signal Start : std_logic := '0';
+    signal Stop : std_logic := '0';
+    signal SampleEn : std_logic := '0';
+    signal DataA : signed(9 downto 0) := (others => '0');
+    signal DataB : signed(9 downto 0) := (others => '0');
+    signal WrEn : std_logic := '0';
+    signal WrSel : std_logic := '0';
+    signal WrAddr : std_logic_vector(MASK_LOG2-1 downto 0) := (others => '0');
+    signal WrData : std_logic_vector(23 downto 0) := (others => '0');
+
+    --Outputs
+    signal ResultTgl : std_logic;
+    signal Fail : std_logic;
+    signal ViolA : std_logic_vector(31 downto 0);
+    signal ViolB : std_logic_vector(31 downto 0);
+    signal FirstFail : std_logic_vector(31 downto 0);
+    signal FramesTested : std_logic_vector(31 downto 0);
+    signal FramesFailed : std_logic_vector(31 downto 0);
+
+    signal sim_done : boolean := false;
+
+    -- Clock period definitions
+    constant clk_period : time := 4 ns;
+    constant clk_wr_period : time := 10 ns;
+
+BEGIN
+
+    -- Instantiate the Unit Under Test (UUT)
+    uut: mask_test
+    GENERIC MAP (
+        MASK_LOG2 => MASK_LOG2
+    )
+    PORT MAP (
+        clk => clk,
+        Enable => Enable,
+        Offset => Offset,
+        StepLog2 => X"1",
+        Length => std_logic_vector(to_unsigned(N_ENTRIES,MASK_LOG2+1)),
+        Start => Start,
+        Stop => Stop,
+        SampleEn => SampleEn,
+        DataA => DataA,
+        DataB => DataB,
+        clk_wr => clk_wr,
+        WrEn => WrEn,
+        WrSel => WrSel,
+        WrAddr => WrAddr,
+        WrData => WrData,
+        ResultTgl => ResultTgl,
+        Fail => Fail,
+        ViolA => ViolA,
+        ViolB => ViolB,
+        FirstFail => FirstFail,
+        FramesTested => FramesTested,
+        FramesFailed => FramesFailed
+    );
+
+    -- Clock process definitions
+    clk_process :process
+    begin
+        if sim_done then
+            wait;
+        end if;
+        clk <= '0';
+        wait for clk_period/2;
+        clk <= '1';
+        wait for clk_period/2;
+    end process;
+
+    clk_wr_process :process
+    begin
+        if sim_done then
+            wait;
+        end if;
+        clk_wr <= '0';
+        wait for clk_wr_period/2;
+        clk_wr <= '1';
+        wait for clk_wr_period/2;
+    end process;
+
+    -- Stimulus process
+    stim_proc: process
+        variable errors : integer := 0;
+        variable res_tgl : std_logic;
+    begin
+        -- mask limits: A +/-100, B full range
+        wait until rising_edge(clk_wr);
+        for ch in 0 to 1 loop
+            for i in 0 to N_ENTRIES-1 loop
+                WrEn <= '1';
+                if ch = 0 then
+                    WrSel <= '0';
+                    WrData <= std_logic_vector(to_signed(100,12)) & std_logic_vector(to_signed(-100,12));
+                else
+                    WrSel <= '1';
+                    WrData <= std_logic_vector(to_signed(511,12)) & std_logic_vector(to_signed(-512,12));
+                end if;
+                WrAddr <= std_logic_vector(to_unsigned(i,MASK_LOG2));
+                wait until rising_edge(clk_wr);
+            end loop;
+        end loop;
+        WrEn <= '0';
+        Enable <= '1';
+        wait for 100 ns;
+
+        for f in 0 to N_FRAMES-1 loop
+            res_tgl := ResultTgl;
+            Offset <= std_logic_vector(to_unsigned(FRAME_OFFSET(f),27));
+            wait until rising_edge(clk);
+            Start <= '1';
+            wait until rising_edge(clk);
+            Start <= '0';
+            for k in 0 to N_SAMPLES-1 loop
+                if f >= 2 or (f = 1 and (k = 3 or k = FAIL_POS or k = 5 + 2*N_ENTRIES + 2)) then
+                    DataA <= to_signed(150,10);
+                elsif (k mod 2) = 0 then
+                    DataA <= to_signed(-90,10);
+                else
+                    DataA <= to_signed(95,10);
+                end if;
+                DataB <= to_signed(-500 + 25*k,10);
+                SampleEn <= '1';
+                wait until rising_edge(clk);
+            end loop;
+            SampleEn <= '0';
+            Stop <= '1';
+            wait until rising_edge(clk);
+            Stop <= '0';
+            wait until ResultTgl /= res_tgl;
+            wait until rising_edge(clk);
+            wait until rising_edge(clk);
+
+            Print("frame " & integer'image(f) & ": fail " & std_logic'image(Fail) &
+                  ", out of mask A " & integer'image(to_integer(unsigned(ViolA))) &
+                  ", B " & integer'image(to_integer(unsigned(ViolB))) &
+                  ", first " & integer'image(to_integer(signed(FirstFail))));
+            Check((Fail = '1') = (FRAME_VIOL(f) /= 0) and unsigned(ViolA) = FRAME_VIOL(f) and unsigned(ViolB) = 0
+                  and signed(FirstFail) = FRAME_FIRST(f),
+                  "expected " & integer'image(FRAME_VIOL(f)) & " samples out of mask A, first " & integer'image(FRAME_FIRST(f)), errors);
+        end loop;
+        Check(unsigned(FramesTested) = N_FRAMES and unsigned(FramesFailed) = 3,
+              "frames tested " & integer'image(to_integer(unsigned(FramesTested))) &
+              ", failed " & integer'image(to_integer(unsigned(FramesFailed))), errors);
+
+        EndTest("mask", errors, sim_done);
+        wait;
+    end process;
+
+END;
@@ -0,0 +1,227 @@
+----------------------------------------------------------------------------------
+--    Copyright (C) 2019 Dejan Priversek
+--
+--    This program is free software: you can redistribute it and/or modify
+--    it under the terms of the GNU General Public License as published by
+--    the Free Software Foundation, either version 3 of the License, or
+--    (at your option) any later version.
+--
+--    This program is distributed in the hope that it will be useful,
+--    but WITHOUT ANY WARRANTY; without even the implied warranty of
+--    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+--    GNU General Public License for more details.
+--
+--    You should have received a copy of the GNU General Public License
+--    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+----------------------------------------------------------------------------------
+
+--
+-- Scopefun firmware: min/max envelope pyramid
+--
+-- Builds min/max envelope of saved samples: level k entry holds min/max over 4^k samples.
+-- Entry is saved as two samples in RAM sample format (CH A: 31..22, CH B: 21..12, digital: 11..0):
+--   first  = max(CH A) & max(CH B) & OR(digital)
+--   second = min(CH A) & min(CH B) & AND(digital)
+-- Two entries of the same level are sent out in one RAM word (first entry in MSBs).
+-- RAM words of different levels that are completed in the same clk cycle wait in per-level output
+-- registers and are sent out one per clk cycle, lower level first (level k word is completed every
+-- 2*4^(k-1) RAM words, so a waiting word is always sent out before the next one of the same level).
+-- Entry without samples (padding) has max < min.
+--
+
+library IEEE;
+use IEEE.STD_LOGIC_1164.ALL;
+use IEEE.NUMERIC_STD.ALL;
+
+entity minmax_pyramid is
+    Generic (
+        FIRST_LEVEL : integer := 2;    -- first level sent out (level 1 is only used to build higher levels)
+        LAST_LEVEL  : integer := 12;   -- last level sent out
+        INDEX_WIDTH : integer := 24    -- width of entry pair index
+    );
+    Port (
+        clk : in std_logic;
+        rst : in std_logic;                              -- restart at first RAM word (new frame)
+        DataIn : in std_logic_vector(127 downto 0);      -- 4 samples (first sample in MSBs)
+        DataInEn : in std_logic;
+        Flush : in std_logic;                            -- send out partially filled entries (end of frame)
+        Busy : out std_logic;
+        DataOut : out std_logic_vector(127 downto 0);    -- 2 entries of the same level
+        DataOutLevel : out std_logic_vector(3 downto 0);
+        DataOutIndex : out std_logic_vector(INDEX_WIDTH-1 downto 0); -- entry pair index within level
+        DataOutValid : out std_logic
+    );
+end minmax_pyramid;
+
+architecture Behavioral of minmax_pyramid is
+
+-- max < min: entry without samples
+CONSTANT EMPTY_ENTRY : std_logic_vector(63 downto 0) := "1000000000" & "1000000000" & X"000" &
+                                                        "0111111111" & "0111111111" & X"FFF";
+
+type entry_array is array(1 to LAST_LEVEL) of std_logic_vector(63 downto 0);
+type cnt_array is array(1 to LAST_LEVEL) of integer range 0 to 3;
+type index_array is array(1 to LAST_LEVEL) of unsigned(INDEX_WIDTH-1 downto 0);
+type word_array is array(1 to LAST_LEVEL) of std_logic_vector(127 downto 0);
+
+signal lvl_acc : entry_array;                 -- partially merged entry
+signal lvl_cnt : cnt_array := (others => 0);  -- number of lower level entries merged in lvl_acc
+signal lvl_out : entry_array;                 -- complete entry
+signal lvl_out_valid : std_logic_vector(1 to LAST_LEVEL) := (others => '0');
+signal pair_first : entry_array;              -- first entry of RAM word
+signal pair_half : std_logic_vector(1 to LAST_LEVEL) := (others => '0');
+signal pair_idx : index_array := (others => (others => '0'));
+signal pend_word : word_array;                -- complete RAM word waiting to be sent out
+signal pend_idx : index_array;
+signal pend_valid : std_logic_vector(1 to LAST_LEVEL) := (others => '0');
+
+signal flush_run : std_logic := '0';
+signal flush_lvl : integer range 1 to LAST_LEVEL+1 := 2;
+signal flush_phase : std_logic := '0';
+signal flush_wait : integer range 0 to LAST_LEVEL+1 := 0;
+
+-- merge two entries
+function merge(a : std_logic_vector(63 downto 0); b : std_logic_vector(63 downto 0)) return std_logic_vector is
+    variable r : std_logic_vector(63 downto 0);
+begin
+    -- max(CH A), max(CH B)
+    if signed(a(63 downto 54)) > signed(b(63 downto 54)) then r(63 downto 54) := a(63 downto 54); else r(63 downto 54) := b(63 downto 54); end if;
+    if signed(a(53 downto 44)) > signed(b(53 downto 44)) then r(53 downto 44) := a(53 downto 44); else r(53 downto 44) := b(53 downto 44); end if;
+    r(43 downto 32) := a(43 downto 32) or b(43 downto 32);
+    -- min(CH A), min(CH B)
+    if signed(a(31 downto 22)) < signed(b(31 downto 22)) then r(31 downto 22) := a(31 downto 22); else r(31 downto 22) := b(31 downto 22); end if;
+    if signed(a(21 downto 12)) < signed(b(21 downto 12)) then r(21 downto 12) := a(21 downto 12); else r(21 downto 12) := b(21 downto 12); end if;
+    r(11 downto 0) := a(11 downto 0) and b(11 downto 0);
+    return r;
+end function;
+
+-- level 1 entry from 4 samples in RAM word
+function reduce4(d : std_logic_vector(127 downto 0)) return std_logic_vector is
+begin
+    return merge(merge(d(127 downto 96) & d(127 downto 96), d(95 downto 64) & d(95 downto 64)),
+                 merge(d(63 downto 32) & d(63 downto 32), d(31 downto 0) & d(31 downto 0)));
+end function;
+
+attribute mark_debug: boolean;
+attribute mark_debug of flush_run : signal is true;
+
+begin
+
+Busy <= '1' when flush_run = '1' or pend_valid /= (pend_valid'range => '0') else '0';
+
+pyramid_proc: process(clk)
+    variable v_sent : boolean;
+begin
+
+    if rising_edge(clk) then
+
+        DataOutValid <= '0';
+
+        if rst = '1' then
+            lvl_cnt <= (others => 0);
+            lvl_out_valid <= (others => '0');
+            pair_half <= (others => '0');
+            pair_idx <= (others => (others => '0'));
+            pend_valid <= (others => '0');
+            flush_run <= '0';
+        else
+
+            -- level 1: min/max of 4 samples in RAM word
+            if DataInEn = '1' and flush_run = '0' then
+                lvl_out(1) <= reduce4(DataIn);
+                lvl_out_valid(1) <= '1';
+            else
+                lvl_out_valid(1) <= '0';
+            end if;
+
+            -- level k: merge 4 entries of level k-1
+            -- each level adds 1 clk latency, so level k entries are complete k-1 clk cycles after
+            -- the last RAM word (entries of several levels can be complete in the same clk cycle)
+            for k in 2 to LAST_LEVEL loop
+                lvl_out_valid(k) <= '0';
+                if lvl_out_valid(k-1) = '1' then
+                    if lvl_cnt(k) = 0 then
+                        lvl_acc(k) <= lvl_out(k-1);
+                    else
+                        lvl_acc(k) <= merge(lvl_acc(k), lvl_out(k-1));
+                    end if;
+                    if lvl_cnt(k) = 3 then
+                        lvl_out(k) <= merge(lvl_acc(k), lvl_out(k-1));
+                        lvl_out_valid(k) <= '1';
+                        lvl_cnt(k) <= 0;
+                    else
+                        lvl_cnt(k) <= lvl_cnt(k) + 1;
+                    end if;
+                end if;
+            end loop;
+
+            -- send out one waiting RAM word, lowest level first
+            v_sent := false;
+            for k in FIRST_LEVEL to LAST_LEVEL loop
+                if pend_valid(k) = '1' and not v_sent then
+                    DataOut <= pend_word(k);
+                    DataOutLevel <= std_logic_vector(to_unsigned(k,4));
+                    DataOutIndex <= std_logic_vector(pend_idx(k));
+                    DataOutValid <= '1';
+                    pend_valid(k) <= '0';
+                    v_sent := true;
+                end if;
+            end loop;
+
+            -- pack two entries into RAM word
+            for k in FIRST_LEVEL to LAST_LEVEL loop
+                if lvl_out_valid(k) = '1' then
+                    if pair_half(k) = '0' then
+                        pair_first(k) <= lvl_out(k);
+                        pair_half(k) <= '1';
+                    else
+                        pend_word(k) <= pair_first(k) & lvl_out(k);
+                        pend_idx(k) <= pair_idx(k);
+                        pend_valid(k) <= '1';
+                        pair_idx(k) <= pair_idx(k) + 1;
+                        pair_half(k) <= '0';
+                    end if;
+                end if;
+            end loop;
+
+            -- end of frame: send out partially filled entries, one level at a time
+            -- phase 0: partial entry of level flush_lvl is sent out (and merged into next level)
+            -- phase 1: RAM word with single entry of level flush_lvl is padded with empty entry
+            -- (empty entry does not change min/max of next level)
+            -- wait for entries to propagate through all levels after each phase
+            if Flush = '1' and flush_run = '0' then
+                flush_run <= '1';
+                flush_lvl <= 2;
+                flush_phase <= '0';
+                flush_wait <= 0;
+            elsif flush_run = '1' then
+                if flush_wait /= 0 then
+                    flush_wait <= flush_wait - 1;
+                elsif flush_lvl > LAST_LEVEL then
+                    flush_run <= '0';
+                elsif flush_phase = '0' then
+                    if lvl_cnt(flush_lvl) /= 0 then
+                        lvl_out(flush_lvl) <= lvl_acc(flush_lvl);
+                        lvl_out_valid(flush_lvl) <= '1';
+                        lvl_cnt(flush_lvl) <= 0;
+                    end if;
+                    flush_phase <= '1';
+                    flush_wait <= LAST_LEVEL+1;
+                else
+                    if flush_lvl >= FIRST_LEVEL and pair_half(flush_lvl) = '1' then
+                        lvl_out(flush_lvl) <= EMPTY_ENTRY;
+                        lvl_out_valid(flush_lvl) <= '1';
+                    end if;
+                    flush_phase <= '0';
+                    flush_lvl <= flush_lvl + 1;
+                    flush_wait <= LAST_LEVEL+1;
+                end if;
+            end if;
+
+        end if;
+
+    end if;
+
+end process;
+
+end Behavioral;
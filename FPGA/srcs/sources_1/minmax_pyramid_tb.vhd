@@ -0,0 +1,317 @@
+----------------------------------------------------------------------------------
+--    Copyright (C) 2019 Dejan Priversek
+--
+--    This program is free software: you can redistribute it and/or modify
+--    it under the terms of the GNU General Public License as published by
+--    the Free Software Foundation, either version 3 of the License, or
+--    (at your option) any later version.
+--
+--    This program is distributed in the hope that it will be useful,
+--    but WITHOUT ANY WARRANTY; without even the implied warranty of
+--    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+--    GNU General Public License for more details.
+--
+--    You should have received a copy of the GNU General Public License
+--    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+----------------------------------------------------------------------------------
+
+--
+-- min/max pyramid testbench
+-- every RAM word sent out is compared to reference pyramid built from the same samples
+-- (RAM words with random gaps, levels 2 to 4)
+-- second instance with all levels gets a long burst without gaps (levels complete RAM words
+-- in the same clk cycle): every level and index must be sent out exactly once
+--
+
+LIBRARY IEEE;
+USE IEEE.STD_LOGIC_1164.ALL;
+USE IEEE.NUMERIC_STD.ALL;
+USE IEEE.MATH_REAL.ALL;
+
+library user_lib;
+use user_lib.TextUtil.all;
+
+ENTITY minmax_pyramid_tb IS
+END minmax_pyramid_tb;
+
+ARCHITECTURE behavior OF minmax_pyramid_tb IS
+
+    -- Component Declaration for the Unit Under Test (UUT)
+
+    component minmax_pyramid is
+    Generic (
+        FIRST_LEVEL : integer := 2;
+        LAST_LEVEL  : integer := 12;
+        INDEX_WIDTH : integer := 24
+    );
+    Port (
+        clk : in std_logic;
+        rst : in std_logic;
+        DataIn : in std_logic_vector(127 downto 0);
+        DataInEn : in std_logic;
+        Flush : in std_logic;
+        Busy : out std_logic;
+        DataOut : out std_logic_vector(127 downto 0);
+        DataOutLevel : out std_logic_vector(3 downto 0);
+        DataOutIndex : out std_logic_vector(INDEX_WIDTH-1 downto 0);
+        DataOutValid : out std_logic
+    );
+    end component;
+
+    --constants
+    CONSTANT FIRST_LEVEL : integer := 2;
+    CONSTANT LAST_LEVEL : integer := 4;
+    CONSTANT INDEX_WIDTH : integer := 24;
+    CONSTANT N_WORDS : integer := 1001;     -- not a multiple of any level (tests end of frame flush)
+    CONSTANT N_SAMPLES : integer := 4*N_WORDS;
+    CONSTANT BURST_LAST_LEVEL : integer := 12;
+    CONSTANT BURST_WORDS : integer := 2**19 + 1001;
+
+    type sample_mem is array(0 to N_SAMPLES-1) of std_logic_vector(31 downto 0);
+    signal samples : sample_mem;
+    type cnt_array is array(FIRST_LEVEL to LAST_LEVEL) of integer;
+    type burst_cnt_array is array(FIRST_LEVEL to BURST_LAST_LEVEL) of integer;
+
+    --Inputs
+    signal clk : std_logic := '0';
+    signal rst : std_logic := '0';
+    signal DataIn : std_logic_vector(127 downto 0) := (others => '0');
+    signal DataInEn : std_logic := '0';
+    signal Flush : std_logic := '0';
+
+    --Outputs
+    signal Busy : std_logic;
+    signal DataOut : std_logic_vector(127 downto 0);
+    signal DataOutLevel : std_logic_vector(3 downto 0);
+    signal DataOutIndex : std_logic_vector(INDEX_WIDTH-1 downto 0);
+    signal DataOutValid : std_logic;
+
+    signal test_done : std_logic := '0';
+
+    -- burst instance
+    signal b_DataIn : std_logic_vector(127 downto 0) := (others => '0');
+    signal b_DataInEn : std_logic := '0';
+    signal b_Flush : std_logic := '0';
+    signal b_Busy : std_logic;
+    signal b_DataOut : std_logic_vector(127 downto 0);
+    signal b_DataOutLevel : std_logic_vector(3 downto 0);
+    signal b_DataOutIndex : std_logic_vector(INDEX_WIDTH-1 downto 0);
+    signal b_DataOutValid : std_logic;
+    signal b_done : std_logic := '0';
+    signal b_errors : integer := 0;
+    signal b_checked : std_logic := '0';
+
+    signal sim_done : boolean := false;
+
+    -- Clock period definitions
+    constant clk_period : time := 10 ns;
+
+    -- reference: min/max entry of level k (empty entry if no samples)
+    function ref_entry(s : sample_mem; k : integer; e : integer) return std_logic_vector is
+        variable maxA, maxB, minA, minB : integer;
+        variable dor : std_logic_vector(11 downto 0) := (others => '0');
+        variable dand : std_logic_vector(11 downto 0) := (others => '1');
+    begin
+        maxA := -512; maxB := -512; minA := 511; minB := 511;
+        for i in e*(4**k) to (e+1)*(4**k)-1 loop
+            if i < N_SAMPLES then
+                if to_integer(signed(s(i)(31 downto 22))) > maxA then maxA := to_integer(signed(s(i)(31 downto 22))); end if;
+                if to_integer(signed(s(i)(31 downto 22))) < minA then minA := to_integer(signed(s(i)(31 downto 22))); end if;
+                if to_integer(signed(s(i)(21 downto 12))) > maxB then maxB := to_integer(signed(s(i)(21 downto 12))); end if;
+                if to_integer(signed(s(i)(21 downto 12))) < minB then minB := to_integer(signed(s(i)(21 downto 12))); end if;
+                dor := dor or s(i)(11 downto 0);
+                dand := dand and s(i)(11 downto 0);
+            end if;
+        end loop;
+        return std_logic_vector(to_signed(maxA,10)) & std_logic_vector(to_signed(maxB,10)) & dor &
+               std_logic_vector(to_signed(minA,10)) & std_logic_vector(to_signed(minB,10)) & dand;
+    end function;
+
+BEGIN
+
+    -- Instantiate the Unit Under Test (UUT)
+    uut: minmax_pyramid
+    generic map (FIRST_LEVEL => FIRST_LEVEL, LAST_LEVEL => LAST_LEVEL, INDEX_WIDTH => INDEX_WIDTH)
+    PORT MAP (
+        clk => clk,
+        rst => rst,
+        DataIn => DataIn,
+        DataInEn => DataInEn,
+        Flush => Flush,
+        Busy => Busy,
+        DataOut => DataOut,
+        DataOutLevel => DataOutLevel,
+        DataOutIndex => DataOutIndex,
+        DataOutValid => DataOutValid
+    );
+
+    uut_burst: minmax_pyramid
+    generic map (FIRST_LEVEL => FIRST_LEVEL, LAST_LEVEL => BURST_LAST_LEVEL, INDEX_WIDTH => INDEX_WIDTH)
+    PORT MAP (
+        clk => clk,
+        rst => rst,
+        DataIn => b_DataIn,
+        DataInEn => b_DataInEn,
+        Flush => b_Flush,
+        Busy => b_Busy,
+        DataOut => b_DataOut,
+        DataOutLevel => b_DataOutLevel,
+        DataOutIndex => b_DataOutIndex,
+        DataOutValid => b_DataOutValid
+    );
+
+    -- Clock process definitions
+    clk_process :process
+    begin
+        if sim_done then
+            wait;
+        end if;
+        clk <= '0';
+        wait for clk_period/2;
+        clk <= '1';
+        wait for clk_period/2;
+    end process;
+
+    -- Stimulus process
+    stim_proc: process
+        variable seed1 : positive := 7;
+        variable seed2 : positive := 11;
+        variable r : real;
+        variable s : std_logic_vector(31 downto 0);
+        variable w : std_logic_vector(127 downto 0);
+    begin
+        -- random samples
+        for i in 0 to N_SAMPLES-1 loop
+            for b in 0 to 31 loop
+                uniform(seed1, seed2, r);
+                if r > 0.5 then s(b) := '1'; else s(b) := '0'; end if;
+            end loop;
+            samples(i) <= s;
+        end loop;
+
+        rst <= '1';
+        wait until rising_edge(clk);
+        wait until rising_edge(clk);
+        rst <= '0';
+
+        -- send RAM words with random gaps (first sample in MSBs)
+        for i in 0 to N_WORDS-1 loop
+            w := samples(4*i) & samples(4*i+1) & samples(4*i+2) & samples(4*i+3);
+            uniform(seed1, seed2, r);
+            if r < 0.3 then
+                DataInEn <= '0';
+                wait until rising_edge(clk);
+            end if;
+            DataIn <= w;
+            DataInEn <= '1';
+            wait until rising_edge(clk);
+        end loop;
+        DataInEn <= '0';
+
+        -- end of frame
+        for i in 0 to 15 loop
+            wait until rising_edge(clk);
+        end loop;
+        Flush <= '1';
+        wait until rising_edge(clk);
+        Flush <= '0';
+        wait until rising_edge(clk);
+        wait until Busy = '0';
+        for i in 0 to 15 loop
+            wait until rising_edge(clk);
+        end loop;
+        test_done <= '1';
+        wait;
+    end process;
+
+    -- burst without gaps
+    burst_proc: process
+    begin
+        wait until rst = '1';
+        wait until rst = '0';
+        for i in 0 to BURST_WORDS-1 loop
+            b_DataIn <= std_logic_vector(to_unsigned(i,128));
+            b_DataInEn <= '1';
+            wait until rising_edge(clk);
+        end loop;
+        b_DataInEn <= '0';
+        for i in 0 to 15 loop
+            wait until rising_edge(clk);
+        end loop;
+        b_Flush <= '1';
+        wait until rising_edge(clk);
+        b_Flush <= '0';
+        wait until rising_edge(clk);
+        wait until b_Busy = '0';
+        for i in 0 to 15 loop
+            wait until rising_edge(clk);
+        end loop;
+        b_done <= '1';
+        wait;
+    end process;
+
+    -- burst: RAM words of every level are sent out in index order, each one once
+    burst_check_proc: process
+        variable cnt : burst_cnt_array := (others => 0);
+        variable k, p : integer;
+        variable errors : integer := 0;
+    begin
+        wait until rising_edge(clk);
+        if b_DataOutValid = '1' then
+            k := to_integer(unsigned(b_DataOutLevel));
+            p := to_integer(unsigned(b_DataOutIndex));
+            if k < FIRST_LEVEL or k > BURST_LAST_LEVEL then
+                Print("burst: unexpected level " & integer'image(k));
+                errors := errors + 1;
+            else
+                Check(p = cnt(k), "burst: level " & integer'image(k) & ": index " & integer'image(p) & ", expected " & integer'image(cnt(k)), errors);
+                cnt(k) := cnt(k) + 1;
+            end if;
+        end if;
+        if b_done = '1' then
+            for l in FIRST_LEVEL to BURST_LAST_LEVEL loop
+                Check(cnt(l) = ((4*BURST_WORDS + 4**l - 1)/(4**l) + 1)/2,
+                      "burst: level " & integer'image(l) & ": " & integer'image(cnt(l)) & " RAM words sent out, expected " &
+                      integer'image(((4*BURST_WORDS + 4**l - 1)/(4**l) + 1)/2), errors);
+            end loop;
+            b_errors <= errors;
+            b_checked <= '1';
+            wait;
+        end if;
+    end process;
+
+    -- compare sent out RAM words to reference
+    check_proc: process
+        variable cnt : cnt_array := (others => 0);
+        variable k, p : integer;
+        variable errors : integer := 0;
+        variable expected : std_logic_vector(127 downto 0);
+    begin
+        wait until rising_edge(clk);
+        if test_done = '1' and b_checked = '1' then
+            errors := errors + b_errors;
+            for l in FIRST_LEVEL to LAST_LEVEL loop
+                -- number of RAM words: ceil(ceil(N_SAMPLES/4^l)/2)
+                Check(cnt(l) = ((N_SAMPLES + 4**l - 1)/(4**l) + 1)/2,
+                      "level " & integer'image(l) & ": " & integer'image(cnt(l)) & " RAM words sent out, expected " &
+                      integer'image(((N_SAMPLES + 4**l - 1)/(4**l) + 1)/2), errors);
+            end loop;
+            EndTest("min/max pyramid", errors, sim_done);
+            wait;
+        end if;
+        if DataOutValid = '1' then
+            k := to_integer(unsigned(DataOutLevel));
+            p := to_integer(unsigned(DataOutIndex));
+            expected := ref_entry(samples, k, 2*p) & ref_entry(samples, k, 2*p+1);
+            if k < FIRST_LEVEL or k > LAST_LEVEL then
+                Print("unexpected level " & integer'image(k));
+                errors := errors + 1;
+            else
+                Check(p = cnt(k), "level " & integer'image(k) & ": index " & integer'image(p) & ", expected " & integer'image(cnt(k)), errors);
+                Check(DataOut = expected, "level " & integer'image(k) & ", index " & integer'image(p) & ": min/max mismatch", errors);
+                cnt(k) := cnt(k) + 1;
+            end if;
+        end if;
+    end process;
+
+END;
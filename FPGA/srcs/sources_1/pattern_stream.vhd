@@ -0,0 +1,367 @@
+----------------------------------------------------------------------------------
+--    Copyright (C) 2019 Dejan Priversek
+--
+--    This program is free software: you can redistribute it and/or modify
+--    it under the terms of the GNU General Public License as published by
+--    the Free Software Foundation, either version 3 of the License, or
+--    (at your option) any later version.
+--
+--    This program is distributed in the hope that it will be useful,
+--    but WITHOUT ANY WARRANTY; without even the implied warranty of
+--    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+--    GNU General Public License for more details.
+--
+--    You should have received a copy of the GNU General Public License
+--    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+----------------------------------------------------------------------------------
+
+--
+-- Scopefun firmware: run-length encoded digital pattern playback from DDR3
+--
+-- Program (uploaded to AWG region of RAM, 4 commands per RAM word, first in MSBs) is prefetched
+-- into playback fifo (clk) and executed on clk_out, one pattern step at each Step pulse:
+--   31..30 = 00: STATE: output bits 11..0 for (bits 29..12) + 1 steps
+--   31..30 = 01: LOOP_START: following STATE commands (up to LOOP_DEPTH) are played bits 23..0 times
+--   31..30 = 10: LOOP_END
+--   31..30 = 11: END: hold last state
+-- Loop body is recorded while it is played first time and repeated from loop buffer,
+-- loops can not be nested. Loop and end commands take one clk_out cycle.
+-- RAM requests are served by DDR3 controller arbiter (Req is held until Ack pulse).
+--
+
+library IEEE;
+use IEEE.STD_LOGIC_1164.ALL;
+use IEEE.NUMERIC_STD.ALL;
+
+Library UNISIM;
+use UNISIM.vcomponents.all;
+
+Library UNIMACRO;
+use UNIMACRO.vcomponents.all;
+
+entity pattern_stream is
+    Port (
+        -- DDR3 controller (clk)
+        clk : in std_logic;
+        RdReq : out std_logic;
+        RdAddr : out std_logic_vector(22 downto 0);    -- RAM word index in AWG region
+        RdAck : in std_logic;
+        RdData : in std_logic_vector(127 downto 0);
+        RdDataValid : in std_logic;
+        PlayEnable : in std_logic;
+        PlayLoop : in std_logic;                        -- restart program after last RAM word
+        PlayStart : in std_logic_vector(22 downto 0);  -- first RAM word of program
+        PlayLength : in std_logic_vector(22 downto 0); -- number of RAM words
+        -- pattern output (clk_out)
+        clk_out : in std_logic;
+        Step : in std_logic;                            -- pattern clock enable
+        State : out std_logic_vector(11 downto 0);
+        Underrun : out std_logic;                       -- command was not ready at step (sticky)
+        LoopError : out std_logic;                      -- loop body was longer than LOOP_DEPTH (sticky)
+        Playing : out std_logic
+    );
+end pattern_stream;
+
+architecture Behavioral of pattern_stream is
+
+CONSTANT RD_MAX_PENDING : integer := 32;   -- read commands waiting for data
+CONSTANT LOOP_DEPTH : integer := 256;
+
+CONSTANT OP_STATE : std_logic_vector(1 downto 0) := "00";
+CONSTANT OP_LOOP_START : std_logic_vector(1 downto 0) := "01";
+CONSTANT OP_LOOP_END : std_logic_vector(1 downto 0) := "10";
+
+-- playback fifo
+signal pl_rst : std_logic := '0';
+signal pl_rst_cnt : integer range 0 to 63 := 0;
+signal pl_ready : std_logic := '0';
+signal pl_ready_d : std_logic := '0';
+signal pl_ready_dd : std_logic := '0';
+signal pl_wren : std_logic;
+signal pl_rden : std_logic;
+signal pl_do_1 : std_logic_vector(63 downto 0);
+signal pl_do_2 : std_logic_vector(63 downto 0);
+signal pl_empty_1 : std_logic;
+signal pl_empty_2 : std_logic;
+signal pl_afull : std_logic;
+signal pl_afull_2 : std_logic;
+
+signal play_en_d : std_logic := '0';
+signal play_en_dd : std_logic := '0';
+signal play_en_ddd : std_logic := '0';
+signal play_active : std_logic := '0';
+signal play_start_req : std_logic := '0';
+signal play_loop_i : std_logic := '0';
+signal play_start_i : unsigned(22 downto 0);
+signal play_length_i : unsigned(22 downto 0);
+signal rd_idx : unsigned(22 downto 0) := (others => '0');
+signal rd_left : unsigned(22 downto 0) := (others => '0');
+signal rd_pending : integer range 0 to RD_MAX_PENDING := 0;
+
+-- command execution
+type loop_buf_t is array(0 to LOOP_DEPTH-1) of std_logic_vector(29 downto 0);
+signal loop_buf : loop_buf_t;
+signal out_en_d : std_logic := '0';
+signal out_en_dd : std_logic := '0';
+signal out_primed : std_logic := '0';
+signal out_word : std_logic_vector(127 downto 0);
+signal out_lane : integer range 0 to 3 := 0;
+signal cmd_take : std_logic;
+signal nxt : std_logic_vector(29 downto 0) := (others => '0');  -- next STATE command
+signal nxt_v : std_logic := '0';
+signal hold : unsigned(17 downto 0) := (others => '0');
+signal ended : std_logic := '0';
+signal lp_rec : std_logic := '0';           -- loop body is being recorded
+signal lp_play : std_logic := '0';          -- loop body is repeated from loop buffer
+signal lp_len : integer range 0 to LOOP_DEPTH := 0;
+signal lp_idx : integer range 0 to LOOP_DEPTH-1 := 0;
+signal lp_cnt : unsigned(23 downto 0) := (others => '0');  -- remaining repeats
+signal state_i : std_logic_vector(11 downto 0) := (others => '0');
+signal out_started : std_logic := '0';      -- first STATE was output
+signal underrun_i : std_logic := '0';
+signal loop_err_i : std_logic := '0';
+
+attribute ASYNC_REG: boolean;
+attribute ASYNC_REG of pl_ready_d: signal is true;
+attribute ASYNC_REG of pl_ready_dd: signal is true;
+attribute ASYNC_REG of play_en_d: signal is true;
+attribute ASYNC_REG of play_en_dd: signal is true;
+attribute ASYNC_REG of out_en_d: signal is true;
+attribute ASYNC_REG of out_en_dd: signal is true;
+
+attribute ram_style: string;
+attribute ram_style of loop_buf: signal is "distributed";
+
+begin
+
+PLAY_FIFO_1: FIFO_DUALCLOCK_MACRO
+   generic map (
+      DEVICE => "7SERIES",
+      ALMOST_FULL_OFFSET => X"0030",  -- keep space for pending read commands
+      ALMOST_EMPTY_OFFSET => X"0006",
+      DATA_WIDTH => 64,
+      FIFO_SIZE => "36Kb",
+      FIRST_WORD_FALL_THROUGH => TRUE)
+   port map (
+      ALMOSTEMPTY => open,
+      ALMOSTFULL => pl_afull,
+      DO => pl_do_1,
+      EMPTY => pl_empty_1,
+      FULL => open,
+      RDCOUNT => open,
+      RDERR => open,
+      WRCOUNT => open,
+      WRERR => open,
+      DI => RdData(127 downto 64),
+      RDCLK => clk_out,
+      RDEN => pl_rden,
+      RST => pl_rst,
+      WRCLK => clk,
+      WREN => pl_wren
+   );
+
+PLAY_FIFO_2: FIFO_DUALCLOCK_MACRO
+   generic map (
+      DEVICE => "7SERIES",
+      ALMOST_FULL_OFFSET => X"0030",
+      ALMOST_EMPTY_OFFSET => X"0006",
+      DATA_WIDTH => 64,
+      FIFO_SIZE => "36Kb",
+      FIRST_WORD_FALL_THROUGH => TRUE)
+   port map (
+      ALMOSTEMPTY => open,
+      ALMOSTFULL => pl_afull_2,
+      DO => pl_do_2,
+      EMPTY => pl_empty_2,
+      FULL => open,
+      RDCOUNT => open,
+      RDERR => open,
+      WRCOUNT => open,
+      WRERR => open,
+      DI => RdData(63 downto 0),
+      RDCLK => clk_out,
+      RDEN => pl_rden,
+      RST => pl_rst,
+      WRCLK => clk,
+      WREN => pl_wren
+   );
+
+-- data of read commands issued after playback was stopped is discarded
+pl_wren <= RdDataValid and play_active and pl_ready;
+RdReq <= '1' when play_active = '1' and pl_ready = '1' and pl_afull = '0' and pl_afull_2 = '0'
+              and rd_pending < RD_MAX_PENDING and rd_left /= 0 else '0';
+RdAddr <= std_logic_vector(rd_idx);
+
+-- next command is taken from playback fifo when next STATE is free (or used in this clk)
+-- and loop buffer is not being played
+out_word <= pl_do_1 & pl_do_2;
+cmd_take <= '1' when out_primed = '1' and ended = '0' and lp_play = '0' and pl_empty_1 = '0' and pl_empty_2 = '0'
+                     and (nxt_v = '0' or (Step = '1' and hold = 0)) else '0';
+pl_rden <= cmd_take when out_lane = 3 else '0';
+
+State <= state_i;
+Underrun <= underrun_i;
+LoopError <= loop_err_i;
+Playing <= out_primed;
+
+ram_proc: process (clk)
+begin
+    if rising_edge(clk) then
+
+        play_en_d <= PlayEnable;
+        play_en_dd <= play_en_d;
+        play_en_ddd <= play_en_dd;
+        if play_en_ddd = '0' and play_en_dd = '1' then
+            play_start_req <= '1';
+            play_active <= '0';
+        elsif play_en_dd = '0' then
+            play_start_req <= '0';
+            play_active <= '0';
+            pl_ready <= '0';
+            pl_rst <= '0';
+            pl_rst_cnt <= 0;
+        end if;
+
+        -- count read commands waiting for data
+        if RdAck = '1' and RdDataValid = '0' then
+            rd_pending <= rd_pending + 1;
+        elsif RdAck = '0' and RdDataValid = '1' and rd_pending /= 0 then
+            rd_pending <= rd_pending - 1;
+        end if;
+
+        -- start: wait until data of previous playback was received, then reset playback fifo
+        if play_start_req = '1' and play_en_dd = '1' and rd_pending = 0 then
+            if pl_rst_cnt = 63 then
+                pl_rst_cnt <= 0;
+                pl_rst <= '0';
+                pl_ready <= '1';
+                play_start_req <= '0';
+                play_active <= '1';
+                play_loop_i <= PlayLoop;
+                play_start_i <= unsigned(PlayStart);
+                play_length_i <= unsigned(PlayLength);
+                rd_idx <= unsigned(PlayStart);
+                rd_left <= unsigned(PlayLength);
+            else
+                pl_rst_cnt <= pl_rst_cnt + 1;
+                pl_ready <= '0';
+                if pl_rst_cnt >= 4 and pl_rst_cnt < 36 then
+                    pl_rst <= '1';
+                else
+                    pl_rst <= '0';
+                end if;
+            end if;
+        end if;
+
+        -- read command accepted: next RAM word
+        if RdAck = '1' and play_active = '1' then
+            if rd_left = 1 and play_loop_i = '1' then
+                rd_idx <= play_start_i;
+                rd_left <= play_length_i;
+            else
+                rd_idx <= rd_idx + 1;
+                rd_left <= rd_left - 1;
+            end if;
+        end if;
+
+    end if;
+end process;
+
+out_proc: process (clk_out)
+    variable v_cmd : std_logic_vector(31 downto 0);
+begin
+    if rising_edge(clk_out) then
+
+        out_en_d <= play_active;
+        out_en_dd <= out_en_d;
+        pl_ready_d <= pl_ready;
+        pl_ready_dd <= pl_ready_d;
+
+        if out_en_dd = '0' or pl_ready_dd = '0' then
+            out_primed <= '0';
+            out_lane <= 0;
+            nxt_v <= '0';
+            hold <= (others => '0');
+            ended <= '0';
+            out_started <= '0';
+            lp_rec <= '0';
+            lp_play <= '0';
+        elsif out_primed = '0' then
+            -- start when first RAM word was prefetched
+            if pl_empty_1 = '0' and pl_empty_2 = '0' then
+                out_primed <= '1';
+                underrun_i <= '0';
+                loop_err_i <= '0';
+            end if;
+        else
+            -- pattern step: hold current state or output next STATE
+            if Step = '1' then
+                if hold /= 0 then
+                    hold <= hold - 1;
+                elsif nxt_v = '1' then
+                    state_i <= nxt(11 downto 0);
+                    hold <= unsigned(nxt(29 downto 12));
+                    nxt_v <= '0';
+                    out_started <= '1';
+                elsif ended = '0' and out_started = '1' then
+                    -- RAM could not keep up: hold last state
+                    underrun_i <= '1';
+                end if;
+            end if;
+
+            if lp_play = '1' and (nxt_v = '0' or (Step = '1' and hold = 0)) then
+                -- repeat loop body
+                nxt <= loop_buf(lp_idx);
+                nxt_v <= '1';
+                if lp_idx = lp_len-1 then
+                    lp_idx <= 0;
+                    if lp_cnt = 1 then
+                        lp_play <= '0';
+                    end if;
+                    lp_cnt <= lp_cnt - 1;
+                else
+                    lp_idx <= lp_idx + 1;
+                end if;
+            elsif cmd_take = '1' then
+                v_cmd := out_word(32*(3-out_lane)+31 downto 32*(3-out_lane));
+                if out_lane = 3 then
+                    out_lane <= 0;
+                else
+                    out_lane <= out_lane + 1;
+                end if;
+                case v_cmd(31 downto 30) is
+                    when OP_STATE =>
+                        nxt <= v_cmd(29 downto 0);
+                        nxt_v <= '1';
+                        if lp_rec = '1' then
+                            if lp_len = LOOP_DEPTH then
+                                loop_err_i <= '1';
+                                lp_rec <= '0';
+                            else
+                                loop_buf(lp_len) <= v_cmd(29 downto 0);
+                                lp_len <= lp_len + 1;
+                            end if;
+                        end if;
+                    when OP_LOOP_START =>
+                        -- body is played once while it is recorded
+                        if unsigned(v_cmd(23 downto 0)) > 1 then
+                            lp_rec <= '1';
+                            lp_len <= 0;
+                            lp_cnt <= unsigned(v_cmd(23 downto 0)) - 1;
+                        end if;
+                    when OP_LOOP_END =>
+                        lp_rec <= '0';
+                        if lp_rec = '1' and lp_len /= 0 then
+                            lp_play <= '1';
+                            lp_idx <= 0;
+                        end if;
+                    when others =>
+                        ended <= '1';
+                end case;
+            end if;
+        end if;
+
+    end if;
+end process;
+
+end Behavioral;
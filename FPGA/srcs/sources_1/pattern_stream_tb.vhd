@@ -0,0 +1,233 @@
+----------------------------------------------------------------------------------
+--    Copyright (C) 2019 Dejan Priversek
+--
+--    This program is free software: you can redistribute it and/or modify
+--    it under the terms of the GNU General Public License as published by
+--    the Free Software Foundation, either version 3 of the License, or
+--    (at your option) any later version.
+--
+--    This program is distributed in the hope that it will be useful,
+--    but WITHOUT ANY WARRANTY; without even the implied warranty of
+--    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+--    GNU General Public License for more details.
+--
+--    You should have received a copy of the GNU General Public License
+--    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+----------------------------------------------------------------------------------
+
+--
+-- RLE pattern streaming testbench
+-- program with a repeated sub-sequence is read from RAM model (with read latency),
+-- run lengths of output states are compared, underrun must not occur
+--
+
+LIBRARY IEEE;
+USE IEEE.STD_LOGIC_1164.ALL;
+USE IEEE.NUMERIC_STD.ALL;
+
+library user_lib;
+use user_lib.TextUtil.all;
+
+ENTITY pattern_stream_tb IS
+END pattern_stream_tb;
+
+ARCHITECTURE behavior OF pattern_stream_tb IS
+
+    -- Component Declaration for the Unit Under Test (UUT)
+
+    component pattern_stream is
+    Port (
+        clk : in std_logic;
+        RdReq : out std_logic;
+        RdAddr : out std_logic_vector(22 downto 0);
+        RdAck : in std_logic;
+        RdData : in std_logic_vector(127 downto 0);
+        RdDataValid : in std_logic;
+        PlayEnable : in std_logic;
+        PlayLoop : in std_logic;
+        PlayStart : in std_logic_vector(22 downto 0);
+        PlayLength : in std_logic_vector(22 downto 0);
+        clk_out : in std_logic;
+        Step : in std_logic;
+        State : out std_logic_vector(11 downto 0);
+        Underrun : out std_logic;
+        LoopError : out std_logic;
+        Playing : out std_logic
+    );
+    end component;
+
+    --constants
+    CONSTANT START_WORD : integer := 2;     -- first RAM word of program
+    CONSTANT N_WORDS : integer := 2;        -- program length (RAM words, 4 commands each)
+    CONSTANT N_RUNS : integer := 8;         -- expected output runs
+    CONSTANT RD_LATENCY : integer := 12;    -- RAM model read latency (clk)
+
+    -- expected output runs (state, number of steps)
+    type run_array is array(0 to N_RUNS-1) of integer;
+    CONSTANT RUN_STATE : run_array := (1, 2, 4, 2, 4, 2, 4, 8);
+    CONSTANT RUN_LENGTH : run_array := (3, 1, 2, 1, 2, 1, 2, 0);   -- last state is held
+
+    -- commands
+    function cmd_state(s : integer; steps : integer) return std_logic_vector is
+    begin
+        return "00" & std_logic_vector(to_unsigned(steps-1,18)) & std_logic_vector(to_unsigned(s,12));
+    end function;
+    CONSTANT CMD_LOOP_END : std_logic_vector(31 downto 0) := X"80000000";
+    CONSTANT CMD_END : std_logic_vector(31 downto 0) := X"C0000000";
+
+    --Inputs
+    signal clk : std_logic := '0';
+    signal clk_out : std_logic := '0';
+    signal RdAck : std_logic := '0';
+    signal RdData : std_logic_vector(127 downto 0) := (others => '0');
+    signal RdDataValid : std_logic := '0';
+    signal PlayEnable : std_logic := '0';
+    signal Step : std_logic := '0';
+
+    --Outputs
+    signal RdReq : std_logic;
+    signal RdAddr : std_logic_vector(22 downto 0);
+    signal State : std_logic_vector(11 downto 0);
+    signal Underrun : std_logic;
+    signal LoopError : std_logic;
+    signal Playing : std_logic;
+
+    -- RAM model
+    type ram_array is array(0 to 15) of std_logic_vector(127 downto 0);
+    signal ram : ram_array := (
+        START_WORD => cmd_state(1,3) & X"40000003" & cmd_state(2,1) & cmd_state(4,2),
+        START_WORD+1 => CMD_LOOP_END & cmd_state(8,1) & CMD_END & CMD_END,
+        others => (others => '0'));
+    type rd_pipe_array is array(1 to RD_LATENCY) of std_logic_vector(128 downto 0);
+    signal rd_pipe : rd_pipe_array := (others => (others => '0'));
+
+    signal run : integer := 0;
+    signal run_steps : integer := 0;
+    signal chk_errors : integer := 0;
+
+    signal sim_done : boolean := false;
+
+    -- Clock period definitions
+    constant clk_period : time := 10 ns;
+    constant clk_out_period : time := 4 ns;
+
+BEGIN
+
+    -- Instantiate the Unit Under Test (UUT)
+    uut: pattern_stream
+    PORT MAP (
+        clk => clk,
+        RdReq => RdReq,
+        RdAddr => RdAddr,
+        RdAck => RdAck,
+        RdData => RdData,
+        RdDataValid => RdDataValid,
+        PlayEnable => PlayEnable,
+        PlayLoop => '0',
+        PlayStart => std_logic_vector(to_unsigned(START_WORD,23)),
+        PlayLength => std_logic_vector(to_unsigned(N_WORDS,23)),
+        clk_out => clk_out,
+        Step => Step,
+        State => State,
+        Underrun => Underrun,
+        LoopError => LoopError,
+        Playing => Playing
+    );
+
+    -- Clock process definitions
+    clk_process :process
+    begin
+        if sim_done then
+            wait;
+        end if;
+        clk <= '0';
+        wait for clk_period/2;
+        clk <= '1';
+        wait for clk_period/2;
+    end process;
+
+    clk_out_process :process
+    begin
+        if sim_done then
+            wait;
+        end if;
+        clk_out <= '0';
+        wait for clk_out_period/2;
+        clk_out <= '1';
+        wait for clk_out_period/2;
+    end process;
+
+    -- pattern step every second clk_out
+    step_proc: process(clk_out)
+    begin
+        if rising_edge(clk_out) then
+            Step <= not(Step);
+        end if;
+    end process;
+
+    -- RAM model: one request per clk, Ack pulse when request is accepted
+    ram_proc: process(clk)
+    begin
+        if rising_edge(clk) then
+            RdAck <= '0';
+            rd_pipe(2 to RD_LATENCY) <= rd_pipe(1 to RD_LATENCY-1);
+            rd_pipe(1) <= (others => '0');
+            if RdReq = '1' and RdAck = '0' then
+                rd_pipe(1) <= '1' & ram(to_integer(unsigned(RdAddr)));
+                RdAck <= '1';
+            end if;
+            RdDataValid <= rd_pipe(RD_LATENCY)(128);
+            RdData <= rd_pipe(RD_LATENCY)(127 downto 0);
+        end if;
+    end process;
+
+    -- Stimulus process
+    stim_proc: process
+        variable errors : integer := 0;
+    begin
+        -- wait for playback fifo reset
+        wait for 1 us;
+        wait until rising_edge(clk);
+        PlayEnable <= '1';
+        wait until run = N_RUNS-1;
+        wait for 1 us;
+        Check(Underrun = '0' and LoopError = '0',
+              "underrun: " & std_logic'image(Underrun) & ", loop error: " & std_logic'image(LoopError), errors);
+        wait until rising_edge(clk);
+        EndTest("pattern streaming", errors + chk_errors, sim_done);
+        wait;
+    end process;
+
+    -- count steps of each output state (output before first state is ignored)
+    check_proc: process(clk_out)
+    begin
+        if rising_edge(clk_out) then
+            if Step = '1' and Playing = '1' and not(is_X(State)) and not(run = 0 and run_steps = 0 and unsigned(State) = 0) then
+                if run_steps /= 0 and to_integer(unsigned(State)) /= RUN_STATE(run) then
+                    -- state changed: previous run is complete
+                    if run_steps /= RUN_LENGTH(run) or run = N_RUNS-1 then
+                        Print("run " & integer'image(run) & ": state " & integer'image(RUN_STATE(run)) &
+                              " for " & integer'image(run_steps) & " steps, expected " & integer'image(RUN_LENGTH(run)));
+                        chk_errors <= chk_errors + 1;
+                    end if;
+                    if run < N_RUNS-1 then
+                        run <= run + 1;
+                    end if;
+                    run_steps <= 1;
+                    if run < N_RUNS-1 and to_integer(unsigned(State)) /= RUN_STATE(run+1) then
+                        Print("run " & integer'image(run+1) & ": state " & integer'image(to_integer(unsigned(State))) &
+                              ", expected " & integer'image(RUN_STATE(run+1)));
+                        chk_errors <= chk_errors + 1;
+                    end if;
+                elsif run_steps = 0 and to_integer(unsigned(State)) /= RUN_STATE(0) then
+                    Print("first state " & integer'image(to_integer(unsigned(State))));
+                    chk_errors <= chk_errors + 1;
+                    run_steps <= 1;
+                else
+                    run_steps <= run_steps + 1;
+                end if;
+            end if;
+        end if;
+    end process;
+
+END;
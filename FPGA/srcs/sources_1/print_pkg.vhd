@@ -21,6 +21,11 @@ use std.textio.all;
 
 package TextUtil is
   procedure Print(s : string);
+  -- testbench checks: print message and count error when condition does not hold
+  procedure Check(cond : boolean; msg : string; errors : inout integer);
+  -- testbench end: print result, stop on failure (severity failure) when there are errors,
+  -- otherwise set done (testbench clocks stop and simulation ends without events)
+  procedure EndTest(name : string; errors : integer; signal done : out boolean);
 end package TextUtil;
 
 package body TextUtil is
@@ -34,4 +39,23 @@ package body TextUtil is
     
   end procedure Print; 
   
+  procedure Check(cond : boolean; msg : string; errors : inout integer) is
+  begin
+    if not cond then
+      Print(msg);
+      errors := errors + 1;
+    end if;
+  end procedure Check;
+  
+  procedure EndTest(name : string; errors : integer; signal done : out boolean) is
+  begin
+    if errors = 0 then
+      Print(name & " test PASSED");
+    else
+      Print(name & " test FAILED (" & integer'image(errors) & " errors)");
+    end if;
+    assert errors = 0 report name & " test FAILED" severity failure;
+    done <= true;
+  end procedure EndTest;
+  
 end package body TextUtil;
\ No newline at end of file
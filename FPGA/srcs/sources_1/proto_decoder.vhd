@@ -0,0 +1,439 @@
+----------------------------------------------------------------------------------
+--    Copyright (C) 2019 Dejan Priversek
+--
+--    This program is free software: you can redistribute it and/or modify
+--    it under the terms of the GNU General Public License as published by
+--    the Free Software Foundation, either version 3 of the License, or
+--    (at your option) any later version.
+--
+--    This program is distributed in the hope that it will be useful,
+--    but WITHOUT ANY WARRANTY; without even the implied warranty of
+--    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+--    GNU General Public License for more details.
+--
+--    You should have received a copy of the GNU General Public License
+--    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+----------------------------------------------------------------------------------
+
+--
+-- Scopefun firmware: UART, SPI and I2C decoders on digital inputs
+--
+-- Decoders run on ADC clock (one digital sample per clk) and write 64-bit event records
+-- into event fifo, which is read on clk_rd:
+--   63..60: type: 1 START, 2 STOP, 3 ADDRESS, 4 DATA, 5 ERROR, 6 LOST (fifo was full), 7 TS_WRAP
+--   59..58: decoder: 01 UART, 10 SPI, 11 I2C (00: LOST, TS_WRAP)
+--   57..56: flags:
+--           UART DATA, ERROR (framing error, stop bit is low): 0: parity error
+--           SPI STOP: 0: incomplete byte (received bits in data), I2C START: 0: repeated start
+--           I2C ADDRESS, DATA: 0: NAK, I2C START, STOP: 1: incomplete byte
+--   55..40: data: UART, I2C: byte in bits 7..0, SPI: MISO byte & MOSI byte
+--   39..0:  timestamp (ADC clk, TS_WRAP record is written when it wraps around)
+-- Trig is pulsed for each decoded record (types 1 to 5) for which
+-- record(63 downto 40) and TrigMask match TrigPattern (bits 31..8).
+--
+
+library IEEE;
+use IEEE.STD_LOGIC_1164.ALL;
+use IEEE.NUMERIC_STD.ALL;
+
+Library UNISIM;
+use UNISIM.vcomponents.all;
+
+Library UNIMACRO;
+use UNIMACRO.vcomponents.all;
+
+entity proto_decoder is
+    Port (
+        clk : in std_logic;                             -- ADC clock
+        dataD : in std_logic_vector(11 downto 0);       -- digital inputs (registered)
+        -- 0..2: UART, SPI, I2C enable, 3: UART inverted, 5..4: UART parity (00 none, 01 even, 10 odd),
+        -- 6: UART 7 data bits, 7: SPI CS active high, 8: SPI CPOL, 9: SPI CPHA, 10: SPI LSB first,
+        -- 15..12: UART RX, 19..16: SPI CS, 23..20: SPI SCK, 27..24: SPI MOSI, 31..28: SPI MISO
+        Ctrl : in std_logic_vector(31 downto 0);
+        -- 19..0: UART bit period (ADC clk), 23..20: I2C SCL, 27..24: I2C SDA
+        Ctrl2 : in std_logic_vector(31 downto 0);
+        TrigPattern : in std_logic_vector(31 downto 0);
+        TrigMask : in std_logic_vector(31 downto 0);
+        Trig : out std_logic;
+        -- event fifo (first word fall through)
+        clk_rd : in std_logic;
+        RdEn : in std_logic;
+        RdData : out std_logic_vector(63 downto 0);
+        RdEmpty : out std_logic
+    );
+end proto_decoder;
+
+architecture Behavioral of proto_decoder is
+
+CONSTANT EV_START : std_logic_vector(3 downto 0) := "0001";
+CONSTANT EV_STOP : std_logic_vector(3 downto 0) := "0010";
+CONSTANT EV_ADDRESS : std_logic_vector(3 downto 0) := "0011";
+CONSTANT EV_DATA : std_logic_vector(3 downto 0) := "0100";
+CONSTANT EV_ERROR : std_logic_vector(3 downto 0) := "0101";
+CONSTANT EV_LOST : std_logic_vector(3 downto 0) := "0110";
+CONSTANT EV_TS_WRAP : std_logic_vector(3 downto 0) := "0111";
+
+CONSTANT DEC_UART : std_logic_vector(1 downto 0) := "01";
+CONSTANT DEC_SPI : std_logic_vector(1 downto 0) := "10";
+CONSTANT DEC_I2C : std_logic_vector(1 downto 0) := "11";
+
+CONSTANT I2C_FILTER : integer := 8;     -- I2C spike filter (ADC clk, 32 ns)
+
+-- record without timestamp: type, decoder, flags, data
+subtype ev_t is std_logic_vector(23 downto 0);
+
+signal ctrl_d : std_logic_vector(31 downto 0) := (others => '0');
+signal ctrl2_d : std_logic_vector(31 downto 0) := (others => '0');
+signal trig_pattern_d : std_logic_vector(23 downto 0) := (others => '0');
+signal trig_mask_d : std_logic_vector(23 downto 0) := (others => '0');
+signal din : std_logic_vector(11 downto 0) := (others => '0');
+signal ts : unsigned(39 downto 0) := (others => '0');
+
+-- UART
+signal uart_rx : std_logic := '1';
+signal uart_rx_d : std_logic := '1';
+signal uart_st : integer range 0 to 4 := 0;    -- idle, start bit, data bits, parity bit, stop bit
+signal uart_cnt : unsigned(19 downto 0) := (others => '0');
+signal uart_bit : integer range 0 to 7 := 0;
+signal uart_sr : std_logic_vector(7 downto 0) := (others => '0');
+signal uart_par : std_logic := '0';
+signal uart_ev : ev_t;
+signal uart_ev_v : std_logic := '0';
+
+-- SPI
+signal spi_cs : std_logic := '0';               -- CS is active
+signal spi_cs_d : std_logic := '0';
+signal spi_sck_d : std_logic := '0';
+signal spi_bit : integer range 0 to 7 := 0;
+signal spi_mosi_sr : std_logic_vector(7 downto 0) := (others => '0');
+signal spi_miso_sr : std_logic_vector(7 downto 0) := (others => '0');
+signal spi_ev : ev_t;
+signal spi_ev_v : std_logic := '0';
+
+-- I2C
+signal i2c_scl_cnt : integer range 0 to I2C_FILTER-1 := 0;
+signal i2c_sda_cnt : integer range 0 to I2C_FILTER-1 := 0;
+signal i2c_scl : std_logic := '1';
+signal i2c_sda : std_logic := '1';
+signal i2c_scl_d : std_logic := '1';
+signal i2c_sda_d : std_logic := '1';
+signal i2c_busy : std_logic := '0';             -- between START and STOP
+signal i2c_addr : std_logic := '0';             -- next byte is address
+signal i2c_bit : integer range 0 to 8 := 0;     -- bit 8: ACK
+signal i2c_sr : std_logic_vector(7 downto 0) := (others => '0');
+signal i2c_ev : ev_t;
+signal i2c_ev_v : std_logic := '0';
+
+-- merged records
+signal wrap_v : std_logic := '0';
+signal rec : std_logic_vector(63 downto 0) := (others => '0');
+signal rec_v : std_logic := '0';
+signal lost : std_logic := '0';
+
+-- event fifo
+signal fifo_rst : std_logic := '0';
+signal fifo_rst_cnt : integer range 0 to 31 := 0;
+signal fifo_ready : std_logic := '0';
+signal fifo_ready_d : std_logic := '0';
+signal fifo_ready_dd : std_logic := '0';
+signal fifo_di : std_logic_vector(63 downto 0) := (others => '0');
+signal fifo_wren : std_logic := '0';
+signal fifo_afull : std_logic;
+signal fifo_empty : std_logic;
+signal fifo_rden : std_logic;
+
+attribute ASYNC_REG: boolean;
+attribute ASYNC_REG of fifo_ready_d: signal is true;
+attribute ASYNC_REG of fifo_ready_dd: signal is true;
+
+begin
+
+EVENT_FIFO: FIFO_DUALCLOCK_MACRO
+   generic map (
+      DEVICE => "7SERIES",
+      ALMOST_FULL_OFFSET => X"0010",  -- FULL flag is not updated in the clk of write
+      ALMOST_EMPTY_OFFSET => X"0006",
+      DATA_WIDTH => 64,
+      FIFO_SIZE => "36Kb",
+      FIRST_WORD_FALL_THROUGH => TRUE)
+   port map (
+      ALMOSTEMPTY => open,
+      ALMOSTFULL => fifo_afull,
+      DO => RdData,
+      EMPTY => fifo_empty,
+      FULL => open,
+      RDCOUNT => open,
+      RDERR => open,
+      WRCOUNT => open,
+      WRERR => open,
+      DI => fifo_di,
+      RDCLK => clk_rd,
+      RDEN => fifo_rden,
+      RST => fifo_rst,
+      WRCLK => clk,
+      WREN => fifo_wren
+   );
+
+RdEmpty <= fifo_empty or not(fifo_ready_dd);
+fifo_rden <= RdEn and fifo_ready_dd and not(fifo_empty);
+
+rd_proc: process (clk_rd)
+begin
+    if rising_edge(clk_rd) then
+        fifo_ready_d <= fifo_ready;
+        fifo_ready_dd <= fifo_ready_d;
+    end if;
+end process;
+
+decoder_proc: process (clk)
+    variable v_sck_edge : boolean;
+    variable v_data : std_logic_vector(7 downto 0);
+    variable v_match : boolean;
+begin
+
+    if rising_edge(clk) then
+
+        -- fifo reset after configuration
+        -- RST must be held high for at least five WRCLK/RDCLK clock cycles, WREN/RDEN must be low
+        if fifo_ready = '0' then
+            if fifo_rst_cnt = 31 then
+                fifo_ready <= '1';
+            else
+                fifo_rst_cnt <= fifo_rst_cnt + 1;
+            end if;
+            if fifo_rst_cnt >= 2 and fifo_rst_cnt < 18 then
+                fifo_rst <= '1';
+            else
+                fifo_rst <= '0';
+            end if;
+        end if;
+
+        ctrl_d <= Ctrl;
+        ctrl2_d <= Ctrl2;
+        trig_pattern_d <= TrigPattern(31 downto 8);
+        trig_mask_d <= TrigMask(31 downto 8);
+        din <= dataD;
+        ts <= ts + 1;
+
+        ------------
+        --  UART  --
+        ------------
+        -- samples are taken in the middle of each bit, LSB first
+        uart_rx <= din(to_integer(unsigned(ctrl_d(15 downto 12)))) xor ctrl_d(3);
+        uart_rx_d <= uart_rx;
+        if ctrl_d(0) = '0' then
+            uart_st <= 0;
+        elsif uart_st = 0 then
+            if uart_rx_d = '1' and uart_rx = '0' then
+                uart_cnt <= '0' & unsigned(ctrl2_d(19 downto 1));
+                uart_st <= 1;
+            end if;
+        elsif uart_cnt /= 0 then
+            uart_cnt <= uart_cnt - 1;
+        else
+            uart_cnt <= unsigned(ctrl2_d(19 downto 0)) - 1;
+            case uart_st is
+                when 1 =>   -- middle of start bit
+                    if uart_rx = '0' then
+                        uart_bit <= 0;
+                        uart_par <= ctrl_d(5);  -- odd parity
+                        uart_st <= 2;
+                    else
+                        uart_st <= 0;
+                    end if;
+                when 2 =>
+                    uart_sr <= uart_rx & uart_sr(7 downto 1);
+                    uart_par <= uart_par xor uart_rx;
+                    if (uart_bit = 7) or (uart_bit = 6 and ctrl_d(6) = '1') then
+                        if ctrl_d(5 downto 4) = "00" then
+                            uart_st <= 4;
+                        else
+                            uart_st <= 3;
+                        end if;
+                    else
+                        uart_bit <= uart_bit + 1;
+                    end if;
+                when 3 =>
+                    uart_par <= uart_par xor uart_rx;
+                    uart_st <= 4;
+                when others =>  -- middle of stop bit
+                    if ctrl_d(6) = '1' then
+                        v_data := '0' & uart_sr(7 downto 1);
+                    else
+                        v_data := uart_sr;
+                    end if;
+                    if uart_rx = '1' then
+                        uart_ev <= EV_DATA & DEC_UART & '0' & (uart_par and (ctrl_d(5) or ctrl_d(4))) & X"00" & v_data;
+                    else
+                        -- framing error
+                        uart_ev <= EV_ERROR & DEC_UART & '0' & (uart_par and (ctrl_d(5) or ctrl_d(4))) & X"00" & v_data;
+                    end if;
+                    uart_ev_v <= '1';
+                    uart_st <= 0;
+            end case;
+        end if;
+
+        -----------
+        --  SPI  --
+        -----------
+        spi_cs <= din(to_integer(unsigned(ctrl_d(19 downto 16)))) xnor ctrl_d(7);
+        spi_cs_d <= spi_cs;
+        spi_sck_d <= din(to_integer(unsigned(ctrl_d(23 downto 20))));
+        -- sample edge: rising for modes 0 and 3, falling for modes 1 and 2
+        if (ctrl_d(8) xor ctrl_d(9)) = '0' then
+            v_sck_edge := spi_sck_d = '0' and din(to_integer(unsigned(ctrl_d(23 downto 20)))) = '1';
+        else
+            v_sck_edge := spi_sck_d = '1' and din(to_integer(unsigned(ctrl_d(23 downto 20)))) = '0';
+        end if;
+        if ctrl_d(1) = '0' then
+            spi_bit <= 0;
+        elsif spi_cs = '1' and spi_cs_d = '0' then
+            spi_bit <= 0;
+            spi_ev <= EV_START & DEC_SPI & "00" & X"0000";
+            spi_ev_v <= '1';
+        elsif spi_cs = '0' and spi_cs_d = '1' then
+            if spi_bit = 0 then
+                spi_ev <= EV_STOP & DEC_SPI & "00" & X"0000";
+            else
+                spi_ev <= EV_STOP & DEC_SPI & "01" & spi_miso_sr & spi_mosi_sr;
+            end if;
+            spi_ev_v <= '1';
+        elsif spi_cs = '1' and v_sck_edge then
+            if ctrl_d(10) = '1' then
+                spi_mosi_sr <= din(to_integer(unsigned(ctrl_d(27 downto 24)))) & spi_mosi_sr(7 downto 1);
+                spi_miso_sr <= din(to_integer(unsigned(ctrl_d(31 downto 28)))) & spi_miso_sr(7 downto 1);
+            else
+                spi_mosi_sr <= spi_mosi_sr(6 downto 0) & din(to_integer(unsigned(ctrl_d(27 downto 24))));
+                spi_miso_sr <= spi_miso_sr(6 downto 0) & din(to_integer(unsigned(ctrl_d(31 downto 28))));
+            end if;
+            if spi_bit = 7 then
+                spi_bit <= 0;
+                if ctrl_d(10) = '1' then
+                    spi_ev <= EV_DATA & DEC_SPI & "00" & din(to_integer(unsigned(ctrl_d(31 downto 28)))) & spi_miso_sr(7 downto 1)
+                                                      & din(to_integer(unsigned(ctrl_d(27 downto 24)))) & spi_mosi_sr(7 downto 1);
+                else
+                    spi_ev <= EV_DATA & DEC_SPI & "00" & spi_miso_sr(6 downto 0) & din(to_integer(unsigned(ctrl_d(31 downto 28))))
+                                                      & spi_mosi_sr(6 downto 0) & din(to_integer(unsigned(ctrl_d(27 downto 24))));
+                end if;
+                spi_ev_v <= '1';
+            else
+                spi_bit <= spi_bit + 1;
+            end if;
+        end if;
+
+        -----------
+        --  I2C  --
+        -----------
+        -- spike filter: new level is taken when it is stable for I2C_FILTER clk
+        if din(to_integer(unsigned(ctrl2_d(23 downto 20)))) = i2c_scl then
+            i2c_scl_cnt <= 0;
+        elsif i2c_scl_cnt = I2C_FILTER-1 then
+            i2c_scl <= not(i2c_scl);
+            i2c_scl_cnt <= 0;
+        else
+            i2c_scl_cnt <= i2c_scl_cnt + 1;
+        end if;
+        if din(to_integer(unsigned(ctrl2_d(27 downto 24)))) = i2c_sda then
+            i2c_sda_cnt <= 0;
+        elsif i2c_sda_cnt = I2C_FILTER-1 then
+            i2c_sda <= not(i2c_sda);
+            i2c_sda_cnt <= 0;
+        else
+            i2c_sda_cnt <= i2c_sda_cnt + 1;
+        end if;
+        i2c_scl_d <= i2c_scl;
+        i2c_sda_d <= i2c_sda;
+        if ctrl_d(2) = '0' then
+            i2c_busy <= '0';
+        elsif i2c_scl = '1' and i2c_scl_d = '1' and i2c_sda = '0' and i2c_sda_d = '1' then
+            -- START (repeated START when bus is busy)
+            if i2c_bit = 0 then
+                i2c_ev <= EV_START & DEC_I2C & '0' & i2c_busy & X"0000";
+            else
+                i2c_ev <= EV_START & DEC_I2C & '1' & i2c_busy & X"00" & i2c_sr;
+            end if;
+            i2c_ev_v <= '1';
+            i2c_busy <= '1';
+            i2c_addr <= '1';
+            i2c_bit <= 0;
+        elsif i2c_scl = '1' and i2c_scl_d = '1' and i2c_sda = '1' and i2c_sda_d = '0' then
+            -- STOP
+            if i2c_bit = 0 then
+                i2c_ev <= EV_STOP & DEC_I2C & "00" & X"0000";
+            else
+                i2c_ev <= EV_STOP & DEC_I2C & "10" & X"00" & i2c_sr;
+            end if;
+            i2c_ev_v <= '1';
+            i2c_busy <= '0';
+            i2c_bit <= 0;
+        elsif i2c_busy = '1' and i2c_scl = '1' and i2c_scl_d = '0' then
+            -- data is sampled on SCL rising edge, MSB first, 9th bit is ACK (low) or NAK
+            if i2c_bit = 8 then
+                if i2c_addr = '1' then
+                    i2c_ev <= EV_ADDRESS & DEC_I2C & '0' & i2c_sda & X"00" & i2c_sr;
+                else
+                    i2c_ev <= EV_DATA & DEC_I2C & '0' & i2c_sda & X"00" & i2c_sr;
+                end if;
+                i2c_ev_v <= '1';
+                i2c_addr <= '0';
+                i2c_bit <= 0;
+            else
+                i2c_sr <= i2c_sr(6 downto 0) & i2c_sda;
+                i2c_bit <= i2c_bit + 1;
+            end if;
+        end if;
+
+        ---------------
+        --  RECORDS  --
+        ---------------
+        -- one record per clk (decoders produce records many clk apart)
+        if ts = X"FFFFFFFFFF" then
+            wrap_v <= '1';
+        end if;
+        rec_v <= '0';
+        if uart_ev_v = '1' then
+            rec <= uart_ev & std_logic_vector(ts);
+            rec_v <= '1';
+            uart_ev_v <= '0';
+        elsif spi_ev_v = '1' then
+            rec <= spi_ev & std_logic_vector(ts);
+            rec_v <= '1';
+            spi_ev_v <= '0';
+        elsif i2c_ev_v = '1' then
+            rec <= i2c_ev & std_logic_vector(ts);
+            rec_v <= '1';
+            i2c_ev_v <= '0';
+        elsif wrap_v = '1' then
+            rec <= EV_TS_WRAP & "0000" & X"0000" & std_logic_vector(ts);
+            rec_v <= '1';
+            wrap_v <= '0';
+        end if;
+
+        -- decoded content trigger
+        v_match := ((rec(63 downto 40) xor trig_pattern_d) and trig_mask_d) = X"000000";
+        if rec_v = '1' and v_match and rec(63 downto 60) /= EV_TS_WRAP then
+            Trig <= '1';
+        else
+            Trig <= '0';
+        end if;
+
+        -- records which do not fit into fifo are dropped, LOST record is written when there is space again
+        fifo_wren <= '0';
+        if rec_v = '1' and ctrl_d(2 downto 0) /= "000" and fifo_ready = '1' then
+            if fifo_afull = '0' and lost = '0' then
+                fifo_di <= rec;
+                fifo_wren <= '1';
+            else
+                lost <= '1';
+            end if;
+        elsif fifo_ready = '1' and fifo_afull = '0' and lost = '1' then
+            fifo_di <= EV_LOST & "0000" & X"0000" & std_logic_vector(ts);
+            fifo_wren <= '1';
+            lost <= '0';
+        end if;
+
+    end if;
+
+end process;
+
+end Behavioral;
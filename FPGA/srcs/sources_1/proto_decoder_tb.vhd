@@ -0,0 +1,239 @@
+----------------------------------------------------------------------------------
+--    Copyright (C) 2019 Dejan Priversek
+--
+--    This program is free software: you can redistribute it and/or modify
+--    it under the terms of the GNU General Public License as published by
+--    the Free Software Foundation, either version 3 of the License, or
+--    (at your option) any later version.
+--
+--    This program is distributed in the hope that it will be useful,
+--    but WITHOUT ANY WARRANTY; without even the implied warranty of
+--    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+--    GNU General Public License for more details.
+--
+--    You should have received a copy of the GNU General Public License
+--    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+----------------------------------------------------------------------------------
+
+--
+-- protocol decoder testbench
+-- UART byte (even parity), SPI transfer (mode 0) and I2C write (address + data, NAK)
+-- are sent one after another, event records read from fifo are compared (without timestamp),
+-- decoded content trigger is set to SPI MOSI byte
+--
+
+LIBRARY IEEE;
+USE IEEE.STD_LOGIC_1164.ALL;
+USE IEEE.NUMERIC_STD.ALL;
+
+library user_lib;
+use user_lib.TextUtil.all;
+
+ENTITY proto_decoder_tb IS
+END proto_decoder_tb;
+
+ARCHITECTURE behavior OF proto_decoder_tb IS
+
+    -- Component Declaration for the Unit Under Test (UUT)
+
+    component proto_decoder is
+    Port (
+        clk : in std_logic;
+        dataD : in std_logic_vector(11 downto 0);
+        Ctrl : in std_logic_vector(31 downto 0);
+        Ctrl2 : in std_logic_vector(31 downto 0);
+        TrigPattern : in std_logic_vector(31 downto 0);
+        TrigMask : in std_logic_vector(31 downto 0);
+        Trig : out std_logic;
+        clk_rd : in std_logic;
+        RdEn : in std_logic;
+        RdData : out std_logic_vector(63 downto 0);
+        RdEmpty : out std_logic
+    );
+    end component;
+
+    --constants
+    CONSTANT UART_PERIOD : integer := 40;   -- ADC clk per bit
+    CONSTANT RX : integer := 0;             -- UART RX line
+    CONSTANT CS : integer := 1;             -- SPI lines
+    CONSTANT SCK : integer := 2;
+    CONSTANT MOSI : integer := 3;
+    CONSTANT MISO : integer := 4;
+    CONSTANT SCL : integer := 5;            -- I2C lines
+    CONSTANT SDA : integer := 6;
+    CONSTANT N_REC : integer := 8;
+
+    -- expected records (type, decoder, flags, data)
+    type rec_array is array(0 to N_REC-1) of std_logic_vector(23 downto 0);
+
+    --Inputs
+    signal clk : std_logic := '0';
+    signal clk_rd : std_logic := '0';
+    signal dataD : std_logic_vector(11 downto 0) := (RX => '1', CS => '1', SCL => '1', SDA => '1', others => '0');
+    signal RdEn : std_logic := '0';
+
+    --Outputs
+    signal Trig : std_logic;
+    signal RdData : std_logic_vector(63 downto 0);
+    signal RdEmpty : std_logic;
+
+    signal trig_cnt : integer := 0;
+
+    signal sim_done : boolean := false;
+
+    -- Clock period definitions
+    constant clk_period : time := 4 ns;
+    constant clk_rd_period : time := 10 ns;
+
+BEGIN
+
+    -- Instantiate the Unit Under Test (UUT)
+    uut: proto_decoder
+    PORT MAP (
+        clk => clk,
+        dataD => dataD,
+        -- UART, SPI, I2C enabled, even parity, SPI mode 0, MSB first
+        Ctrl => std_logic_vector(to_unsigned(MISO,4)) & std_logic_vector(to_unsigned(MOSI,4)) &
+                std_logic_vector(to_unsigned(SCK,4)) & std_logic_vector(to_unsigned(CS,4)) &
+                std_logic_vector(to_unsigned(RX,4)) & "00000" & "001" & "0" & "111",
+        Ctrl2 => X"0" & std_logic_vector(to_unsigned(SDA,4)) & std_logic_vector(to_unsigned(SCL,4)) &
+                 std_logic_vector(to_unsigned(UART_PERIOD,20)),
+        TrigPattern => X"48" & X"00A5" & X"00",     -- SPI DATA, MOSI 0xA5
+        TrigMask => X"FC" & X"00FF" & X"00",
+        Trig => Trig,
+        clk_rd => clk_rd,
+        RdEn => RdEn,
+        RdData => RdData,
+        RdEmpty => RdEmpty
+    );
+
+    -- Clock process definitions
+    clk_process :process
+    begin
+        if sim_done then
+            wait;
+        end if;
+        clk <= '0';
+        wait for clk_period/2;
+        clk <= '1';
+        wait for clk_period/2;
+    end process;
+
+    clk_rd_process :process
+    begin
+        if sim_done then
+            wait;
+        end if;
+        clk_rd <= '0';
+        wait for clk_rd_period/2;
+        clk_rd <= '1';
+        wait for clk_rd_period/2;
+    end process;
+
+    trig_proc: process(clk)
+    begin
+        if rising_edge(clk) then
+            if Trig = '1' then
+                trig_cnt <= trig_cnt + 1;
+            end if;
+        end if;
+    end process;
+
+    -- Stimulus process
+    stim_proc: process
+
+        procedure uart_send(b : std_logic_vector(7 downto 0)) is
+            variable bits : std_logic_vector(10 downto 0);
+        begin
+            -- stop, parity (even), data LSB first, start
+            bits := '1' & (b(0) xor b(1) xor b(2) xor b(3) xor b(4) xor b(5) xor b(6) xor b(7)) & b & '0';
+            for i in 0 to 10 loop
+                dataD(RX) <= bits(i);
+                wait for clk_period * UART_PERIOD;
+            end loop;
+        end procedure;
+
+        procedure spi_send(mo : std_logic_vector(7 downto 0); mi : std_logic_vector(7 downto 0)) is
+        begin
+            dataD(CS) <= '0';
+            wait for 40 ns;
+            for i in 7 downto 0 loop
+                dataD(MOSI) <= mo(i);
+                dataD(MISO) <= mi(i);
+                wait for 20 ns;
+                dataD(SCK) <= '1';
+                wait for 20 ns;
+                dataD(SCK) <= '0';
+            end loop;
+            wait for 40 ns;
+            dataD(CS) <= '1';
+        end procedure;
+
+        procedure i2c_byte(b : std_logic_vector(7 downto 0); ack : std_logic) is
+            variable bits : std_logic_vector(8 downto 0);
+        begin
+            bits := b & ack;
+            for i in 8 downto 0 loop
+                dataD(SDA) <= bits(i);
+                wait for 200 ns;
+                dataD(SCL) <= '1';
+                wait for 200 ns;
+                dataD(SCL) <= '0';
+                wait for 50 ns;
+            end loop;
+        end procedure;
+
+        variable errors : integer := 0;
+        variable n : integer := 0;
+        variable expected_rec : rec_array;
+    begin
+        expected_rec(0) := "0100" & "01" & "00" & X"00" & X"5A";    -- UART DATA
+        expected_rec(1) := "0001" & "10" & "00" & X"0000";          -- SPI START
+        expected_rec(2) := "0100" & "10" & "00" & X"3C" & X"A5";    -- SPI DATA (MISO, MOSI)
+        expected_rec(3) := "0010" & "10" & "00" & X"0000";          -- SPI STOP
+        expected_rec(4) := "0001" & "11" & "00" & X"0000";          -- I2C START
+        expected_rec(5) := "0011" & "11" & "00" & X"00" & X"A0";    -- I2C ADDRESS, ACK
+        expected_rec(6) := "0100" & "11" & "01" & X"00" & X"17";    -- I2C DATA, NAK
+        expected_rec(7) := "0010" & "11" & "00" & X"0000";          -- I2C STOP
+
+        -- wait for event fifo reset
+        wait for 1 us;
+        uart_send(X"5A");
+        wait for 200 ns;
+        spi_send(X"A5", X"3C");
+        wait for 200 ns;
+        -- I2C START, address, data, STOP
+        dataD(SDA) <= '0';
+        wait for 200 ns;
+        dataD(SCL) <= '0';
+        i2c_byte(X"A0", '0');
+        i2c_byte(X"17", '1');
+        dataD(SDA) <= '0';
+        wait for 200 ns;
+        dataD(SCL) <= '1';
+        wait for 200 ns;
+        dataD(SDA) <= '1';
+        wait for 1 us;
+
+        -- read event records
+        wait until rising_edge(clk_rd);
+        while RdEmpty = '0' loop
+            if n < N_REC then
+                Check(RdData(63 downto 40) = expected_rec(n),
+                      "record " & integer'image(n) & ": " & integer'image(to_integer(unsigned(RdData(63 downto 40)))) &
+                          ", expected " & integer'image(to_integer(unsigned(expected_rec(n)))), errors);
+            end if;
+            n := n + 1;
+            RdEn <= '1';
+            wait until rising_edge(clk_rd);
+            RdEn <= '0';
+            wait until rising_edge(clk_rd);
+        end loop;
+        Check(n = N_REC, "number of records: " & integer'image(n), errors);
+        Check(trig_cnt = 1, "number of triggers: " & integer'image(trig_cnt), errors);
+
+        EndTest("protocol decoder", errors, sim_done);
+        wait;
+    end process;
+
+END;
@@ -0,0 +1,174 @@
+----------------------------------------------------------------------------------
+--    Copyright (C) 2019 Dejan Priversek
+--
+--    This program is free software: you can redistribute it and/or modify
+--    it under the terms of the GNU General Public License as published by
+--    the Free Software Foundation, either version 3 of the License, or
+--    (at your option) any later version.
+--
+--    This program is distributed in the hope that it will be useful,
+--    but WITHOUT ANY WARRANTY; without even the implied warranty of
+--    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+--    GNU General Public License for more details.
+--
+--    You should have received a copy of the GNU General Public License
+--    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+----------------------------------------------------------------------------------
+
+--
+-- Scopefun firmware: SPI write queue
+--
+-- Words written with Wr are queued (FIFO) and sent to SPI interface one after another
+-- by its own sequencer, writer does not have to wait until SPI is finished.
+-- Idle is asserted when queue is empty, last word was sent and SETTLE_CYCLES clocks
+-- have passed after it (e.g. for DAC output to settle).
+--
+
+library IEEE;
+use IEEE.STD_LOGIC_1164.ALL;
+use IEEE.NUMERIC_STD.ALL;
+
+entity spi_queue is
+    generic (
+        SPI_LENGTH : integer;         -- number of bits transfered
+        DEPTH : integer := 8;         -- queue size (words)
+        SETTLE_CYCLES : integer := 0  -- wait after last word before Idle is asserted
+    );
+    Port (
+        clk : in std_logic;
+        clk_divide : in std_logic_vector (4 downto 0);  -- SPI input clock divide (0 to 31)
+        sck_idle_value : in std_logic;                  -- value of sck when not sending bytes
+        Wr : in std_logic;                              -- queue WrData (one word each clk)
+        WrData : in std_logic_vector (SPI_LENGTH-1 downto 0);
+        Full : out std_logic;                           -- queue is full, Wr is ignored
+        Idle : out std_logic;                           -- all queued words were sent
+        DoneCnt : out std_logic_vector (7 downto 0);    -- number of sent words (wraps around)
+        cs : out std_logic;                             -- SPI out signal CS#
+        sck : out std_logic;                            -- SPI out signal SCK
+        si : out std_logic                              -- SPI out signal SI
+    );
+end spi_queue;
+
+architecture Behavioral of spi_queue is
+
+component spi is
+    generic (
+        SPI_LENGTH : integer
+    );
+    Port ( clk : in  std_logic;
+           rst : in std_logic;
+           clk_divide : in std_logic_vector (4 downto 0);
+           spi_data : in  std_logic_vector (SPI_LENGTH-1 downto 0);
+           spi_write_trig : in std_logic;
+           sck_idle_value : in std_logic;
+           spi_busy : out std_logic;
+           cs : out  std_logic;
+           sck : out  std_logic;
+           si : out  std_logic
+      );
+end component;
+
+CONSTANT Q_A: STD_LOGIC_VECTOR (1 downto 0) := "00";
+CONSTANT Q_B: STD_LOGIC_VECTOR (1 downto 0) := "01";
+CONSTANT Q_C: STD_LOGIC_VECTOR (1 downto 0) := "10";
+
+type queue_array is array(0 to DEPTH-1) of std_logic_vector(SPI_LENGTH-1 downto 0);
+signal queue : queue_array;
+signal wr_ptr : integer range 0 to DEPTH-1 := 0;
+signal rd_ptr : integer range 0 to DEPTH-1 := 0;
+signal q_cnt : integer range 0 to DEPTH := 0;
+
+signal q_state : std_logic_vector (1 downto 0) := Q_A;
+signal spi_data : std_logic_vector (SPI_LENGTH-1 downto 0) := (others => '0');
+signal spi_write_trig : std_logic := '0';
+signal spi_busy : std_logic;
+signal settle_cnt : integer range 0 to SETTLE_CYCLES := 0;
+signal done_cnt : unsigned (7 downto 0) := (others => '0');
+
+attribute mark_debug: boolean;
+attribute mark_debug of q_state : signal is true;
+attribute mark_debug of q_cnt : signal is true;
+
+begin
+
+Full <= '1' when q_cnt = DEPTH else '0';
+Idle <= '1' when q_cnt = 0 and q_state = Q_A and settle_cnt = 0 else '0';
+DoneCnt <= std_logic_vector(done_cnt);
+
+spi_interface: spi
+generic map (SPI_LENGTH => SPI_LENGTH)
+port map (
+        clk => clk,
+        rst => '0',
+        clk_divide => clk_divide,
+        spi_data => spi_data,
+        spi_write_trig => spi_write_trig,
+        sck_idle_value => sck_idle_value,
+        spi_busy => spi_busy,
+        cs => cs,
+        sck => sck,
+        si => si
+        );
+
+queue_proc: process(clk)
+    variable v_push, v_pop : boolean;
+begin
+
+    if rising_edge(clk) then
+
+        v_push := Wr = '1' and q_cnt /= DEPTH;
+        v_pop := false;
+
+        if v_push then
+            queue(wr_ptr) <= WrData;
+            if wr_ptr = DEPTH-1 then
+                wr_ptr <= 0;
+            else
+                wr_ptr <= wr_ptr + 1;
+            end if;
+        end if;
+
+        case q_state is
+
+            when Q_A =>     -- "IDLE": take next word from queue
+                spi_write_trig <= '0';
+                if q_cnt /= 0 then
+                    spi_data <= queue(rd_ptr);
+                    v_pop := true;
+                    if rd_ptr = DEPTH-1 then
+                        rd_ptr <= 0;
+                    else
+                        rd_ptr <= rd_ptr + 1;
+                    end if;
+                    q_state <= Q_B;
+                elsif settle_cnt /= 0 then
+                    settle_cnt <= settle_cnt - 1;
+                end if;
+
+            when Q_B =>     -- "START SPI WRITE"
+                if spi_busy = '0' then
+                    spi_write_trig <= '1';
+                    q_state <= Q_C;
+                end if;
+
+            when others =>  -- "WAIT UNTIL SPI WRITE IS FINISHED"
+                spi_write_trig <= '0';
+                if spi_busy = '0' and spi_write_trig = '0' then
+                    done_cnt <= done_cnt + 1;
+                    settle_cnt <= SETTLE_CYCLES;
+                    q_state <= Q_A;
+                end if;
+
+        end case;
+
+        if v_push and not v_pop then
+            q_cnt <= q_cnt + 1;
+        elsif v_pop and not v_push then
+            q_cnt <= q_cnt - 1;
+        end if;
+
+    end if;
+
+end process;
+
+end Behavioral;
@@ -0,0 +1,158 @@
+----------------------------------------------------------------------------------
+--    Copyright (C) 2019 Dejan Priversek
+--
+--    This program is free software: you can redistribute it and/or modify
+--    it under the terms of the GNU General Public License as published by
+--    the Free Software Foundation, either version 3 of the License, or
+--    (at your option) any later version.
+--
+--    This program is distributed in the hope that it will be useful,
+--    but WITHOUT ANY WARRANTY; without even the implied warranty of
+--    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+--    GNU General Public License for more details.
+--
+--    You should have received a copy of the GNU General Public License
+--    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+----------------------------------------------------------------------------------
+
+--
+-- SPI write queue testbench
+-- a burst of words is written in consecutive clocks, words received on SPI are compared
+--
+
+LIBRARY IEEE;
+USE IEEE.STD_LOGIC_1164.ALL;
+USE IEEE.NUMERIC_STD.ALL;
+
+library user_lib;
+use user_lib.TextUtil.all;
+
+ENTITY spi_queue_tb IS
+END spi_queue_tb;
+
+ARCHITECTURE behavior OF spi_queue_tb IS
+
+    -- Component Declaration for the Unit Under Test (UUT)
+
+    component spi_queue is
+    generic (
+        SPI_LENGTH : integer;
+        DEPTH : integer;
+        SETTLE_CYCLES : integer
+    );
+    Port (
+        clk : in std_logic;
+        clk_divide : in std_logic_vector (4 downto 0);
+        sck_idle_value : in std_logic;
+        Wr : in std_logic;
+        WrData : in std_logic_vector (SPI_LENGTH-1 downto 0);
+        Full : out std_logic;
+        Idle : out std_logic;
+        DoneCnt : out std_logic_vector (7 downto 0);
+        cs : out std_logic;
+        sck : out std_logic;
+        si : out std_logic
+    );
+    end component;
+
+    --constants
+    CONSTANT N_WORDS : integer := 6;
+    type word_array is array(0 to N_WORDS-1) of std_logic_vector(15 downto 0);
+    CONSTANT WORDS : word_array := (X"F123", X"B456", X"3789", X"7ABC", X"8001", X"0FF0");
+
+    --Inputs
+    signal clk : std_logic := '0';
+    signal Wr : std_logic := '0';
+    signal WrData : std_logic_vector(15 downto 0) := (others => '0');
+
+    --Outputs
+    signal Full : std_logic;
+    signal Idle : std_logic;
+    signal DoneCnt : std_logic_vector(7 downto 0);
+    signal cs : std_logic;
+    signal sck : std_logic;
+    signal si : std_logic;
+
+    signal rx_word : std_logic_vector(15 downto 0) := (others => '0');
+    signal rx_cnt : integer := 0;
+    signal rx_errors : integer := 0;
+
+    signal sim_done : boolean := false;
+
+    -- Clock period definitions
+    constant clk_period : time := 10 ns;
+
+BEGIN
+
+    -- Instantiate the Unit Under Test (UUT)
+    uut: spi_queue
+    GENERIC MAP (SPI_LENGTH => 16, DEPTH => 4, SETTLE_CYCLES => 20)
+    PORT MAP (
+        clk => clk,
+        clk_divide => "00001",
+        sck_idle_value => '1',
+        Wr => Wr,
+        WrData => WrData,
+        Full => Full,
+        Idle => Idle,
+        DoneCnt => DoneCnt,
+        cs => cs,
+        sck => sck,
+        si => si
+    );
+
+    -- Clock process definitions
+    clk_process :process
+    begin
+        if sim_done then
+            wait;
+        end if;
+        clk <= '0';
+        wait for clk_period/2;
+        clk <= '1';
+        wait for clk_period/2;
+    end process;
+
+    -- Stimulus process
+    stim_proc: process
+        variable i : integer := 0;
+        variable errors : integer := 0;
+    begin
+        wait for 100 ns;
+        wait until rising_edge(clk);
+        -- write all words in consecutive clocks (wait only if queue is full)
+        while i < N_WORDS loop
+            WrData <= WORDS(i);
+            Wr <= '1';
+            wait until rising_edge(clk);
+            if Full = '0' then
+                i := i + 1;
+            end if;
+        end loop;
+        Wr <= '0';
+        wait until rising_edge(clk);
+        assert Idle = '0' report "queue is idle while words are pending" severity failure;
+        wait until Idle = '1';
+        Check(rx_cnt = N_WORDS and to_integer(unsigned(DoneCnt)) = N_WORDS,
+              "received " & integer'image(rx_cnt) & " words, DoneCnt " & integer'image(to_integer(unsigned(DoneCnt))), errors);
+        wait until rising_edge(clk);
+        EndTest("SPI queue", errors + rx_errors, sim_done);
+        wait;
+    end process;
+
+    -- shift in SPI data on rising SCK, compare word when CS# goes high
+    rx_proc: process(sck, cs)
+    begin
+        if rising_edge(sck) and cs = '0' then
+            rx_word <= rx_word(14 downto 0) & si;
+        end if;
+        if rising_edge(cs) then
+            if rx_word /= WORDS(rx_cnt) then
+                Print("word " & integer'image(rx_cnt) & " mismatch");
+                rx_errors <= rx_errors + 1;
+            end if;
+            rx_cnt <= rx_cnt + 1;
+        end if;
+    end process;
+
+END;
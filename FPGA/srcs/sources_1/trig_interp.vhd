@@ -0,0 +1,109 @@
+----------------------------------------------------------------------------------
+--    Copyright (C) 2019 Dejan Priversek
+--
+--    This program is free software: you can redistribute it and/or modify
+--    it under the terms of the GNU General Public License as published by
+--    the Free Software Foundation, either version 3 of the License, or
+--    (at your option) any later version.
+--
+--    This program is distributed in the hope that it will be useful,
+--    but WITHOUT ANY WARRANTY; without even the implied warranty of
+--    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+--    GNU General Public License for more details.
+--
+--    You should have received a copy of the GNU General Public License
+--    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+----------------------------------------------------------------------------------
+
+--
+-- Scopefun firmware: sub-sample trigger interpolation
+--
+-- Linear interpolation of trigger level crossing between two samples:
+--   Frac = |Level - Sample0| / |Sample1 - Sample0|  (unsigned 0.16 fixed point, saturated to X"FFFF")
+-- Division is done as multiplication with reciprocal from ROM (DSP48), result is valid 4 clk after Start
+--
+
+library IEEE;
+use IEEE.STD_LOGIC_1164.ALL;
+use IEEE.NUMERIC_STD.ALL;
+
+entity trig_interp is
+    Port (
+        clk : in std_logic;
+        Start : in std_logic;
+        Sample0 : in std_logic_vector(9 downto 0);   -- last sample before crossing (signed)
+        Sample1 : in std_logic_vector(9 downto 0);   -- first sample after crossing (signed)
+        Level : in std_logic_vector(10 downto 0);    -- crossed level (signed)
+        Frac : out std_logic_vector(15 downto 0);    -- crossing position after Sample0 (fraction of sample period)
+        FracValid : out std_logic
+    );
+end trig_interp;
+
+architecture Behavioral of trig_interp is
+
+-- reciprocal: round(2^26/d) (10 extra bits keep rounding error below 1 LSB of result)
+type recip_rom_t is array(0 to 2047) of unsigned(26 downto 0);
+
+function recip_rom_init return recip_rom_t is
+    variable r : recip_rom_t;
+begin
+    r(0) := (others => '1');
+    for d in 1 to 2047 loop
+        r(d) := to_unsigned((2**26 + d/2)/d,27);
+    end loop;
+    return r;
+end function;
+
+CONSTANT RECIP_ROM : recip_rom_t := recip_rom_init;
+
+signal num_1 : unsigned(10 downto 0);
+signal den_1 : unsigned(10 downto 0);
+signal num_2 : unsigned(10 downto 0);
+signal recip_2 : unsigned(26 downto 0);
+signal prod_3 : unsigned(37 downto 0);
+signal valid_sr : std_logic_vector(1 to 3) := (others => '0');
+
+attribute use_dsp : string;
+attribute use_dsp of prod_3 : signal is "yes";
+attribute rom_style : string;
+attribute rom_style of recip_2 : signal is "block";
+
+begin
+
+interp_proc: process(clk)
+    variable n, d : signed(11 downto 0);
+    variable n_abs, d_abs : signed(11 downto 0);
+begin
+
+    if rising_edge(clk) then
+
+        -- stage 1: distance of level and next sample from the last sample before crossing
+        n := resize(signed(Level),12) - resize(signed(Sample0),12);
+        d := resize(signed(Sample1),12) - resize(signed(Sample0),12);
+        n_abs := abs(n);
+        d_abs := abs(d);
+        num_1 <= unsigned(n_abs(10 downto 0));
+        den_1 <= unsigned(d_abs(10 downto 0));
+
+        -- stage 2: reciprocal of sample difference
+        num_2 <= num_1;
+        recip_2 <= RECIP_ROM(to_integer(den_1));
+
+        -- stage 3: multiply
+        prod_3 <= num_2 * recip_2;
+
+        -- stage 4: saturate (level exactly at next sample)
+        if prod_3(37 downto 26) /= 0 then
+            Frac <= X"FFFF";
+        else
+            Frac <= std_logic_vector(prod_3(25 downto 10));
+        end if;
+
+        valid_sr <= Start & valid_sr(1 to 2);
+        FracValid <= valid_sr(3);
+
+    end if;
+
+end process;
+
+end Behavioral;
@@ -0,0 +1,136 @@
+----------------------------------------------------------------------------------
+--    Copyright (C) 2019 Dejan Priversek
+--
+--    This program is free software: you can redistribute it and/or modify
+--    it under the terms of the GNU General Public License as published by
+--    the Free Software Foundation, either version 3 of the License, or
+--    (at your option) any later version.
+--
+--    This program is distributed in the hope that it will be useful,
+--    but WITHOUT ANY WARRANTY; without even the implied warranty of
+--    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+--    GNU General Public License for more details.
+--
+--    You should have received a copy of the GNU General Public License
+--    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+----------------------------------------------------------------------------------
+
+--
+-- trigger interpolation testbench
+-- result is compared to exact fraction (max. error 2 LSB of 0.16 fixed point)
+--
+
+LIBRARY IEEE;
+USE IEEE.STD_LOGIC_1164.ALL;
+USE IEEE.NUMERIC_STD.ALL;
+USE IEEE.MATH_REAL.ALL;
+
+library user_lib;
+use user_lib.TextUtil.all;
+
+ENTITY trig_interp_tb IS
+END trig_interp_tb;
+
+ARCHITECTURE behavior OF trig_interp_tb IS
+
+    -- Component Declaration for the Unit Under Test (UUT)
+
+    component trig_interp is
+    Port ( clk : in std_logic;
+           Start : in std_logic;
+           Sample0 : in std_logic_vector(9 downto 0);
+           Sample1 : in std_logic_vector(9 downto 0);
+           Level : in std_logic_vector(10 downto 0);
+           Frac : out std_logic_vector(15 downto 0);
+           FracValid : out std_logic
+           );
+    end component;
+
+    --Inputs
+    signal clk : std_logic := '0';
+    signal Start : std_logic := '0';
+    signal Sample0 : std_logic_vector(9 downto 0) := (others => '0');
+    signal Sample1 : std_logic_vector(9 downto 0) := (others => '0');
+    signal Level : std_logic_vector(10 downto 0) := (others => '0');
+
+    --Outputs
+    signal Frac : std_logic_vector(15 downto 0);
+    signal FracValid : std_logic;
+
+    signal sim_done : boolean := false;
+
+    -- Clock period definitions
+    constant clk_period : time := 4 ns;
+
+BEGIN
+
+    -- Instantiate the Unit Under Test (UUT)
+    uut: trig_interp
+    PORT MAP (
+        clk => clk,
+        Start => Start,
+        Sample0 => Sample0,
+        Sample1 => Sample1,
+        Level => Level,
+        Frac => Frac,
+        FracValid => FracValid
+    );
+
+    -- Clock process definitions
+    clk_process :process
+    begin
+        if sim_done then
+            wait;
+        end if;
+        clk <= '0';
+        wait for clk_period/2;
+        clk <= '1';
+        wait for clk_period/2;
+    end process;
+
+    -- Stimulus process
+    stim_proc: process
+        variable seed1 : positive := 3;
+        variable seed2 : positive := 5;
+        variable r : real;
+        variable s0, s1, lvl : integer;
+        variable expected : real;
+        variable errors : integer := 0;
+    begin
+        wait until rising_edge(clk);
+        for i in 0 to 999 loop
+            -- random rising or falling crossing
+            uniform(seed1, seed2, r);
+            s0 := integer(r*1000.0) - 500;
+            uniform(seed1, seed2, r);
+            s1 := integer(r*1000.0) - 500;
+            if s1 = s0 then
+                s1 := s0 + 1;
+            end if;
+            uniform(seed1, seed2, r);
+            if s1 > s0 then
+                lvl := s0 + 1 + integer(r*real(s1-s0-1));
+            else
+                lvl := s0 - 1 - integer(r*real(s0-s1-1));
+            end if;
+            expected := real(abs(lvl-s0))/real(abs(s1-s0))*65536.0;
+            if expected > 65535.0 then
+                expected := 65535.0;
+            end if;
+            Sample0 <= std_logic_vector(to_signed(s0,10));
+            Sample1 <= std_logic_vector(to_signed(s1,10));
+            Level <= std_logic_vector(to_signed(lvl,11));
+            Start <= '1';
+            wait until rising_edge(clk);
+            Start <= '0';
+            wait until FracValid = '1';
+            Check(abs(real(to_integer(unsigned(Frac))) - expected) <= 2.0,
+                  "s0 " & integer'image(s0) & ", s1 " & integer'image(s1) & ", level " & integer'image(lvl) &
+                      ": " & integer'image(to_integer(unsigned(Frac))) & ", expected " & integer'image(integer(expected)), errors);
+            wait until rising_edge(clk);
+        end loop;
+        EndTest("trigger interpolation", errors, sim_done);
+        wait;
+    end process;
+
+END;